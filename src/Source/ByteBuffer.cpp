@@ -0,0 +1,324 @@
+// ----------------------------------------------------------------------------
+//
+// ByteBuffer.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "ByteBuffer.h"
+#include <cstring>
+#include <new>
+extern "C"
+{
+#	include "lua.h"
+#	include "lauxlib.h"
+}
+
+
+//---------------------------------------------------------------------------------
+// Private Static Functions
+//---------------------------------------------------------------------------------
+
+/** Reads a little-endian 16-bit unsigned integer from the given bytes. */
+static uint16_t ReadUInt16From(const uint8_t* bytes)
+{
+	return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+/** Reads a little-endian 32-bit unsigned integer from the given bytes. */
+static uint32_t ReadUInt32From(const uint8_t* bytes)
+{
+	return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+
+//---------------------------------------------------------------------------------
+// ByteBuffer Class Members
+//---------------------------------------------------------------------------------
+
+const char ByteBuffer::kLuaMetatableName[] = "eos.ByteBuffer";
+
+ByteBuffer::ByteBuffer()
+:	fLength(0)
+{
+}
+
+ByteBuffer::~ByteBuffer()
+{
+}
+
+uint8_t* ByteBuffer::GetData()
+{
+	return fBytes.data();
+}
+
+const uint8_t* ByteBuffer::GetData() const
+{
+	return fBytes.data();
+}
+
+uint32_t ByteBuffer::GetLength() const
+{
+	return fLength;
+}
+
+void ByteBuffer::SetLength(uint32_t value)
+{
+	fLength = (value < (uint32_t)fBytes.size()) ? value : (uint32_t)fBytes.size();
+}
+
+uint32_t ByteBuffer::GetCapacity() const
+{
+	return (uint32_t)fBytes.size();
+}
+
+void ByteBuffer::Reserve(uint32_t byteCount)
+{
+	if (byteCount > (uint32_t)fBytes.size())
+	{
+		fBytes.resize(byteCount);
+	}
+}
+
+void ByteBuffer::SwapBytesWith(std::vector<uint8_t>& bytes)
+{
+	fBytes.swap(bytes);
+	fLength = (uint32_t)fBytes.size();
+}
+
+ByteBuffer* ByteBuffer::PushNewTo(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return nullptr;
+	}
+
+	// Create the buffer within a new Lua userdata's memory block.
+	auto memoryPointer = lua_newuserdata(luaStatePointer, sizeof(ByteBuffer));
+	auto bufferPointer = new (memoryPointer) ByteBuffer();
+
+	// Assign the shared metatable providing the buffer's Lua methods, creating it the first time.
+	if (luaL_newmetatable(luaStatePointer, kLuaMetatableName))
+	{
+		const struct luaL_Reg luaMethods[] =
+		{
+			{ "getLength", OnGetLength },
+			{ "readInt8", OnReadInt8 },
+			{ "readUInt8", OnReadUInt8 },
+			{ "readInt16", OnReadInt16 },
+			{ "readUInt16", OnReadUInt16 },
+			{ "readInt32", OnReadInt32 },
+			{ "readUInt32", OnReadUInt32 },
+			{ "readFloat", OnReadFloat },
+			{ "readDouble", OnReadDouble },
+			{ "readString", OnReadString },
+			{ nullptr, nullptr }
+		};
+		lua_createtable(luaStatePointer, 0, 0);
+		luaL_openlib(luaStatePointer, nullptr, luaMethods, 0);
+		lua_setfield(luaStatePointer, -2, "__index");
+		lua_pushcfunction(luaStatePointer, OnGetLength);
+		lua_setfield(luaStatePointer, -2, "__len");
+		lua_pushcfunction(luaStatePointer, OnFinalizing);
+		lua_setfield(luaStatePointer, -2, "__gc");
+	}
+	lua_setmetatable(luaStatePointer, -2);
+	return bufferPointer;
+}
+
+ByteBuffer* ByteBuffer::GetFrom(lua_State* luaStatePointer, int luaIndex)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return nullptr;
+	}
+
+	// Fetch the userdata, but only if its metatable is the ByteBuffer metatable.
+	auto memoryPointer = lua_touserdata(luaStatePointer, luaIndex);
+	if (!memoryPointer || !lua_getmetatable(luaStatePointer, luaIndex))
+	{
+		return nullptr;
+	}
+	luaL_getmetatable(luaStatePointer, kLuaMetatableName);
+	bool isByteBuffer = lua_rawequal(luaStatePointer, -1, -2) ? true : false;
+	lua_pop(luaStatePointer, 2);
+	return isByteBuffer ? (ByteBuffer*)memoryPointer : nullptr;
+}
+
+const uint8_t* ByteBuffer::FetchReadPointer(lua_State* luaStatePointer, uint32_t byteCount)
+{
+	// Fetch the buffer.
+	auto bufferPointer = GetFrom(luaStatePointer, 1);
+	if (!bufferPointer)
+	{
+		luaL_argerror(luaStatePointer, 1, "expected a ByteBuffer");
+		return nullptr;
+	}
+
+	// Fetch the zero-based offset to read from and make sure the read stays within bounds.
+	// Comparisons are negated so that NaN offsets, for which every comparison is false, are rejected too.
+	lua_Number offset = luaL_optnumber(luaStatePointer, 2, 0);
+	if (!(offset >= 0) || !((offset + byteCount) <= (lua_Number)bufferPointer->fLength))
+	{
+		return nullptr;
+	}
+	return bufferPointer->fBytes.data() + (uint32_t)offset;
+}
+
+int ByteBuffer::OnFinalizing(lua_State* luaStatePointer)
+{
+	auto bufferPointer = GetFrom(luaStatePointer, 1);
+	if (bufferPointer)
+	{
+		bufferPointer->~ByteBuffer();
+	}
+	return 0;
+}
+
+int ByteBuffer::OnGetLength(lua_State* luaStatePointer)
+{
+	auto bufferPointer = GetFrom(luaStatePointer, 1);
+	lua_pushinteger(luaStatePointer, bufferPointer ? (lua_Integer)bufferPointer->fLength : 0);
+	return 1;
+}
+
+int ByteBuffer::OnReadInt8(lua_State* luaStatePointer)
+{
+	auto bytes = FetchReadPointer(luaStatePointer, 1);
+	if (!bytes)
+	{
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+	lua_pushinteger(luaStatePointer, (int8_t)bytes[0]);
+	lua_pushnumber(luaStatePointer, lua_tonumber(luaStatePointer, 2) + 1);
+	return 2;
+}
+
+int ByteBuffer::OnReadUInt8(lua_State* luaStatePointer)
+{
+	auto bytes = FetchReadPointer(luaStatePointer, 1);
+	if (!bytes)
+	{
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+	lua_pushinteger(luaStatePointer, bytes[0]);
+	lua_pushnumber(luaStatePointer, lua_tonumber(luaStatePointer, 2) + 1);
+	return 2;
+}
+
+int ByteBuffer::OnReadInt16(lua_State* luaStatePointer)
+{
+	auto bytes = FetchReadPointer(luaStatePointer, 2);
+	if (!bytes)
+	{
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+	lua_pushinteger(luaStatePointer, (int16_t)ReadUInt16From(bytes));
+	lua_pushnumber(luaStatePointer, lua_tonumber(luaStatePointer, 2) + 2);
+	return 2;
+}
+
+int ByteBuffer::OnReadUInt16(lua_State* luaStatePointer)
+{
+	auto bytes = FetchReadPointer(luaStatePointer, 2);
+	if (!bytes)
+	{
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+	lua_pushinteger(luaStatePointer, ReadUInt16From(bytes));
+	lua_pushnumber(luaStatePointer, lua_tonumber(luaStatePointer, 2) + 2);
+	return 2;
+}
+
+int ByteBuffer::OnReadInt32(lua_State* luaStatePointer)
+{
+	auto bytes = FetchReadPointer(luaStatePointer, 4);
+	if (!bytes)
+	{
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+	lua_pushnumber(luaStatePointer, (int32_t)ReadUInt32From(bytes));
+	lua_pushnumber(luaStatePointer, lua_tonumber(luaStatePointer, 2) + 4);
+	return 2;
+}
+
+int ByteBuffer::OnReadUInt32(lua_State* luaStatePointer)
+{
+	auto bytes = FetchReadPointer(luaStatePointer, 4);
+	if (!bytes)
+	{
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+	lua_pushnumber(luaStatePointer, ReadUInt32From(bytes));
+	lua_pushnumber(luaStatePointer, lua_tonumber(luaStatePointer, 2) + 4);
+	return 2;
+}
+
+int ByteBuffer::OnReadFloat(lua_State* luaStatePointer)
+{
+	auto bytes = FetchReadPointer(luaStatePointer, 4);
+	if (!bytes)
+	{
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+	uint32_t bits = ReadUInt32From(bytes);
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	lua_pushnumber(luaStatePointer, value);
+	lua_pushnumber(luaStatePointer, lua_tonumber(luaStatePointer, 2) + 4);
+	return 2;
+}
+
+int ByteBuffer::OnReadDouble(lua_State* luaStatePointer)
+{
+	auto bytes = FetchReadPointer(luaStatePointer, 8);
+	if (!bytes)
+	{
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+	uint64_t bits = (uint64_t)ReadUInt32From(bytes) | ((uint64_t)ReadUInt32From(bytes + 4) << 32);
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	lua_pushnumber(luaStatePointer, value);
+	lua_pushnumber(luaStatePointer, lua_tonumber(luaStatePointer, 2) + 8);
+	return 2;
+}
+
+int ByteBuffer::OnReadString(lua_State* luaStatePointer)
+{
+	// Fetch the buffer.
+	auto bufferPointer = GetFrom(luaStatePointer, 1);
+	if (!bufferPointer)
+	{
+		return luaL_argerror(luaStatePointer, 1, "expected a ByteBuffer");
+	}
+
+	// Determine the number of bytes to read, defaulting to the rest of the buffer.
+	lua_Number offset = luaL_optnumber(luaStatePointer, 2, 0);
+	lua_Number length = luaL_optnumber(luaStatePointer, 3, (lua_Number)bufferPointer->fLength - offset);
+	// Every comparison with NaN is false, so NaN arguments fail these checks and are rejected too.
+	bool isInBounds =
+			(offset >= 0) && (length >= 0) && ((offset + length) <= (lua_Number)bufferPointer->fLength);
+	if (!isInBounds)
+	{
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+
+	// Push the bytes as a Lua string, followed by the offset of the next byte.
+	lua_pushlstring(luaStatePointer, (const char*)bufferPointer->fBytes.data() + (uint32_t)offset, (size_t)length);
+	lua_pushnumber(luaStatePointer, offset + length);
+	return 2;
+}
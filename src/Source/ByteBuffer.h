@@ -0,0 +1,150 @@
+// ----------------------------------------------------------------------------
+//
+// ByteBuffer.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+
+// Forward declarations.
+extern "C"
+{
+	struct lua_State;
+}
+
+
+/**
+  Resizable block of bytes that is exposed to Lua as a userdata with read methods, such as readUInt16().
+
+  Intended to be created once and then re-used, such as by the P2P receive path which writes every received packet
+  directly into the same buffer. This lets Lua read binary data without a new Lua string being created per packet.
+  Note that this also means the buffer's content is only valid until the next time native code writes to it.
+
+  Lua read methods take a zero-based byte offset and return the value read followed by the offset of the next byte,
+  or nil if the read would go past the end of the buffer. Multi-byte values are read in little-endian byte order.
+ */
+class ByteBuffer
+{
+	public:
+		/** Name of the Lua metatable assigned to all ByteBuffer userdata objects. */
+		static const char kLuaMetatableName[];
+
+
+		/** Creates an empty buffer. */
+		ByteBuffer();
+
+		/** Frees this buffer's bytes. */
+		virtual ~ByteBuffer();
+
+		/** Gets a pointer to this buffer's bytes. Only valid until the next call to Reserve(). */
+		uint8_t* GetData();
+
+		/** Gets a pointer to this buffer's bytes. Only valid until the next call to Reserve(). */
+		const uint8_t* GetData() const;
+
+		/** Gets the number of bytes that Lua can read from this buffer. */
+		uint32_t GetLength() const;
+
+		/**
+		  Sets the number of bytes that Lua can read from this buffer.
+		  @param value The number of bytes. Clamped to the buffer's capacity.
+		 */
+		void SetLength(uint32_t value);
+
+		/** Gets the number of bytes that can be written to GetData() without calling Reserve(). */
+		uint32_t GetCapacity() const;
+
+		/**
+		  Grows this buffer's capacity to at least the given number of bytes. Never shrinks it.
+		  Existing bytes are preserved, but pointers returned by GetData() are invalidated if it grows.
+		  @param byteCount The number of bytes needed.
+		 */
+		void Reserve(uint32_t byteCount);
+
+		/**
+		  Swaps this buffer's bytes with the given vector's bytes without copying them.
+		  Used to hand natively assembled bytes to Lua. The buffer's length is set to the vector's size.
+		  @param bytes The bytes to take. Receives this buffer's previous bytes.
+		 */
+		void SwapBytesWith(std::vector<uint8_t>& bytes);
+
+		/**
+		  Creates a new ByteBuffer as a Lua userdata and pushes it to the top of the Lua stack.
+		  The buffer is owned by Lua and is deleted once garbage collected.
+		  @param luaStatePointer The Lua state to push the buffer to.
+		  @return Returns a pointer to the new buffer. Returns null if given a null Lua state.
+		 */
+		static ByteBuffer* PushNewTo(lua_State* luaStatePointer);
+
+		/**
+		  Fetches the ByteBuffer at the given index of the Lua stack.
+		  @param luaStatePointer The Lua state to fetch the buffer from.
+		  @param luaIndex Index to a Lua value on the stack.
+		  @return Returns a pointer to the buffer. Returns null if the value is not a ByteBuffer.
+		 */
+		static ByteBuffer* GetFrom(lua_State* luaStatePointer, int luaIndex);
+
+	private:
+		/** Copy constructor deleted to prevent it from being called. */
+		ByteBuffer(const ByteBuffer&) = delete;
+
+		/** Method deleted to prevent the copy operator from being used. */
+		void operator=(const ByteBuffer&) = delete;
+
+		/**
+		  Fetches the bytes at the given offset for one of the Lua read methods.
+		  @param luaStatePointer The Lua state whose 1st argument is the buffer and 2nd argument the offset.
+		  @param byteCount The number of bytes to be read.
+		  @return Returns a pointer to the bytes to read. Returns null if the read would go out of bounds.
+		 */
+		static const uint8_t* FetchReadPointer(lua_State* luaStatePointer, uint32_t byteCount);
+
+		/** Called when a buffer's Lua userdata is garbage collected. Deletes the buffer. */
+		static int OnFinalizing(lua_State* luaStatePointer);
+
+		/** Called when Lua's "#" operator or getLength() method is used on a buffer. */
+		static int OnGetLength(lua_State* luaStatePointer);
+
+		/** Called when Lua invokes the buffer's readInt8() method. */
+		static int OnReadInt8(lua_State* luaStatePointer);
+
+		/** Called when Lua invokes the buffer's readUInt8() method. */
+		static int OnReadUInt8(lua_State* luaStatePointer);
+
+		/** Called when Lua invokes the buffer's readInt16() method. */
+		static int OnReadInt16(lua_State* luaStatePointer);
+
+		/** Called when Lua invokes the buffer's readUInt16() method. */
+		static int OnReadUInt16(lua_State* luaStatePointer);
+
+		/** Called when Lua invokes the buffer's readInt32() method. */
+		static int OnReadInt32(lua_State* luaStatePointer);
+
+		/** Called when Lua invokes the buffer's readUInt32() method. */
+		static int OnReadUInt32(lua_State* luaStatePointer);
+
+		/** Called when Lua invokes the buffer's readFloat() method. */
+		static int OnReadFloat(lua_State* luaStatePointer);
+
+		/** Called when Lua invokes the buffer's readDouble() method. */
+		static int OnReadDouble(lua_State* luaStatePointer);
+
+		/**
+		  Called when Lua invokes the buffer's readString(offset[, length]) method.
+		  Reads to the end of the buffer if a length is not given. Note that this creates a new Lua string.
+		 */
+		static int OnReadString(lua_State* luaStatePointer);
+
+		/** The buffer's bytes. Its size is the buffer's capacity. */
+		std::vector<uint8_t> fBytes;
+
+		/** Number of bytes readable by Lua. */
+		uint32_t fLength;
+};
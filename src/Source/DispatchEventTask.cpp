@@ -8,9 +8,66 @@
 // --------------------------------------------------------------------------------
 
 #include "DispatchEventTask.h"
+#include "ByteBuffer.h"
 #include "CoronaLua.h"
+#include "P2PConnectionManager.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <sstream>
 #include <string>
+#include "eos_ecom_types.h"
+
+//---------------------------------------------------------------------------------
+// Private Static Functions
+//---------------------------------------------------------------------------------
+
+/**
+  Pushes the given Corona "system" directory constant, such as system.CachesDirectory, to the top of the Lua stack.
+  @param luaStatePointer The Lua state to push the constant to.
+  @param directoryName Name of the constant's field in the "system" table.
+ */
+static void PushSystemDirectoryTo(lua_State* luaStatePointer, const std::string& directoryName)
+{
+	lua_getglobal(luaStatePointer, "system");
+	if (lua_istable(luaStatePointer, -1))
+	{
+		lua_getfield(luaStatePointer, -1, directoryName.c_str());
+		lua_remove(luaStatePointer, -2);
+	}
+	else
+	{
+		lua_pop(luaStatePointer, 1);
+		lua_pushnil(luaStatePointer);
+	}
+}
+
+/**
+  Fetches the current value of Corona's system.getTimer() function.
+  @param luaStatePointer The Lua state to call the function with.
+  @return Returns the number of milliseconds since the app was launched. Returns zero if unavailable.
+ */
+static double FetchSystemTimerFrom(lua_State* luaStatePointer)
+{
+	double milliseconds = 0;
+	lua_getglobal(luaStatePointer, "system");
+	if (lua_istable(luaStatePointer, -1))
+	{
+		lua_getfield(luaStatePointer, -1, "getTimer");
+		if (lua_isfunction(luaStatePointer, -1))
+		{
+			int callResultCode = CoronaLuaDoCall(luaStatePointer, 0, 1);
+			if (!callResultCode && (lua_type(luaStatePointer, -1) == LUA_TNUMBER))
+			{
+				milliseconds = lua_tonumber(luaStatePointer, -1);
+			}
+		}
+		lua_pop(luaStatePointer, 1);
+	}
+	lua_pop(luaStatePointer, 1);
+	return milliseconds;
+}
+
 
 //---------------------------------------------------------------------------------
 // BaseDispatchEventTask Class Members
@@ -34,6 +91,40 @@ void BaseDispatchEventTask::SetLuaEventDispatcher(const std::shared_ptr<LuaEvent
 	fLuaEventDispatcherPointer = dispatcherPointer;
 }
 
+std::shared_ptr<EosIdCache> BaseDispatchEventTask::GetIdCache() const
+{
+	return fIdCachePointer;
+}
+
+void BaseDispatchEventTask::SetIdCache(const std::shared_ptr<EosIdCache>& cachePointer)
+{
+	fIdCachePointer = cachePointer;
+}
+
+void BaseDispatchEventTask::PushEpicAccountIdTo(lua_State* luaStatePointer, EOS_EpicAccountId accountId) const
+{
+	if (fIdCachePointer)
+	{
+		fIdCachePointer->PushEpicAccountIdTo(luaStatePointer, accountId);
+	}
+	else
+	{
+		EosIdCache::PushUncachedEpicAccountIdTo(luaStatePointer, accountId);
+	}
+}
+
+void BaseDispatchEventTask::PushProductUserIdTo(lua_State* luaStatePointer, EOS_ProductUserId productUserId) const
+{
+	if (fIdCachePointer)
+	{
+		fIdCachePointer->PushProductUserIdTo(luaStatePointer, productUserId);
+	}
+	else
+	{
+		EosIdCache::PushUncachedProductUserIdTo(luaStatePointer, productUserId);
+	}
+}
+
 bool BaseDispatchEventTask::Execute()
 {
 	// Do not continue if not assigned a Lua event dispatcher.
@@ -98,7 +189,9 @@ void BaseDispatchCallResultEventTask::SetHadIOFailure(bool value)
 const char DispatchLoginResponseEventTask::kLuaEventName[] = "loginResponse";
 
 DispatchLoginResponseEventTask::DispatchLoginResponseEventTask()
-: fResult(EOS_EResult::EOS_UnexpectedError)
+: fResult(EOS_EResult::EOS_UnexpectedError),
+  fUserHandle(0),
+  fSelectedAccountId(nullptr)
 {
 }
 
@@ -109,12 +202,12 @@ DispatchLoginResponseEventTask::~DispatchLoginResponseEventTask()
 void DispatchLoginResponseEventTask::AcquireEventDataFrom(const EOS_Auth_LoginCallbackInfo* eosEventData)
 {
 	fResult = eosEventData->ResultCode;
-	int sz = 0;
-	if(fResult == EOS_EResult::EOS_Success && eosEventData->SelectedAccountId) {
-		sz = EOS_EPICACCOUNTID_MAX_LENGTH + 1;
-		EOS_EpicAccountId_ToString(eosEventData->SelectedAccountId, fSelectedAccountID, &sz);
-	}
-	fSelectedAccountID[sz] = 0;
+	fSelectedAccountId = eosEventData->SelectedAccountId;
+}
+
+void DispatchLoginResponseEventTask::SetUserHandle(int value)
+{
+	fUserHandle = value;
 }
 
 const char* DispatchLoginResponseEventTask::GetLuaEventName() const
@@ -133,10 +226,15 @@ bool DispatchLoginResponseEventTask::PushLuaEventTableTo(lua_State* luaStatePoin
 	// Push the event data to Lua.
 	CoronaLuaNewEvent(luaStatePointer, kLuaEventName);
 
-	if(fResult == EOS_EResult::EOS_Success) {
-		lua_pushstring(luaStatePointer, fSelectedAccountID);
+	if(fResult == EOS_EResult::EOS_Success && fSelectedAccountId) {
+		PushEpicAccountIdTo(luaStatePointer, fSelectedAccountId);
 		lua_setfield(luaStatePointer, -2, "selectedAccountId");
 	}
+	if (fUserHandle > 0)
+	{
+		lua_pushinteger(luaStatePointer, fUserHandle);
+		lua_setfield(luaStatePointer, -2, "userHandle");
+	}
 	
 	lua_pushboolean(luaStatePointer, fResult != EOS_EResult::EOS_Success ? 1 : 0);
 	lua_setfield(luaStatePointer, -2, "isError");
@@ -144,3 +242,1356 @@ bool DispatchLoginResponseEventTask::PushLuaEventTableTo(lua_State* luaStatePoin
 	lua_setfield(luaStatePointer, -2, "resultCode");
 	return true;
 }
+
+
+//---------------------------------------------------------------------------------
+// DispatchLogoutResponseEventTask Class Members
+//---------------------------------------------------------------------------------
+
+const char DispatchLogoutResponseEventTask::kLuaEventName[] = "logoutResponse";
+
+DispatchLogoutResponseEventTask::DispatchLogoutResponseEventTask()
+:	fResult(EOS_EResult::EOS_UnexpectedError),
+	fUserHandle(0)
+{
+}
+
+DispatchLogoutResponseEventTask::~DispatchLogoutResponseEventTask()
+{
+}
+
+void DispatchLogoutResponseEventTask::AcquireEventDataFrom(EOS_EResult resultCode)
+{
+	fResult = resultCode;
+}
+
+void DispatchLogoutResponseEventTask::SetUserHandle(int value)
+{
+	fUserHandle = value;
+}
+
+const char* DispatchLogoutResponseEventTask::GetLuaEventName() const
+{
+	return kLuaEventName;
+}
+
+bool DispatchLogoutResponseEventTask::PushLuaEventTableTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+
+	// Push the event data to Lua.
+	CoronaLuaNewEvent(luaStatePointer, kLuaEventName);
+	lua_pushinteger(luaStatePointer, fUserHandle);
+	lua_setfield(luaStatePointer, -2, "userHandle");
+	lua_pushboolean(luaStatePointer, fResult != EOS_EResult::EOS_Success ? 1 : 0);
+	lua_setfield(luaStatePointer, -2, "isError");
+	lua_pushinteger(luaStatePointer, (int)fResult);
+	lua_setfield(luaStatePointer, -2, "resultCode");
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------
+// DispatchConnectLoginResponseEventTask Class Members
+//---------------------------------------------------------------------------------
+
+const char DispatchConnectLoginResponseEventTask::kLuaEventName[] = "connectLoginResponse";
+
+DispatchConnectLoginResponseEventTask::DispatchConnectLoginResponseEventTask()
+:	fResult(EOS_EResult::EOS_UnexpectedError),
+	fIsRefresh(false),
+	fUserHandle(0),
+	fProductUserId(nullptr)
+{
+}
+
+DispatchConnectLoginResponseEventTask::~DispatchConnectLoginResponseEventTask()
+{
+}
+
+void DispatchConnectLoginResponseEventTask::AcquireEventDataFrom(EOS_EResult resultCode, EOS_ProductUserId productUserId)
+{
+	fResult = resultCode;
+	fProductUserId = (resultCode == EOS_EResult::EOS_Success) ? productUserId : nullptr;
+}
+
+void DispatchConnectLoginResponseEventTask::SetIsRefresh(bool value)
+{
+	fIsRefresh = value;
+}
+
+void DispatchConnectLoginResponseEventTask::SetUserHandle(int value)
+{
+	fUserHandle = value;
+}
+
+const char* DispatchConnectLoginResponseEventTask::GetLuaEventName() const
+{
+	return kLuaEventName;
+}
+
+bool DispatchConnectLoginResponseEventTask::PushLuaEventTableTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+
+	// Push the event data to Lua.
+	CoronaLuaNewEvent(luaStatePointer, kLuaEventName);
+
+	if (fProductUserId)
+	{
+		PushProductUserIdTo(luaStatePointer, fProductUserId);
+		lua_setfield(luaStatePointer, -2, "productUserId");
+	}
+
+	lua_pushinteger(luaStatePointer, fUserHandle);
+	lua_setfield(luaStatePointer, -2, "userHandle");
+	lua_pushboolean(luaStatePointer, fIsRefresh ? 1 : 0);
+	lua_setfield(luaStatePointer, -2, "isRefresh");
+	lua_pushboolean(luaStatePointer, fResult != EOS_EResult::EOS_Success ? 1 : 0);
+	lua_setfield(luaStatePointer, -2, "isError");
+	lua_pushinteger(luaStatePointer, (int)fResult);
+	lua_setfield(luaStatePointer, -2, "resultCode");
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------
+// DispatchLoginStatusEventTask Class Members
+//---------------------------------------------------------------------------------
+
+const char DispatchLoginStatusEventTask::kLuaEventName[] = "loginStatus";
+
+DispatchLoginStatusEventTask::DispatchLoginStatusEventTask()
+:	fDefaultStatusName("notLoggedIn")
+{
+}
+
+DispatchLoginStatusEventTask::~DispatchLoginStatusEventTask()
+{
+}
+
+void DispatchLoginStatusEventTask::AddStatusChange(
+	int userHandle, const char* statusName, const char* previousStatusName)
+{
+	StatusChange statusChange;
+	statusChange.UserHandle = userHandle;
+	statusChange.StatusName = statusName;
+	statusChange.PreviousStatusName = previousStatusName;
+	fStatusChanges.push_back(statusChange);
+}
+
+bool DispatchLoginStatusEventTask::HasStatusChanges() const
+{
+	return !fStatusChanges.empty();
+}
+
+void DispatchLoginStatusEventTask::SetDefaultStatus(const char* statusName)
+{
+	fDefaultStatusName = statusName ? statusName : "notLoggedIn";
+}
+
+const char* DispatchLoginStatusEventTask::GetLuaEventName() const
+{
+	return kLuaEventName;
+}
+
+bool DispatchLoginStatusEventTask::PushLuaEventTableTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+
+	// Push the event data to Lua.
+	CoronaLuaNewEvent(luaStatePointer, kLuaEventName);
+	lua_pushstring(luaStatePointer, fDefaultStatusName);
+	lua_setfield(luaStatePointer, -2, "status");
+	lua_createtable(luaStatePointer, (int)fStatusChanges.size(), 0);
+	int arrayIndex = 1;
+	for (auto&& statusChange : fStatusChanges)
+	{
+		lua_createtable(luaStatePointer, 0, 3);
+		lua_pushinteger(luaStatePointer, statusChange.UserHandle);
+		lua_setfield(luaStatePointer, -2, "userHandle");
+		lua_pushstring(luaStatePointer, statusChange.StatusName);
+		lua_setfield(luaStatePointer, -2, "status");
+		lua_pushstring(luaStatePointer, statusChange.PreviousStatusName);
+		lua_setfield(luaStatePointer, -2, "previousStatus");
+		lua_rawseti(luaStatePointer, -2, arrayIndex++);
+	}
+	lua_setfield(luaStatePointer, -2, "users");
+	lua_pushboolean(luaStatePointer, 0);
+	lua_setfield(luaStatePointer, -2, "isError");
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------
+// DispatchLoadProductsEventTask Class Members
+//---------------------------------------------------------------------------------
+
+const char DispatchLoadProductsEventTask::kLuaEventName[] = "loadProducts";
+
+DispatchLoadProductsEventTask::DispatchLoadProductsEventTask()
+:	fResult(EOS_EResult::EOS_UnexpectedError),
+	fUserHandle(0),
+	fIsStale(false)
+{
+}
+
+DispatchLoadProductsEventTask::~DispatchLoadProductsEventTask()
+{
+}
+
+void DispatchLoadProductsEventTask::AcquireEventDataFrom(
+	const std::shared_ptr<const EcomStore::Catalog>& catalogPointer,
+	const std::vector<std::string>& productIds, EOS_EResult resultCode)
+{
+	// Note: The catalog is immutable, so sharing it defers building the Lua tables until dispatch without copying it.
+	fCatalogPointer = catalogPointer;
+	fProductIds = productIds;
+	fResult = resultCode;
+}
+
+void DispatchLoadProductsEventTask::SetUserHandle(int value)
+{
+	fUserHandle = value;
+}
+
+void DispatchLoadProductsEventTask::SetIsStale(bool value)
+{
+	fIsStale = value;
+}
+
+void DispatchLoadProductsEventTask::SetImageFileNames(
+	std::unordered_map<std::string, std::string>&& fileNames, const std::string& luaDirectoryName)
+{
+	fImageFileNames = std::move(fileNames);
+	fImageLuaDirectoryName = luaDirectoryName;
+}
+
+const char* DispatchLoadProductsEventTask::GetLuaEventName() const
+{
+	return kLuaEventName;
+}
+
+bool DispatchLoadProductsEventTask::PushLuaEventTableTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+
+	// Push the event data to Lua.
+	CoronaLuaNewEvent(luaStatePointer, kLuaEventName);
+
+	// Push the requested offers. All offers are provided if none were requested.
+	// Requested IDs not found in the catalog are provided via the "invalidProducts" array.
+	lua_newtable(luaStatePointer);
+	lua_newtable(luaStatePointer);
+	if (fCatalogPointer)
+	{
+		int productIndex = 1;
+		int invalidProductIndex = 1;
+		if (fProductIds.empty())
+		{
+			for (auto&& offer : fCatalogPointer->GetOffers())
+			{
+				PushOfferTo(luaStatePointer, offer);
+				lua_rawseti(luaStatePointer, -3, productIndex++);
+			}
+		}
+		else
+		{
+			for (auto&& productId : fProductIds)
+			{
+				auto offerPointer = fCatalogPointer->GetOfferBy(productId);
+				if (offerPointer)
+				{
+					PushOfferTo(luaStatePointer, *offerPointer);
+					lua_rawseti(luaStatePointer, -3, productIndex++);
+				}
+				else
+				{
+					lua_pushlstring(luaStatePointer, productId.c_str(), productId.length());
+					lua_rawseti(luaStatePointer, -2, invalidProductIndex++);
+				}
+			}
+		}
+	}
+	lua_setfield(luaStatePointer, -3, "invalidProducts");
+	lua_setfield(luaStatePointer, -2, "products");
+
+	lua_pushinteger(luaStatePointer, fUserHandle);
+	lua_setfield(luaStatePointer, -2, "userHandle");
+	lua_pushboolean(luaStatePointer, fIsStale ? 1 : 0);
+	lua_setfield(luaStatePointer, -2, "isStale");
+	lua_pushboolean(luaStatePointer, fResult != EOS_EResult::EOS_Success ? 1 : 0);
+	lua_setfield(luaStatePointer, -2, "isError");
+	lua_pushinteger(luaStatePointer, (int)fResult);
+	lua_setfield(luaStatePointer, -2, "resultCode");
+	return true;
+}
+
+void DispatchLoadProductsEventTask::PushOfferTo(
+	lua_State* luaStatePointer, const EcomStore::CatalogOffer& offer) const
+{
+	lua_createtable(luaStatePointer, 0, 16);
+	lua_pushlstring(luaStatePointer, offer.Id.c_str(), offer.Id.length());
+	lua_setfield(luaStatePointer, -2, "productIdentifier");
+	lua_pushlstring(luaStatePointer, offer.CatalogNamespace.c_str(), offer.CatalogNamespace.length());
+	lua_setfield(luaStatePointer, -2, "catalogNamespace");
+	lua_pushlstring(luaStatePointer, offer.Title.c_str(), offer.Title.length());
+	lua_setfield(luaStatePointer, -2, "title");
+	lua_pushlstring(luaStatePointer, offer.Description.c_str(), offer.Description.length());
+	lua_setfield(luaStatePointer, -2, "description");
+	lua_pushlstring(luaStatePointer, offer.LongDescription.c_str(), offer.LongDescription.length());
+	lua_setfield(luaStatePointer, -2, "longDescription");
+	if (offer.PriceResult == EOS_EResult::EOS_Success)
+	{
+		// Prices are provided in the currency's smallest unit, such as cents.
+		uint64_t divisor = 1;
+		for (uint32_t index = 0; (index < offer.DecimalPoint) && (index < 18); index++)
+		{
+			divisor *= 10;
+		}
+		char priceString[64];
+		if (divisor > 1)
+		{
+			snprintf(
+					priceString, sizeof(priceString), "%llu.%0*llu %s",
+					(unsigned long long)(offer.CurrentPrice / divisor), (int)offer.DecimalPoint,
+					(unsigned long long)(offer.CurrentPrice % divisor), offer.CurrencyCode.c_str());
+		}
+		else
+		{
+			snprintf(
+					priceString, sizeof(priceString), "%llu %s",
+					(unsigned long long)offer.CurrentPrice, offer.CurrencyCode.c_str());
+		}
+		lua_pushstring(luaStatePointer, priceString);
+		lua_setfield(luaStatePointer, -2, "localizedPrice");
+		lua_pushnumber(luaStatePointer, (double)offer.CurrentPrice / (double)divisor);
+		lua_setfield(luaStatePointer, -2, "price");
+		lua_pushnumber(luaStatePointer, (double)offer.OriginalPrice / (double)divisor);
+		lua_setfield(luaStatePointer, -2, "originalPrice");
+		lua_pushlstring(luaStatePointer, offer.CurrencyCode.c_str(), offer.CurrencyCode.length());
+		lua_setfield(luaStatePointer, -2, "priceCurrencyCode");
+		lua_pushinteger(luaStatePointer, offer.DiscountPercentage);
+		lua_setfield(luaStatePointer, -2, "discountPercentage");
+	}
+	if (offer.ExpirationTimestamp != EOS_ECOM_CATALOGOFFER_EXPIRATIONTIMESTAMP_UNDEFINED)
+	{
+		lua_pushnumber(luaStatePointer, (double)offer.ExpirationTimestamp);
+		lua_setfield(luaStatePointer, -2, "expirationTime");
+	}
+	if (offer.ReleaseDateTimestamp != EOS_ECOM_CATALOGOFFER_RELEASEDATETIMESTAMP_UNDEFINED)
+	{
+		lua_pushnumber(luaStatePointer, (double)offer.ReleaseDateTimestamp);
+		lua_setfield(luaStatePointer, -2, "releaseTime");
+	}
+	if (offer.EffectiveDateTimestamp != EOS_ECOM_CATALOGOFFER_EFFECTIVEDATETIMESTAMP_UNDEFINED)
+	{
+		lua_pushnumber(luaStatePointer, (double)offer.EffectiveDateTimestamp);
+		lua_setfield(luaStatePointer, -2, "effectiveTime");
+	}
+	lua_pushinteger(luaStatePointer, offer.PurchaseLimit);
+	lua_setfield(luaStatePointer, -2, "purchaseLimit");
+	lua_pushboolean(luaStatePointer, offer.IsAvailableForPurchase ? 1 : 0);
+	lua_setfield(luaStatePointer, -2, "isAvailableForPurchase");
+	PushKeyImagesTo(luaStatePointer, offer.Images);
+	lua_setfield(luaStatePointer, -2, "images");
+
+	lua_createtable(luaStatePointer, (int)offer.Items.size(), 0);
+	int itemIndex = 1;
+	for (auto&& item : offer.Items)
+	{
+		lua_createtable(luaStatePointer, 0, 5);
+		lua_pushlstring(luaStatePointer, item.Id.c_str(), item.Id.length());
+		lua_setfield(luaStatePointer, -2, "id");
+		lua_pushlstring(luaStatePointer, item.EntitlementName.c_str(), item.EntitlementName.length());
+		lua_setfield(luaStatePointer, -2, "entitlementName");
+		lua_pushlstring(luaStatePointer, item.Title.c_str(), item.Title.length());
+		lua_setfield(luaStatePointer, -2, "title");
+		lua_pushlstring(luaStatePointer, item.Description.c_str(), item.Description.length());
+		lua_setfield(luaStatePointer, -2, "description");
+		switch (item.ItemType)
+		{
+			case EOS_EEcomItemType::EOS_EIT_Durable:
+				lua_pushstring(luaStatePointer, "durable");
+				break;
+			case EOS_EEcomItemType::EOS_EIT_Consumable:
+				lua_pushstring(luaStatePointer, "consumable");
+				break;
+			default:
+				lua_pushstring(luaStatePointer, "other");
+				break;
+		}
+		lua_setfield(luaStatePointer, -2, "type");
+		PushKeyImagesTo(luaStatePointer, item.Images);
+		lua_setfield(luaStatePointer, -2, "images");
+		lua_createtable(luaStatePointer, (int)item.Releases.size(), 0);
+		int releaseIndex = 1;
+		for (auto&& release : item.Releases)
+		{
+			lua_createtable(luaStatePointer, 0, 3);
+			lua_createtable(luaStatePointer, (int)release.CompatibleAppIds.size(), 0);
+			for (size_t index = 0; index < release.CompatibleAppIds.size(); index++)
+			{
+				lua_pushstring(luaStatePointer, release.CompatibleAppIds[index].c_str());
+				lua_rawseti(luaStatePointer, -2, (int)index + 1);
+			}
+			lua_setfield(luaStatePointer, -2, "compatibleAppIds");
+			lua_createtable(luaStatePointer, (int)release.CompatiblePlatforms.size(), 0);
+			for (size_t index = 0; index < release.CompatiblePlatforms.size(); index++)
+			{
+				lua_pushstring(luaStatePointer, release.CompatiblePlatforms[index].c_str());
+				lua_rawseti(luaStatePointer, -2, (int)index + 1);
+			}
+			lua_setfield(luaStatePointer, -2, "compatiblePlatforms");
+			lua_pushlstring(luaStatePointer, release.ReleaseNote.c_str(), release.ReleaseNote.length());
+			lua_setfield(luaStatePointer, -2, "releaseNote");
+			lua_rawseti(luaStatePointer, -2, releaseIndex++);
+		}
+		lua_setfield(luaStatePointer, -2, "releases");
+		lua_rawseti(luaStatePointer, -2, itemIndex++);
+	}
+	lua_setfield(luaStatePointer, -2, "items");
+}
+
+void DispatchLoadProductsEventTask::PushKeyImagesTo(
+	lua_State* luaStatePointer, const std::vector<EcomStore::KeyImage>& images) const
+{
+	lua_createtable(luaStatePointer, (int)images.size(), 0);
+	int imageIndex = 1;
+	for (auto&& image : images)
+	{
+		lua_createtable(luaStatePointer, 0, 6);
+		lua_pushlstring(luaStatePointer, image.Type.c_str(), image.Type.length());
+		lua_setfield(luaStatePointer, -2, "type");
+		lua_pushlstring(luaStatePointer, image.Url.c_str(), image.Url.length());
+		lua_setfield(luaStatePointer, -2, "url");
+		lua_pushinteger(luaStatePointer, (lua_Integer)image.Width);
+		lua_setfield(luaStatePointer, -2, "width");
+		lua_pushinteger(luaStatePointer, (lua_Integer)image.Height);
+		lua_setfield(luaStatePointer, -2, "height");
+
+		// Provide the image's local file if it was cached, which can be passed to display.newImage() as is.
+		auto fileNameIter = fImageFileNames.find(image.Url);
+		if (fileNameIter != fImageFileNames.end())
+		{
+			lua_pushlstring(luaStatePointer, fileNameIter->second.c_str(), fileNameIter->second.length());
+			lua_setfield(luaStatePointer, -2, "fileName");
+			PushSystemDirectoryTo(luaStatePointer, fImageLuaDirectoryName);
+			lua_setfield(luaStatePointer, -2, "baseDir");
+		}
+		lua_rawseti(luaStatePointer, -2, imageIndex++);
+	}
+}
+
+
+//---------------------------------------------------------------------------------
+// DispatchProductImagesEventTask Class Members
+//---------------------------------------------------------------------------------
+
+const char DispatchProductImagesEventTask::kLuaEventName[] = "productImages";
+
+DispatchProductImagesEventTask::DispatchProductImagesEventTask()
+{
+}
+
+DispatchProductImagesEventTask::~DispatchProductImagesEventTask()
+{
+}
+
+void DispatchProductImagesEventTask::AcquireEventDataFrom(
+	std::vector<ImageCache::FetchResult>&& results, const std::string& luaDirectoryName)
+{
+	fResults = std::move(results);
+	fLuaDirectoryName = luaDirectoryName;
+}
+
+const char* DispatchProductImagesEventTask::GetLuaEventName() const
+{
+	return kLuaEventName;
+}
+
+bool DispatchProductImagesEventTask::PushLuaEventTableTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+
+	// Push the event data to Lua.
+	// Images that failed to download have no "fileName" and are flagged via "isError".
+	CoronaLuaNewEvent(luaStatePointer, kLuaEventName);
+	bool hasError = false;
+	lua_createtable(luaStatePointer, (int)fResults.size(), 0);
+	int imageIndex = 1;
+	for (auto&& result : fResults)
+	{
+		lua_createtable(luaStatePointer, 0, 4);
+		lua_pushlstring(luaStatePointer, result.Url.c_str(), result.Url.length());
+		lua_setfield(luaStatePointer, -2, "url");
+		if (!result.FileName.empty())
+		{
+			lua_pushlstring(luaStatePointer, result.FileName.c_str(), result.FileName.length());
+			lua_setfield(luaStatePointer, -2, "fileName");
+			PushSystemDirectoryTo(luaStatePointer, fLuaDirectoryName);
+			lua_setfield(luaStatePointer, -2, "baseDir");
+		}
+		lua_pushboolean(luaStatePointer, result.FileName.empty() ? 1 : 0);
+		lua_setfield(luaStatePointer, -2, "isError");
+		lua_rawseti(luaStatePointer, -2, imageIndex++);
+		hasError |= result.FileName.empty();
+	}
+	lua_setfield(luaStatePointer, -2, "images");
+	lua_pushboolean(luaStatePointer, hasError ? 1 : 0);
+	lua_setfield(luaStatePointer, -2, "isError");
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------
+// DispatchProductsChangedEventTask Class Members
+//---------------------------------------------------------------------------------
+
+const char DispatchProductsChangedEventTask::kLuaEventName[] = "productsChanged";
+
+DispatchProductsChangedEventTask::DispatchProductsChangedEventTask()
+{
+}
+
+DispatchProductsChangedEventTask::~DispatchProductsChangedEventTask()
+{
+}
+
+void DispatchProductsChangedEventTask::AcquireEventDataFrom(
+	std::vector<std::string>&& addedIds, std::vector<std::string>&& changedIds,
+	std::vector<std::string>&& removedIds)
+{
+	fAddedIds = std::move(addedIds);
+	fChangedIds = std::move(changedIds);
+	fRemovedIds = std::move(removedIds);
+}
+
+const char* DispatchProductsChangedEventTask::GetLuaEventName() const
+{
+	return kLuaEventName;
+}
+
+bool DispatchProductsChangedEventTask::PushLuaEventTableTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+
+	// Push the event data to Lua.
+	// Note: Listeners are expected to call loadProducts() again, which is answered from the refreshed catalog.
+	CoronaLuaNewEvent(luaStatePointer, kLuaEventName);
+	PushStringArrayTo(luaStatePointer, fAddedIds);
+	lua_setfield(luaStatePointer, -2, "added");
+	PushStringArrayTo(luaStatePointer, fChangedIds);
+	lua_setfield(luaStatePointer, -2, "changed");
+	PushStringArrayTo(luaStatePointer, fRemovedIds);
+	lua_setfield(luaStatePointer, -2, "removed");
+	lua_pushboolean(luaStatePointer, 0);
+	lua_setfield(luaStatePointer, -2, "isError");
+	return true;
+}
+
+void DispatchProductsChangedEventTask::PushStringArrayTo(
+	lua_State* luaStatePointer, const std::vector<std::string>& strings)
+{
+	lua_createtable(luaStatePointer, (int)strings.size(), 0);
+	int arrayIndex = 1;
+	for (auto&& value : strings)
+	{
+		lua_pushlstring(luaStatePointer, value.c_str(), value.length());
+		lua_rawseti(luaStatePointer, -2, arrayIndex++);
+	}
+}
+
+
+//---------------------------------------------------------------------------------
+// DispatchStoreTransactionEventTask Class Members
+//---------------------------------------------------------------------------------
+
+const char DispatchStoreTransactionEventTask::kLuaEventName[] = "storeTransaction";
+
+DispatchStoreTransactionEventTask::DispatchStoreTransactionEventTask()
+:	fUserHandle(0)
+{
+}
+
+DispatchStoreTransactionEventTask::~DispatchStoreTransactionEventTask()
+{
+}
+
+void DispatchStoreTransactionEventTask::AcquireEventDataFrom(std::vector<EcomStore::Transaction>&& transactions)
+{
+	fTransactions = std::move(transactions);
+}
+
+void DispatchStoreTransactionEventTask::SetUserHandle(int value)
+{
+	fUserHandle = value;
+}
+
+const char* DispatchStoreTransactionEventTask::GetLuaEventName() const
+{
+	return kLuaEventName;
+}
+
+bool DispatchStoreTransactionEventTask::PushLuaEventTableTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+
+	// Fetch the current time in system.getTimer() milliseconds, used to convert checkout timings to it.
+	// This way checkout timings can be compared with the times measured by the game, such as a button tap.
+	auto now = std::chrono::steady_clock::now();
+	double systemTimerNow = FetchSystemTimerFrom(luaStatePointer);
+	auto toSystemTimer = [now, systemTimerNow](std::chrono::steady_clock::time_point value)
+	{
+		return systemTimerNow - std::chrono::duration<double, std::milli>(now - value).count();
+	};
+
+	// Push the event data to Lua.
+	CoronaLuaNewEvent(luaStatePointer, kLuaEventName);
+	bool hasError = false;
+	lua_createtable(luaStatePointer, (int)fTransactions.size(), 0);
+	int transactionIndex = 1;
+	for (auto&& transaction : fTransactions)
+	{
+		bool isError = (transaction.Result != EOS_EResult::EOS_Success);
+		hasError |= isError;
+		lua_createtable(luaStatePointer, 0, 8);
+		lua_pushstring(luaStatePointer, transaction.State);
+		lua_setfield(luaStatePointer, -2, "state");
+		if (!transaction.Identifier.empty())
+		{
+			lua_pushlstring(luaStatePointer, transaction.Identifier.c_str(), transaction.Identifier.length());
+			lua_setfield(luaStatePointer, -2, "identifier");
+		}
+		if (!transaction.ProductIdentifier.empty())
+		{
+			lua_pushlstring(
+					luaStatePointer, transaction.ProductIdentifier.c_str(), transaction.ProductIdentifier.length());
+			lua_setfield(luaStatePointer, -2, "productIdentifier");
+		}
+		lua_createtable(luaStatePointer, (int)transaction.EntitlementIds.size(), 0);
+		int entitlementIndex = 1;
+		for (auto&& entitlementId : transaction.EntitlementIds)
+		{
+			lua_pushlstring(luaStatePointer, entitlementId.c_str(), entitlementId.length());
+			lua_rawseti(luaStatePointer, -2, entitlementIndex++);
+		}
+		lua_setfield(luaStatePointer, -2, "entitlementIds");
+		lua_pushboolean(luaStatePointer, isError ? 1 : 0);
+		lua_setfield(luaStatePointer, -2, "isError");
+		lua_pushinteger(luaStatePointer, (int)transaction.Result);
+		lua_setfield(luaStatePointer, -2, "resultCode");
+		if (transaction.CheckoutTimingPointer)
+		{
+			auto& timing = *transaction.CheckoutTimingPointer;
+			lua_createtable(luaStatePointer, 0, 4);
+			lua_pushnumber(luaStatePointer, toSystemTimer(timing.RequestTime));
+			lua_setfield(luaStatePointer, -2, "requestIssued");
+			if (timing.WasOverlayShown)
+			{
+				lua_pushnumber(luaStatePointer, toSystemTimer(timing.OverlayShownTime));
+				lua_setfield(luaStatePointer, -2, "overlayShown");
+			}
+			lua_pushnumber(luaStatePointer, toSystemTimer(timing.ResultTime));
+			lua_setfield(luaStatePointer, -2, "resultReceived");
+			lua_pushboolean(luaStatePointer, timing.WasPrepared ? 1 : 0);
+			lua_setfield(luaStatePointer, -2, "isPrepared");
+			lua_setfield(luaStatePointer, -2, "timing");
+		}
+		lua_rawseti(luaStatePointer, -2, transactionIndex++);
+	}
+	lua_setfield(luaStatePointer, -2, "transactions");
+	lua_pushinteger(luaStatePointer, fUserHandle);
+	lua_setfield(luaStatePointer, -2, "userHandle");
+	lua_pushboolean(luaStatePointer, hasError ? 1 : 0);
+	lua_setfield(luaStatePointer, -2, "isError");
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------
+// DispatchQueryOwnershipEventTask Class Members
+//---------------------------------------------------------------------------------
+
+const char DispatchQueryOwnershipEventTask::kLuaEventName[] = "queryOwnership";
+
+DispatchQueryOwnershipEventTask::DispatchQueryOwnershipEventTask()
+:	fResult(EOS_EResult::EOS_Success),
+	fUserHandle(0)
+{
+}
+
+DispatchQueryOwnershipEventTask::~DispatchQueryOwnershipEventTask()
+{
+}
+
+void DispatchQueryOwnershipEventTask::AcquireEventDataFrom(
+	std::vector<EcomStore::ItemOwnership>&& ownerships, EOS_EResult resultCode)
+{
+	fOwnerships = std::move(ownerships);
+	fResult = resultCode;
+}
+
+void DispatchQueryOwnershipEventTask::SetUserHandle(int value)
+{
+	fUserHandle = value;
+}
+
+const char* DispatchQueryOwnershipEventTask::GetLuaEventName() const
+{
+	return kLuaEventName;
+}
+
+bool DispatchQueryOwnershipEventTask::PushLuaEventTableTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+
+	// Push the event data to Lua.
+	CoronaLuaNewEvent(luaStatePointer, kLuaEventName);
+	lua_createtable(luaStatePointer, (int)fOwnerships.size(), 0);
+	int itemIndex = 1;
+	for (auto&& ownership : fOwnerships)
+	{
+		lua_createtable(luaStatePointer, 0, 2);
+		lua_pushlstring(luaStatePointer, ownership.Id.c_str(), ownership.Id.length());
+		lua_setfield(luaStatePointer, -2, "id");
+		lua_pushboolean(luaStatePointer, ownership.IsOwned ? 1 : 0);
+		lua_setfield(luaStatePointer, -2, "isOwned");
+		lua_rawseti(luaStatePointer, -2, itemIndex++);
+	}
+	lua_setfield(luaStatePointer, -2, "items");
+	lua_pushinteger(luaStatePointer, fUserHandle);
+	lua_setfield(luaStatePointer, -2, "userHandle");
+	lua_pushboolean(luaStatePointer, (fResult != EOS_EResult::EOS_Success) ? 1 : 0);
+	lua_setfield(luaStatePointer, -2, "isError");
+	lua_pushinteger(luaStatePointer, (int)fResult);
+	lua_setfield(luaStatePointer, -2, "resultCode");
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------
+// DispatchQueryEntitlementsEventTask Class Members
+//---------------------------------------------------------------------------------
+
+const char DispatchQueryEntitlementsEventTask::kLuaEventName[] = "queryEntitlements";
+
+DispatchQueryEntitlementsEventTask::DispatchQueryEntitlementsEventTask()
+:	fResult(EOS_EResult::EOS_Success),
+	fUserHandle(0)
+{
+}
+
+DispatchQueryEntitlementsEventTask::~DispatchQueryEntitlementsEventTask()
+{
+}
+
+void DispatchQueryEntitlementsEventTask::AcquireEventDataFrom(
+	std::vector<EcomStore::Entitlement>&& entitlements, EOS_EResult resultCode)
+{
+	fEntitlements = std::move(entitlements);
+	fResult = resultCode;
+}
+
+void DispatchQueryEntitlementsEventTask::SetUserHandle(int value)
+{
+	fUserHandle = value;
+}
+
+const char* DispatchQueryEntitlementsEventTask::GetLuaEventName() const
+{
+	return kLuaEventName;
+}
+
+bool DispatchQueryEntitlementsEventTask::PushLuaEventTableTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+
+	// Push the event data to Lua.
+	CoronaLuaNewEvent(luaStatePointer, kLuaEventName);
+	lua_createtable(luaStatePointer, (int)fEntitlements.size(), 0);
+	int entitlementIndex = 1;
+	for (auto&& entitlement : fEntitlements)
+	{
+		lua_createtable(luaStatePointer, 0, 5);
+		lua_pushlstring(luaStatePointer, entitlement.Name.c_str(), entitlement.Name.length());
+		lua_setfield(luaStatePointer, -2, "name");
+		lua_pushlstring(luaStatePointer, entitlement.Id.c_str(), entitlement.Id.length());
+		lua_setfield(luaStatePointer, -2, "id");
+		lua_pushlstring(luaStatePointer, entitlement.CatalogItemId.c_str(), entitlement.CatalogItemId.length());
+		lua_setfield(luaStatePointer, -2, "catalogItemId");
+		lua_pushboolean(luaStatePointer, entitlement.IsRedeemed ? 1 : 0);
+		lua_setfield(luaStatePointer, -2, "isRedeemed");
+		if (entitlement.EndTimestamp != EOS_ECOM_ENTITLEMENT_ENDTIMESTAMP_UNDEFINED)
+		{
+			lua_pushnumber(luaStatePointer, (double)entitlement.EndTimestamp);
+			lua_setfield(luaStatePointer, -2, "endTime");
+		}
+		lua_rawseti(luaStatePointer, -2, entitlementIndex++);
+	}
+	lua_setfield(luaStatePointer, -2, "entitlements");
+	lua_pushinteger(luaStatePointer, fUserHandle);
+	lua_setfield(luaStatePointer, -2, "userHandle");
+	lua_pushboolean(luaStatePointer, (fResult != EOS_EResult::EOS_Success) ? 1 : 0);
+	lua_setfield(luaStatePointer, -2, "isError");
+	lua_pushinteger(luaStatePointer, (int)fResult);
+	lua_setfield(luaStatePointer, -2, "resultCode");
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------
+// DispatchEcomTokenEventTask Class Members
+//---------------------------------------------------------------------------------
+
+const char DispatchEcomTokenEventTask::kOwnershipTokenLuaEventName[] = "ownershipToken";
+const char DispatchEcomTokenEventTask::kEntitlementTokenLuaEventName[] = "entitlementToken";
+
+DispatchEcomTokenEventTask::DispatchEcomTokenEventTask()
+:	fIsOwnershipToken(true),
+	fResult(EOS_EResult::EOS_Success),
+	fUserHandle(0)
+{
+}
+
+DispatchEcomTokenEventTask::~DispatchEcomTokenEventTask()
+{
+}
+
+void DispatchEcomTokenEventTask::AcquireEventDataFrom(
+	bool isOwnershipToken, std::vector<EcomStore::EcomToken>&& tokens, EOS_EResult resultCode)
+{
+	fIsOwnershipToken = isOwnershipToken;
+	fTokens = std::move(tokens);
+	fResult = resultCode;
+}
+
+void DispatchEcomTokenEventTask::SetUserHandle(int value)
+{
+	fUserHandle = value;
+}
+
+const char* DispatchEcomTokenEventTask::GetLuaEventName() const
+{
+	return fIsOwnershipToken ? kOwnershipTokenLuaEventName : kEntitlementTokenLuaEventName;
+}
+
+bool DispatchEcomTokenEventTask::PushLuaEventTableTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+
+	// Push the event data to Lua.
+	CoronaLuaNewEvent(luaStatePointer, GetLuaEventName());
+	lua_createtable(luaStatePointer, (int)fTokens.size(), 0);
+	int tokenIndex = 1;
+	for (auto&& token : fTokens)
+	{
+		lua_createtable(luaStatePointer, 0, 4);
+		lua_pushlstring(luaStatePointer, token.Token.c_str(), token.Token.length());
+		lua_setfield(luaStatePointer, -2, "token");
+		lua_createtable(luaStatePointer, (int)token.Ids.size(), 0);
+		int idIndex = 1;
+		for (auto&& id : token.Ids)
+		{
+			lua_pushlstring(luaStatePointer, id.c_str(), id.length());
+			lua_rawseti(luaStatePointer, -2, idIndex++);
+		}
+		lua_setfield(luaStatePointer, -2, "ids");
+		if (token.ExpirationTime > 0)
+		{
+			lua_pushnumber(luaStatePointer, (double)token.ExpirationTime);
+			lua_setfield(luaStatePointer, -2, "expirationTime");
+		}
+		lua_pushboolean(luaStatePointer, token.IsVerified ? 1 : 0);
+		lua_setfield(luaStatePointer, -2, "isVerified");
+		lua_rawseti(luaStatePointer, -2, tokenIndex++);
+	}
+	lua_setfield(luaStatePointer, -2, "tokens");
+	lua_pushinteger(luaStatePointer, fUserHandle);
+	lua_setfield(luaStatePointer, -2, "userHandle");
+	lua_pushboolean(luaStatePointer, (fResult != EOS_EResult::EOS_Success) ? 1 : 0);
+	lua_setfield(luaStatePointer, -2, "isError");
+	lua_pushinteger(luaStatePointer, (int)fResult);
+	lua_setfield(luaStatePointer, -2, "resultCode");
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------
+// DispatchP2PPacketsEventTask Class Members
+//---------------------------------------------------------------------------------
+
+const char DispatchP2PPacketsEventTask::kLuaEventName[] = "p2pPackets";
+
+DispatchP2PPacketsEventTask::DispatchP2PPacketsEventTask()
+:	fUserHandle(0),
+	fChannel(0),
+	fBufferLuaReference(LUA_NOREF)
+{
+}
+
+DispatchP2PPacketsEventTask::~DispatchP2PPacketsEventTask()
+{
+}
+
+void DispatchP2PPacketsEventTask::AcquireEventDataFrom(
+	int userHandle, uint8_t channel, int bufferLuaReference, std::vector<P2PManager::ReceivedPacket>&& packets)
+{
+	fUserHandle = userHandle;
+	fChannel = channel;
+	fBufferLuaReference = bufferLuaReference;
+	fPackets = std::move(packets);
+}
+
+const char* DispatchP2PPacketsEventTask::GetLuaEventName() const
+{
+	return kLuaEventName;
+}
+
+bool DispatchP2PPacketsEventTask::PushLuaEventTableTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+
+	// Push the event data to Lua.
+	// Packets are provided as parallel arrays instead of a table per packet to minimize garbage.
+	CoronaLuaNewEvent(luaStatePointer, kLuaEventName);
+	lua_rawgeti(luaStatePointer, LUA_REGISTRYINDEX, fBufferLuaReference);
+	lua_setfield(luaStatePointer, -2, "buffer");
+	int packetCount = (int)fPackets.size();
+	lua_createtable(luaStatePointer, packetCount, 0);
+	for (int index = 0; index < packetCount; index++)
+	{
+		lua_pushinteger(luaStatePointer, fPackets[index].Offset);
+		lua_rawseti(luaStatePointer, -2, index + 1);
+	}
+	lua_setfield(luaStatePointer, -2, "offsets");
+	lua_createtable(luaStatePointer, packetCount, 0);
+	for (int index = 0; index < packetCount; index++)
+	{
+		lua_pushinteger(luaStatePointer, fPackets[index].Length);
+		lua_rawseti(luaStatePointer, -2, index + 1);
+	}
+	lua_setfield(luaStatePointer, -2, "lengths");
+	lua_createtable(luaStatePointer, packetCount, 0);
+	for (int index = 0; index < packetCount; index++)
+	{
+		PushProductUserIdTo(luaStatePointer, fPackets[index].PeerId);
+		lua_rawseti(luaStatePointer, -2, index + 1);
+	}
+	lua_setfield(luaStatePointer, -2, "peerIds");
+	lua_createtable(luaStatePointer, packetCount, 0);
+	for (int index = 0; index < packetCount; index++)
+	{
+		lua_pushstring(luaStatePointer, fPackets[index].SocketId.SocketName);
+		lua_rawseti(luaStatePointer, -2, index + 1);
+	}
+	lua_setfield(luaStatePointer, -2, "socketNames");
+	lua_pushinteger(luaStatePointer, packetCount);
+	lua_setfield(luaStatePointer, -2, "count");
+	lua_pushinteger(luaStatePointer, fChannel);
+	lua_setfield(luaStatePointer, -2, "channel");
+	lua_pushinteger(luaStatePointer, fUserHandle);
+	lua_setfield(luaStatePointer, -2, "userHandle");
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------
+// DispatchP2PSnapshotEventTask Class Members
+//---------------------------------------------------------------------------------
+
+const char DispatchP2PSnapshotEventTask::kLuaEventName[] = "p2pSnapshot";
+
+DispatchP2PSnapshotEventTask::DispatchP2PSnapshotEventTask()
+:	fUserHandle(0),
+	fPacket()
+{
+}
+
+DispatchP2PSnapshotEventTask::~DispatchP2PSnapshotEventTask()
+{
+}
+
+void DispatchP2PSnapshotEventTask::AcquireEventDataFrom(
+	int userHandle, const P2PManager::ReceivedPacket& packet,
+	const std::shared_ptr<const SnapshotReplicator::Schema>& schemaPointer,
+	const std::shared_ptr<const SnapshotReplicator::Snapshot>& snapshotPointer)
+{
+	fUserHandle = userHandle;
+	fPacket = packet;
+	fSchemaPointer = schemaPointer;
+	fSnapshotPointer = snapshotPointer;
+}
+
+const char* DispatchP2PSnapshotEventTask::GetLuaEventName() const
+{
+	return kLuaEventName;
+}
+
+bool DispatchP2PSnapshotEventTask::PushLuaEventTableTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer || !fSchemaPointer || !fSnapshotPointer)
+	{
+		return false;
+	}
+
+	// Push the event data to Lua.
+	CoronaLuaNewEvent(luaStatePointer, kLuaEventName);
+	SnapshotReplicator::PushEntitiesTo(luaStatePointer, *fSchemaPointer, fSnapshotPointer->Entities);
+	lua_setfield(luaStatePointer, -2, "entities");
+	lua_pushinteger(luaStatePointer, fSchemaPointer->Id);
+	lua_setfield(luaStatePointer, -2, "schemaId");
+	lua_pushnumber(luaStatePointer, (lua_Number)fSnapshotPointer->Sequence);
+	lua_setfield(luaStatePointer, -2, "sequence");
+	PushProductUserIdTo(luaStatePointer, fPacket.PeerId);
+	lua_setfield(luaStatePointer, -2, "peerId");
+	lua_pushstring(luaStatePointer, fPacket.SocketId.SocketName);
+	lua_setfield(luaStatePointer, -2, "socketName");
+	lua_pushinteger(luaStatePointer, fPacket.Channel);
+	lua_setfield(luaStatePointer, -2, "channel");
+	lua_pushinteger(luaStatePointer, fUserHandle);
+	lua_setfield(luaStatePointer, -2, "userHandle");
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------
+// DispatchP2PMessageEventTask Class Members
+//---------------------------------------------------------------------------------
+
+const char DispatchP2PMessageEventTask::kLuaEventName[] = "p2pMessage";
+
+DispatchP2PMessageEventTask::DispatchP2PMessageEventTask()
+:	fUserHandle(0),
+	fPacket(),
+	fTransferId(0)
+{
+}
+
+DispatchP2PMessageEventTask::~DispatchP2PMessageEventTask()
+{
+}
+
+void DispatchP2PMessageEventTask::AcquireEventDataFrom(
+	int userHandle, const P2PManager::ReceivedPacket& packet, uint32_t transferId,
+	const std::shared_ptr<std::vector<uint8_t>>& bytesPointer)
+{
+	fUserHandle = userHandle;
+	fPacket = packet;
+	fTransferId = transferId;
+	fBytesPointer = bytesPointer;
+}
+
+const char* DispatchP2PMessageEventTask::GetLuaEventName() const
+{
+	return kLuaEventName;
+}
+
+bool DispatchP2PMessageEventTask::PushLuaEventTableTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer || !fBytesPointer)
+	{
+		return false;
+	}
+
+	// Push the event data to Lua.
+	// The message's bytes are swapped into a new buffer owned by Lua instead of being copied.
+	CoronaLuaNewEvent(luaStatePointer, kLuaEventName);
+	auto bufferPointer = ByteBuffer::PushNewTo(luaStatePointer);
+	bufferPointer->SwapBytesWith(*fBytesPointer);
+	lua_setfield(luaStatePointer, -2, "buffer");
+	lua_pushinteger(luaStatePointer, bufferPointer->GetLength());
+	lua_setfield(luaStatePointer, -2, "length");
+	lua_pushnumber(luaStatePointer, (lua_Number)fTransferId);
+	lua_setfield(luaStatePointer, -2, "transferId");
+	PushProductUserIdTo(luaStatePointer, fPacket.PeerId);
+	lua_setfield(luaStatePointer, -2, "peerId");
+	lua_pushstring(luaStatePointer, fPacket.SocketId.SocketName);
+	lua_setfield(luaStatePointer, -2, "socketName");
+	lua_pushinteger(luaStatePointer, fPacket.Channel);
+	lua_setfield(luaStatePointer, -2, "channel");
+	lua_pushinteger(luaStatePointer, fUserHandle);
+	lua_setfield(luaStatePointer, -2, "userHandle");
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------
+// DispatchP2PMessageProgressEventTask Class Members
+//---------------------------------------------------------------------------------
+
+const char DispatchP2PMessageProgressEventTask::kLuaEventName[] = "p2pMessageProgress";
+
+DispatchP2PMessageProgressEventTask::DispatchP2PMessageProgressEventTask()
+:	fUserHandle(0),
+	fPacket(),
+	fTransferId(0),
+	fReceivedByteCount(0),
+	fTotalByteCount(0)
+{
+}
+
+DispatchP2PMessageProgressEventTask::~DispatchP2PMessageProgressEventTask()
+{
+}
+
+void DispatchP2PMessageProgressEventTask::AcquireEventDataFrom(
+	int userHandle, const P2PManager::ReceivedPacket& packet, uint32_t transferId,
+	uint32_t receivedByteCount, uint32_t totalByteCount)
+{
+	fUserHandle = userHandle;
+	fPacket = packet;
+	fTransferId = transferId;
+	fReceivedByteCount = receivedByteCount;
+	fTotalByteCount = totalByteCount;
+}
+
+const char* DispatchP2PMessageProgressEventTask::GetLuaEventName() const
+{
+	return kLuaEventName;
+}
+
+bool DispatchP2PMessageProgressEventTask::PushLuaEventTableTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+
+	// Push the event data to Lua.
+	CoronaLuaNewEvent(luaStatePointer, kLuaEventName);
+	lua_pushnumber(luaStatePointer, (lua_Number)fReceivedByteCount);
+	lua_setfield(luaStatePointer, -2, "receivedByteCount");
+	lua_pushnumber(luaStatePointer, (lua_Number)fTotalByteCount);
+	lua_setfield(luaStatePointer, -2, "totalByteCount");
+	lua_pushnumber(luaStatePointer, (lua_Number)fTransferId);
+	lua_setfield(luaStatePointer, -2, "transferId");
+	PushProductUserIdTo(luaStatePointer, fPacket.PeerId);
+	lua_setfield(luaStatePointer, -2, "peerId");
+	lua_pushstring(luaStatePointer, fPacket.SocketId.SocketName);
+	lua_setfield(luaStatePointer, -2, "socketName");
+	lua_pushinteger(luaStatePointer, fPacket.Channel);
+	lua_setfield(luaStatePointer, -2, "channel");
+	lua_pushinteger(luaStatePointer, fUserHandle);
+	lua_setfield(luaStatePointer, -2, "userHandle");
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------
+// DispatchP2PConnectionEventTask Class Members
+//---------------------------------------------------------------------------------
+
+const char DispatchP2PConnectionEventTask::kLuaEventName[] = "p2pConnection";
+
+DispatchP2PConnectionEventTask::DispatchP2PConnectionEventTask()
+:	fUserHandle(0),
+	fPhaseName(""),
+	fPeerId(nullptr),
+	fWasAccepted(false),
+	fIsReconnection(false),
+	fNetworkType(EOS_ENetworkConnectionType::EOS_NCT_NoConnection),
+	fReason(EOS_EConnectionClosedReason::EOS_CCR_Unknown)
+{
+}
+
+DispatchP2PConnectionEventTask::~DispatchP2PConnectionEventTask()
+{
+}
+
+void DispatchP2PConnectionEventTask::AcquireEventDataFrom(
+	int userHandle, const EOS_P2P_OnIncomingConnectionRequestInfo& data, bool wasAccepted)
+{
+	fUserHandle = userHandle;
+	fPhaseName = "request";
+	fPeerId = data.RemoteUserId;
+	fSocketName = data.SocketId ? data.SocketId->SocketName : "";
+	fWasAccepted = wasAccepted;
+}
+
+void DispatchP2PConnectionEventTask::AcquireEventDataFrom(
+	int userHandle, const EOS_P2P_OnPeerConnectionEstablishedInfo& data)
+{
+	fUserHandle = userHandle;
+	fPhaseName = "established";
+	fPeerId = data.RemoteUserId;
+	fSocketName = data.SocketId ? data.SocketId->SocketName : "";
+	fIsReconnection = (data.ConnectionType == EOS_EConnectionEstablishedType::EOS_CET_Reconnection);
+	fNetworkType = data.NetworkType;
+}
+
+void DispatchP2PConnectionEventTask::AcquireEventDataFrom(
+	int userHandle, const EOS_P2P_OnPeerConnectionInterruptedInfo& data)
+{
+	fUserHandle = userHandle;
+	fPhaseName = "interrupted";
+	fPeerId = data.RemoteUserId;
+	fSocketName = data.SocketId ? data.SocketId->SocketName : "";
+}
+
+void DispatchP2PConnectionEventTask::AcquireEventDataFrom(
+	int userHandle, const EOS_P2P_OnRemoteConnectionClosedInfo& data)
+{
+	fUserHandle = userHandle;
+	fPhaseName = "closed";
+	fPeerId = data.RemoteUserId;
+	fSocketName = data.SocketId ? data.SocketId->SocketName : "";
+	fReason = data.Reason;
+}
+
+const char* DispatchP2PConnectionEventTask::GetLuaEventName() const
+{
+	return kLuaEventName;
+}
+
+bool DispatchP2PConnectionEventTask::PushLuaEventTableTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+
+	// Push the event data to Lua. Only the fields relevant to the event's phase are provided.
+	CoronaLuaNewEvent(luaStatePointer, kLuaEventName);
+	lua_pushstring(luaStatePointer, fPhaseName);
+	lua_setfield(luaStatePointer, -2, "phase");
+	PushProductUserIdTo(luaStatePointer, fPeerId);
+	lua_setfield(luaStatePointer, -2, "peerId");
+	lua_pushstring(luaStatePointer, fSocketName.c_str());
+	lua_setfield(luaStatePointer, -2, "socketName");
+	lua_pushinteger(luaStatePointer, fUserHandle);
+	lua_setfield(luaStatePointer, -2, "userHandle");
+	if (!strcmp(fPhaseName, "request"))
+	{
+		lua_pushboolean(luaStatePointer, fWasAccepted ? 1 : 0);
+		lua_setfield(luaStatePointer, -2, "isAutoAccepted");
+	}
+	else if (!strcmp(fPhaseName, "established"))
+	{
+		lua_pushboolean(luaStatePointer, fIsReconnection ? 1 : 0);
+		lua_setfield(luaStatePointer, -2, "isReconnection");
+		lua_pushstring(luaStatePointer, P2PConnectionManager::GetNameOf(fNetworkType));
+		lua_setfield(luaStatePointer, -2, "networkType");
+	}
+	else if (!strcmp(fPhaseName, "closed"))
+	{
+		lua_pushstring(luaStatePointer, P2PConnectionManager::GetNameOf(fReason));
+		lua_setfield(luaStatePointer, -2, "reason");
+	}
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------
+// DispatchP2PStatsEventTask Class Members
+//---------------------------------------------------------------------------------
+
+const char DispatchP2PStatsEventTask::kLuaEventName[] = "p2pStats";
+
+DispatchP2PStatsEventTask::DispatchP2PStatsEventTask()
+:	fHasQueueInfo(false),
+	fQueueInfo(),
+	fOverflowStats()
+{
+}
+
+DispatchP2PStatsEventTask::~DispatchP2PStatsEventTask()
+{
+}
+
+void DispatchP2PStatsEventTask::AcquireEventDataFrom(
+	const std::vector<PeerEntry>& peers, const EOS_P2P_PacketQueueInfo* queueInfoPointer,
+	const P2PQueueManager::OverflowStats& overflowStats)
+{
+	fOverflowStats = overflowStats;
+	fPeers = peers;
+	fHasQueueInfo = (queueInfoPointer != nullptr);
+	if (queueInfoPointer)
+	{
+		fQueueInfo = *queueInfoPointer;
+	}
+}
+
+const char* DispatchP2PStatsEventTask::GetLuaEventName() const
+{
+	return kLuaEventName;
+}
+
+bool DispatchP2PStatsEventTask::PushLuaEventTableTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+
+	// Push the event data to Lua.
+	CoronaLuaNewEvent(luaStatePointer, kLuaEventName);
+	lua_createtable(luaStatePointer, (int)fPeers.size(), 0);
+	for (size_t index = 0; index < fPeers.size(); index++)
+	{
+		auto& peer = fPeers[index];
+		lua_createtable(luaStatePointer, 0, 12);
+		P2PLinkStats::SetLuaFieldsFrom(luaStatePointer, peer.Stats);
+		PushProductUserIdTo(luaStatePointer, peer.PeerId);
+		lua_setfield(luaStatePointer, -2, "peerId");
+		lua_pushinteger(luaStatePointer, peer.UserHandle);
+		lua_setfield(luaStatePointer, -2, "userHandle");
+		lua_rawseti(luaStatePointer, -2, (int)index + 1);
+	}
+	lua_setfield(luaStatePointer, -2, "peers");
+	if (fHasQueueInfo)
+	{
+		P2PLinkStats::SetLuaFieldsFrom(luaStatePointer, fQueueInfo);
+	}
+	P2PQueueManager::SetLuaFieldsFrom(luaStatePointer, fOverflowStats);
+	return true;
+}
@@ -9,10 +9,15 @@
 
 #pragma once
 
+#include "EcomStore.h"
+#include "EosIdCache.h"
+#include "ImageCache.h"
 #include "LuaEventDispatcher.h"
+#include "P2PManager.h"
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "eos_sdk.h"
 
@@ -39,12 +44,28 @@ class BaseDispatchEventTask
 
 		std::shared_ptr<LuaEventDispatcher> GetLuaEventDispatcher() const;
 		void SetLuaEventDispatcher(const std::shared_ptr<LuaEventDispatcher>& dispatcherPointer);
+		std::shared_ptr<EosIdCache> GetIdCache() const;
+		void SetIdCache(const std::shared_ptr<EosIdCache>& cachePointer);
 		virtual const char* GetLuaEventName() const = 0;
 		virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const = 0;
 		bool Execute();
 
+	protected:
+		/**
+		  Pushes the given Epic account ID to Lua as a string, or nil if null.
+		  Uses the assigned ID cache if available, making recurring IDs a single registry lookup.
+		 */
+		void PushEpicAccountIdTo(lua_State* luaStatePointer, EOS_EpicAccountId accountId) const;
+
+		/**
+		  Pushes the given product user ID to Lua as a string, or nil if null.
+		  Uses the assigned ID cache if available, making recurring IDs a single registry lookup.
+		 */
+		void PushProductUserIdTo(lua_State* luaStatePointer, EOS_ProductUserId productUserId) const;
+
 	private:
 		std::shared_ptr<LuaEventDispatcher> fLuaEventDispatcherPointer;
+		std::shared_ptr<EosIdCache> fIdCachePointer;
 };
 
 
@@ -78,10 +99,394 @@ public:
 	virtual ~DispatchLoginResponseEventTask();
 
 	void AcquireEventDataFrom(const EOS_Auth_LoginCallbackInfo* Data);
+	void SetUserHandle(int value);
+	virtual const char* GetLuaEventName() const;
+	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
+
+private:
+	EOS_EResult fResult;
+	int fUserHandle;
+	EOS_EpicAccountId fSelectedAccountId;
+};
+
+/** Dispatches the result of a local user's Auth interface logout to Lua. */
+class DispatchLogoutResponseEventTask : public BaseDispatchEventTask
+{
+public:
+	static const char kLuaEventName[];
+
+	DispatchLogoutResponseEventTask();
+	virtual ~DispatchLogoutResponseEventTask();
+
+	void AcquireEventDataFrom(EOS_EResult resultCode);
+	void SetUserHandle(int value);
+	virtual const char* GetLuaEventName() const;
+	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
+
+private:
+	EOS_EResult fResult;
+	int fUserHandle;
+};
+
+/** Dispatches the result of a Connect interface login or session refresh to Lua. */
+class DispatchConnectLoginResponseEventTask : public BaseDispatchEventTask
+{
+public:
+	static const char kLuaEventName[];
+
+	DispatchConnectLoginResponseEventTask();
+	virtual ~DispatchConnectLoginResponseEventTask();
+
+	void AcquireEventDataFrom(EOS_EResult resultCode, EOS_ProductUserId productUserId);
+	void SetIsRefresh(bool value);
+	void SetUserHandle(int value);
+	virtual const char* GetLuaEventName() const;
+	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
+
+private:
+	EOS_EResult fResult;
+	bool fIsRefresh;
+	int fUserHandle;
+	EOS_ProductUserId fProductUserId;
+};
+
+/** Dispatches all local user login state changes that occurred during 1 frame to Lua as a single event. */
+class DispatchLoginStatusEventTask : public BaseDispatchEventTask
+{
+public:
+	static const char kLuaEventName[];
+
+	DispatchLoginStatusEventTask();
+	virtual ~DispatchLoginStatusEventTask();
+
+	void AddStatusChange(int userHandle, const char* statusName, const char* previousStatusName);
+	bool HasStatusChanges() const;
+	void SetDefaultStatus(const char* statusName);
+	virtual const char* GetLuaEventName() const;
+	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
+
+private:
+	struct StatusChange
+	{
+		int UserHandle;
+		const char* StatusName;
+		const char* PreviousStatusName;
+	};
+
+	std::vector<StatusChange> fStatusChanges;
+	const char* fDefaultStatusName;
+};
+
+/** Dispatches a "loadProducts" event providing offers from the store's catalog to Lua. */
+class DispatchLoadProductsEventTask : public BaseDispatchEventTask
+{
+public:
+	static const char kLuaEventName[];
+
+	DispatchLoadProductsEventTask();
+	virtual ~DispatchLoadProductsEventTask();
+
+	void AcquireEventDataFrom(
+			const std::shared_ptr<const EcomStore::Catalog>& catalogPointer,
+			const std::vector<std::string>& productIds, EOS_EResult resultCode);
+	void SetUserHandle(int value);
+	void SetIsStale(bool value);
+	void SetImageFileNames(
+			std::unordered_map<std::string, std::string>&& fileNames, const std::string& luaDirectoryName);
+	virtual const char* GetLuaEventName() const;
+	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
+
+private:
+	void PushOfferTo(lua_State* luaStatePointer, const EcomStore::CatalogOffer& offer) const;
+	void PushKeyImagesTo(lua_State* luaStatePointer, const std::vector<EcomStore::KeyImage>& images) const;
+
+	EOS_EResult fResult;
+	int fUserHandle;
+	bool fIsStale;
+	std::shared_ptr<const EcomStore::Catalog> fCatalogPointer;
+	std::vector<std::string> fProductIds;
+	std::unordered_map<std::string, std::string> fImageFileNames;
+	std::string fImageLuaDirectoryName;
+};
+
+/** Dispatches the offer and item images that finished downloading to the store's image cache to Lua. */
+class DispatchProductImagesEventTask : public BaseDispatchEventTask
+{
+public:
+	static const char kLuaEventName[];
+
+	DispatchProductImagesEventTask();
+	virtual ~DispatchProductImagesEventTask();
+
+	void AcquireEventDataFrom(std::vector<ImageCache::FetchResult>&& results, const std::string& luaDirectoryName);
+	virtual const char* GetLuaEventName() const;
+	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
+
+private:
+	std::vector<ImageCache::FetchResult> fResults;
+	std::string fLuaDirectoryName;
+};
+
+/** Dispatches the IDs of all offers that changed when the store's catalog was refreshed to Lua. */
+class DispatchProductsChangedEventTask : public BaseDispatchEventTask
+{
+public:
+	static const char kLuaEventName[];
+
+	DispatchProductsChangedEventTask();
+	virtual ~DispatchProductsChangedEventTask();
+
+	void AcquireEventDataFrom(
+			std::vector<std::string>&& addedIds, std::vector<std::string>&& changedIds,
+			std::vector<std::string>&& removedIds);
+	virtual const char* GetLuaEventName() const;
+	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
+
+private:
+	static void PushStringArrayTo(lua_State* luaStatePointer, const std::vector<std::string>& strings);
+
+	std::vector<std::string> fAddedIds;
+	std::vector<std::string> fChangedIds;
+	std::vector<std::string> fRemovedIds;
+};
+
+/** Dispatches the result of a store purchase, restore, or redemption to Lua. */
+class DispatchStoreTransactionEventTask : public BaseDispatchEventTask
+{
+public:
+	static const char kLuaEventName[];
+
+	DispatchStoreTransactionEventTask();
+	virtual ~DispatchStoreTransactionEventTask();
+
+	void AcquireEventDataFrom(std::vector<EcomStore::Transaction>&& transactions);
+	void SetUserHandle(int value);
+	virtual const char* GetLuaEventName() const;
+	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
+
+private:
+	std::vector<EcomStore::Transaction> fTransactions;
+	int fUserHandle;
+};
+
+/** Dispatches the combined result of a batched EOS_Ecom_QueryOwnership() query to Lua. */
+class DispatchQueryOwnershipEventTask : public BaseDispatchEventTask
+{
+public:
+	static const char kLuaEventName[];
+
+	DispatchQueryOwnershipEventTask();
+	virtual ~DispatchQueryOwnershipEventTask();
+
+	void AcquireEventDataFrom(std::vector<EcomStore::ItemOwnership>&& ownerships, EOS_EResult resultCode);
+	void SetUserHandle(int value);
+	virtual const char* GetLuaEventName() const;
+	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
+
+private:
+	std::vector<EcomStore::ItemOwnership> fOwnerships;
+	EOS_EResult fResult;
+	int fUserHandle;
+};
+
+/** Dispatches the combined result of a batched EOS_Ecom_QueryEntitlements() query to Lua. */
+class DispatchQueryEntitlementsEventTask : public BaseDispatchEventTask
+{
+public:
+	static const char kLuaEventName[];
+
+	DispatchQueryEntitlementsEventTask();
+	virtual ~DispatchQueryEntitlementsEventTask();
+
+	void AcquireEventDataFrom(std::vector<EcomStore::Entitlement>&& entitlements, EOS_EResult resultCode);
+	void SetUserHandle(int value);
 	virtual const char* GetLuaEventName() const;
 	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
 
 private:
+	std::vector<EcomStore::Entitlement> fEntitlements;
 	EOS_EResult fResult;
-	char fSelectedAccountID[EOS_EPICACCOUNTID_MAX_LENGTH + 1];
+	int fUserHandle;
+};
+
+/** Dispatches the ownership or entitlement tokens fetched by 1 batched token query to Lua. */
+class DispatchEcomTokenEventTask : public BaseDispatchEventTask
+{
+public:
+	static const char kOwnershipTokenLuaEventName[];
+	static const char kEntitlementTokenLuaEventName[];
+
+	DispatchEcomTokenEventTask();
+	virtual ~DispatchEcomTokenEventTask();
+
+	void AcquireEventDataFrom(bool isOwnershipToken, std::vector<EcomStore::EcomToken>&& tokens, EOS_EResult resultCode);
+	void SetUserHandle(int value);
+	virtual const char* GetLuaEventName() const;
+	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
+
+private:
+	bool fIsOwnershipToken;
+	std::vector<EcomStore::EcomToken> fTokens;
+	EOS_EResult fResult;
+	int fUserHandle;
+};
+
+/**
+  Dispatches the P2P packets that 1 local user received on 1 channel this frame to Lua.
+  The packets are referenced by offset and length within the P2P manager's shared receive buffer.
+ */
+class DispatchP2PPacketsEventTask : public BaseDispatchEventTask
+{
+public:
+	static const char kLuaEventName[];
+
+	DispatchP2PPacketsEventTask();
+	virtual ~DispatchP2PPacketsEventTask();
+
+	void AcquireEventDataFrom(
+			int userHandle, uint8_t channel, int bufferLuaReference, std::vector<P2PManager::ReceivedPacket>&& packets);
+	virtual const char* GetLuaEventName() const;
+	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
+
+private:
+	int fUserHandle;
+	uint8_t fChannel;
+	int fBufferLuaReference;
+	std::vector<P2PManager::ReceivedPacket> fPackets;
+};
+
+
+/** Dispatches a P2P snapshot that 1 local user received from a remote peer to Lua. */
+class DispatchP2PSnapshotEventTask : public BaseDispatchEventTask
+{
+public:
+	static const char kLuaEventName[];
+
+	DispatchP2PSnapshotEventTask();
+	virtual ~DispatchP2PSnapshotEventTask();
+
+	void AcquireEventDataFrom(
+			int userHandle, const P2PManager::ReceivedPacket& packet,
+			const std::shared_ptr<const SnapshotReplicator::Schema>& schemaPointer,
+			const std::shared_ptr<const SnapshotReplicator::Snapshot>& snapshotPointer);
+	virtual const char* GetLuaEventName() const;
+	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
+
+private:
+	int fUserHandle;
+	P2PManager::ReceivedPacket fPacket;
+	std::shared_ptr<const SnapshotReplicator::Schema> fSchemaPointer;
+	std::shared_ptr<const SnapshotReplicator::Snapshot> fSnapshotPointer;
+};
+
+
+/**
+  Dispatches a large P2P message that 1 local user finished receiving from a remote peer to Lua.
+  The message's natively assembled bytes are handed to a new ByteBuffer without being copied.
+ */
+class DispatchP2PMessageEventTask : public BaseDispatchEventTask
+{
+public:
+	static const char kLuaEventName[];
+
+	DispatchP2PMessageEventTask();
+	virtual ~DispatchP2PMessageEventTask();
+
+	void AcquireEventDataFrom(
+			int userHandle, const P2PManager::ReceivedPacket& packet, uint32_t transferId,
+			const std::shared_ptr<std::vector<uint8_t>>& bytesPointer);
+	virtual const char* GetLuaEventName() const;
+	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
+
+private:
+	int fUserHandle;
+	P2PManager::ReceivedPacket fPacket;
+	uint32_t fTransferId;
+	std::shared_ptr<std::vector<uint8_t>> fBytesPointer;
+};
+
+
+/** Dispatches how much of a large P2P message 1 local user received so far to Lua. */
+class DispatchP2PMessageProgressEventTask : public BaseDispatchEventTask
+{
+public:
+	static const char kLuaEventName[];
+
+	DispatchP2PMessageProgressEventTask();
+	virtual ~DispatchP2PMessageProgressEventTask();
+
+	void AcquireEventDataFrom(
+			int userHandle, const P2PManager::ReceivedPacket& packet, uint32_t transferId,
+			uint32_t receivedByteCount, uint32_t totalByteCount);
+	virtual const char* GetLuaEventName() const;
+	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
+
+private:
+	int fUserHandle;
+	P2PManager::ReceivedPacket fPacket;
+	uint32_t fTransferId;
+	uint32_t fReceivedByteCount;
+	uint32_t fTotalByteCount;
+};
+
+
+/**
+  Dispatches a change to a P2P connection between a local user and a remote peer to Lua,
+  such as an incoming connection request or a connection being established, interrupted, or closed.
+ */
+class DispatchP2PConnectionEventTask : public BaseDispatchEventTask
+{
+public:
+	static const char kLuaEventName[];
+
+	DispatchP2PConnectionEventTask();
+	virtual ~DispatchP2PConnectionEventTask();
+
+	void AcquireEventDataFrom(int userHandle, const EOS_P2P_OnIncomingConnectionRequestInfo& data, bool wasAccepted);
+	void AcquireEventDataFrom(int userHandle, const EOS_P2P_OnPeerConnectionEstablishedInfo& data);
+	void AcquireEventDataFrom(int userHandle, const EOS_P2P_OnPeerConnectionInterruptedInfo& data);
+	void AcquireEventDataFrom(int userHandle, const EOS_P2P_OnRemoteConnectionClosedInfo& data);
+	virtual const char* GetLuaEventName() const;
+	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
+
+private:
+	int fUserHandle;
+	const char* fPhaseName;
+	EOS_ProductUserId fPeerId;
+	std::string fSocketName;
+	bool fWasAccepted;
+	bool fIsReconnection;
+	EOS_ENetworkConnectionType fNetworkType;
+	EOS_EConnectionClosedReason fReason;
+};
+
+
+/** Dispatches the link statistics of every remote peer and the state of the EOS packet queues to Lua. */
+class DispatchP2PStatsEventTask : public BaseDispatchEventTask
+{
+public:
+	/** The statistics of 1 link, as provided to AcquireEventDataFrom(). */
+	struct PeerEntry
+	{
+		int UserHandle;
+		EOS_ProductUserId PeerId;
+		P2PLinkStats::PeerStats Stats;
+	};
+
+	static const char kLuaEventName[];
+
+	DispatchP2PStatsEventTask();
+	virtual ~DispatchP2PStatsEventTask();
+
+	void AcquireEventDataFrom(
+			const std::vector<PeerEntry>& peers, const EOS_P2P_PacketQueueInfo* queueInfoPointer,
+			const P2PQueueManager::OverflowStats& overflowStats);
+	virtual const char* GetLuaEventName() const;
+	virtual bool PushLuaEventTableTo(lua_State* luaStatePointer) const;
+
+private:
+	std::vector<PeerEntry> fPeers;
+	bool fHasQueueInfo;
+	EOS_P2P_PacketQueueInfo fQueueInfo;
+	P2PQueueManager::OverflowStats fOverflowStats;
 };
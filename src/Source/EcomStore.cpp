@@ -0,0 +1,2799 @@
+// ----------------------------------------------------------------------------
+//
+// EcomStore.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "EcomStore.h"
+#include "CoronaLua.h"
+#include "DispatchEventTask.h"
+#include "JsonWebToken.h"
+#include "LocalUserSession.h"
+#include "RuntimeContext.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <unordered_set>
+#include "eos_ecom.h"
+#include "eos_ui.h"
+#ifdef _WIN32
+#	include <io.h>
+#else
+#	include <unistd.h>
+#endif
+
+
+//---------------------------------------------------------------------------------
+// Private Constants and Static Variables
+//---------------------------------------------------------------------------------
+
+/** Stores a collection of all EcomStore instances that currently exist. Used to validate EOS callbacks. */
+static std::unordered_set<EcomStore*> sEcomStoreCollection;
+
+/** Stores the "ClientData" of all in-flight batch query requests as void pointers. Used to validate EOS callbacks. */
+static std::unordered_set<void*> sBatchQueryRequestCollection;
+
+/** Default amount of time a fetched catalog is served from memory. */
+static const std::chrono::seconds kDefaultCatalogTimeToLive(300);
+
+/** Identifies a catalog file written by Catalog::WriteTo(). */
+static const char kCatalogFileSignature[4] = { 'E', 'C', 'A', 'T' };
+
+/** Version of the catalog file format. Files of any other version are ignored. */
+static const uint32_t kCatalogFileVersion = 1;
+
+/** Max length of a string read from a catalog file. Guards against allocating huge buffers from a corrupt file. */
+static const uint32_t kCatalogFileMaxStringLength = 1024 * 1024;
+
+/** Max number of elements in an array read from a catalog file. Guards against a corrupt file. */
+static const uint32_t kCatalogFileMaxArrayLength = 65536;
+
+/** Identifies a journal file written by TransactionJournal. */
+static const char kJournalFileSignature[4] = { 'E', 'T', 'X', 'J' };
+
+/** Version of the journal file format. Files of any other version are discarded. */
+static const uint32_t kJournalFileVersion = 2;
+
+/** Oldest journal file version that can still be read. Version 1 files have no redeem records. */
+static const uint32_t kJournalFileMinVersion = 1;
+
+/** Journal record type which adds or replaces a transaction entry. */
+static const uint8_t kJournalRecordTypePut = 1;
+
+/** Journal record type which removes a finished transaction's entry. */
+static const uint8_t kJournalRecordTypeRemove = 2;
+
+/** Journal record type which adds an entitlement waiting to be redeemed. */
+static const uint8_t kJournalRecordTypePutRedeem = 3;
+
+/** Journal record type which removes an entitlement that was redeemed or given up on. */
+static const uint8_t kJournalRecordTypeRemoveRedeem = 4;
+
+/** Number of superseded records a journal file may contain before it is compacted when opened. */
+static const size_t kJournalMaxSupersededRecordCount = 256;
+
+/** Default amount of time finished transactions' entitlements are collected before being redeemed in 1 request. */
+static const std::chrono::seconds kDefaultRedeemInterval(5);
+
+/** Number of failed redeem requests after which an entitlement is given up on until it is restored again. */
+static const int kMaxRedeemAttemptCount = 8;
+
+/** Number of seconds before a cached ownership or entitlement token expires that it is fetched again instead. */
+static const time_t kTokenExpirationMargin = 60;
+
+/** Number of seconds of clock difference with the token issuer tolerated when checking token timestamps. */
+static const double kTokenClockSkewInSeconds = 60;
+
+
+//---------------------------------------------------------------------------------
+// Private Static Functions
+//---------------------------------------------------------------------------------
+
+/** Returns the given EOS string or an empty string if null. */
+static const char* ToSafeString(const char* text)
+{
+	return text ? text : "";
+}
+
+/** Copies the given EOS key image info. */
+static EcomStore::KeyImage CopyKeyImageFrom(const EOS_Ecom_KeyImageInfo& imageInfo)
+{
+	EcomStore::KeyImage image;
+	image.Type = ToSafeString(imageInfo.Type);
+	image.Url = ToSafeString(imageInfo.Url);
+	image.Width = imageInfo.Width;
+	image.Height = imageInfo.Height;
+	return image;
+}
+
+/** Copies the given Epic account ID's string form. Returns an empty string if given null or an invalid ID. */
+static std::string CopyAccountIdStringFrom(EOS_EpicAccountId accountId)
+{
+	char stringId[EOS_EPICACCOUNTID_MAX_LENGTH + 1];
+	int32_t stringIdLength = sizeof(stringId);
+	if (!accountId || (EOS_EpicAccountId_ToString(accountId, stringId, &stringIdLength) != EOS_EResult::EOS_Success))
+	{
+		return std::string();
+	}
+	return std::string(stringId);
+}
+
+/** Copies the given IDs, removing empty and duplicate IDs while preserving the order of the rest. */
+static std::vector<std::string> CopyUniqueIdsFrom(const std::vector<std::string>& ids)
+{
+	std::vector<std::string> uniqueIds;
+	std::unordered_set<std::string> idSet;
+	uniqueIds.reserve(ids.size());
+	for (auto&& id : ids)
+	{
+		if (!id.empty() && idSet.insert(id).second)
+		{
+			uniqueIds.push_back(id);
+		}
+	}
+	return uniqueIds;
+}
+
+/** Copies the given EOS entitlement. */
+static EcomStore::Entitlement CopyEntitlementFrom(const EOS_Ecom_Entitlement& eosEntitlement)
+{
+	EcomStore::Entitlement entitlement;
+	entitlement.Name = ToSafeString(eosEntitlement.EntitlementName);
+	entitlement.Id = ToSafeString(eosEntitlement.EntitlementId);
+	entitlement.CatalogItemId = ToSafeString(eosEntitlement.CatalogItemId);
+	entitlement.IsRedeemed = (eosEntitlement.bRedeemed == EOS_TRUE);
+	entitlement.EndTimestamp = eosEntitlement.EndTimestamp;
+	return entitlement;
+}
+
+/** Flags the given entitlement's name, ID, and catalog item ID as owned by the given user. */
+static void AddEntitlementTo(LocalUserSession& session, const EOS_Ecom_Entitlement& entitlement)
+{
+	session.SetIsEntitledTo(ToSafeString(entitlement.EntitlementName), true);
+	session.SetIsEntitledTo(ToSafeString(entitlement.EntitlementId), true);
+	session.SetIsEntitledTo(ToSafeString(entitlement.CatalogItemId), true);
+}
+
+/** Appends the given integer to the given buffer in little endian byte order. */
+template<class TInteger>
+static void WriteInteger(std::string& buffer, TInteger value)
+{
+	auto unsignedValue = (uint64_t)value;
+	for (size_t index = 0; index < sizeof(TInteger); index++)
+	{
+		buffer.push_back((char)((unsignedValue >> (index * 8)) & 0xFF));
+	}
+}
+
+/** Appends the given string to the given buffer, prefixed by its length. */
+static void WriteString(std::string& buffer, const std::string& value)
+{
+	WriteInteger(buffer, (uint32_t)value.length());
+	buffer.append(value);
+}
+
+/** Appends the given strings to the given buffer, prefixed by their count. */
+static void WriteStringArray(std::string& buffer, const std::vector<std::string>& values)
+{
+	WriteInteger(buffer, (uint32_t)values.size());
+	for (auto&& value : values)
+	{
+		WriteString(buffer, value);
+	}
+}
+
+/** Appends a journal record to the given buffer which adds or replaces the given transaction entry. */
+static void WriteJournalPutRecord(std::string& buffer, const EcomStore::JournalEntry& entry)
+{
+	WriteInteger(buffer, kJournalRecordTypePut);
+	WriteString(buffer, entry.Id);
+	WriteString(buffer, entry.State);
+	WriteString(buffer, entry.ProductIdentifier);
+	WriteStringArray(buffer, entry.EntitlementIds);
+}
+
+/** Appends a journal record to the given buffer which adds an entitlement waiting to be redeemed. */
+static void WriteJournalPutRedeemRecord(std::string& buffer, const EcomStore::PendingRedeem& redeem)
+{
+	WriteInteger(buffer, kJournalRecordTypePutRedeem);
+	WriteString(buffer, redeem.EntitlementId);
+	WriteString(buffer, redeem.AccountId);
+	WriteString(buffer, redeem.TransactionId);
+	WriteString(buffer, redeem.ProductIdentifier);
+}
+
+/** Appends the given key images to the given buffer, prefixed by their count. */
+static void WriteKeyImages(std::string& buffer, const std::vector<EcomStore::KeyImage>& images)
+{
+	WriteInteger(buffer, (uint32_t)images.size());
+	for (auto&& image : images)
+	{
+		WriteString(buffer, image.Type);
+		WriteString(buffer, image.Url);
+		WriteInteger(buffer, image.Width);
+		WriteInteger(buffer, image.Height);
+	}
+}
+
+/**
+  Reads a little endian integer from the given buffer.
+  @param buffer The buffer to read from.
+  @param offset Byte offset to read from. Advanced past the integer if successful.
+  @param value Assigned the integer read.
+  @return Returns true if read. Returns false if the buffer is too short.
+ */
+template<class TInteger>
+static bool ReadInteger(const std::string& buffer, size_t& offset, TInteger& value)
+{
+	if ((buffer.length() < sizeof(TInteger)) || (offset > (buffer.length() - sizeof(TInteger))))
+	{
+		return false;
+	}
+	uint64_t unsignedValue = 0;
+	for (size_t index = 0; index < sizeof(TInteger); index++)
+	{
+		unsignedValue |= (uint64_t)(uint8_t)buffer[offset + index] << (index * 8);
+	}
+	value = (TInteger)unsignedValue;
+	offset += sizeof(TInteger);
+	return true;
+}
+
+/** Reads a length prefixed string from the given buffer. Returns false if the buffer is too short or corrupt. */
+static bool ReadString(const std::string& buffer, size_t& offset, std::string& value)
+{
+	uint32_t length = 0;
+	if (!ReadInteger(buffer, offset, length) || (length > kCatalogFileMaxStringLength))
+	{
+		return false;
+	}
+	if (length > (buffer.length() - offset))
+	{
+		return false;
+	}
+	value.assign(buffer, offset, length);
+	offset += length;
+	return true;
+}
+
+/** Reads a count prefixed string array from the given buffer. Returns false if the buffer is too short or corrupt. */
+static bool ReadStringArray(const std::string& buffer, size_t& offset, std::vector<std::string>& values)
+{
+	uint32_t count = 0;
+	if (!ReadInteger(buffer, offset, count) || (count > kCatalogFileMaxArrayLength))
+	{
+		return false;
+	}
+	values.resize(count);
+	for (auto&& value : values)
+	{
+		if (!ReadString(buffer, offset, value))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Reads count prefixed key images from the given buffer. Returns false if the buffer is too short or corrupt. */
+static bool ReadKeyImages(const std::string& buffer, size_t& offset, std::vector<EcomStore::KeyImage>& images)
+{
+	uint32_t count = 0;
+	if (!ReadInteger(buffer, offset, count) || (count > kCatalogFileMaxArrayLength))
+	{
+		return false;
+	}
+	images.resize(count);
+	for (auto&& image : images)
+	{
+		bool wasRead =
+				ReadString(buffer, offset, image.Type) &&
+				ReadString(buffer, offset, image.Url) &&
+				ReadInteger(buffer, offset, image.Width) &&
+				ReadInteger(buffer, offset, image.Height);
+		if (!wasRead)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+  Reads the entire given file into memory.
+  @param filePath Path of the file to read.
+  @param buffer Assigned the file's contents.
+  @return Returns true if the file was read. Returns false if it does not exist or could not be opened.
+ */
+static bool ReadFileTo(const std::string& filePath, std::string& buffer)
+{
+	buffer.clear();
+	auto filePointer = fopen(filePath.c_str(), "rb");
+	if (!filePointer)
+	{
+		return false;
+	}
+	char readBuffer[4096];
+	size_t readCount;
+	while ((readCount = fread(readBuffer, 1, sizeof(readBuffer), filePointer)) > 0)
+	{
+		buffer.append(readBuffer, readCount);
+	}
+	fclose(filePointer);
+	return true;
+}
+
+/**
+  Writes the given buffer to a temporary file and then replaces the given file with it,
+  so that a crash while writing cannot corrupt the existing file.
+  @param filePath Path of the file to write.
+  @param buffer The bytes to write.
+  @return Returns true if the file was written. Returns false if it could not be written.
+ */
+static bool WriteFileAtomically(const std::string& filePath, const std::string& buffer)
+{
+	// Note: On Windows, rename() cannot replace an existing file, which is why it is removed first.
+	std::string temporaryFilePath = filePath + ".tmp";
+	auto filePointer = fopen(temporaryFilePath.c_str(), "wb");
+	if (!filePointer)
+	{
+		return false;
+	}
+	bool wasWritten = (fwrite(buffer.data(), 1, buffer.length(), filePointer) == buffer.length());
+	wasWritten &= (fclose(filePointer) == 0);
+	if (!wasWritten)
+	{
+		remove(temporaryFilePath.c_str());
+		return false;
+	}
+	remove(filePath.c_str());
+	if (rename(temporaryFilePath.c_str(), filePath.c_str()) != 0)
+	{
+		remove(temporaryFilePath.c_str());
+		return false;
+	}
+	return true;
+}
+
+/** Flushes the given file's buffered writes and syncs them to storage. Returns false on failure. */
+static bool SyncFile(FILE* filePointer)
+{
+	if (fflush(filePointer) != 0)
+	{
+		return false;
+	}
+#ifdef _WIN32
+	return (_commit(_fileno(filePointer)) == 0);
+#else
+	return (fsync(fileno(filePointer)) == 0);
+#endif
+}
+
+
+//---------------------------------------------------------------------------------
+// EcomStore Catalog Structure Members
+//---------------------------------------------------------------------------------
+
+bool EcomStore::KeyImage::operator==(const KeyImage& value) const
+{
+	return (Type == value.Type) && (Url == value.Url) && (Width == value.Width) && (Height == value.Height);
+}
+
+bool EcomStore::KeyImage::operator!=(const KeyImage& value) const
+{
+	return !(*this == value);
+}
+
+bool EcomStore::ItemRelease::operator==(const ItemRelease& value) const
+{
+	return
+			(CompatibleAppIds == value.CompatibleAppIds) &&
+			(CompatiblePlatforms == value.CompatiblePlatforms) &&
+			(ReleaseNote == value.ReleaseNote);
+}
+
+bool EcomStore::ItemRelease::operator!=(const ItemRelease& value) const
+{
+	return !(*this == value);
+}
+
+bool EcomStore::CatalogItem::operator==(const CatalogItem& value) const
+{
+	return
+			(Id == value.Id) &&
+			(EntitlementName == value.EntitlementName) &&
+			(Title == value.Title) &&
+			(Description == value.Description) &&
+			(ItemType == value.ItemType) &&
+			(Images == value.Images) &&
+			(Releases == value.Releases);
+}
+
+bool EcomStore::CatalogItem::operator!=(const CatalogItem& value) const
+{
+	return !(*this == value);
+}
+
+bool EcomStore::CatalogOffer::operator==(const CatalogOffer& value) const
+{
+	return
+			(Id == value.Id) &&
+			(CatalogNamespace == value.CatalogNamespace) &&
+			(Title == value.Title) &&
+			(Description == value.Description) &&
+			(LongDescription == value.LongDescription) &&
+			(CurrencyCode == value.CurrencyCode) &&
+			(PriceResult == value.PriceResult) &&
+			(OriginalPrice == value.OriginalPrice) &&
+			(CurrentPrice == value.CurrentPrice) &&
+			(DecimalPoint == value.DecimalPoint) &&
+			(DiscountPercentage == value.DiscountPercentage) &&
+			(ExpirationTimestamp == value.ExpirationTimestamp) &&
+			(PurchaseLimit == value.PurchaseLimit) &&
+			(ReleaseDateTimestamp == value.ReleaseDateTimestamp) &&
+			(EffectiveDateTimestamp == value.EffectiveDateTimestamp) &&
+			(IsAvailableForPurchase == value.IsAvailableForPurchase) &&
+			(Images == value.Images) &&
+			(Items == value.Items);
+}
+
+bool EcomStore::CatalogOffer::operator!=(const CatalogOffer& value) const
+{
+	return !(*this == value);
+}
+
+
+//---------------------------------------------------------------------------------
+// EcomStore::Catalog Class Members
+//---------------------------------------------------------------------------------
+
+EcomStore::Catalog::Catalog()
+{
+}
+
+EcomStore::Catalog::~Catalog()
+{
+}
+
+void EcomStore::Catalog::AddOffer(CatalogOffer&& offer)
+{
+	// Do not add the same offer twice.
+	if (fOfferIndexes.find(offer.Id) != fOfferIndexes.end())
+	{
+		return;
+	}
+
+	// Index the offer and its items.
+	size_t offerIndex = fOffers.size();
+	fOfferIndexes[offer.Id] = offerIndex;
+	for (auto&& item : offer.Items)
+	{
+		fItemOfferIndexes.emplace(item.Id, offerIndex);
+	}
+	fOffers.push_back(std::move(offer));
+}
+
+const std::vector<EcomStore::CatalogOffer>& EcomStore::Catalog::GetOffers() const
+{
+	return fOffers;
+}
+
+const EcomStore::CatalogOffer* EcomStore::Catalog::GetOfferBy(const std::string& offerId) const
+{
+	auto iterator = fOfferIndexes.find(offerId);
+	if (iterator == fOfferIndexes.end())
+	{
+		return nullptr;
+	}
+	return &fOffers[iterator->second];
+}
+
+const EcomStore::CatalogOffer* EcomStore::Catalog::GetOfferByItemId(const std::string& itemId) const
+{
+	auto iterator = fItemOfferIndexes.find(itemId);
+	if (iterator == fItemOfferIndexes.end())
+	{
+		return nullptr;
+	}
+	return &fOffers[iterator->second];
+}
+
+std::chrono::steady_clock::time_point EcomStore::Catalog::GetFetchTime() const
+{
+	return fFetchTime;
+}
+
+void EcomStore::Catalog::SetFetchTime(std::chrono::steady_clock::time_point value)
+{
+	fFetchTime = value;
+}
+
+bool EcomStore::Catalog::WriteTo(const std::string& filePath) const
+{
+	// Validate.
+	if (filePath.empty())
+	{
+		return false;
+	}
+
+	// Serialize the catalog to memory.
+	std::string buffer;
+	buffer.append(kCatalogFileSignature, sizeof(kCatalogFileSignature));
+	WriteInteger(buffer, kCatalogFileVersion);
+	WriteInteger(buffer, (uint32_t)fOffers.size());
+	for (auto&& offer : fOffers)
+	{
+		WriteString(buffer, offer.Id);
+		WriteString(buffer, offer.CatalogNamespace);
+		WriteString(buffer, offer.Title);
+		WriteString(buffer, offer.Description);
+		WriteString(buffer, offer.LongDescription);
+		WriteString(buffer, offer.CurrencyCode);
+		WriteInteger(buffer, (int32_t)offer.PriceResult);
+		WriteInteger(buffer, offer.OriginalPrice);
+		WriteInteger(buffer, offer.CurrentPrice);
+		WriteInteger(buffer, offer.DecimalPoint);
+		WriteInteger(buffer, offer.DiscountPercentage);
+		WriteInteger(buffer, offer.ExpirationTimestamp);
+		WriteInteger(buffer, offer.PurchaseLimit);
+		WriteInteger(buffer, offer.ReleaseDateTimestamp);
+		WriteInteger(buffer, offer.EffectiveDateTimestamp);
+		WriteInteger(buffer, (uint8_t)(offer.IsAvailableForPurchase ? 1 : 0));
+		WriteKeyImages(buffer, offer.Images);
+		WriteInteger(buffer, (uint32_t)offer.Items.size());
+		for (auto&& item : offer.Items)
+		{
+			WriteString(buffer, item.Id);
+			WriteString(buffer, item.EntitlementName);
+			WriteString(buffer, item.Title);
+			WriteString(buffer, item.Description);
+			WriteInteger(buffer, (int32_t)item.ItemType);
+			WriteKeyImages(buffer, item.Images);
+			WriteInteger(buffer, (uint32_t)item.Releases.size());
+			for (auto&& release : item.Releases)
+			{
+				WriteStringArray(buffer, release.CompatibleAppIds);
+				WriteStringArray(buffer, release.CompatiblePlatforms);
+				WriteString(buffer, release.ReleaseNote);
+			}
+		}
+	}
+
+	// Write to a temporary file and then replace the existing file with it.
+	return WriteFileAtomically(filePath, buffer);
+}
+
+bool EcomStore::Catalog::ReadFrom(const std::string& filePath)
+{
+	// Validate.
+	if (filePath.empty())
+	{
+		return false;
+	}
+
+	// Read the entire file into memory.
+	std::string buffer;
+	if (!ReadFileTo(filePath, buffer))
+	{
+		return false;
+	}
+
+	// Validate the file's header.
+	size_t offset = sizeof(kCatalogFileSignature);
+	if ((buffer.length() < offset) || buffer.compare(0, offset, kCatalogFileSignature, offset) != 0)
+	{
+		return false;
+	}
+	uint32_t version = 0;
+	if (!ReadInteger(buffer, offset, version) || (version != kCatalogFileVersion))
+	{
+		return false;
+	}
+
+	// Deserialize all offers. Nothing is added to this catalog unless the whole file is valid.
+	uint32_t offerCount = 0;
+	if (!ReadInteger(buffer, offset, offerCount) || (offerCount > kCatalogFileMaxArrayLength))
+	{
+		return false;
+	}
+	std::vector<CatalogOffer> offers(offerCount);
+	for (auto&& offer : offers)
+	{
+		int32_t priceResult = 0;
+		uint8_t isAvailableForPurchase = 0;
+		uint32_t itemCount = 0;
+		bool wasRead =
+				ReadString(buffer, offset, offer.Id) &&
+				ReadString(buffer, offset, offer.CatalogNamespace) &&
+				ReadString(buffer, offset, offer.Title) &&
+				ReadString(buffer, offset, offer.Description) &&
+				ReadString(buffer, offset, offer.LongDescription) &&
+				ReadString(buffer, offset, offer.CurrencyCode) &&
+				ReadInteger(buffer, offset, priceResult) &&
+				ReadInteger(buffer, offset, offer.OriginalPrice) &&
+				ReadInteger(buffer, offset, offer.CurrentPrice) &&
+				ReadInteger(buffer, offset, offer.DecimalPoint) &&
+				ReadInteger(buffer, offset, offer.DiscountPercentage) &&
+				ReadInteger(buffer, offset, offer.ExpirationTimestamp) &&
+				ReadInteger(buffer, offset, offer.PurchaseLimit) &&
+				ReadInteger(buffer, offset, offer.ReleaseDateTimestamp) &&
+				ReadInteger(buffer, offset, offer.EffectiveDateTimestamp) &&
+				ReadInteger(buffer, offset, isAvailableForPurchase) &&
+				ReadKeyImages(buffer, offset, offer.Images) &&
+				ReadInteger(buffer, offset, itemCount) &&
+				(itemCount <= kCatalogFileMaxArrayLength);
+		if (!wasRead)
+		{
+			return false;
+		}
+		offer.PriceResult = (EOS_EResult)priceResult;
+		offer.IsAvailableForPurchase = (isAvailableForPurchase != 0);
+		offer.Items.resize(itemCount);
+		for (auto&& item : offer.Items)
+		{
+			int32_t itemType = 0;
+			uint32_t releaseCount = 0;
+			wasRead =
+					ReadString(buffer, offset, item.Id) &&
+					ReadString(buffer, offset, item.EntitlementName) &&
+					ReadString(buffer, offset, item.Title) &&
+					ReadString(buffer, offset, item.Description) &&
+					ReadInteger(buffer, offset, itemType) &&
+					ReadKeyImages(buffer, offset, item.Images) &&
+					ReadInteger(buffer, offset, releaseCount) &&
+					(releaseCount <= kCatalogFileMaxArrayLength);
+			if (!wasRead)
+			{
+				return false;
+			}
+			item.ItemType = (EOS_EEcomItemType)itemType;
+			item.Releases.resize(releaseCount);
+			for (auto&& release : item.Releases)
+			{
+				wasRead =
+						ReadStringArray(buffer, offset, release.CompatibleAppIds) &&
+						ReadStringArray(buffer, offset, release.CompatiblePlatforms) &&
+						ReadString(buffer, offset, release.ReleaseNote);
+				if (!wasRead)
+				{
+					return false;
+				}
+			}
+		}
+	}
+	for (auto&& offer : offers)
+	{
+		AddOffer(std::move(offer));
+	}
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------
+// EcomStore::TransactionJournal Class Members
+//---------------------------------------------------------------------------------
+
+EcomStore::TransactionJournal::TransactionJournal()
+:	fFilePointer(nullptr)
+{
+}
+
+EcomStore::TransactionJournal::~TransactionJournal()
+{
+	Close();
+}
+
+bool EcomStore::TransactionJournal::Open(const std::string& filePath)
+{
+	// Close the last opened journal, if any.
+	Close();
+
+	// Validate.
+	if (filePath.empty())
+	{
+		return false;
+	}
+	fFilePath = filePath;
+
+	// Replay all records in the existing file, if any.
+	// Note: Stops at the first incomplete record, which is expected if the app was terminated while writing.
+	std::string buffer;
+	size_t recordCount = 0;
+	bool isCompactionNeeded = true;
+	size_t offset = sizeof(kJournalFileSignature);
+	uint32_t version = 0;
+	bool isValidFile =
+			ReadFileTo(filePath, buffer) &&
+			(buffer.length() >= offset) &&
+			(buffer.compare(0, offset, kJournalFileSignature, offset) == 0) &&
+			ReadInteger(buffer, offset, version) &&
+			(version >= kJournalFileMinVersion) && (version <= kJournalFileVersion);
+	if (isValidFile)
+	{
+		isCompactionNeeded = false;
+		while (offset < buffer.length())
+		{
+			uint8_t recordType = 0;
+			JournalEntry entry;
+			PendingRedeem redeem;
+			bool wasRead = ReadInteger(buffer, offset, recordType) && ReadString(buffer, offset, entry.Id);
+			if (wasRead && (recordType == kJournalRecordTypePut))
+			{
+				wasRead =
+						ReadString(buffer, offset, entry.State) &&
+						ReadString(buffer, offset, entry.ProductIdentifier) &&
+						ReadStringArray(buffer, offset, entry.EntitlementIds);
+			}
+			else if (wasRead && (recordType == kJournalRecordTypePutRedeem))
+			{
+				redeem.EntitlementId = entry.Id;
+				wasRead =
+						ReadString(buffer, offset, redeem.AccountId) &&
+						ReadString(buffer, offset, redeem.TransactionId) &&
+						ReadString(buffer, offset, redeem.ProductIdentifier);
+			}
+			else if ((recordType != kJournalRecordTypeRemove) && (recordType != kJournalRecordTypeRemoveRedeem))
+			{
+				wasRead = false;
+			}
+			if (!wasRead)
+			{
+				isCompactionNeeded = true;
+				break;
+			}
+			recordCount++;
+			switch (recordType)
+			{
+				case kJournalRecordTypePut:
+				{
+					entry.WasDispatched = false;
+					Put(entry);
+					break;
+				}
+				case kJournalRecordTypeRemove:
+				{
+					std::vector<std::string> entitlementIds;
+					Remove(entry.Id, entitlementIds);
+					break;
+				}
+				case kJournalRecordTypePutRedeem:
+					PutRedeem(redeem);
+					break;
+				case kJournalRecordTypeRemoveRedeem:
+					RemoveRedeem(entry.Id);
+					break;
+			}
+		}
+	}
+	fPendingRecords.clear();
+
+	// Rewrite the file if it is new, corrupt, of an older version, or mostly made up of finished or replaced records.
+	size_t supersededRecordCount = recordCount - fEntries.size() - fRedeems.size();
+	if ((version != kJournalFileVersion) || (supersededRecordCount > kJournalMaxSupersededRecordCount))
+	{
+		isCompactionNeeded = true;
+	}
+	if (isCompactionNeeded && !Compact())
+	{
+		return false;
+	}
+
+	// Open the file for appending new records.
+	// Note: If this fails, then the next Flush() attempts to rewrite the file instead.
+	fFilePointer = fopen(filePath.c_str(), "ab");
+	return (fFilePointer != nullptr);
+}
+
+void EcomStore::TransactionJournal::Close()
+{
+	Flush();
+	if (fFilePointer)
+	{
+		fclose(fFilePointer);
+		fFilePointer = nullptr;
+	}
+	fEntries.clear();
+	fEntitlementTransactionIds.clear();
+	fRedeems.clear();
+	fPendingRecords.clear();
+	fFilePath.clear();
+}
+
+const EcomStore::JournalEntry* EcomStore::TransactionJournal::GetEntryBy(const std::string& transactionId) const
+{
+	auto iterator = fEntries.find(transactionId);
+	return (iterator != fEntries.end()) ? &(iterator->second) : nullptr;
+}
+
+const EcomStore::JournalEntry* EcomStore::TransactionJournal::GetEntryByEntitlementId(
+	const std::string& entitlementId) const
+{
+	auto iterator = fEntitlementTransactionIds.find(entitlementId);
+	return (iterator != fEntitlementTransactionIds.end()) ? GetEntryBy(iterator->second) : nullptr;
+}
+
+void EcomStore::TransactionJournal::Put(const JournalEntry& entry)
+{
+	// Validate.
+	if (entry.Id.empty())
+	{
+		return;
+	}
+
+	// Replace the existing entry, if any, and re-index its entitlements.
+	auto& storedEntry = fEntries[entry.Id];
+	for (auto&& entitlementId : storedEntry.EntitlementIds)
+	{
+		fEntitlementTransactionIds.erase(entitlementId);
+	}
+	storedEntry = entry;
+	for (auto&& entitlementId : storedEntry.EntitlementIds)
+	{
+		fEntitlementTransactionIds[entitlementId] = storedEntry.Id;
+	}
+
+	// Record the change. Written to file on the next Flush().
+	WriteJournalPutRecord(fPendingRecords, storedEntry);
+}
+
+void EcomStore::TransactionJournal::SetWasDispatched(const std::string& transactionId)
+{
+	auto iterator = fEntries.find(transactionId);
+	if (iterator != fEntries.end())
+	{
+		iterator->second.WasDispatched = true;
+	}
+}
+
+bool EcomStore::TransactionJournal::Remove(const std::string& transactionId, std::vector<std::string>& entitlementIds)
+{
+	// Remove the entry and its entitlements' index.
+	auto iterator = fEntries.find(transactionId);
+	if (iterator == fEntries.end())
+	{
+		return false;
+	}
+	for (auto&& entitlementId : iterator->second.EntitlementIds)
+	{
+		fEntitlementTransactionIds.erase(entitlementId);
+	}
+	entitlementIds = std::move(iterator->second.EntitlementIds);
+	fEntries.erase(iterator);
+
+	// Record the change. Written to file on the next Flush().
+	WriteInteger(fPendingRecords, kJournalRecordTypeRemove);
+	WriteString(fPendingRecords, transactionId);
+	return true;
+}
+
+const EcomStore::PendingRedeem* EcomStore::TransactionJournal::GetRedeemBy(const std::string& entitlementId) const
+{
+	auto iterator = fRedeems.find(entitlementId);
+	return (iterator != fRedeems.end()) ? &(iterator->second) : nullptr;
+}
+
+const std::unordered_map<std::string, EcomStore::PendingRedeem>& EcomStore::TransactionJournal::GetRedeems() const
+{
+	return fRedeems;
+}
+
+void EcomStore::TransactionJournal::PutRedeem(const PendingRedeem& redeem)
+{
+	// Validate.
+	if (redeem.EntitlementId.empty())
+	{
+		return;
+	}
+
+	// Add or replace the entry and record the change. Written to file on the next Flush().
+	fRedeems[redeem.EntitlementId] = redeem;
+	WriteJournalPutRedeemRecord(fPendingRecords, redeem);
+}
+
+bool EcomStore::TransactionJournal::RemoveRedeem(const std::string& entitlementId)
+{
+	if (fRedeems.erase(entitlementId) <= 0)
+	{
+		return false;
+	}
+	WriteInteger(fPendingRecords, kJournalRecordTypeRemoveRedeem);
+	WriteString(fPendingRecords, entitlementId);
+	return true;
+}
+
+bool EcomStore::TransactionJournal::Flush()
+{
+	// Do nothing if there are no changes to write.
+	if (fPendingRecords.empty())
+	{
+		return true;
+	}
+	if (fFilePath.empty())
+	{
+		return false;
+	}
+
+	// Rewrite the whole file if it could not be opened or the last write failed,
+	// since a failed write may have left a partial record at the end of the file.
+	if (!fFilePointer)
+	{
+		if (!Compact())
+		{
+			return false;
+		}
+		fPendingRecords.clear();
+		fFilePointer = fopen(fFilePath.c_str(), "ab");
+		return true;
+	}
+
+	// Append all of the changes with a single write and sync.
+	// Note: Changes are kept pending on failure so that they are retried by the next flush.
+	bool wasWritten =
+			(fwrite(fPendingRecords.data(), 1, fPendingRecords.length(), fFilePointer) == fPendingRecords.length());
+	wasWritten &= SyncFile(fFilePointer);
+	if (!wasWritten)
+	{
+		CoronaLog("WARNING: [EOS SDK] Failed to write store transaction journal: %s", fFilePath.c_str());
+		fclose(fFilePointer);
+		fFilePointer = nullptr;
+		return false;
+	}
+	fPendingRecords.clear();
+	return true;
+}
+
+bool EcomStore::TransactionJournal::Compact()
+{
+	// Serialize 1 record per unfinished transaction and per entitlement waiting to be redeemed.
+	std::string buffer;
+	buffer.append(kJournalFileSignature, sizeof(kJournalFileSignature));
+	WriteInteger(buffer, kJournalFileVersion);
+	for (auto&& pair : fEntries)
+	{
+		WriteJournalPutRecord(buffer, pair.second);
+	}
+	for (auto&& pair : fRedeems)
+	{
+		WriteJournalPutRedeemRecord(buffer, pair.second);
+	}
+
+	// Replace the existing file.
+	return WriteFileAtomically(fFilePath, buffer);
+}
+
+
+//---------------------------------------------------------------------------------
+// EcomStore Class Members
+//---------------------------------------------------------------------------------
+
+EcomStore::EcomStore(RuntimeContext& context)
+:	fContext(context),
+	fCatalogTimeToLive(kDefaultCatalogTimeToLive),
+	fIsCatalogInvalidated(false),
+	fIsQueryingOffers(false),
+	fDisplaySettingsNotificationId(EOS_INVALID_NOTIFICATIONID),
+	fRedeemInterval(kDefaultRedeemInterval),
+	fRedeemBatchSize(EOS_ECOM_REDEEMENTITLEMENTS_MAX_IDS),
+	fImageCache(context)
+{
+	sEcomStoreCollection.insert(this);
+}
+
+EcomStore::~EcomStore()
+{
+	// Remove this store from the global collection, causing its in-flight EOS callbacks to be ignored.
+	sEcomStoreCollection.erase(this);
+
+	// Stop tracking the EOS overlay's visibility.
+	if ((fDisplaySettingsNotificationId != EOS_INVALID_NOTIFICATIONID) && fContext.fPlatformHandle)
+	{
+		auto uiHandle = EOS_Platform_GetUIInterface(fContext.fPlatformHandle);
+		if (uiHandle)
+		{
+			EOS_UI_RemoveNotifyDisplaySettingsUpdated(uiHandle, fDisplaySettingsNotificationId);
+		}
+	}
+	fDisplaySettingsNotificationId = EOS_INVALID_NOTIFICATIONID;
+
+	// Delete all batch query requests still waiting on EOS. Their callbacks will be ignored too.
+	for (auto&& requestPointer : fBatchQueryRequests)
+	{
+		sBatchQueryRequestCollection.erase(requestPointer);
+		delete requestPointer;
+	}
+	fBatchQueryRequests.clear();
+}
+
+std::chrono::seconds EcomStore::GetCatalogTimeToLive() const
+{
+	return fCatalogTimeToLive;
+}
+
+void EcomStore::SetCatalogTimeToLive(std::chrono::seconds value)
+{
+	fCatalogTimeToLive = (value.count() > 0) ? value : std::chrono::seconds(0);
+}
+
+void EcomStore::SetCatalogFilePath(const std::string& filePath)
+{
+	fCatalogFilePath = filePath;
+
+	// Load the catalog persisted by the last app session, unless one was already fetched during this session.
+	// It is flagged stale so that the next "loadProducts" request refreshes it in the background.
+	if (!fCatalogPointer && !filePath.empty())
+	{
+		auto catalogPointer = std::make_shared<Catalog>();
+		if (catalogPointer->ReadFrom(filePath))
+		{
+			fCatalogPointer = catalogPointer;
+			fIsCatalogInvalidated = true;
+		}
+	}
+}
+
+bool EcomStore::SetTransactionJournalFilePath(const std::string& filePath)
+{
+	// Do not switch journals while the current one has redeems pending.
+	// Their EOS callbacks reconcile the batch against the journal, which would no longer have them.
+	if (!fRedeemQueues.empty())
+	{
+		CoronaLog("WARNING: Cannot change the store's transaction journal while entitlements are being redeemed.");
+		return false;
+	}
+
+	// Load the journal, queuing the redeems it recorded.
+	// Redeems left unfinished by the last app session are due as soon as their owner logs in.
+	fTransactionJournal.Open(filePath);
+	auto now = std::chrono::steady_clock::now();
+	for (auto&& pair : fTransactionJournal.GetRedeems())
+	{
+		auto& queue = fRedeemQueues[pair.second.AccountId];
+		queue.EntitlementIds.push_back(pair.first);
+		queue.NextRedeemTime = now;
+	}
+	return true;
+}
+
+std::chrono::seconds EcomStore::GetRedeemInterval() const
+{
+	return fRedeemInterval;
+}
+
+void EcomStore::SetRedeemInterval(std::chrono::seconds value)
+{
+	fRedeemInterval = (value.count() > 0) ? value : std::chrono::seconds(0);
+}
+
+uint32_t EcomStore::GetRedeemBatchSize() const
+{
+	return fRedeemBatchSize;
+}
+
+void EcomStore::SetRedeemBatchSize(uint32_t value)
+{
+	if (value < 1)
+	{
+		value = 1;
+	}
+	else if (value > EOS_ECOM_REDEEMENTITLEMENTS_MAX_IDS)
+	{
+		value = EOS_ECOM_REDEEMENTITLEMENTS_MAX_IDS;
+	}
+	fRedeemBatchSize = value;
+}
+
+void EcomStore::Update()
+{
+	FlushRedeemQueues();
+	fTransactionJournal.Flush();
+	fImageCache.Update();
+}
+
+ImageCache& EcomStore::GetImageCache()
+{
+	return fImageCache;
+}
+
+std::shared_ptr<const EcomStore::Catalog> EcomStore::GetCatalog() const
+{
+	return fCatalogPointer;
+}
+
+bool EcomStore::IsCatalogFresh() const
+{
+	if (!fCatalogPointer || fIsCatalogInvalidated)
+	{
+		return false;
+	}
+	return (std::chrono::steady_clock::now() - fCatalogPointer->GetFetchTime()) < fCatalogTimeToLive;
+}
+
+void EcomStore::InvalidateCatalog()
+{
+	// Keep the stale catalog around so that transactions can still be mapped to their offers.
+	fIsCatalogInvalidated = true;
+}
+
+bool EcomStore::LoadProducts(LocalUserSession& session, const std::vector<std::string>& productIds)
+{
+	// Validate.
+	auto accountId = session.GetEpicAccountId();
+	if (!accountId)
+	{
+		return false;
+	}
+
+	// Answer the request from memory if a catalog is available, refreshing it in the background if stale.
+	PendingLoadProductsRequest request;
+	request.UserHandle = session.GetUserHandle();
+	request.ProductIds = productIds;
+	if (fCatalogPointer)
+	{
+		bool isStale = !IsCatalogFresh();
+		if (isStale)
+		{
+			isStale = RefreshCatalog(accountId);
+		}
+		QueueLoadProductsEvent(fCatalogPointer, request, EOS_EResult::EOS_Success, isStale);
+		return true;
+	}
+
+	// Otherwise fetch the catalog, sharing the query if one is already in flight.
+	if (!RefreshCatalog(accountId))
+	{
+		return false;
+	}
+	fPendingLoadProductsRequests.push_back(std::move(request));
+	return true;
+}
+
+bool EcomStore::PrepareStore(LocalUserSession& session, const std::vector<std::string>& productIds)
+{
+	// Validate.
+	auto accountId = session.GetEpicAccountId();
+	if (!accountId)
+	{
+		return false;
+	}
+	auto ecomHandle = GetEcomHandle();
+	if (!ecomHandle)
+	{
+		return false;
+	}
+
+	// Refresh the catalog in the background if stale, so that "loadProducts" and purchases don't wait on it.
+	if (!IsCatalogFresh())
+	{
+		RefreshCatalog(accountId);
+	}
+
+	// Prefetch the images of the offers about to be shown.
+	if (fCatalogPointer)
+	{
+		std::unordered_map<std::string, std::string> imageFileNames;
+		CacheOfferImages(*fCatalogPointer, productIds, imageFileNames);
+	}
+
+	// Query all of the user's entitlements, caching ownership in the session for isEntitled().
+	if (fPreparingAccountIds.find(accountId) == fPreparingAccountIds.end())
+	{
+		EOS_Ecom_QueryEntitlementsOptions options = {};
+		options.ApiVersion = EOS_ECOM_QUERYENTITLEMENTS_API_LATEST;
+		options.LocalUserId = accountId;
+		options.EntitlementNames = nullptr;
+		options.EntitlementNameCount = 0;
+		options.bIncludeRedeemed = EOS_TRUE;
+		fPreparingAccountIds.insert(accountId);
+		EOS_Ecom_QueryEntitlements(ecomHandle, &options, this, &EcomStore::OnPrepareEntitlementsCallback);
+	}
+
+	// Track the overlay's visibility before the first checkout, so that its timing is complete.
+	AddDisplaySettingsNotification();
+	fPreparedAccountIds.insert(accountId);
+	return true;
+}
+
+bool EcomStore::Purchase(LocalUserSession& session, const std::vector<std::string>& offerIds)
+{
+	// Validate.
+	auto accountId = session.GetEpicAccountId();
+	if (!accountId || offerIds.empty() || (offerIds.size() > EOS_ECOM_CHECKOUT_MAX_ENTRIES))
+	{
+		return false;
+	}
+	if (fCheckouts.find(accountId) != fCheckouts.end())
+	{
+		return false;
+	}
+	auto ecomHandle = GetEcomHandle();
+	if (!ecomHandle)
+	{
+		return false;
+	}
+	AddDisplaySettingsNotification();
+
+	// Check out. The overlay is shown by EOS and the result is handled by OnCheckoutCallback().
+	// Note: The offer IDs are stored first since the checkout entries point to their strings.
+	auto& checkout = fCheckouts[accountId];
+	checkout.OfferIds = offerIds;
+	checkout.Timing.WasOverlayShown = false;
+	checkout.Timing.WasPrepared = (fPreparedAccountIds.find(accountId) != fPreparedAccountIds.end()) && IsCatalogFresh();
+	auto& storedOfferIds = checkout.OfferIds;
+	std::vector<EOS_Ecom_CheckoutEntry> entries(storedOfferIds.size());
+	for (size_t index = 0; index < storedOfferIds.size(); index++)
+	{
+		entries[index].ApiVersion = EOS_ECOM_CHECKOUTENTRY_API_LATEST;
+		entries[index].OfferId = storedOfferIds[index].c_str();
+	}
+	EOS_Ecom_CheckoutOptions options = {};
+	options.ApiVersion = EOS_ECOM_CHECKOUT_API_LATEST;
+	options.LocalUserId = accountId;
+	options.OverrideCatalogNamespace = nullptr;
+	options.EntryCount = (uint32_t)entries.size();
+	options.Entries = entries.data();
+	checkout.Timing.RequestTime = std::chrono::steady_clock::now();
+	EOS_Ecom_Checkout(ecomHandle, &options, this, &EcomStore::OnCheckoutCallback);
+	return true;
+}
+
+bool EcomStore::Restore(LocalUserSession& session)
+{
+	// Validate.
+	auto accountId = session.GetEpicAccountId();
+	if (!accountId || (fRestoringAccountIds.find(accountId) != fRestoringAccountIds.end()))
+	{
+		return false;
+	}
+	auto ecomHandle = GetEcomHandle();
+	if (!ecomHandle)
+	{
+		return false;
+	}
+
+	// Query all entitlements that have not been redeemed yet.
+	EOS_Ecom_QueryEntitlementsOptions options = {};
+	options.ApiVersion = EOS_ECOM_QUERYENTITLEMENTS_API_LATEST;
+	options.LocalUserId = accountId;
+	options.EntitlementNames = nullptr;
+	options.EntitlementNameCount = 0;
+	options.bIncludeRedeemed = EOS_FALSE;
+	fRestoringAccountIds.insert(accountId);
+	EOS_Ecom_QueryEntitlements(ecomHandle, &options, this, &EcomStore::OnQueryEntitlementsCallback);
+	return true;
+}
+
+bool EcomStore::FinishTransaction(LocalUserSession& session, const std::string& transactionId)
+{
+	// Validate.
+	auto accountId = session.GetEpicAccountId();
+	if (!accountId || transactionId.empty())
+	{
+		return false;
+	}
+	if (!GetEcomHandle())
+	{
+		return false;
+	}
+	PendingRedeem redeem;
+	redeem.AccountId = CopyAccountIdStringFrom(accountId);
+	if (redeem.AccountId.empty())
+	{
+		return false;
+	}
+
+	// Remove the transaction from the journal, fetching the entitlements it granted.
+	// If given 1 of those entitlement IDs instead, then the transaction that granted it is finished.
+	// If not journaled at all, then it must be an entitlement that an EOS query reported as unredeemed.
+	// Anything else, such as an already finished transaction's ID, is rejected instead of sent to EOS to fail.
+	std::vector<std::string> entitlementIds;
+	auto entryPointer = fTransactionJournal.GetEntryBy(transactionId);
+	if (!entryPointer)
+	{
+		entryPointer = fTransactionJournal.GetEntryByEntitlementId(transactionId);
+	}
+	if (entryPointer)
+	{
+		redeem.TransactionId = entryPointer->Id;
+		redeem.ProductIdentifier = entryPointer->ProductIdentifier;
+		fTransactionJournal.Remove(redeem.TransactionId, entitlementIds);
+	}
+	else
+	{
+		auto unredeemedIterator = fUnredeemedEntitlementIds.find(accountId);
+		bool isUnredeemed =
+				(unredeemedIterator != fUnredeemedEntitlementIds.end()) &&
+				(unredeemedIterator->second.erase(transactionId) > 0);
+		if (!isUnredeemed)
+		{
+			return false;
+		}
+		redeem.TransactionId = transactionId;
+		entitlementIds.push_back(transactionId);
+	}
+
+	// Queue the entitlements to be redeemed in batches by Update(), which journals them until redeemed.
+	// This way a burst of consumable purchases, such as during a sale, only costs a few EOS requests.
+	for (auto&& entitlementId : entitlementIds)
+	{
+		redeem.EntitlementId = entitlementId;
+		QueueRedeem(redeem);
+	}
+	return true;
+}
+
+bool EcomStore::QueryOwnership(LocalUserSession& session, const std::vector<std::string>& itemIds)
+{
+	// Validate.
+	if (!session.GetEpicAccountId())
+	{
+		return false;
+	}
+	auto uniqueItemIds = CopyUniqueIdsFrom(itemIds);
+	if (uniqueItemIds.empty())
+	{
+		return false;
+	}
+
+	// Query ownership in as few requests as possible.
+	return IssueBatchQuery(session, std::move(uniqueItemIds), BatchQueryType::kOwnership);
+}
+
+bool EcomStore::QueryEntitlements(LocalUserSession& session, const std::vector<std::string>& entitlementNames)
+{
+	// Validate.
+	if (!session.GetEpicAccountId())
+	{
+		return false;
+	}
+
+	// Query entitlements in as few requests as possible. No names queries all of them in 1 request.
+	return IssueBatchQuery(session, CopyUniqueIdsFrom(entitlementNames), BatchQueryType::kEntitlements);
+}
+
+bool EcomStore::QueryOwnershipToken(LocalUserSession& session, const std::vector<std::string>& itemIds)
+{
+	// Validate.
+	if (!session.GetEpicAccountId())
+	{
+		return false;
+	}
+	auto uniqueItemIds = CopyUniqueIdsFrom(itemIds);
+	if (uniqueItemIds.empty())
+	{
+		return false;
+	}
+
+	// Sort the IDs so that the same set of IDs is always split into the same batches, which are cached by ID.
+	std::sort(uniqueItemIds.begin(), uniqueItemIds.end());
+	return IssueBatchQuery(session, std::move(uniqueItemIds), BatchQueryType::kOwnershipToken);
+}
+
+bool EcomStore::QueryEntitlementToken(LocalUserSession& session, const std::vector<std::string>& entitlementNames)
+{
+	// Validate.
+	if (!session.GetEpicAccountId())
+	{
+		return false;
+	}
+
+	// Sort the names so that the same set of names is always split into the same batches, which are cached by name.
+	auto uniqueNames = CopyUniqueIdsFrom(entitlementNames);
+	std::sort(uniqueNames.begin(), uniqueNames.end());
+	return IssueBatchQuery(session, std::move(uniqueNames), BatchQueryType::kEntitlementToken);
+}
+
+void EcomStore::SetTokenPublicKeys(const std::vector<RsaPublicKey>& keys)
+{
+	fTokenPublicKeys = keys;
+}
+
+void EcomStore::SetTokenIssuer(const std::string& value)
+{
+	fTokenIssuer = value;
+}
+
+bool EcomStore::VerifyToken(const JsonWebToken& token, EOS_EpicAccountId accountId) const
+{
+	// Validate.
+	if (!token.IsValid() || fTokenPublicKeys.empty())
+	{
+		return false;
+	}
+
+	// Verify the signature with the key the token names, or with every key if it does not name one.
+	std::string keyId;
+	bool hasKeyId = token.GetHeaderString("kid", keyId);
+	bool isSignatureValid = false;
+	for (auto&& key : fTokenPublicKeys)
+	{
+		if (hasKeyId && !key.GetKeyId().empty() && (key.GetKeyId() != keyId))
+		{
+			continue;
+		}
+		if (token.VerifySignatureWith(key))
+		{
+			isSignatureValid = true;
+			break;
+		}
+	}
+	if (!isSignatureValid)
+	{
+		return false;
+	}
+
+	// The token must not be expired or not yet valid, allowing for some clock skew.
+	double expirationTime = 0;
+	auto currentTime = (double)time(nullptr);
+	if (!token.GetClaimNumber("exp", expirationTime) || ((expirationTime + kTokenClockSkewInSeconds) <= currentTime))
+	{
+		return false;
+	}
+	double notBeforeTime = 0;
+	if (token.GetClaimNumber("nbf", notBeforeTime) && (notBeforeTime > (currentTime + kTokenClockSkewInSeconds)))
+	{
+		return false;
+	}
+
+	// The token must be issued by the configured issuer, if any.
+	std::string issuer;
+	if (!fTokenIssuer.empty() && (!token.GetClaimString("iss", issuer) || (issuer != fTokenIssuer)))
+	{
+		return false;
+	}
+
+	// The token must be issued to the given account, if it names one.
+	std::string subject;
+	if (accountId && token.GetClaimString("sub", subject))
+	{
+		if (subject != CopyAccountIdStringFrom(accountId))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool EcomStore::IssueBatchQuery(LocalUserSession& session, std::vector<std::string>&& ids, BatchQueryType type)
+{
+	// Validate.
+	auto ecomHandle = GetEcomHandle();
+	if (!ecomHandle)
+	{
+		return false;
+	}
+
+	// Set up the query shared by all of its requests.
+	size_t maxIdsPerRequest = 1;
+	switch (type)
+	{
+		case BatchQueryType::kOwnership:
+			maxIdsPerRequest = EOS_ECOM_QUERYOWNERSHIP_MAX_CATALOG_IDS;
+			break;
+		case BatchQueryType::kEntitlements:
+			maxIdsPerRequest = EOS_ECOM_QUERYENTITLEMENTS_MAX_ENTITLEMENT_IDS;
+			break;
+		case BatchQueryType::kOwnershipToken:
+			maxIdsPerRequest = EOS_ECOM_QUERYOWNERSHIPTOKEN_MAX_CATALOGITEM_IDS;
+			break;
+		case BatchQueryType::kEntitlementToken:
+			maxIdsPerRequest = EOS_ECOM_QUERYENTITLEMENTTOKEN_MAX_ENTITLEMENT_IDS;
+			break;
+	}
+	const size_t requestCount = ids.empty() ? 1 : ((ids.size() + maxIdsPerRequest - 1) / maxIdsPerRequest);
+	bool isTokenQuery = (type == BatchQueryType::kOwnershipToken) || (type == BatchQueryType::kEntitlementToken);
+	auto accountId = session.GetEpicAccountId();
+	auto queryPointer = std::make_shared<BatchQuery>();
+	queryPointer->Type = type;
+	queryPointer->UserHandle = session.GetUserHandle();
+	queryPointer->PendingRequestCount = 0;
+	queryPointer->Result = EOS_EResult::EOS_Success;
+	if (type == BatchQueryType::kOwnership)
+	{
+		queryPointer->Ownerships.reserve(ids.size());
+	}
+	else if (isTokenQuery)
+	{
+		queryPointer->Tokens.reserve(requestCount);
+	}
+
+	// Issue 1 request per chunk of IDs. Results are handled by the callbacks below,
+	// which queue a single Lua event once the last request completes.
+	// Note: Each request keeps its IDs since its callback needs them to collect the results.
+	std::vector<BatchQueryRequest*> requests;
+	requests.reserve(requestCount);
+	for (size_t requestIndex = 0; requestIndex < requestCount; requestIndex++)
+	{
+		std::vector<std::string> requestIds;
+		size_t startIndex = requestIndex * maxIdsPerRequest;
+		size_t endIndex = std::min(startIndex + maxIdsPerRequest, ids.size());
+		requestIds.reserve(endIndex - startIndex);
+		for (size_t index = startIndex; index < endIndex; index++)
+		{
+			requestIds.push_back(std::move(ids[index]));
+		}
+
+		// Provide a cached token for this chunk instead, if it is not about to expire.
+		if (isTokenQuery)
+		{
+			auto& accountTokens = fTokenCache[accountId];
+			auto tokenIterator = accountTokens.find(GetTokenCacheKey(type, requestIds));
+			if (tokenIterator != accountTokens.end())
+			{
+				if ((time(nullptr) + kTokenExpirationMargin) < tokenIterator->second.ExpirationTime)
+				{
+					queryPointer->Tokens.push_back(tokenIterator->second);
+					continue;
+				}
+				accountTokens.erase(tokenIterator);
+			}
+		}
+
+		auto requestPointer = new BatchQueryRequest();
+		requestPointer->StorePointer = this;
+		requestPointer->QueryPointer = queryPointer;
+		requestPointer->Ids = std::move(requestIds);
+		requests.push_back(requestPointer);
+	}
+	queryPointer->PendingRequestCount = requests.size();
+	if (requests.empty())
+	{
+		QueueBatchQueryEvent(*queryPointer);
+		return true;
+	}
+	for (auto&& requestPointer : requests)
+	{
+		std::vector<const char*> idArray(requestPointer->Ids.size());
+		for (size_t index = 0; index < requestPointer->Ids.size(); index++)
+		{
+			idArray[index] = requestPointer->Ids[index].c_str();
+		}
+		fBatchQueryRequests.insert(requestPointer);
+		sBatchQueryRequestCollection.insert(requestPointer);
+		switch (type)
+		{
+			case BatchQueryType::kOwnership:
+			{
+				EOS_Ecom_QueryOwnershipOptions options = {};
+				options.ApiVersion = EOS_ECOM_QUERYOWNERSHIP_API_LATEST;
+				options.LocalUserId = accountId;
+				options.CatalogItemIds = idArray.data();
+				options.CatalogItemIdCount = (uint32_t)idArray.size();
+				options.CatalogNamespace = nullptr;
+				EOS_Ecom_QueryOwnership(ecomHandle, &options, requestPointer, &EcomStore::OnQueryOwnershipCallback);
+				break;
+			}
+			case BatchQueryType::kEntitlements:
+			{
+				EOS_Ecom_QueryEntitlementsOptions options = {};
+				options.ApiVersion = EOS_ECOM_QUERYENTITLEMENTS_API_LATEST;
+				options.LocalUserId = accountId;
+				options.EntitlementNames = idArray.empty() ? nullptr : idArray.data();
+				options.EntitlementNameCount = (uint32_t)idArray.size();
+				options.bIncludeRedeemed = EOS_TRUE;
+				EOS_Ecom_QueryEntitlements(
+						ecomHandle, &options, requestPointer, &EcomStore::OnBatchQueryEntitlementsCallback);
+				break;
+			}
+			case BatchQueryType::kOwnershipToken:
+			{
+				EOS_Ecom_QueryOwnershipTokenOptions options = {};
+				options.ApiVersion = EOS_ECOM_QUERYOWNERSHIPTOKEN_API_LATEST;
+				options.LocalUserId = accountId;
+				options.CatalogItemIds = idArray.data();
+				options.CatalogItemIdCount = (uint32_t)idArray.size();
+				options.CatalogNamespace = nullptr;
+				EOS_Ecom_QueryOwnershipToken(
+						ecomHandle, &options, requestPointer, &EcomStore::OnQueryOwnershipTokenCallback);
+				break;
+			}
+			case BatchQueryType::kEntitlementToken:
+			{
+				EOS_Ecom_QueryEntitlementTokenOptions options = {};
+				options.ApiVersion = EOS_ECOM_QUERYENTITLEMENTTOKEN_API_LATEST;
+				options.LocalUserId = accountId;
+				options.EntitlementNames = idArray.empty() ? nullptr : idArray.data();
+				options.EntitlementNameCount = (uint32_t)idArray.size();
+				EOS_Ecom_QueryEntitlementToken(
+						ecomHandle, &options, requestPointer, &EcomStore::OnQueryEntitlementTokenCallback);
+				break;
+			}
+		}
+	}
+	return true;
+}
+
+void EcomStore::OnBatchQueryRequestCompleted(BatchQueryRequest* requestPointer)
+{
+	// Validate.
+	if (!requestPointer)
+	{
+		return;
+	}
+
+	// Release the request. Do nothing else until all of the query's other requests have completed.
+	auto queryPointer = requestPointer->QueryPointer;
+	delete requestPointer;
+	if (!queryPointer || (queryPointer->PendingRequestCount == 0) || (--queryPointer->PendingRequestCount > 0))
+	{
+		return;
+	}
+
+	// Queue the combined results to be dispatched to Lua later.
+	QueueBatchQueryEvent(*queryPointer);
+}
+
+void EcomStore::QueueBatchQueryEvent(BatchQuery& query)
+{
+	switch (query.Type)
+	{
+		case BatchQueryType::kOwnership:
+		{
+			auto taskPointer = std::make_shared<DispatchQueryOwnershipEventTask>();
+			taskPointer->AcquireEventDataFrom(std::move(query.Ownerships), query.Result);
+			taskPointer->SetUserHandle(query.UserHandle);
+			fContext.QueueDispatchEventTask(taskPointer);
+			break;
+		}
+		case BatchQueryType::kEntitlements:
+		{
+			auto taskPointer = std::make_shared<DispatchQueryEntitlementsEventTask>();
+			taskPointer->AcquireEventDataFrom(std::move(query.Entitlements), query.Result);
+			taskPointer->SetUserHandle(query.UserHandle);
+			fContext.QueueDispatchEventTask(taskPointer);
+			break;
+		}
+		case BatchQueryType::kOwnershipToken:
+		case BatchQueryType::kEntitlementToken:
+		{
+			auto taskPointer = std::make_shared<DispatchEcomTokenEventTask>();
+			taskPointer->AcquireEventDataFrom(
+					(query.Type == BatchQueryType::kOwnershipToken), std::move(query.Tokens), query.Result);
+			taskPointer->SetUserHandle(query.UserHandle);
+			fContext.QueueDispatchEventTask(taskPointer);
+			break;
+		}
+	}
+}
+
+void EcomStore::OnTokenReceived(
+	BatchQueryRequest* requestPointer, EOS_EpicAccountId accountId, EOS_EResult resultCode, const char* encodedToken)
+{
+	// Validate.
+	if (!requestPointer)
+	{
+		return;
+	}
+	auto& query = *(requestPointer->QueryPointer);
+
+	// Decode the token and cache it until it is about to expire.
+	JsonWebToken token;
+	if ((resultCode == EOS_EResult::EOS_Success) && token.Parse(encodedToken))
+	{
+		EcomToken ecomToken;
+		ecomToken.Token = token.GetEncodedToken();
+		ecomToken.Ids = requestPointer->Ids;
+		double expirationTime = 0;
+		ecomToken.ExpirationTime = token.GetClaimNumber("exp", expirationTime) ? (time_t)expirationTime : 0;
+		ecomToken.IsVerified = VerifyToken(token, accountId);
+		if (ecomToken.ExpirationTime > 0)
+		{
+			fTokenCache[accountId][GetTokenCacheKey(query.Type, ecomToken.Ids)] = ecomToken;
+		}
+		query.Tokens.push_back(std::move(ecomToken));
+	}
+	else if (query.Result == EOS_EResult::EOS_Success)
+	{
+		query.Result = (resultCode != EOS_EResult::EOS_Success) ? resultCode : EOS_EResult::EOS_UnexpectedError;
+	}
+
+	// Queue a Lua event if this was the query's last request.
+	OnBatchQueryRequestCompleted(requestPointer);
+}
+
+std::string EcomStore::GetTokenCacheKey(BatchQueryType type, const std::vector<std::string>& ids)
+{
+	std::string key((type == BatchQueryType::kOwnershipToken) ? "o" : "e");
+	for (auto&& id : ids)
+	{
+		key += '\n';
+		key += id;
+	}
+	return key;
+}
+
+bool EcomStore::RefreshCatalog(EOS_EpicAccountId accountId)
+{
+	// Do not issue another query if one is already in flight.
+	if (fIsQueryingOffers)
+	{
+		return true;
+	}
+
+	// Query offers. Result is handled by OnQueryOffersCallback().
+	auto ecomHandle = GetEcomHandle();
+	if (!ecomHandle || !accountId)
+	{
+		return false;
+	}
+	EOS_Ecom_QueryOffersOptions options = {};
+	options.ApiVersion = EOS_ECOM_QUERYOFFERS_API_LATEST;
+	options.LocalUserId = accountId;
+	options.OverrideCatalogNamespace = nullptr;
+	fIsQueryingOffers = true;
+	EOS_Ecom_QueryOffers(ecomHandle, &options, this, &EcomStore::OnQueryOffersCallback);
+	return true;
+}
+
+bool EcomStore::QueueProductsChangedEvent(const Catalog& previousCatalog, const Catalog& catalog)
+{
+	// Collect the IDs of all offers that were added, changed, or removed.
+	std::vector<std::string> addedOfferIds;
+	std::vector<std::string> changedOfferIds;
+	std::vector<std::string> removedOfferIds;
+	for (auto&& offer : catalog.GetOffers())
+	{
+		auto previousOfferPointer = previousCatalog.GetOfferBy(offer.Id);
+		if (!previousOfferPointer)
+		{
+			addedOfferIds.push_back(offer.Id);
+		}
+		else if (*previousOfferPointer != offer)
+		{
+			changedOfferIds.push_back(offer.Id);
+		}
+	}
+	for (auto&& previousOffer : previousCatalog.GetOffers())
+	{
+		if (!catalog.GetOfferBy(previousOffer.Id))
+		{
+			removedOfferIds.push_back(previousOffer.Id);
+		}
+	}
+	if (addedOfferIds.empty() && changedOfferIds.empty() && removedOfferIds.empty())
+	{
+		return false;
+	}
+
+	// Queue the changes to be dispatched to Lua later.
+	auto taskPointer = std::make_shared<DispatchProductsChangedEventTask>();
+	taskPointer->AcquireEventDataFrom(
+			std::move(addedOfferIds), std::move(changedOfferIds), std::move(removedOfferIds));
+	fContext.QueueDispatchEventTask(taskPointer);
+	return true;
+}
+
+EOS_HEcom EcomStore::GetEcomHandle()
+{
+	if (!fContext.fPlatformHandle)
+	{
+		return nullptr;
+	}
+	return EOS_Platform_GetEcomInterface(fContext.fPlatformHandle);
+}
+
+void EcomStore::QueueLoadProductsEvent(
+	const std::shared_ptr<const Catalog>& catalogPointer,
+	const PendingLoadProductsRequest& request, EOS_EResult resultCode, bool isStale)
+{
+	// Provide the local files of the requested offers' cached images and prefetch the ones not cached yet.
+	std::unordered_map<std::string, std::string> imageFileNames;
+	if (catalogPointer)
+	{
+		CacheOfferImages(*catalogPointer, request.ProductIds, imageFileNames);
+	}
+
+	// Queue the event to be dispatched to Lua later.
+	auto taskPointer = std::make_shared<DispatchLoadProductsEventTask>();
+	taskPointer->AcquireEventDataFrom(catalogPointer, request.ProductIds, resultCode);
+	taskPointer->SetUserHandle(request.UserHandle);
+	taskPointer->SetIsStale(isStale);
+	taskPointer->SetImageFileNames(std::move(imageFileNames), fImageCache.GetLuaDirectoryName());
+	fContext.QueueDispatchEventTask(taskPointer);
+}
+
+void EcomStore::CacheOfferImages(
+	const Catalog& catalog, const std::vector<std::string>& productIds,
+	std::unordered_map<std::string, std::string>& imageFileNames)
+{
+	// Images are only fetched once their offers are requested, since most catalogs are never shown in full.
+	auto cacheImages = [this, &imageFileNames](const std::vector<KeyImage>& images)
+	{
+		for (auto&& image : images)
+		{
+			auto fileName = fImageCache.GetFileNameBy(image.Url);
+			if (!fileName.empty())
+			{
+				imageFileNames[image.Url] = fileName;
+			}
+			else
+			{
+				fImageCache.Prefetch(image.Url);
+			}
+		}
+	};
+	auto cacheOfferImages = [&cacheImages](const CatalogOffer& offer)
+	{
+		cacheImages(offer.Images);
+		for (auto&& item : offer.Items)
+		{
+			cacheImages(item.Images);
+		}
+	};
+	if (productIds.empty())
+	{
+		for (auto&& offer : catalog.GetOffers())
+		{
+			cacheOfferImages(offer);
+		}
+	}
+	else
+	{
+		for (auto&& productId : productIds)
+		{
+			auto offerPointer = catalog.GetOfferBy(productId);
+			if (offerPointer)
+			{
+				cacheOfferImages(*offerPointer);
+			}
+		}
+	}
+}
+
+void EcomStore::AddDisplaySettingsNotification()
+{
+	// Validate.
+	if ((fDisplaySettingsNotificationId != EOS_INVALID_NOTIFICATIONID) || !fContext.fPlatformHandle)
+	{
+		return;
+	}
+	auto uiHandle = EOS_Platform_GetUIInterface(fContext.fPlatformHandle);
+	if (!uiHandle)
+	{
+		return;
+	}
+
+	// Subscribe to the overlay's visibility changes, used to time when a checkout's overlay is shown.
+	EOS_UI_AddNotifyDisplaySettingsUpdatedOptions options = {};
+	options.ApiVersion = EOS_UI_ADDNOTIFYDISPLAYSETTINGSUPDATED_API_LATEST;
+	fDisplaySettingsNotificationId = EOS_UI_AddNotifyDisplaySettingsUpdated(
+			uiHandle, &options, this, &EcomStore::OnDisplaySettingsUpdatedCallback);
+}
+
+void EcomStore::TrackUnredeemedEntitlement(EOS_EpicAccountId accountId, const EOS_Ecom_Entitlement& entitlement)
+{
+	if (!accountId || !entitlement.EntitlementId)
+	{
+		return;
+	}
+	if (entitlement.bRedeemed != EOS_TRUE)
+	{
+		fUnredeemedEntitlementIds[accountId].insert(entitlement.EntitlementId);
+	}
+	else
+	{
+		auto iterator = fUnredeemedEntitlementIds.find(accountId);
+		if (iterator != fUnredeemedEntitlementIds.end())
+		{
+			iterator->second.erase(entitlement.EntitlementId);
+		}
+	}
+}
+
+void EcomStore::QueueRedeem(const PendingRedeem& redeem)
+{
+	// Ignore entitlements that are already waiting to be redeemed.
+	if (redeem.EntitlementId.empty() || fTransactionJournal.GetRedeemBy(redeem.EntitlementId))
+	{
+		return;
+	}
+	fTransactionJournal.PutRedeem(redeem);
+
+	// Add the entitlement to its owner's queue. The first entitlement starts the wait for more to batch with it.
+	auto& queue = fRedeemQueues[redeem.AccountId];
+	if (queue.EntitlementIds.empty() && (queue.FailureCount <= 0))
+	{
+		queue.NextRedeemTime = std::chrono::steady_clock::now() + fRedeemInterval;
+	}
+	queue.EntitlementIds.push_back(redeem.EntitlementId);
+}
+
+void EcomStore::FlushRedeemQueues()
+{
+	// Validate.
+	if (fRedeemQueues.empty())
+	{
+		return;
+	}
+	auto ecomHandle = GetEcomHandle();
+	if (!ecomHandle)
+	{
+		return;
+	}
+
+	// Redeem a batch of every queue that is full or whose interval has elapsed.
+	// Only 1 request per account is in flight at a time, which keeps EOS' "last redeemed" results unambiguous.
+	auto now = std::chrono::steady_clock::now();
+	for (auto&& pair : fRedeemQueues)
+	{
+		auto& queue = pair.second;
+		if (!queue.RedeemingIds.empty() || queue.EntitlementIds.empty())
+		{
+			continue;
+		}
+		bool isBatchFull = (queue.EntitlementIds.size() >= fRedeemBatchSize) && (queue.FailureCount <= 0);
+		if (!isBatchFull && (now < queue.NextRedeemTime))
+		{
+			continue;
+		}
+
+		// Entitlements can only be redeemed while their owner is logged in.
+		EOS_EpicAccountId accountId = nullptr;
+		for (auto&& sessionPointer : fContext.GetLocalUsers())
+		{
+			if (CopyAccountIdStringFrom(sessionPointer->GetEpicAccountId()) == pair.first)
+			{
+				accountId = sessionPointer->GetEpicAccountId();
+				break;
+			}
+		}
+		if (!accountId)
+		{
+			continue;
+		}
+
+		// Move the next batch to the in-flight list and redeem it.
+		size_t batchCount = queue.EntitlementIds.size();
+		if (batchCount > EOS_ECOM_REDEEMENTITLEMENTS_MAX_IDS)
+		{
+			batchCount = EOS_ECOM_REDEEMENTITLEMENTS_MAX_IDS;
+		}
+		queue.RedeemingIds.assign(queue.EntitlementIds.begin(), queue.EntitlementIds.begin() + batchCount);
+		queue.EntitlementIds.erase(queue.EntitlementIds.begin(), queue.EntitlementIds.begin() + batchCount);
+		queue.NextRedeemTime = now + fRedeemInterval;
+		std::vector<EOS_Ecom_EntitlementId> idArray(batchCount);
+		for (size_t index = 0; index < batchCount; index++)
+		{
+			idArray[index] = queue.RedeemingIds[index].c_str();
+		}
+		EOS_Ecom_RedeemEntitlementsOptions options = {};
+		options.ApiVersion = EOS_ECOM_REDEEMENTITLEMENTS_API_LATEST;
+		options.LocalUserId = accountId;
+		options.EntitlementIdCount = (uint32_t)batchCount;
+		options.EntitlementIds = idArray.data();
+		EOS_Ecom_RedeemEntitlements(ecomHandle, &options, this, &EcomStore::OnRedeemEntitlementsCallback);
+	}
+}
+
+void EcomStore::OnRedeemCompleted(EOS_EpicAccountId accountId, EOS_EResult resultCode)
+{
+	// Fetch the account's queue and take its in-flight batch.
+	auto queueIterator = fRedeemQueues.find(CopyAccountIdStringFrom(accountId));
+	if (queueIterator == fRedeemQueues.end())
+	{
+		return;
+	}
+	auto& queue = queueIterator->second;
+	std::vector<std::string> redeemingIds;
+	redeemingIds.swap(queue.RedeemingIds);
+
+	// Put the batch back at the front of the queue if it failed, retrying it after an exponential backoff.
+	// After too many attempts, the entitlements are given up on. They'll be provided by the next restore.
+	const char* state = "consumed";
+	if (resultCode != EOS_EResult::EOS_Success)
+	{
+		queue.FailureCount++;
+		CoronaLog(
+				"WARNING: [EOS SDK] Failed to redeem %d entitlements. Result code: %d",
+				(int)redeemingIds.size(), (int)resultCode);
+		if (queue.FailureCount < kMaxRedeemAttemptCount)
+		{
+			auto backoffInterval = std::max(fRedeemInterval, std::chrono::seconds(1));
+			backoffInterval *= (1 << std::min(queue.FailureCount, 6));
+			queue.NextRedeemTime = std::chrono::steady_clock::now() + backoffInterval;
+			queue.EntitlementIds.insert(queue.EntitlementIds.begin(), redeemingIds.begin(), redeemingIds.end());
+			return;
+		}
+		state = "failed";
+	}
+	queue.FailureCount = 0;
+
+	// Reconcile the batch with the entitlements EOS reports as redeemed by the request.
+	// The others were either redeemed before, such as by a request whose response was lost, or are invalid.
+	std::unordered_set<std::string> redeemedIds;
+	auto ecomHandle = GetEcomHandle();
+	if ((resultCode == EOS_EResult::EOS_Success) && ecomHandle)
+	{
+		EOS_Ecom_GetLastRedeemedEntitlementsCountOptions countOptions = {};
+		countOptions.ApiVersion = EOS_ECOM_GETLASTREDEEMEDENTITLEMENTSCOUNT_API_LATEST;
+		countOptions.LocalUserId = accountId;
+		uint32_t redeemedCount = EOS_Ecom_GetLastRedeemedEntitlementsCount(ecomHandle, &countOptions);
+		for (uint32_t index = 0; index < redeemedCount; index++)
+		{
+			EOS_Ecom_CopyLastRedeemedEntitlementByIndexOptions copyOptions = {};
+			copyOptions.ApiVersion = EOS_ECOM_COPYLASTREDEEMEDENTITLEMENTBYINDEX_API_LATEST;
+			copyOptions.LocalUserId = accountId;
+			copyOptions.RedeemedEntitlementIndex = index;
+			char entitlementId[EOS_ECOM_ENTITLEMENTID_MAX_LENGTH + 1];
+			int32_t entitlementIdLength = sizeof(entitlementId);
+			auto copyResult = EOS_Ecom_CopyLastRedeemedEntitlementByIndex(
+					ecomHandle, &copyOptions, entitlementId, &entitlementIdLength);
+			if (copyResult == EOS_EResult::EOS_Success)
+			{
+				redeemedIds.insert(std::string(entitlementId));
+			}
+		}
+	}
+
+	// Remove the batch from the journal and provide it to Lua as 1 transaction per finished transaction and state.
+	// Entitlements that a successful request did not report as redeemed are provided as "unconfirmed" so that
+	// the game accounts for every entitlement it finished, even though EOS may have consumed them before.
+	std::vector<Transaction> transactions;
+	size_t unconfirmedCount = 0;
+	for (auto&& entitlementId : redeemingIds)
+	{
+		auto redeemPointer = fTransactionJournal.GetRedeemBy(entitlementId);
+		if (!redeemPointer)
+		{
+			continue;
+		}
+		const char* entitlementState = state;
+		if ((resultCode == EOS_EResult::EOS_Success) && (redeemedIds.find(entitlementId) == redeemedIds.end()))
+		{
+			entitlementState = "unconfirmed";
+			unconfirmedCount++;
+		}
+		auto transactionIterator = std::find_if(
+				transactions.begin(), transactions.end(),
+				[redeemPointer, entitlementState](const Transaction& transaction)
+				{
+					return (transaction.Identifier == redeemPointer->TransactionId) &&
+							!strcmp(transaction.State, entitlementState);
+				});
+		if (transactionIterator == transactions.end())
+		{
+			Transaction transaction;
+			transaction.State = entitlementState;
+			transaction.Result = resultCode;
+			transaction.Identifier = redeemPointer->TransactionId;
+			transaction.ProductIdentifier = redeemPointer->ProductIdentifier;
+			transactions.push_back(std::move(transaction));
+			transactionIterator = transactions.end() - 1;
+		}
+		transactionIterator->EntitlementIds.push_back(entitlementId);
+		fTransactionJournal.RemoveRedeem(entitlementId);
+	}
+	if (unconfirmedCount > 0)
+	{
+		CoronaLog("WARNING: [EOS SDK] %d entitlements were not redeemed by EOS.", (int)unconfirmedCount);
+	}
+
+	// Remove the queue once it has nothing left to redeem.
+	if (queue.EntitlementIds.empty())
+	{
+		fRedeemQueues.erase(queueIterator);
+	}
+
+	// Queue the result to be dispatched to Lua later.
+	if (!transactions.empty())
+	{
+		QueueStoreTransactionEvent(accountId, std::move(transactions));
+	}
+}
+
+void EcomStore::QueueStoreTransactionEvent(EOS_EpicAccountId accountId, std::vector<Transaction>&& transactions)
+{
+	auto taskPointer = std::make_shared<DispatchStoreTransactionEventTask>();
+	taskPointer->AcquireEventDataFrom(std::move(transactions));
+	auto sessionPointer = fContext.GetLocalUserBy(accountId);
+	if (sessionPointer)
+	{
+		taskPointer->SetUserHandle(sessionPointer->GetUserHandle());
+	}
+	fContext.QueueDispatchEventTask(taskPointer);
+}
+
+EcomStore* EcomStore::GetInstanceBy(void* clientData)
+{
+	auto storePointer = (EcomStore*)clientData;
+	if (sEcomStoreCollection.find(storePointer) == sEcomStoreCollection.end())
+	{
+		return nullptr;
+	}
+	return storePointer;
+}
+
+EcomStore::BatchQueryRequest* EcomStore::TakeBatchQueryRequestBy(void* clientData)
+{
+	if (sBatchQueryRequestCollection.erase(clientData) == 0)
+	{
+		return nullptr;
+	}
+	auto requestPointer = (BatchQueryRequest*)clientData;
+	requestPointer->StorePointer->fBatchQueryRequests.erase(requestPointer);
+	return requestPointer;
+}
+
+void EOS_CALL EcomStore::OnQueryOffersCallback(const EOS_Ecom_QueryOffersCallbackInfo* data)
+{
+	// Validate.
+	if (!data || !EOS_EResult_IsOperationComplete(data->ResultCode))
+	{
+		return;
+	}
+	auto storePointer = GetInstanceBy(data->ClientData);
+	if (!storePointer)
+	{
+		return;
+	}
+	storePointer->fIsQueryingOffers = false;
+
+	// Copy all offers and their items from EOS into a new catalog.
+	auto resultCode = data->ResultCode;
+	auto ecomHandle = storePointer->GetEcomHandle();
+	if ((resultCode == EOS_EResult::EOS_Success) && ecomHandle)
+	{
+		auto catalogPointer = std::make_shared<Catalog>();
+		EOS_Ecom_GetOfferCountOptions offerCountOptions = {};
+		offerCountOptions.ApiVersion = EOS_ECOM_GETOFFERCOUNT_API_LATEST;
+		offerCountOptions.LocalUserId = data->LocalUserId;
+		uint32_t offerCount = EOS_Ecom_GetOfferCount(ecomHandle, &offerCountOptions);
+		for (uint32_t offerIndex = 0; offerIndex < offerCount; offerIndex++)
+		{
+			EOS_Ecom_CopyOfferByIndexOptions copyOfferOptions = {};
+			copyOfferOptions.ApiVersion = EOS_ECOM_COPYOFFERBYINDEX_API_LATEST;
+			copyOfferOptions.LocalUserId = data->LocalUserId;
+			copyOfferOptions.OfferIndex = offerIndex;
+			EOS_Ecom_CatalogOffer* eosOfferPointer = nullptr;
+			if (EOS_Ecom_CopyOfferByIndex(ecomHandle, &copyOfferOptions, &eosOfferPointer) != EOS_EResult::EOS_Success)
+			{
+				continue;
+			}
+			if (!eosOfferPointer)
+			{
+				continue;
+			}
+
+			CatalogOffer offer;
+			offer.Id = ToSafeString(eosOfferPointer->Id);
+			offer.CatalogNamespace = ToSafeString(eosOfferPointer->CatalogNamespace);
+			offer.Title = ToSafeString(eosOfferPointer->TitleText);
+			offer.Description = ToSafeString(eosOfferPointer->DescriptionText);
+			offer.LongDescription = ToSafeString(eosOfferPointer->LongDescriptionText);
+			offer.CurrencyCode = ToSafeString(eosOfferPointer->CurrencyCode);
+			offer.PriceResult = eosOfferPointer->PriceResult;
+			offer.OriginalPrice = eosOfferPointer->OriginalPrice64;
+			offer.CurrentPrice = eosOfferPointer->CurrentPrice64;
+			offer.DecimalPoint = eosOfferPointer->DecimalPoint;
+			offer.DiscountPercentage = eosOfferPointer->DiscountPercentage;
+			offer.ExpirationTimestamp = eosOfferPointer->ExpirationTimestamp;
+			offer.PurchaseLimit = eosOfferPointer->PurchaseLimit;
+			offer.ReleaseDateTimestamp = eosOfferPointer->ReleaseDateTimestamp;
+			offer.EffectiveDateTimestamp = eosOfferPointer->EffectiveDateTimestamp;
+			offer.IsAvailableForPurchase = (eosOfferPointer->bAvailableForPurchase == EOS_TRUE);
+
+			EOS_Ecom_GetOfferImageInfoCountOptions offerImageCountOptions = {};
+			offerImageCountOptions.ApiVersion = EOS_ECOM_GETOFFERIMAGEINFOCOUNT_API_LATEST;
+			offerImageCountOptions.LocalUserId = data->LocalUserId;
+			offerImageCountOptions.OfferId = eosOfferPointer->Id;
+			uint32_t offerImageCount = EOS_Ecom_GetOfferImageInfoCount(ecomHandle, &offerImageCountOptions);
+			for (uint32_t imageIndex = 0; imageIndex < offerImageCount; imageIndex++)
+			{
+				EOS_Ecom_CopyOfferImageInfoByIndexOptions copyImageOptions = {};
+				copyImageOptions.ApiVersion = EOS_ECOM_COPYOFFERIMAGEINFOBYINDEX_API_LATEST;
+				copyImageOptions.LocalUserId = data->LocalUserId;
+				copyImageOptions.OfferId = eosOfferPointer->Id;
+				copyImageOptions.ImageInfoIndex = imageIndex;
+				EOS_Ecom_KeyImageInfo* eosImagePointer = nullptr;
+				auto copyResult = EOS_Ecom_CopyOfferImageInfoByIndex(ecomHandle, &copyImageOptions, &eosImagePointer);
+				if ((copyResult == EOS_EResult::EOS_Success) && eosImagePointer)
+				{
+					offer.Images.push_back(CopyKeyImageFrom(*eosImagePointer));
+					EOS_Ecom_KeyImageInfo_Release(eosImagePointer);
+				}
+			}
+
+			EOS_Ecom_GetOfferItemCountOptions itemCountOptions = {};
+			itemCountOptions.ApiVersion = EOS_ECOM_GETOFFERITEMCOUNT_API_LATEST;
+			itemCountOptions.LocalUserId = data->LocalUserId;
+			itemCountOptions.OfferId = eosOfferPointer->Id;
+			uint32_t itemCount = EOS_Ecom_GetOfferItemCount(ecomHandle, &itemCountOptions);
+			offer.Items.reserve(itemCount);
+			for (uint32_t itemIndex = 0; itemIndex < itemCount; itemIndex++)
+			{
+				EOS_Ecom_CopyOfferItemByIndexOptions copyItemOptions = {};
+				copyItemOptions.ApiVersion = EOS_ECOM_COPYOFFERITEMBYINDEX_API_LATEST;
+				copyItemOptions.LocalUserId = data->LocalUserId;
+				copyItemOptions.OfferId = eosOfferPointer->Id;
+				copyItemOptions.ItemIndex = itemIndex;
+				EOS_Ecom_CatalogItem* eosItemPointer = nullptr;
+				if (EOS_Ecom_CopyOfferItemByIndex(ecomHandle, &copyItemOptions, &eosItemPointer) != EOS_EResult::EOS_Success)
+				{
+					continue;
+				}
+				if (!eosItemPointer)
+				{
+					continue;
+				}
+				CatalogItem item;
+				item.Id = ToSafeString(eosItemPointer->Id);
+				item.EntitlementName = ToSafeString(eosItemPointer->EntitlementName);
+				item.Title = ToSafeString(eosItemPointer->TitleText);
+				item.Description = ToSafeString(eosItemPointer->DescriptionText);
+				item.ItemType = eosItemPointer->ItemType;
+
+				EOS_Ecom_GetItemImageInfoCountOptions itemImageCountOptions = {};
+				itemImageCountOptions.ApiVersion = EOS_ECOM_GETITEMIMAGEINFOCOUNT_API_LATEST;
+				itemImageCountOptions.LocalUserId = data->LocalUserId;
+				itemImageCountOptions.ItemId = eosItemPointer->Id;
+				uint32_t itemImageCount = EOS_Ecom_GetItemImageInfoCount(ecomHandle, &itemImageCountOptions);
+				for (uint32_t imageIndex = 0; imageIndex < itemImageCount; imageIndex++)
+				{
+					EOS_Ecom_CopyItemImageInfoByIndexOptions copyImageOptions = {};
+					copyImageOptions.ApiVersion = EOS_ECOM_COPYITEMIMAGEINFOBYINDEX_API_LATEST;
+					copyImageOptions.LocalUserId = data->LocalUserId;
+					copyImageOptions.ItemId = eosItemPointer->Id;
+					copyImageOptions.ImageInfoIndex = imageIndex;
+					EOS_Ecom_KeyImageInfo* eosImagePointer = nullptr;
+					auto copyResult = EOS_Ecom_CopyItemImageInfoByIndex(ecomHandle, &copyImageOptions, &eosImagePointer);
+					if ((copyResult == EOS_EResult::EOS_Success) && eosImagePointer)
+					{
+						item.Images.push_back(CopyKeyImageFrom(*eosImagePointer));
+						EOS_Ecom_KeyImageInfo_Release(eosImagePointer);
+					}
+				}
+
+				EOS_Ecom_GetItemReleaseCountOptions releaseCountOptions = {};
+				releaseCountOptions.ApiVersion = EOS_ECOM_GETITEMRELEASECOUNT_API_LATEST;
+				releaseCountOptions.LocalUserId = data->LocalUserId;
+				releaseCountOptions.ItemId = eosItemPointer->Id;
+				uint32_t releaseCount = EOS_Ecom_GetItemReleaseCount(ecomHandle, &releaseCountOptions);
+				for (uint32_t releaseIndex = 0; releaseIndex < releaseCount; releaseIndex++)
+				{
+					EOS_Ecom_CopyItemReleaseByIndexOptions copyReleaseOptions = {};
+					copyReleaseOptions.ApiVersion = EOS_ECOM_COPYITEMRELEASEBYINDEX_API_LATEST;
+					copyReleaseOptions.LocalUserId = data->LocalUserId;
+					copyReleaseOptions.ItemId = eosItemPointer->Id;
+					copyReleaseOptions.ReleaseIndex = releaseIndex;
+					EOS_Ecom_CatalogRelease* eosReleasePointer = nullptr;
+					auto copyResult = EOS_Ecom_CopyItemReleaseByIndex(ecomHandle, &copyReleaseOptions, &eosReleasePointer);
+					if ((copyResult == EOS_EResult::EOS_Success) && eosReleasePointer)
+					{
+						ItemRelease release;
+						for (uint32_t index = 0; index < eosReleasePointer->CompatibleAppIdCount; index++)
+						{
+							release.CompatibleAppIds.push_back(ToSafeString(eosReleasePointer->CompatibleAppIds[index]));
+						}
+						for (uint32_t index = 0; index < eosReleasePointer->CompatiblePlatformCount; index++)
+						{
+							release.CompatiblePlatforms.push_back(ToSafeString(eosReleasePointer->CompatiblePlatforms[index]));
+						}
+						release.ReleaseNote = ToSafeString(eosReleasePointer->ReleaseNote);
+						item.Releases.push_back(std::move(release));
+						EOS_Ecom_CatalogRelease_Release(eosReleasePointer);
+					}
+				}
+
+				offer.Items.push_back(std::move(item));
+				EOS_Ecom_CatalogItem_Release(eosItemPointer);
+			}
+
+			EOS_Ecom_CatalogOffer_Release(eosOfferPointer);
+			catalogPointer->AddOffer(std::move(offer));
+		}
+		catalogPointer->SetFetchTime(std::chrono::steady_clock::now());
+
+		// Notify Lua if the catalog it was given before differs from the new one.
+		// The catalog file only needs to be re-written if something changed.
+		auto previousCatalogPointer = storePointer->fCatalogPointer;
+		bool hasChanged = true;
+		if (previousCatalogPointer)
+		{
+			hasChanged = storePointer->QueueProductsChangedEvent(*previousCatalogPointer, *catalogPointer);
+		}
+		storePointer->fCatalogPointer = catalogPointer;
+		storePointer->fIsCatalogInvalidated = false;
+		if (hasChanged && !storePointer->fCatalogFilePath.empty())
+		{
+			if (!catalogPointer->WriteTo(storePointer->fCatalogFilePath))
+			{
+				CoronaLog("WARNING: [EOS SDK] Failed to write store catalog to file: %s", storePointer->fCatalogFilePath.c_str());
+			}
+		}
+	}
+	else
+	{
+		CoronaLog("WARNING: [EOS SDK] Failed to query store offers. Result code: %d", (int)resultCode);
+	}
+
+	// Respond to all requests that were waiting on this query.
+	// Note: A failed query still provides the last fetched catalog, if any, flagged as an error.
+	std::vector<PendingLoadProductsRequest> requests;
+	requests.swap(storePointer->fPendingLoadProductsRequests);
+	for (auto&& request : requests)
+	{
+		storePointer->QueueLoadProductsEvent(storePointer->fCatalogPointer, request, resultCode, false);
+	}
+}
+
+void EOS_CALL EcomStore::OnCheckoutCallback(const EOS_Ecom_CheckoutCallbackInfo* data)
+{
+	// Validate.
+	if (!data || !EOS_EResult_IsOperationComplete(data->ResultCode))
+	{
+		return;
+	}
+	auto storePointer = GetInstanceBy(data->ClientData);
+	if (!storePointer)
+	{
+		return;
+	}
+
+	// Fetch the offers that were checked out and the timing of the checkout's phases.
+	std::vector<std::string> offerIds;
+	std::shared_ptr<CheckoutTiming> timingPointer;
+	auto checkoutIterator = storePointer->fCheckouts.find(data->LocalUserId);
+	if (checkoutIterator != storePointer->fCheckouts.end())
+	{
+		offerIds = std::move(checkoutIterator->second.OfferIds);
+		timingPointer = std::make_shared<CheckoutTiming>(checkoutIterator->second.Timing);
+		timingPointer->ResultTime = std::chrono::steady_clock::now();
+		storePointer->fCheckouts.erase(checkoutIterator);
+	}
+
+	// Create 1 transaction for the whole checkout.
+	Transaction transaction;
+	transaction.Result = data->ResultCode;
+	transaction.CheckoutTimingPointer = timingPointer;
+	if (!offerIds.empty())
+	{
+		transaction.ProductIdentifier = offerIds.front();
+	}
+	if (data->ResultCode == EOS_EResult::EOS_Success)
+	{
+		transaction.State = "purchased";
+		transaction.Identifier = ToSafeString(data->TransactionId);
+
+		// Fetch the entitlements granted by the transaction, needed to redeem them later.
+		auto ecomHandle = storePointer->GetEcomHandle();
+		auto sessionPointer = storePointer->fContext.GetLocalUserBy(data->LocalUserId);
+		EOS_Ecom_HTransaction transactionHandle = nullptr;
+		EOS_Ecom_CopyTransactionByIdOptions copyTransactionOptions = {};
+		copyTransactionOptions.ApiVersion = EOS_ECOM_COPYTRANSACTIONBYID_API_LATEST;
+		copyTransactionOptions.LocalUserId = data->LocalUserId;
+		copyTransactionOptions.TransactionId = data->TransactionId;
+		bool wasCopied =
+				ecomHandle && data->TransactionId &&
+				(EOS_Ecom_CopyTransactionById(ecomHandle, &copyTransactionOptions, &transactionHandle) == EOS_EResult::EOS_Success);
+		if (wasCopied && transactionHandle)
+		{
+			EOS_Ecom_Transaction_GetEntitlementsCountOptions countOptions = {};
+			countOptions.ApiVersion = EOS_ECOM_TRANSACTION_GETENTITLEMENTSCOUNT_API_LATEST;
+			uint32_t entitlementCount = EOS_Ecom_Transaction_GetEntitlementsCount(transactionHandle, &countOptions);
+			for (uint32_t index = 0; index < entitlementCount; index++)
+			{
+				EOS_Ecom_Transaction_CopyEntitlementByIndexOptions copyOptions = {};
+				copyOptions.ApiVersion = EOS_ECOM_TRANSACTION_COPYENTITLEMENTBYINDEX_API_LATEST;
+				copyOptions.EntitlementIndex = index;
+				EOS_Ecom_Entitlement* entitlementPointer = nullptr;
+				auto copyResult = EOS_Ecom_Transaction_CopyEntitlementByIndex(transactionHandle, &copyOptions, &entitlementPointer);
+				if ((copyResult == EOS_EResult::EOS_Success) && entitlementPointer)
+				{
+					if (entitlementPointer->EntitlementId)
+					{
+						transaction.EntitlementIds.push_back(entitlementPointer->EntitlementId);
+					}
+					if (sessionPointer)
+					{
+						AddEntitlementTo(*sessionPointer, *entitlementPointer);
+					}
+					EOS_Ecom_Entitlement_Release(entitlementPointer);
+				}
+			}
+			EOS_Ecom_Transaction_Release(transactionHandle);
+		}
+
+		// Journal the transaction until it is finished, in case the app is terminated before then.
+		JournalEntry entry;
+		entry.Id = transaction.Identifier;
+		entry.State = transaction.State;
+		entry.ProductIdentifier = transaction.ProductIdentifier;
+		entry.EntitlementIds = transaction.EntitlementIds;
+		entry.WasDispatched = true;
+		storePointer->fTransactionJournal.Put(entry);
+
+		// Purchases can change offer availability and purchase limits. Fetch the catalog again on next request.
+		storePointer->InvalidateCatalog();
+	}
+	else if (data->ResultCode == EOS_EResult::EOS_Canceled)
+	{
+		transaction.State = "cancelled";
+	}
+	else
+	{
+		transaction.State = "failed";
+	}
+
+	// Queue the result to be dispatched to Lua later.
+	std::vector<Transaction> transactions;
+	transactions.push_back(std::move(transaction));
+	storePointer->QueueStoreTransactionEvent(data->LocalUserId, std::move(transactions));
+}
+
+void EOS_CALL EcomStore::OnQueryEntitlementsCallback(const EOS_Ecom_QueryEntitlementsCallbackInfo* data)
+{
+	// Validate.
+	if (!data || !EOS_EResult_IsOperationComplete(data->ResultCode))
+	{
+		return;
+	}
+	auto storePointer = GetInstanceBy(data->ClientData);
+	if (!storePointer)
+	{
+		return;
+	}
+	storePointer->fRestoringAccountIds.erase(data->LocalUserId);
+
+	// Create a "restored" transaction for every unredeemed entitlement that is new or has changed.
+	std::vector<Transaction> transactions;
+	auto ecomHandle = storePointer->GetEcomHandle();
+	if ((data->ResultCode == EOS_EResult::EOS_Success) && ecomHandle)
+	{
+		auto catalogPointer = storePointer->fCatalogPointer;
+		auto& journal = storePointer->fTransactionJournal;
+		auto sessionPointer = storePointer->fContext.GetLocalUserBy(data->LocalUserId);
+		EOS_Ecom_GetEntitlementsCountOptions countOptions = {};
+		countOptions.ApiVersion = EOS_ECOM_GETENTITLEMENTSCOUNT_API_LATEST;
+		countOptions.LocalUserId = data->LocalUserId;
+		uint32_t entitlementCount = EOS_Ecom_GetEntitlementsCount(ecomHandle, &countOptions);
+		transactions.reserve(entitlementCount);
+		for (uint32_t index = 0; index < entitlementCount; index++)
+		{
+			EOS_Ecom_CopyEntitlementByIndexOptions copyOptions = {};
+			copyOptions.ApiVersion = EOS_ECOM_COPYENTITLEMENTBYINDEX_API_LATEST;
+			copyOptions.LocalUserId = data->LocalUserId;
+			copyOptions.EntitlementIndex = index;
+			EOS_Ecom_Entitlement* entitlementPointer = nullptr;
+			auto copyResult = EOS_Ecom_CopyEntitlementByIndex(ecomHandle, &copyOptions, &entitlementPointer);
+			if ((copyResult != EOS_EResult::EOS_Success) || !entitlementPointer)
+			{
+				continue;
+			}
+			if (sessionPointer)
+			{
+				AddEntitlementTo(*sessionPointer, *entitlementPointer);
+			}
+			storePointer->TrackUnredeemedEntitlement(data->LocalUserId, *entitlementPointer);
+			// Note: Entitlements of finished transactions waiting to be redeemed are not provided again.
+			bool isRedeemable =
+					entitlementPointer->EntitlementId && (entitlementPointer->bRedeemed != EOS_TRUE) &&
+					!journal.GetRedeemBy(entitlementPointer->EntitlementId);
+			if (isRedeemable)
+			{
+				// Fetch the offer that granted the entitlement, if in the catalog.
+				std::string productIdentifier;
+				if (catalogPointer && entitlementPointer->CatalogItemId)
+				{
+					auto offerPointer = catalogPointer->GetOfferByItemId(entitlementPointer->CatalogItemId);
+					if (offerPointer)
+					{
+						productIdentifier = offerPointer->Id;
+					}
+				}
+
+				// Fetch the journaled transaction that granted the entitlement, journaling a new one if not found.
+				// An entry whose offer was unknown, such as if restored before the catalog was loaded, has changed.
+				auto entryPointer = journal.GetEntryByEntitlementId(entitlementPointer->EntitlementId);
+				if (!entryPointer || (entryPointer->ProductIdentifier.empty() && !productIdentifier.empty()))
+				{
+					JournalEntry entry;
+					if (entryPointer)
+					{
+						entry = *entryPointer;
+					}
+					else
+					{
+						entry.Id = entitlementPointer->EntitlementId;
+						entry.State = "restored";
+						entry.EntitlementIds.push_back(entry.Id);
+					}
+					entry.ProductIdentifier = productIdentifier;
+					entry.WasDispatched = false;
+					journal.Put(entry);
+					entryPointer = journal.GetEntryBy(entry.Id);
+				}
+
+				// Provide the transaction only if new, changed, or not provided since the app was launched.
+				if (entryPointer && !entryPointer->WasDispatched)
+				{
+					Transaction transaction;
+					transaction.State = "restored";
+					transaction.Result = EOS_EResult::EOS_Success;
+					transaction.Identifier = entryPointer->Id;
+					transaction.ProductIdentifier = entryPointer->ProductIdentifier;
+					transaction.EntitlementIds = entryPointer->EntitlementIds;
+					journal.SetWasDispatched(entryPointer->Id);
+					transactions.push_back(std::move(transaction));
+				}
+			}
+			EOS_Ecom_Entitlement_Release(entitlementPointer);
+		}
+	}
+	else
+	{
+		Transaction transaction;
+		transaction.State = "failed";
+		transaction.Result = data->ResultCode;
+		transactions.push_back(std::move(transaction));
+	}
+
+	// Queue the result to be dispatched to Lua later.
+	storePointer->QueueStoreTransactionEvent(data->LocalUserId, std::move(transactions));
+}
+
+void EOS_CALL EcomStore::OnPrepareEntitlementsCallback(const EOS_Ecom_QueryEntitlementsCallbackInfo* data)
+{
+	// Validate.
+	if (!data || !EOS_EResult_IsOperationComplete(data->ResultCode))
+	{
+		return;
+	}
+	auto storePointer = GetInstanceBy(data->ClientData);
+	if (!storePointer)
+	{
+		return;
+	}
+	storePointer->fPreparingAccountIds.erase(data->LocalUserId);
+
+	// Cache the user's entitlements in the session. Failures are only logged since nothing waits on this.
+	auto ecomHandle = storePointer->GetEcomHandle();
+	auto sessionPointer = storePointer->fContext.GetLocalUserBy(data->LocalUserId);
+	if (data->ResultCode != EOS_EResult::EOS_Success)
+	{
+		CoronaLog("WARNING: [EOS SDK] Failed to prepare store entitlements. Result code: %d", (int)data->ResultCode);
+		return;
+	}
+	if (!ecomHandle || !sessionPointer)
+	{
+		return;
+	}
+	EOS_Ecom_GetEntitlementsCountOptions countOptions = {};
+	countOptions.ApiVersion = EOS_ECOM_GETENTITLEMENTSCOUNT_API_LATEST;
+	countOptions.LocalUserId = data->LocalUserId;
+	uint32_t entitlementCount = EOS_Ecom_GetEntitlementsCount(ecomHandle, &countOptions);
+	for (uint32_t index = 0; index < entitlementCount; index++)
+	{
+		EOS_Ecom_CopyEntitlementByIndexOptions copyOptions = {};
+		copyOptions.ApiVersion = EOS_ECOM_COPYENTITLEMENTBYINDEX_API_LATEST;
+		copyOptions.LocalUserId = data->LocalUserId;
+		copyOptions.EntitlementIndex = index;
+		EOS_Ecom_Entitlement* entitlementPointer = nullptr;
+		auto copyResult = EOS_Ecom_CopyEntitlementByIndex(ecomHandle, &copyOptions, &entitlementPointer);
+		if ((copyResult == EOS_EResult::EOS_Success) && entitlementPointer)
+		{
+			AddEntitlementTo(*sessionPointer, *entitlementPointer);
+			storePointer->TrackUnredeemedEntitlement(data->LocalUserId, *entitlementPointer);
+			EOS_Ecom_Entitlement_Release(entitlementPointer);
+		}
+	}
+}
+
+void EOS_CALL EcomStore::OnDisplaySettingsUpdatedCallback(const EOS_UI_OnDisplaySettingsUpdatedCallbackInfo* data)
+{
+	// Validate.
+	if (!data || (data->bIsVisible != EOS_TRUE))
+	{
+		return;
+	}
+	auto storePointer = GetInstanceBy(data->ClientData);
+	if (!storePointer)
+	{
+		return;
+	}
+
+	// Flag the overlay as shown for all in-flight checkouts, since EOS does not say what the overlay is showing.
+	auto now = std::chrono::steady_clock::now();
+	for (auto&& pair : storePointer->fCheckouts)
+	{
+		if (!pair.second.Timing.WasOverlayShown)
+		{
+			pair.second.Timing.OverlayShownTime = now;
+			pair.second.Timing.WasOverlayShown = true;
+		}
+	}
+}
+
+void EOS_CALL EcomStore::OnQueryOwnershipCallback(const EOS_Ecom_QueryOwnershipCallbackInfo* data)
+{
+	// Validate.
+	if (!data || !EOS_EResult_IsOperationComplete(data->ResultCode))
+	{
+		return;
+	}
+	auto requestPointer = TakeBatchQueryRequestBy(data->ClientData);
+	if (!requestPointer)
+	{
+		return;
+	}
+	auto storePointer = requestPointer->StorePointer;
+	auto& query = *(requestPointer->QueryPointer);
+
+	// Copy the ownership results and update the user's entitlement set for fast IsEntitledTo() lookups.
+	if (data->ResultCode == EOS_EResult::EOS_Success)
+	{
+		auto sessionPointer = storePointer->fContext.GetLocalUserBy(data->LocalUserId);
+		for (uint32_t index = 0; data->ItemOwnership && (index < data->ItemOwnershipCount); index++)
+		{
+			auto& eosOwnership = data->ItemOwnership[index];
+			ItemOwnership ownership;
+			ownership.Id = ToSafeString(eosOwnership.Id);
+			ownership.IsOwned = (eosOwnership.OwnershipStatus == EOS_EOwnershipStatus::EOS_OS_Owned);
+			if (sessionPointer)
+			{
+				sessionPointer->SetIsEntitledTo(ownership.Id, ownership.IsOwned);
+			}
+			query.Ownerships.push_back(std::move(ownership));
+		}
+	}
+	else if (query.Result == EOS_EResult::EOS_Success)
+	{
+		query.Result = data->ResultCode;
+	}
+
+	// Queue a Lua event if this was the query's last request.
+	storePointer->OnBatchQueryRequestCompleted(requestPointer);
+}
+
+void EOS_CALL EcomStore::OnBatchQueryEntitlementsCallback(const EOS_Ecom_QueryEntitlementsCallbackInfo* data)
+{
+	// Validate.
+	if (!data || !EOS_EResult_IsOperationComplete(data->ResultCode))
+	{
+		return;
+	}
+	auto requestPointer = TakeBatchQueryRequestBy(data->ClientData);
+	if (!requestPointer)
+	{
+		return;
+	}
+	auto storePointer = requestPointer->StorePointer;
+	auto& query = *(requestPointer->QueryPointer);
+
+	// Handle errors.
+	auto ecomHandle = storePointer->GetEcomHandle();
+	if ((data->ResultCode != EOS_EResult::EOS_Success) || !ecomHandle)
+	{
+		if (query.Result == EOS_EResult::EOS_Success)
+		{
+			query.Result = ecomHandle ? data->ResultCode : EOS_EResult::EOS_InvalidState;
+		}
+		storePointer->OnBatchQueryRequestCompleted(requestPointer);
+		return;
+	}
+
+	// Copy the entitlements this request asked for and update the user's entitlement set.
+	// Note: The EOS cache holds the results of all of the user's queries, so only the requested names are copied.
+	// A request made without names asked for all entitlements, in which case everything is copied.
+	auto sessionPointer = storePointer->fContext.GetLocalUserBy(data->LocalUserId);
+	auto accountId = data->LocalUserId;
+	auto addEntitlement = [&query, storePointer, sessionPointer, accountId](EOS_Ecom_Entitlement* entitlementPointer)
+	{
+		if (sessionPointer)
+		{
+			AddEntitlementTo(*sessionPointer, *entitlementPointer);
+		}
+		storePointer->TrackUnredeemedEntitlement(accountId, *entitlementPointer);
+		query.Entitlements.push_back(CopyEntitlementFrom(*entitlementPointer));
+		EOS_Ecom_Entitlement_Release(entitlementPointer);
+	};
+	if (requestPointer->Ids.empty())
+	{
+		EOS_Ecom_GetEntitlementsCountOptions countOptions = {};
+		countOptions.ApiVersion = EOS_ECOM_GETENTITLEMENTSCOUNT_API_LATEST;
+		countOptions.LocalUserId = data->LocalUserId;
+		uint32_t entitlementCount = EOS_Ecom_GetEntitlementsCount(ecomHandle, &countOptions);
+		query.Entitlements.reserve(query.Entitlements.size() + entitlementCount);
+		for (uint32_t index = 0; index < entitlementCount; index++)
+		{
+			EOS_Ecom_CopyEntitlementByIndexOptions copyOptions = {};
+			copyOptions.ApiVersion = EOS_ECOM_COPYENTITLEMENTBYINDEX_API_LATEST;
+			copyOptions.LocalUserId = data->LocalUserId;
+			copyOptions.EntitlementIndex = index;
+			EOS_Ecom_Entitlement* entitlementPointer = nullptr;
+			auto copyResult = EOS_Ecom_CopyEntitlementByIndex(ecomHandle, &copyOptions, &entitlementPointer);
+			if ((copyResult == EOS_EResult::EOS_Success) && entitlementPointer)
+			{
+				addEntitlement(entitlementPointer);
+			}
+		}
+	}
+	else
+	{
+		for (auto&& name : requestPointer->Ids)
+		{
+			EOS_Ecom_GetEntitlementsByNameCountOptions countOptions = {};
+			countOptions.ApiVersion = EOS_ECOM_GETENTITLEMENTSBYNAMECOUNT_API_LATEST;
+			countOptions.LocalUserId = data->LocalUserId;
+			countOptions.EntitlementName = name.c_str();
+			uint32_t entitlementCount = EOS_Ecom_GetEntitlementsByNameCount(ecomHandle, &countOptions);
+			if ((entitlementCount == 0) && sessionPointer)
+			{
+				sessionPointer->SetIsEntitledTo(name, false);
+			}
+			for (uint32_t index = 0; index < entitlementCount; index++)
+			{
+				EOS_Ecom_CopyEntitlementByNameAndIndexOptions copyOptions = {};
+				copyOptions.ApiVersion = EOS_ECOM_COPYENTITLEMENTBYNAMEANDINDEX_API_LATEST;
+				copyOptions.LocalUserId = data->LocalUserId;
+				copyOptions.EntitlementName = name.c_str();
+				copyOptions.Index = index;
+				EOS_Ecom_Entitlement* entitlementPointer = nullptr;
+				auto copyResult = EOS_Ecom_CopyEntitlementByNameAndIndex(ecomHandle, &copyOptions, &entitlementPointer);
+				if ((copyResult == EOS_EResult::EOS_Success) && entitlementPointer)
+				{
+					addEntitlement(entitlementPointer);
+				}
+			}
+		}
+	}
+
+	// Queue a Lua event if this was the query's last request.
+	storePointer->OnBatchQueryRequestCompleted(requestPointer);
+}
+
+void EOS_CALL EcomStore::OnQueryOwnershipTokenCallback(const EOS_Ecom_QueryOwnershipTokenCallbackInfo* data)
+{
+	// Validate.
+	if (!data || !EOS_EResult_IsOperationComplete(data->ResultCode))
+	{
+		return;
+	}
+	auto requestPointer = TakeBatchQueryRequestBy(data->ClientData);
+	if (!requestPointer)
+	{
+		return;
+	}
+
+	// Cache the token and queue a Lua event if this was the query's last request.
+	requestPointer->StorePointer->OnTokenReceived(
+			requestPointer, data->LocalUserId, data->ResultCode, data->OwnershipToken);
+}
+
+void EOS_CALL EcomStore::OnQueryEntitlementTokenCallback(const EOS_Ecom_QueryEntitlementTokenCallbackInfo* data)
+{
+	// Validate.
+	if (!data || !EOS_EResult_IsOperationComplete(data->ResultCode))
+	{
+		return;
+	}
+	auto requestPointer = TakeBatchQueryRequestBy(data->ClientData);
+	if (!requestPointer)
+	{
+		return;
+	}
+
+	// Cache the token and queue a Lua event if this was the query's last request.
+	requestPointer->StorePointer->OnTokenReceived(
+			requestPointer, data->LocalUserId, data->ResultCode, data->EntitlementToken);
+}
+
+void EOS_CALL EcomStore::OnRedeemEntitlementsCallback(const EOS_Ecom_RedeemEntitlementsCallbackInfo* data)
+{
+	// Validate.
+	if (!data || !EOS_EResult_IsOperationComplete(data->ResultCode))
+	{
+		return;
+	}
+
+	auto storePointer = GetInstanceBy(data->ClientData);
+	if (!storePointer)
+	{
+		return;
+	}
+
+	// Reconcile the account's in-flight batch with the entitlements EOS redeemed.
+	storePointer->OnRedeemCompleted(data->LocalUserId, data->ResultCode);
+}
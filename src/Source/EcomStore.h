@@ -0,0 +1,961 @@
+// ----------------------------------------------------------------------------
+//
+// EcomStore.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "eos_sdk.h"
+#include "eos_ecom_types.h"
+#include "eos_ui_types.h"
+#include "ImageCache.h"
+#include "RsaPublicKey.h"
+
+
+// Forward declarations.
+class JsonWebToken;
+class LocalUserSession;
+class RuntimeContext;
+
+
+/**
+  Provides the plugin's in-app store via the EOS Ecom interface.
+
+  Keeps an in-memory catalog of all offers and their items, indexed by ID, which is fetched via
+  EOS_Ecom_QueryOffers() and considered fresh for a configurable amount of time. While fresh,
+  "loadProducts" requests are answered from the catalog on the next frame without a network round trip.
+  Concurrent requests made while the catalog is being fetched share the same EOS query.
+
+  Purchases, restores, and redemptions are dispatched to Lua as "storeTransaction" events.
+ */
+class EcomStore
+{
+	public:
+		/** Stores a copy of a key image used to display an offer or item in a storefront. */
+		struct KeyImage
+		{
+			/** Describes the usage of the image, such as "home_thumbnail". */
+			std::string Type;
+
+			std::string Url;
+			uint32_t Width;
+			uint32_t Height;
+
+			bool operator==(const KeyImage& value) const;
+			bool operator!=(const KeyImage& value) const;
+		};
+
+		/** Stores a copy of a release an item is compatible with. */
+		struct ItemRelease
+		{
+			std::vector<std::string> CompatibleAppIds;
+			std::vector<std::string> CompatiblePlatforms;
+			std::string ReleaseNote;
+
+			bool operator==(const ItemRelease& value) const;
+			bool operator!=(const ItemRelease& value) const;
+		};
+
+		/** Stores a copy of an item belonging to a catalog offer. */
+		struct CatalogItem
+		{
+			std::string Id;
+			std::string EntitlementName;
+			std::string Title;
+			std::string Description;
+			EOS_EEcomItemType ItemType;
+			std::vector<KeyImage> Images;
+			std::vector<ItemRelease> Releases;
+
+			bool operator==(const CatalogItem& value) const;
+			bool operator!=(const CatalogItem& value) const;
+		};
+
+		/** Stores a copy of an offer in the store's catalog. */
+		struct CatalogOffer
+		{
+			std::string Id;
+			std::string CatalogNamespace;
+			std::string Title;
+			std::string Description;
+			std::string LongDescription;
+			std::string CurrencyCode;
+
+			/** Set to EOS_Success if the price fields below are valid. */
+			EOS_EResult PriceResult;
+
+			/** Price before discounts, in the currency's smallest unit. Divide by 10^DecimalPoint for its value. */
+			uint64_t OriginalPrice;
+
+			/** Price after discounts, in the currency's smallest unit. Divide by 10^DecimalPoint for its value. */
+			uint64_t CurrentPrice;
+
+			uint32_t DecimalPoint;
+			uint8_t DiscountPercentage;
+
+			/** POSIX time the offer expires. Set to EOS_ECOM_CATALOGOFFER_EXPIRATIONTIMESTAMP_UNDEFINED if it never does. */
+			int64_t ExpirationTimestamp;
+
+			/** Max number of times the offer can be purchased. Negative if unlimited. */
+			int32_t PurchaseLimit;
+
+			/** POSIX time the offer was released. Set to EOS_ECOM_CATALOGOFFER_RELEASEDATETIMESTAMP_UNDEFINED if unknown. */
+			int64_t ReleaseDateTimestamp;
+
+			/** POSIX time the offer becomes purchasable. Set to EOS_ECOM_CATALOGOFFER_EFFECTIVEDATETIMESTAMP_UNDEFINED if unknown. */
+			int64_t EffectiveDateTimestamp;
+
+			bool IsAvailableForPurchase;
+			std::vector<KeyImage> Images;
+			std::vector<CatalogItem> Items;
+
+			bool operator==(const CatalogOffer& value) const;
+			bool operator!=(const CatalogOffer& value) const;
+		};
+
+		/**
+		  Immutable snapshot of all offers fetched by one EOS_Ecom_QueryOffers() request.
+		  Shared with queued Lua event tasks, which read from it when they are dispatched.
+		 */
+		class Catalog
+		{
+			public:
+				Catalog();
+				virtual ~Catalog();
+
+				/**
+				  Adds the given offer to the catalog, indexing it and its items by ID.
+				  Only intended to be called while the catalog is being built.
+				  @param offer The offer to add. Ignored if an offer with the same ID was already added.
+				 */
+				void AddOffer(CatalogOffer&& offer);
+
+				/** Gets all offers in the order EOS provided them. */
+				const std::vector<CatalogOffer>& GetOffers() const;
+
+				/**
+				  Fetches an offer by its ID.
+				  @param offerId The offer's ID.
+				  @return Returns the offer. Returns null if not found.
+				 */
+				const CatalogOffer* GetOfferBy(const std::string& offerId) const;
+
+				/**
+				  Fetches the offer that grants the given catalog item.
+				  @param itemId The ID of the item, such as an entitlement's catalog item ID.
+				  @return Returns the offer. Returns null if the item does not belong to any offer in the catalog.
+				 */
+				const CatalogOffer* GetOfferByItemId(const std::string& itemId) const;
+
+				/** Gets the time this catalog was fetched from EOS. */
+				std::chrono::steady_clock::time_point GetFetchTime() const;
+
+				/** Sets the time this catalog was fetched from EOS. */
+				void SetFetchTime(std::chrono::steady_clock::time_point value);
+
+				/**
+				  Writes this catalog to the given file in a compact binary format.
+				  The file is written to a temporary file first and then renamed, so that a crash cannot corrupt it.
+				  @param filePath Path of the file to write to.
+				  @return Returns true if the file was written. Returns false if it could not be written.
+				 */
+				bool WriteTo(const std::string& filePath) const;
+
+				/**
+				  Adds all offers from the given file written by WriteTo() to this catalog.
+				  @param filePath Path of the file to read from.
+				  @return Returns true if the file was read.
+
+				          Returns false if the file does not exist, was written by an older plugin version,
+				          or is corrupt, in which case no offers are added.
+				 */
+				bool ReadFrom(const std::string& filePath);
+
+			private:
+				/** All offers in the order EOS provided them. */
+				std::vector<CatalogOffer> fOffers;
+
+				/** Offer IDs mapped to their index in "fOffers". */
+				std::unordered_map<std::string, size_t> fOfferIndexes;
+
+				/** Item IDs mapped to the index of their owning offer in "fOffers". */
+				std::unordered_map<std::string, size_t> fItemOfferIndexes;
+
+				/** Time this catalog was fetched from EOS. */
+				std::chrono::steady_clock::time_point fFetchTime;
+		};
+
+		/** Stores the ownership status of 1 catalog item, as received from EOS_Ecom_QueryOwnership(). */
+		struct ItemOwnership
+		{
+			std::string Id;
+			bool IsOwned;
+		};
+
+		/** Stores a copy of 1 entitlement owned by a user. */
+		struct Entitlement
+		{
+			std::string Name;
+			std::string Id;
+			std::string CatalogItemId;
+			bool IsRedeemed;
+
+			/** POSIX time the entitlement ends. Set to EOS_ECOM_ENTITLEMENT_ENDTIMESTAMP_UNDEFINED if it never does. */
+			int64_t EndTimestamp;
+		};
+
+		/** A signed ownership or entitlement token received from EOS, as a JSON Web Token. */
+		struct EcomToken
+		{
+			/** The encoded JWT string, to be sent to a game server for verification. */
+			std::string Token;
+
+			/** The catalog item IDs or entitlement names the token covers. Empty if it covers all entitlements. */
+			std::vector<std::string> Ids;
+
+			/** POSIX time the token expires, read from its "exp" claim. Zero if it has no expiration. */
+			time_t ExpirationTime;
+
+			/** Set true if the token's signature and claims were verified locally via VerifyToken(). */
+			bool IsVerified;
+		};
+
+		/** Times at which the phases of 1 checkout happened, used to measure purchase latency. */
+		struct CheckoutTiming
+		{
+			/** Time at which EOS_Ecom_Checkout() was called. */
+			std::chrono::steady_clock::time_point RequestTime;
+
+			/** Time at which the EOS overlay was shown. Only valid if "WasOverlayShown" is true. */
+			std::chrono::steady_clock::time_point OverlayShownTime;
+
+			/** Time at which EOS provided the checkout's result. */
+			std::chrono::steady_clock::time_point ResultTime;
+
+			/** Set true if the overlay was seen becoming visible during the checkout. */
+			bool WasOverlayShown;
+
+			/** Set true if the store was prepared via PrepareStore() and its catalog was fresh when checking out. */
+			bool WasPrepared;
+		};
+
+		/** Stores the information of 1 purchased, restored, consumed, or failed transaction to be dispatched to Lua. */
+		struct Transaction
+		{
+			/**
+			  The transaction's Lua state name, such as "purchased", "restored", "consumed", "failed", or "cancelled".
+			  Set to "unconfirmed" for finished entitlements that EOS did not report as redeemed by its request,
+			  such as if they were already redeemed or are invalid.
+			 */
+			const char* State;
+
+			/** The checkout transaction ID, or the entitlement ID of a restored purchase. Can be empty on failure. */
+			std::string Identifier;
+
+			/** ID of the purchased offer. Empty if unknown. */
+			std::string ProductIdentifier;
+
+			/** IDs of the entitlements granted by the transaction, to be redeemed by finishTransaction(). */
+			std::vector<std::string> EntitlementIds;
+
+			/** The EOS result of the request that produced this transaction. */
+			EOS_EResult Result;
+
+			/** The timing of the checkout that produced this transaction. Null if not produced by a checkout. */
+			std::shared_ptr<const CheckoutTiming> CheckoutTimingPointer;
+		};
+
+		/** A purchased or restored transaction recorded by a TransactionJournal until it is finished. */
+		struct JournalEntry
+		{
+			/** The checkout transaction ID, or the entitlement ID of a restored purchase. */
+			std::string Id;
+
+			/** The state the transaction was dispatched to Lua with, such as "purchased" or "restored". */
+			std::string State;
+
+			/** ID of the purchased offer. Empty if unknown. */
+			std::string ProductIdentifier;
+
+			/** IDs of the entitlements granted by the transaction, to be redeemed by finishTransaction(). */
+			std::vector<std::string> EntitlementIds;
+
+			/**
+			  Set true if the transaction has been dispatched to Lua since the app was launched.
+			  Not persisted, so that unfinished transactions recorded by a previous launch get dispatched again.
+			 */
+			bool WasDispatched;
+		};
+
+		/** A finished transaction's entitlement recorded by a TransactionJournal until it has been redeemed. */
+		struct PendingRedeem
+		{
+			/** ID of the entitlement to redeem. */
+			std::string EntitlementId;
+
+			/** String form of the Epic account that owns the entitlement. */
+			std::string AccountId;
+
+			/** ID of the finished transaction that granted the entitlement. */
+			std::string TransactionId;
+
+			/** ID of the purchased offer. Empty if unknown. */
+			std::string ProductIdentifier;
+		};
+
+		/**
+		  Persistent record of all transactions that have not been finished yet, keyed by transaction ID,
+		  and of the entitlements of finished transactions that have not been redeemed yet.
+
+		  Changes are appended to a file as small records and are written and synced to storage in a batch by Flush(),
+		  which the store calls once per frame. The file is compacted when opened if it is mostly finished entries.
+		 */
+		class TransactionJournal
+		{
+			public:
+				TransactionJournal();
+
+				/** Flushes pending changes and closes the file. */
+				virtual ~TransactionJournal();
+
+				/**
+				  Loads all unfinished transactions from the given journal file and opens it for appending.
+				  A truncated final record, such as from a crash while writing, is discarded.
+				  @param filePath Path of the journal file. Created if it does not exist.
+				  @return Returns true if the file was opened. Returns false if it could not be opened,
+				          in which case changes are only recorded in memory.
+				 */
+				bool Open(const std::string& filePath);
+
+				/** Flushes pending changes, closes the file, and removes all entries from memory. */
+				void Close();
+
+				/**
+				  Fetches an unfinished transaction by its ID.
+				  @param transactionId The transaction ID or restored entitlement ID.
+				  @return Returns the entry. Returns null if not found or if already finished.
+				 */
+				const JournalEntry* GetEntryBy(const std::string& transactionId) const;
+
+				/**
+				  Fetches the unfinished transaction that granted the given entitlement.
+				  @param entitlementId ID of an entitlement, such as one received by a restore.
+				  @return Returns the entry. Returns null if no unfinished transaction granted the entitlement.
+				 */
+				const JournalEntry* GetEntryByEntitlementId(const std::string& entitlementId) const;
+
+				/**
+				  Adds the given transaction to the journal, replacing the entry with the same ID if one exists.
+				  @param entry The transaction to record. Ignored if its ID is empty.
+				 */
+				void Put(const JournalEntry& entry);
+
+				/**
+				  Flags the given transaction's entry as dispatched to Lua. Not persisted.
+				  @param transactionId ID of the transaction.
+				 */
+				void SetWasDispatched(const std::string& transactionId);
+
+				/**
+				  Removes the given transaction from the journal, recording that it has been finished.
+				  @param transactionId ID of the transaction to remove.
+				  @param entitlementIds Assigned the IDs of the entitlements the transaction granted, if found.
+				  @return Returns true if the transaction was found and removed. Returns false if not found.
+				 */
+				bool Remove(const std::string& transactionId, std::vector<std::string>& entitlementIds);
+
+				/**
+				  Fetches an entitlement waiting to be redeemed.
+				  @param entitlementId ID of the entitlement.
+				  @return Returns the entry. Returns null if the entitlement is not waiting to be redeemed.
+				 */
+				const PendingRedeem* GetRedeemBy(const std::string& entitlementId) const;
+
+				/** Gets all entitlements waiting to be redeemed, keyed by entitlement ID. */
+				const std::unordered_map<std::string, PendingRedeem>& GetRedeems() const;
+
+				/**
+				  Records that the given entitlement is waiting to be redeemed, replacing the entry with the same ID.
+				  @param redeem The entitlement to record. Ignored if its ID is empty.
+				 */
+				void PutRedeem(const PendingRedeem& redeem);
+
+				/**
+				  Removes the given entitlement's redeem entry, recording that it was redeemed or given up on.
+				  @param entitlementId ID of the entitlement.
+				  @return Returns true if the entry was found and removed. Returns false if not found.
+				 */
+				bool RemoveRedeem(const std::string& entitlementId);
+
+				/**
+				  Writes all changes made since the last flush to the file and syncs it to storage.
+				  Does nothing if there are no pending changes.
+				  @return Returns true if the changes were written or if there were none to write.
+				          Returns false if the file is not open or could not be written to.
+				 */
+				bool Flush();
+
+			private:
+				/** Copy constructor deleted to prevent it from being called. */
+				TransactionJournal(const TransactionJournal&) = delete;
+
+				/** Method deleted to prevent the copy operator from being used. */
+				void operator=(const TransactionJournal&) = delete;
+
+				/**
+				  Rewrites the journal file with 1 record per unfinished transaction and per pending redeem.
+				  @return Returns true if the file was rewritten. Returns false if it could not be written.
+				 */
+				bool Compact();
+
+				/** Unfinished transactions keyed by ID. */
+				std::unordered_map<std::string, JournalEntry> fEntries;
+
+				/** Entitlement IDs mapped to the ID of the unfinished transaction that granted them. */
+				std::unordered_map<std::string, std::string> fEntitlementTransactionIds;
+
+				/** Entitlements of finished transactions waiting to be redeemed, keyed by entitlement ID. */
+				std::unordered_map<std::string, PendingRedeem> fRedeems;
+
+				/** Records appended since the last flush, waiting to be written to the file. */
+				std::string fPendingRecords;
+
+				/** Path to the journal file. Empty if not opened. */
+				std::string fFilePath;
+
+				/** The journal file opened for appending. Null if not open. */
+				FILE* fFilePointer;
+		};
+
+
+		/**
+		  Creates a new store with an empty catalog.
+		  @param context The runtime context that owns this store, used to fetch EOS handles and queue Lua events.
+		 */
+		EcomStore(RuntimeContext& context);
+
+		/** Ignores all in-flight EOS requests and releases the catalog. */
+		virtual ~EcomStore();
+
+		/** Gets the amount of time a fetched catalog is served from memory before it is fetched again. */
+		std::chrono::seconds GetCatalogTimeToLive() const;
+
+		/**
+		  Sets the amount of time a fetched catalog is served from memory before it is fetched again.
+		  @param value The time to live. Zero makes every "loadProducts" request fetch the catalog from EOS.
+		 */
+		void SetCatalogTimeToLive(std::chrono::seconds value);
+
+		/**
+		  Sets the file used to persist the catalog between app launches and loads the catalog it contains, if any.
+		  A catalog loaded from disk is provided to "loadProducts" requests right away, but is always considered
+		  stale, causing the first request to refresh it from EOS in the background.
+		  @param filePath Path to the catalog file, typically in the app's caches directory. Empty to not persist it.
+		 */
+		void SetCatalogFilePath(const std::string& filePath);
+
+		/**
+		  Sets the file used to journal unfinished transactions between app launches and loads its transactions.
+		  Transactions that were not finished by a previous launch are provided by the next restore.
+		  @param filePath Path to the journal file, typically in the app's caches directory. Empty to not persist it.
+		  @return Returns true if the journal was opened.
+
+		          Returns false if entitlements recorded by the current journal are still queued or being redeemed,
+		          since their results could no longer be reconciled with the journal that recorded them.
+		 */
+		bool SetTransactionJournalFilePath(const std::string& filePath);
+
+		/**
+		  Gets the amount of time finished transactions' entitlements are collected before being redeemed together.
+		 */
+		std::chrono::seconds GetRedeemInterval() const;
+
+		/**
+		  Sets the amount of time finished transactions' entitlements are collected before being redeemed together.
+		  @param value The interval. Zero redeems them on the next frame.
+		 */
+		void SetRedeemInterval(std::chrono::seconds value);
+
+		/** Gets the number of queued entitlements that causes them to be redeemed before the interval elapses. */
+		uint32_t GetRedeemBatchSize() const;
+
+		/**
+		  Sets the number of queued entitlements that causes them to be redeemed before the interval elapses.
+		  @param value The batch size. Clamped between 1 and the max number of entitlements EOS redeems at once.
+		 */
+		void SetRedeemBatchSize(uint32_t value);
+
+		/**
+		  To be called once per frame. Redeems the queued entitlements that are due, flushes the changes made to
+		  the transaction journal this frame, and starts queued image downloads.
+		 */
+		void Update();
+
+		/**
+		  Gets the cache that offer and item images are downloaded to.
+		  The images of the offers provided by a "loadProducts" event are prefetched into it.
+		 */
+		ImageCache& GetImageCache();
+
+		/** Gets the last fetched catalog. Returns null if it was never fetched. */
+		std::shared_ptr<const Catalog> GetCatalog() const;
+
+		/** Determines if the catalog has been fetched and its time to live has not elapsed. */
+		bool IsCatalogFresh() const;
+
+		/** Marks the catalog as stale, forcing the next "loadProducts" request to fetch it from EOS. */
+		void InvalidateCatalog();
+
+		/**
+		  Requests the given offers for Lua's "loadProducts" event.
+
+		  Answered from the in-memory catalog on the next frame if one is available. If the catalog is stale,
+		  it is refreshed from EOS in the background and a "productsChanged" event is dispatched if the
+		  refreshed catalog differs from the one that was provided. The request waits on EOS if there is no catalog.
+		  @param session The local user to query offers with. Must be logged into the Auth interface.
+		  @param productIds IDs of the offers to provide. Empty to provide all offers in the catalog.
+		  @return Returns true if a "loadProducts" event will be dispatched. Returns false if not logged in.
+		 */
+		bool LoadProducts(LocalUserSession& session, const std::vector<std::string>& productIds);
+
+		/**
+		  Pre-warms the store for purchases, to be called once a store screen opens.
+
+		  Refreshes the catalog if stale, prefetches the given offers' images, queries the user's entitlements
+		  so that ownership is answered locally by LocalUserSession::IsEntitledTo(), and starts tracking the
+		  EOS overlay's visibility so that checkouts are timed. Nothing is dispatched to Lua.
+		  @param session The local user who will make purchases. Must be logged into the Auth interface.
+		  @param productIds IDs of the offers to be shown. Empty to prefetch the images of all offers.
+		  @return Returns true if the store is being prepared. Returns false if not logged in.
+		 */
+		bool PrepareStore(LocalUserSession& session, const std::vector<std::string>& productIds);
+
+		/**
+		  Opens the EOS overlay to check out the given offers.
+		  A "storeTransaction" event is dispatched once the user completes or cancels the checkout,
+		  providing the time at which the checkout was requested, its overlay shown, and its result received.
+		  @param session The local user making the purchase. Must be logged into the Auth interface.
+		  @param offerIds IDs of the offers to purchase, up to EOS_ECOM_CHECKOUT_MAX_ENTRIES.
+		  @return Returns true if the checkout was started.
+
+		          Returns false if not logged in, if given no or too many offers,
+		          or if the user is already checking out.
+		 */
+		bool Purchase(LocalUserSession& session, const std::vector<std::string>& offerIds);
+
+		/**
+		  Queries all of the user's unredeemed entitlements and dispatches them as "restored" transactions.
+		  Only entitlements that are new or have changed since they were last dispatched are provided,
+		  as well as any unfinished transactions journaled by a previous app launch.
+		  @param session The local user to restore the purchases of. Must be logged into the Auth interface.
+		  @return Returns true if the query was started. Returns false if not logged in or a restore is in flight.
+		 */
+		bool Restore(LocalUserSession& session);
+
+		/**
+		  Redeems the entitlements granted by the given transaction, flagging them as consumed by the game.
+		  The transaction's entitlements are looked up in the journal, which then records it as finished.
+
+		  The entitlements are queued and redeemed in a batch once the redeem interval elapses or the batch size
+		  is reached. Queued entitlements are journaled until EOS answers, at which point they are dispatched as
+		  a "consumed" transaction, or as an "unconfirmed" one if EOS did not report them as redeemed.
+		  @param session The local user who owns the transaction. Must be logged into the Auth interface.
+		  @param transactionId A transaction ID received by a "storeTransaction" event, or an entitlement ID.
+		  @return Returns true if the entitlements were queued.
+
+		          Returns false if not logged in, or if the ID is neither an unfinished transaction nor an entitlement
+		          that a restore or entitlement query reported as unredeemed, such as if it was already finished.
+		 */
+		bool FinishTransaction(LocalUserSession& session, const std::string& transactionId);
+
+		/**
+		  Queries the ownership of the given catalog items, such as to gate DLC.
+
+		  Duplicate IDs are removed and the rest are sent in as few EOS_Ecom_QueryOwnership() requests as the
+		  SDK allows, EOS_ECOM_QUERYOWNERSHIP_MAX_CATALOG_IDS at a time. A single "queryOwnership" event is
+		  dispatched once all of them complete, and the user's entitlement set is updated for IsEntitledTo().
+		  @param session The local user to query. Must be logged into the Auth interface.
+		  @param itemIds IDs of the catalog items to query. Cannot be empty.
+		  @return Returns true if the query was started. Returns false if not logged in or given no IDs.
+		 */
+		bool QueryOwnership(LocalUserSession& session, const std::vector<std::string>& itemIds);
+
+		/**
+		  Queries the given entitlements, including redeemed ones.
+
+		  Duplicate names are removed and the rest are sent in as few EOS_Ecom_QueryEntitlements() requests as the
+		  SDK allows, EOS_ECOM_QUERYENTITLEMENTS_MAX_ENTITLEMENT_IDS at a time. A single "queryEntitlements" event
+		  is dispatched once all of them complete, and the user's entitlement set is updated for IsEntitledTo().
+		  @param session The local user to query. Must be logged into the Auth interface.
+		  @param entitlementNames Names of the entitlements to query. Empty to query all of the user's entitlements.
+		  @return Returns true if the query was started. Returns false if not logged in.
+		 */
+		bool QueryEntitlements(LocalUserSession& session, const std::vector<std::string>& entitlementNames);
+
+		/**
+		  Fetches signed ownership tokens for the given catalog items, such as to send to a game server.
+
+		  Duplicate IDs are removed and the rest are sorted and split into batches of
+		  EOS_ECOM_QUERYOWNERSHIPTOKEN_MAX_CATALOGITEM_IDS, 1 token per batch. Tokens are cached until they
+		  expire, so batches that were fetched recently are provided without an EOS request.
+		  A single "ownershipToken" event is dispatched once all batches are available.
+		  @param session The local user to fetch tokens for. Must be logged into the Auth interface.
+		  @param itemIds IDs of the catalog items to cover. Cannot be empty.
+		  @return Returns true if an "ownershipToken" event will be dispatched. Returns false if not logged in or given no IDs.
+		 */
+		bool QueryOwnershipToken(LocalUserSession& session, const std::vector<std::string>& itemIds);
+
+		/**
+		  Fetches signed entitlement tokens for the given entitlements, such as to send to a game server.
+		  Works like QueryOwnershipToken(), batched by EOS_ECOM_QUERYENTITLEMENTTOKEN_MAX_ENTITLEMENT_IDS,
+		  and dispatches a single "entitlementToken" event.
+		  @param session The local user to fetch tokens for. Must be logged into the Auth interface.
+		  @param entitlementNames Names of the entitlements to cover. Empty to cover all of the user's entitlements.
+		  @return Returns true if an "entitlementToken" event will be dispatched. Returns false if not logged in.
+		 */
+		bool QueryEntitlementToken(LocalUserSession& session, const std::vector<std::string>& entitlementNames);
+
+		/**
+		  Sets the public keys used to verify ownership and entitlement tokens locally via VerifyToken().
+		  @param keys The RSA keys. Empty to disable local verification.
+		 */
+		void SetTokenPublicKeys(const std::vector<RsaPublicKey>& keys);
+
+		/**
+		  Sets the "iss" claim a token must have to be verified by VerifyToken().
+		  @param value The expected issuer. Empty to accept any issuer.
+		 */
+		void SetTokenIssuer(const std::string& value);
+
+		/**
+		  Verifies a token locally, allowing content to be gated without waiting on a server.
+		  The token must have a valid RS256 signature made by a key given to SetTokenPublicKeys(),
+		  must not be expired, and must match the configured issuer, if any.
+		  @param token The decoded token to verify.
+		  @param accountId Optional account the token must have been issued to via its "sub" claim. Can be null.
+		  @return Returns true if verified. Returns false if not or if no public keys have been set.
+		 */
+		bool VerifyToken(const JsonWebToken& token, EOS_EpicAccountId accountId) const;
+
+	private:
+		/** Copy constructor deleted to prevent it from being called. */
+		EcomStore(const EcomStore&) = delete;
+
+		/** Method deleted to prevent the copy operator from being used. */
+		void operator=(const EcomStore&) = delete;
+
+		/** A checkout waiting on EOS. */
+		struct PendingCheckout
+		{
+			/** IDs of the offers being checked out. Referenced by the EOS_Ecom_Checkout() request's entries. */
+			std::vector<std::string> OfferIds;
+
+			/** The checkout's phase times so far. */
+			CheckoutTiming Timing;
+		};
+
+		/** A "loadProducts" request waiting on the catalog to be fetched. */
+		struct PendingLoadProductsRequest
+		{
+			int UserHandle;
+			std::vector<std::string> ProductIds;
+		};
+
+		/** Indicates which EOS query a BatchQuery is made up of. */
+		enum class BatchQueryType
+		{
+			/** EOS_Ecom_QueryOwnership() */
+			kOwnership,
+
+			/** EOS_Ecom_QueryEntitlements() */
+			kEntitlements,
+
+			/** EOS_Ecom_QueryOwnershipToken() */
+			kOwnershipToken,
+
+			/** EOS_Ecom_QueryEntitlementToken() */
+			kEntitlementToken
+		};
+
+		/** The combined results of an Ecom query split into several EOS requests. */
+		struct BatchQuery
+		{
+			/** The EOS query the batch is made up of. */
+			BatchQueryType Type;
+
+			/** Handle of the local user who made the query. */
+			int UserHandle;
+
+			/** Number of EOS requests that have not completed yet. */
+			size_t PendingRequestCount;
+
+			/** EOS_Success if all requests have succeeded so far. Otherwise the result of the first failure. */
+			EOS_EResult Result;
+
+			std::vector<ItemOwnership> Ownerships;
+			std::vector<Entitlement> Entitlements;
+			std::vector<EcomToken> Tokens;
+		};
+
+		/** Entitlements of 1 Epic account waiting to be redeemed in batches. */
+		struct RedeemQueue
+		{
+			/** IDs of the entitlements waiting to be redeemed, in the order they were finished. */
+			std::vector<std::string> EntitlementIds;
+
+			/** IDs of the entitlements being redeemed by the account's in-flight request. Empty if none. */
+			std::vector<std::string> RedeemingIds;
+
+			/** Time at which the queued entitlements are due to be redeemed, even if the batch is not full. */
+			std::chrono::steady_clock::time_point NextRedeemTime;
+
+			/** Number of consecutive redeem requests that failed. */
+			int FailureCount;
+		};
+
+		/** 1 EOS request of a batch query. Given to EOS as the request's "ClientData". */
+		struct BatchQueryRequest
+		{
+			EcomStore* StorePointer;
+			std::shared_ptr<BatchQuery> QueryPointer;
+
+			/** The catalog item IDs or entitlement names sent with this request. Referenced by the EOS options. */
+			std::vector<std::string> Ids;
+		};
+
+		/**
+		  Splits the given IDs into as few batch query requests as the SDK allows and issues them.
+		  Token batches that are cached and have not expired are provided without a request.
+		  @param session The local user making the query.
+		  @param ids The catalog item IDs or entitlement names to query. Expected to be free of duplicates.
+		  @param type The EOS query to issue.
+		  @return Returns true if the requests were issued. Returns false if the Ecom interface is unavailable.
+		 */
+		bool IssueBatchQuery(LocalUserSession& session, std::vector<std::string>&& ids, BatchQueryType type);
+
+		/** Queues the Lua event providing the given batch query's combined results. */
+		void QueueBatchQueryEvent(BatchQuery& query);
+
+		/**
+		  Records whether the given entitlement, copied from an EOS query, is waiting to be redeemed.
+		  Only entitlements recorded this way or journaled can be finished by their entitlement ID.
+		  @param accountId The Epic account that owns the entitlement.
+		  @param entitlement The entitlement received from EOS.
+		 */
+		void TrackUnredeemedEntitlement(EOS_EpicAccountId accountId, const EOS_Ecom_Entitlement& entitlement);
+
+		/**
+		  Journals the given entitlement and adds it to its owner's redeem queue.
+		  @param redeem The entitlement to redeem. Ignored if it is already queued.
+		 */
+		void QueueRedeem(const PendingRedeem& redeem);
+
+		/** Issues 1 EOS_Ecom_RedeemEntitlements() request per account whose queued entitlements are due. */
+		void FlushRedeemQueues();
+
+		/**
+		  Called when an account's EOS_Ecom_RedeemEntitlements() request completes.
+		  Reconciles its batch with the entitlements EOS reports as redeemed and queues a "storeTransaction" event,
+		  or re-queues the batch if the request failed.
+		  @param accountId The Epic account that redeemed the entitlements.
+		  @param resultCode The request's result.
+		 */
+		void OnRedeemCompleted(EOS_EpicAccountId accountId, EOS_EResult resultCode);
+
+		/**
+		  Caches the given token received from EOS, verifying it locally if public keys are set,
+		  and adds it to the given request's query.
+		  @param requestPointer The request the token was received for.
+		  @param accountId The account the token was issued to.
+		  @param resultCode The result of the EOS request.
+		  @param encodedToken The received token. Can be null on failure.
+		 */
+		void OnTokenReceived(
+				BatchQueryRequest* requestPointer, EOS_EpicAccountId accountId,
+				EOS_EResult resultCode, const char* encodedToken);
+
+		/** Creates the key of a token in "fTokenCache" from the type of token and the batch of IDs it covers. */
+		static std::string GetTokenCacheKey(BatchQueryType type, const std::vector<std::string>& ids);
+
+		/**
+		  Marks the given batch query request as complete, queueing the query's Lua event if it was the last one.
+		  @param requestPointer The completed request. Deleted by this method.
+		 */
+		void OnBatchQueryRequestCompleted(BatchQueryRequest* requestPointer);
+
+		/** Fetches the EOS Ecom interface. Returns null if the EOS platform has not been created. */
+		EOS_HEcom GetEcomHandle();
+
+		/**
+		  Queues a "loadProducts" event providing the given offers from the given catalog.
+		  @param catalogPointer The catalog to provide offers from. Null if the catalog failed to be fetched.
+		  @param request The Lua request to respond to.
+		  @param resultCode The result of fetching the catalog.
+		  @param isStale Set true if the catalog is being refreshed, meaning a "productsChanged" event may follow.
+		 */
+		void QueueLoadProductsEvent(
+				const std::shared_ptr<const Catalog>& catalogPointer,
+				const PendingLoadProductsRequest& request, EOS_EResult resultCode, bool isStale);
+
+		/**
+		  Issues an EOS_Ecom_QueryOffers() request to refresh the catalog, unless one is already in flight.
+		  @param accountId The Epic account to query offers with.
+		  @return Returns true if a query is in flight. Returns false if the Ecom interface is unavailable.
+		 */
+		bool RefreshCatalog(EOS_EpicAccountId accountId);
+
+		/**
+		  Fetches the local files of the given offers' cached images and prefetches the images not cached yet.
+		  @param catalog The catalog to fetch the offers from.
+		  @param productIds IDs of the offers. Empty for all offers in the catalog.
+		  @param imageFileNames Assigned the cached images' file names, keyed by URL.
+		 */
+		void CacheOfferImages(
+				const Catalog& catalog, const std::vector<std::string>& productIds,
+				std::unordered_map<std::string, std::string>& imageFileNames);
+
+		/** Subscribes to the EOS overlay's visibility changes, if not done already. */
+		void AddDisplaySettingsNotification();
+
+		/**
+		  Queues a "productsChanged" event if the given catalogs differ.
+		  @param previousCatalog The catalog that was replaced.
+		  @param catalog The newly fetched catalog.
+		  @return Returns true if the catalogs differ. Returns false if they are identical.
+		 */
+		bool QueueProductsChangedEvent(const Catalog& previousCatalog, const Catalog& catalog);
+
+		/**
+		  Queues a "storeTransaction" event with the given transactions.
+		  @param accountId The Epic account the transactions belong to. Used to look up the local user's handle.
+		  @param transactions The transactions to dispatch.
+		 */
+		void QueueStoreTransactionEvent(EOS_EpicAccountId accountId, std::vector<Transaction>&& transactions);
+
+		/**
+		  Fetches the store the given EOS callback "ClientData" refers to.
+		  @param clientData The "ClientData" pointer given to the EOS callback.
+		  @return Returns the store. Returns null if the store has since been deleted.
+		 */
+		static EcomStore* GetInstanceBy(void* clientData);
+
+		/** Called by EOS when an EOS_Ecom_QueryOffers() request completes. */
+		static void EOS_CALL OnQueryOffersCallback(const EOS_Ecom_QueryOffersCallbackInfo* data);
+
+		/** Called by EOS when an EOS_Ecom_Checkout() request completes. */
+		static void EOS_CALL OnCheckoutCallback(const EOS_Ecom_CheckoutCallbackInfo* data);
+
+		/** Called by EOS when an EOS_Ecom_QueryEntitlements() request issued by PrepareStore() completes. */
+		static void EOS_CALL OnPrepareEntitlementsCallback(const EOS_Ecom_QueryEntitlementsCallbackInfo* data);
+
+		/** Called by EOS when the EOS overlay is shown or hidden. */
+		static void EOS_CALL OnDisplaySettingsUpdatedCallback(const EOS_UI_OnDisplaySettingsUpdatedCallbackInfo* data);
+
+		/** Called by EOS when an EOS_Ecom_QueryEntitlements() request completes. */
+		static void EOS_CALL OnQueryEntitlementsCallback(const EOS_Ecom_QueryEntitlementsCallbackInfo* data);
+
+		/**
+		  Fetches the batch query request the given EOS callback "ClientData" refers to and releases it from
+		  the collection of in-flight requests.
+		  @param clientData The "ClientData" pointer given to the EOS callback.
+		  @return Returns the request. Returns null if its store has since been deleted.
+		 */
+		static BatchQueryRequest* TakeBatchQueryRequestBy(void* clientData);
+
+		/** Called by EOS when an EOS_Ecom_QueryOwnership() batch request completes. */
+		static void EOS_CALL OnQueryOwnershipCallback(const EOS_Ecom_QueryOwnershipCallbackInfo* data);
+
+		/** Called by EOS when an EOS_Ecom_QueryEntitlements() batch request completes. */
+		static void EOS_CALL OnBatchQueryEntitlementsCallback(const EOS_Ecom_QueryEntitlementsCallbackInfo* data);
+
+		/** Called by EOS when an EOS_Ecom_QueryOwnershipToken() batch request completes. */
+		static void EOS_CALL OnQueryOwnershipTokenCallback(const EOS_Ecom_QueryOwnershipTokenCallbackInfo* data);
+
+		/** Called by EOS when an EOS_Ecom_QueryEntitlementToken() batch request completes. */
+		static void EOS_CALL OnQueryEntitlementTokenCallback(const EOS_Ecom_QueryEntitlementTokenCallbackInfo* data);
+
+		/** Called by EOS when an EOS_Ecom_RedeemEntitlements() request completes. */
+		static void EOS_CALL OnRedeemEntitlementsCallback(const EOS_Ecom_RedeemEntitlementsCallbackInfo* data);
+
+		/** The runtime context that owns this store. */
+		RuntimeContext& fContext;
+
+		/** The last fetched catalog. Null if never fetched. */
+		std::shared_ptr<const Catalog> fCatalogPointer;
+
+		/** Amount of time "fCatalogPointer" is served from memory before being fetched again. */
+		std::chrono::seconds fCatalogTimeToLive;
+
+		/**
+		  Set true if "fCatalogPointer" was invalidated before its time to live elapsed, such as by a purchase,
+		  or if it was loaded from disk.
+		 */
+		bool fIsCatalogInvalidated;
+
+		/** Path to the file the catalog is persisted to. Empty if not persisted. */
+		std::string fCatalogFilePath;
+
+		/** Set true while an EOS_Ecom_QueryOffers() request is in flight. */
+		bool fIsQueryingOffers;
+
+		/** "loadProducts" requests waiting on the in-flight EOS_Ecom_QueryOffers() request. */
+		std::vector<PendingLoadProductsRequest> fPendingLoadProductsRequests;
+
+		/** In-flight checkouts, keyed by the purchasing Epic account. */
+		std::unordered_map<EOS_EpicAccountId, PendingCheckout> fCheckouts;
+
+		/** Epic accounts whose store was prepared via PrepareStore(). */
+		std::unordered_set<EOS_EpicAccountId> fPreparedAccountIds;
+
+		/** Epic accounts with an in-flight EOS_Ecom_QueryEntitlements() request issued by PrepareStore(). */
+		std::unordered_set<EOS_EpicAccountId> fPreparingAccountIds;
+
+		/** ID of the EOS overlay visibility subscription. EOS_INVALID_NOTIFICATIONID if not subscribed. */
+		EOS_NotificationId fDisplaySettingsNotificationId;
+
+		/** Epic accounts with an in-flight EOS_Ecom_QueryEntitlements() restore request. */
+		std::unordered_set<EOS_EpicAccountId> fRestoringAccountIds;
+
+		/** Batch query requests waiting on EOS, owned by this store until their callback is invoked. */
+		std::unordered_set<BatchQueryRequest*> fBatchQueryRequests;
+
+		/** Purchased and restored transactions that have not been finished yet. */
+		TransactionJournal fTransactionJournal;
+
+		/** IDs of entitlements that EOS queries reported as not redeemed yet, keyed by their owner's account. */
+		std::unordered_map<EOS_EpicAccountId, std::unordered_set<std::string>> fUnredeemedEntitlementIds;
+
+		/** Entitlements waiting to be redeemed, keyed by the string form of their owner's Epic account ID. */
+		std::unordered_map<std::string, RedeemQueue> fRedeemQueues;
+
+		/** Amount of time finished transactions' entitlements are collected before being redeemed together. */
+		std::chrono::seconds fRedeemInterval;
+
+		/** Number of queued entitlements that causes them to be redeemed before the interval elapses. */
+		uint32_t fRedeemBatchSize;
+
+		/** Offer and item images downloaded to local files. */
+		ImageCache fImageCache;
+
+		/** Unexpired ownership and entitlement tokens keyed by account and then by GetTokenCacheKey(). */
+		std::unordered_map<EOS_EpicAccountId, std::unordered_map<std::string, EcomToken>> fTokenCache;
+
+		/** Keys used to verify tokens locally. Empty if local verification is disabled. */
+		std::vector<RsaPublicKey> fTokenPublicKeys;
+
+		/** The "iss" claim a token must have to be verified locally. Empty to accept any issuer. */
+		std::string fTokenIssuer;
+};
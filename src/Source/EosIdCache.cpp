@@ -0,0 +1,242 @@
+// ----------------------------------------------------------------------------
+//
+// EosIdCache.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "EosIdCache.h"
+#include <exception>
+extern "C"
+{
+#	include "lua.h"
+#	include "lauxlib.h"
+}
+
+
+//---------------------------------------------------------------------------------
+// Private Constants
+//---------------------------------------------------------------------------------
+
+/**
+  Max number of handle/string pairs cached per ID type.
+  The cache is cleared once exceeded, which bounds its memory use in long sessions meeting many users.
+ */
+static const size_t kMaxEntryCount = 4096;
+
+
+//---------------------------------------------------------------------------------
+// EosIdCache Class Members
+//---------------------------------------------------------------------------------
+
+EosIdCache::EosIdCache(lua_State* luaStatePointer)
+:	fLuaStatePointer(luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		throw std::exception();
+	}
+}
+
+EosIdCache::~EosIdCache()
+{
+	Clear();
+}
+
+bool EosIdCache::PushEpicAccountIdTo(lua_State* luaStatePointer, EOS_EpicAccountId accountId)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+	if (!accountId)
+	{
+		lua_pushnil(luaStatePointer);
+		return false;
+	}
+
+	// Format and cache the ID's string if this is the first time it has been seen.
+	int luaReference;
+	auto iterator = fEpicAccountIdStrings.find(accountId);
+	if (iterator != fEpicAccountIdStrings.end())
+	{
+		luaReference = iterator->second.LuaReference;
+	}
+	else
+	{
+		char stringId[EOS_EPICACCOUNTID_MAX_LENGTH + 1];
+		int32_t stringIdLength = sizeof(stringId);
+		if (EOS_EpicAccountId_ToString(accountId, stringId, &stringIdLength) != EOS_EResult::EOS_Success)
+		{
+			lua_pushnil(luaStatePointer);
+			return false;
+		}
+		luaReference = AddStringEntry(fEpicAccountIdStrings, accountId, stringId).LuaReference;
+		fEpicAccountIds[stringId] = accountId;
+	}
+
+	// Push the cached string.
+	lua_rawgeti(luaStatePointer, LUA_REGISTRYINDEX, luaReference);
+	return true;
+}
+
+bool EosIdCache::PushProductUserIdTo(lua_State* luaStatePointer, EOS_ProductUserId productUserId)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+	if (!productUserId)
+	{
+		lua_pushnil(luaStatePointer);
+		return false;
+	}
+
+	// Format and cache the ID's string if this is the first time it has been seen.
+	int luaReference;
+	auto iterator = fProductUserIdStrings.find(productUserId);
+	if (iterator != fProductUserIdStrings.end())
+	{
+		luaReference = iterator->second.LuaReference;
+	}
+	else
+	{
+		char stringId[EOS_PRODUCTUSERID_MAX_LENGTH + 1];
+		int32_t stringIdLength = sizeof(stringId);
+		if (EOS_ProductUserId_ToString(productUserId, stringId, &stringIdLength) != EOS_EResult::EOS_Success)
+		{
+			lua_pushnil(luaStatePointer);
+			return false;
+		}
+		luaReference = AddStringEntry(fProductUserIdStrings, productUserId, stringId).LuaReference;
+		fProductUserIds[stringId] = productUserId;
+	}
+
+	// Push the cached string.
+	lua_rawgeti(luaStatePointer, LUA_REGISTRYINDEX, luaReference);
+	return true;
+}
+
+EOS_EpicAccountId EosIdCache::GetEpicAccountIdFrom(const char* stringId)
+{
+	// Validate.
+	if (!stringId || ('\0' == stringId[0]))
+	{
+		return nullptr;
+	}
+
+	// Return the cached handle, if available.
+	auto iterator = fEpicAccountIds.find(stringId);
+	if (iterator != fEpicAccountIds.end())
+	{
+		return iterator->second;
+	}
+
+	// Convert the string to a handle and cache it.
+	auto accountId = EOS_EpicAccountId_FromString(stringId);
+	if (EOS_EpicAccountId_IsValid(accountId) != EOS_TRUE)
+	{
+		return nullptr;
+	}
+	if (fEpicAccountIds.size() >= kMaxEntryCount)
+	{
+		Clear();
+	}
+	fEpicAccountIds[stringId] = accountId;
+	return accountId;
+}
+
+EOS_ProductUserId EosIdCache::GetProductUserIdFrom(const char* stringId)
+{
+	// Validate.
+	if (!stringId || ('\0' == stringId[0]))
+	{
+		return nullptr;
+	}
+
+	// Return the cached handle, if available.
+	auto iterator = fProductUserIds.find(stringId);
+	if (iterator != fProductUserIds.end())
+	{
+		return iterator->second;
+	}
+
+	// Convert the string to a handle and cache it.
+	auto productUserId = EOS_ProductUserId_FromString(stringId);
+	if (EOS_ProductUserId_IsValid(productUserId) != EOS_TRUE)
+	{
+		return nullptr;
+	}
+	if (fProductUserIds.size() >= kMaxEntryCount)
+	{
+		Clear();
+	}
+	fProductUserIds[stringId] = productUserId;
+	return productUserId;
+}
+
+void EosIdCache::PushUncachedEpicAccountIdTo(lua_State* luaStatePointer, EOS_EpicAccountId accountId)
+{
+	char stringId[EOS_EPICACCOUNTID_MAX_LENGTH + 1];
+	int32_t stringIdLength = sizeof(stringId);
+	if (accountId && (EOS_EpicAccountId_ToString(accountId, stringId, &stringIdLength) == EOS_EResult::EOS_Success))
+	{
+		lua_pushstring(luaStatePointer, stringId);
+	}
+	else
+	{
+		lua_pushnil(luaStatePointer);
+	}
+}
+
+void EosIdCache::PushUncachedProductUserIdTo(lua_State* luaStatePointer, EOS_ProductUserId productUserId)
+{
+	char stringId[EOS_PRODUCTUSERID_MAX_LENGTH + 1];
+	int32_t stringIdLength = sizeof(stringId);
+	if (productUserId && (EOS_ProductUserId_ToString(productUserId, stringId, &stringIdLength) == EOS_EResult::EOS_Success))
+	{
+		lua_pushstring(luaStatePointer, stringId);
+	}
+	else
+	{
+		lua_pushnil(luaStatePointer);
+	}
+}
+
+void EosIdCache::Clear()
+{
+	for (auto&& pair : fEpicAccountIdStrings)
+	{
+		luaL_unref(fLuaStatePointer, LUA_REGISTRYINDEX, pair.second.LuaReference);
+	}
+	for (auto&& pair : fProductUserIdStrings)
+	{
+		luaL_unref(fLuaStatePointer, LUA_REGISTRYINDEX, pair.second.LuaReference);
+	}
+	fEpicAccountIdStrings.clear();
+	fProductUserIdStrings.clear();
+	fEpicAccountIds.clear();
+	fProductUserIds.clear();
+}
+
+const EosIdCache::StringEntry& EosIdCache::AddStringEntry(
+	StringEntryMap& strings, const void* handle, const char* stringId)
+{
+	if (strings.size() >= kMaxEntryCount)
+	{
+		Clear();
+	}
+
+	StringEntry entry;
+	entry.String = stringId;
+	lua_pushlstring(fLuaStatePointer, entry.String.c_str(), entry.String.length());
+	entry.LuaReference = luaL_ref(fLuaStatePointer, LUA_REGISTRYINDEX);
+	auto& insertedEntry = strings[handle];
+	insertedEntry = entry;
+	return insertedEntry;
+}
@@ -0,0 +1,139 @@
+// ----------------------------------------------------------------------------
+//
+// EosIdCache.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include "eos_sdk.h"
+
+
+// Forward declarations.
+extern "C"
+{
+	struct lua_State;
+}
+
+
+/**
+  Bidirectional cache between EOS user ID handles and their string forms.
+
+  The string form of every handle is formatted once and kept in the Lua registry, so pushing a known ID to Lua
+  is a single registry lookup instead of an EOS_*_ToString() call and a new Lua string.
+  Strings received from Lua are converted back to handles via EOS_*_FromString() once and then looked up.
+
+  EOS user ID handles are interned by the SDK and remain valid until it shuts down, which makes them
+  usable as cache keys.
+ */
+class EosIdCache
+{
+	public:
+		/**
+		  Creates an empty cache.
+		  @param luaStatePointer The main Lua state whose registry will store the cached strings. Cannot be null.
+		 */
+		EosIdCache(lua_State* luaStatePointer);
+
+		/** Releases all cached strings from the Lua registry. */
+		virtual ~EosIdCache();
+
+		/**
+		  Pushes the string form of the given Epic account ID to the top of the Lua stack.
+		  @param luaStatePointer The Lua state to push to. Must share the registry of the cache's main Lua state.
+		  @param accountId The ID to push. Can be null.
+		  @return Returns true if a string was pushed. Returns false if given a null or invalid ID, in which case nil is pushed.
+		 */
+		bool PushEpicAccountIdTo(lua_State* luaStatePointer, EOS_EpicAccountId accountId);
+
+		/**
+		  Pushes the string form of the given product user ID to the top of the Lua stack.
+		  @param luaStatePointer The Lua state to push to. Must share the registry of the cache's main Lua state.
+		  @param productUserId The ID to push. Can be null.
+		  @return Returns true if a string was pushed. Returns false if given a null or invalid ID, in which case nil is pushed.
+		 */
+		bool PushProductUserIdTo(lua_State* luaStatePointer, EOS_ProductUserId productUserId);
+
+		/**
+		  Fetches the Epic account ID handle for the given string.
+		  @param stringId The ID's string form, such as one received from a Lua event. Can be null.
+		  @return Returns the ID's handle. Returns null if given a null or invalid string.
+		 */
+		EOS_EpicAccountId GetEpicAccountIdFrom(const char* stringId);
+
+		/**
+		  Fetches the product user ID handle for the given string.
+		  @param stringId The ID's string form, such as one received from a Lua event. Can be null.
+		  @return Returns the ID's handle. Returns null if given a null or invalid string.
+		 */
+		EOS_ProductUserId GetProductUserIdFrom(const char* stringId);
+
+		/**
+		  Pushes the string form of the given Epic account ID to the top of the Lua stack without a cache.
+		  Intended for callers that were not given a cache.
+		  @param luaStatePointer The Lua state to push to.
+		  @param accountId The ID to push. Can be null, in which case nil is pushed.
+		 */
+		static void PushUncachedEpicAccountIdTo(lua_State* luaStatePointer, EOS_EpicAccountId accountId);
+
+		/**
+		  Pushes the string form of the given product user ID to the top of the Lua stack without a cache.
+		  Intended for callers that were not given a cache.
+		  @param luaStatePointer The Lua state to push to.
+		  @param productUserId The ID to push. Can be null, in which case nil is pushed.
+		 */
+		static void PushUncachedProductUserIdTo(lua_State* luaStatePointer, EOS_ProductUserId productUserId);
+
+		/** Removes all entries from the cache and releases their strings from the Lua registry. */
+		void Clear();
+
+	private:
+		/** Copy constructor deleted to prevent it from being called. */
+		EosIdCache(const EosIdCache&) = delete;
+
+		/** Method deleted to prevent the copy operator from being used. */
+		void operator=(const EosIdCache&) = delete;
+
+		/** A cached handle's string form. */
+		struct StringEntry
+		{
+			/** Lua registry reference to the handle's Lua string. */
+			int LuaReference;
+
+			/** The handle's string form. */
+			std::string String;
+		};
+
+		/** Maps EOS ID handles to their string forms. */
+		typedef std::unordered_map<const void*, StringEntry> StringEntryMap;
+
+		/**
+		  Adds the given handle's string form to the given map and to the Lua registry.
+		  Clears the whole cache first if it has grown beyond its limit.
+		  @param strings The map to add the entry to.
+		  @param handle The EOS ID handle.
+		  @param stringId The handle's string form.
+		  @return Returns the added entry.
+		 */
+		const StringEntry& AddStringEntry(StringEntryMap& strings, const void* handle, const char* stringId);
+
+		/** The main Lua state whose registry stores the cached strings. */
+		lua_State* fLuaStatePointer;
+
+		/** Epic account ID handles mapped to their string forms. */
+		StringEntryMap fEpicAccountIdStrings;
+
+		/** Product user ID handles mapped to their string forms. */
+		StringEntryMap fProductUserIdStrings;
+
+		/** String forms of Epic account IDs mapped to their handles. */
+		std::unordered_map<std::string, EOS_EpicAccountId> fEpicAccountIds;
+
+		/** String forms of product user IDs mapped to their handles. */
+		std::unordered_map<std::string, EOS_ProductUserId> fProductUserIds;
+};
@@ -7,18 +7,34 @@
 //
 // --------------------------------------------------------------------------------
 
+#include "ByteBuffer.h"
 #include "CoronaLua.h"
 #include "CoronaMacros.h"
 #include "DispatchEventTask.h"
+#include "EosLuaInterface.h"
+#include "JsonWebToken.h"
+#include "LocalUserSession.h"
+#include "LoopbackP2PTransport.h"
 #include "LuaEventDispatcher.h"
+#include "LuaValueCodec.h"
+#include "P2PInterestManager.h"
+#include "P2PLinkStats.h"
+#include "P2PManager.h"
+#include "P2PNetworkSettings.h"
+#include "P2PQueueManager.h"
 #include "PluginConfigLuaSettings.h"
 #include "RuntimeContext.h"
+#include "SnapshotReplicator.h"
+#include <chrono>
 #include <cmath>
+#include <cstring>
+#include <memory>
 #include <sstream>
 #include <stdint.h>
 
 #include <string>
 #include <thread>
+#include <vector>
 extern "C"
 {
 #	include "lua.h"
@@ -28,6 +44,7 @@ extern "C"
 #include "eos_ui.h"
 #include "eos_logging.h"
 #include "eos_auth.h"
+#include "eos_ecom_types.h"
 #include "PlatformCommandLine.h"
 
 #if ALLOW_RESERVED_PLATFORM_OPTIONS
@@ -45,6 +62,8 @@ extern "C"
 // Constants
 //---------------------------------------------------------------------------------
 
+/** Max number of milliseconds accepted for intervals and delays given by Lua, about 24.8 days. */
+static const double kMaxMilliseconds = 2147483647.0;
 
 //---------------------------------------------------------------------------------
 // Private Static Variables
@@ -113,25 +132,1865 @@ void EOS_CALL onEOSLogMessageReceived(const EOS_LogMessage* InMsg)
 	}
 }
 
-void EOS_CALL onLoginCallback(const EOS_Auth_LoginCallbackInfo* Data)
+/**
+  Fetches the local user session referenced by the given Lua argument.
+  @param luaStatePointer The Lua state the argument belongs to.
+  @param contextPointer The runtime context that owns the sessions.
+  @param luaArgumentIndex Index to an optional integer user handle returned by eos.login().
+  @return Returns the session referenced by the given user handle, or the default local user if the argument
+          is nil or missing. Returns null if the handle is invalid or if there are no local users.
+ */
+LocalUserSession* FetchLocalUserSession(lua_State* luaStatePointer, RuntimeContext* contextPointer, int luaArgumentIndex)
+{
+	// Validate.
+	if (!luaStatePointer || !contextPointer)
+	{
+		return nullptr;
+	}
+
+	// Fetch the session referenced by the given argument.
+	if (lua_type(luaStatePointer, luaArgumentIndex) == LUA_TNUMBER)
+	{
+		return contextPointer->GetLocalUserBy((int)lua_tointeger(luaStatePointer, luaArgumentIndex));
+	}
+	return contextPointer->GetDefaultLocalUser();
+}
+
+/**
+  Fetches the absolute path to the given file in a Corona system directory via system.pathForFile().
+  @param luaStatePointer The Lua state to call system.pathForFile() with.
+  @param fileName Name of the file.
+  @param directoryName Name of the "system" directory constant, such as "CachesDirectory" or "DocumentsDirectory".
+  @return Returns the file's absolute path. Returns an empty string if the path could not be determined.
+ */
+std::string FetchSystemDirectoryFilePath(lua_State* luaStatePointer, const char* fileName, const char* directoryName)
+{
+	std::string filePath;
+	lua_getglobal(luaStatePointer, "system");
+	if (lua_istable(luaStatePointer, -1))
+	{
+		lua_getfield(luaStatePointer, -1, "pathForFile");
+		if (lua_isfunction(luaStatePointer, -1))
+		{
+			lua_pushstring(luaStatePointer, fileName);
+			lua_getfield(luaStatePointer, -3, directoryName);
+			int callResultCode = CoronaLuaDoCall(luaStatePointer, 2, 1);
+			if (!callResultCode && (lua_type(luaStatePointer, -1) == LUA_TSTRING))
+			{
+				filePath = lua_tostring(luaStatePointer, -1);
+			}
+		}
+		lua_pop(luaStatePointer, 1);
+	}
+	lua_pop(luaStatePointer, 1);
+	return filePath;
+}
+
+/**
+  Copies the string or array of strings at the given Lua stack index to the given vector.
+  @param luaStatePointer The Lua state the argument belongs to.
+  @param luaArgumentIndex Index to a string or an array of strings. Non-string array elements are ignored.
+  @param strings The vector to append the strings to.
+  @return Returns true if given a string or a table. Returns false if given any other type.
+ */
+bool FetchStringArray(lua_State* luaStatePointer, int luaArgumentIndex, std::vector<std::string>& strings)
+{
+	auto luaType = lua_type(luaStatePointer, luaArgumentIndex);
+	if (luaType == LUA_TSTRING)
+	{
+		strings.push_back(lua_tostring(luaStatePointer, luaArgumentIndex));
+		return true;
+	}
+	else if (luaType == LUA_TTABLE)
+	{
+		int count = (int)lua_objlen(luaStatePointer, luaArgumentIndex);
+		strings.reserve(strings.size() + count);
+		for (int index = 1; index <= count; index++)
+		{
+			lua_rawgeti(luaStatePointer, luaArgumentIndex, index);
+			if (lua_type(luaStatePointer, -1) == LUA_TSTRING)
+			{
+				strings.push_back(lua_tostring(luaStatePointer, -1));
+			}
+			lua_pop(luaStatePointer, 1);
+		}
+		return true;
+	}
+	return false;
+}
+
+/**
+  Converts the given P2P reliability name to its equivalent EOS enum constant.
+  @param reliabilityName One of "unreliable", "reliableUnordered", or "reliableOrdered". Can be null.
+  @param reliability Assigned the name's enum constant if recognized.
+  @return Returns true if the name was recognized. Returns false if not.
+ */
+bool FetchPacketReliabilityFrom(const char* reliabilityName, EOS_EPacketReliability& reliability)
+{
+	if (!reliabilityName)
+	{
+		return false;
+	}
+	if (!strcmp(reliabilityName, "unreliable"))
+	{
+		reliability = EOS_EPacketReliability::EOS_PR_UnreliableUnordered;
+	}
+	else if (!strcmp(reliabilityName, "reliableUnordered"))
+	{
+		reliability = EOS_EPacketReliability::EOS_PR_ReliableUnordered;
+	}
+	else if (!strcmp(reliabilityName, "reliableOrdered"))
+	{
+		reliability = EOS_EPacketReliability::EOS_PR_ReliableOrdered;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+/**
+  Fetches a number of milliseconds, such as an interval given by an options table's field.
+  @param luaStatePointer The Lua state the value belongs to.
+  @param luaIndex Index to the value.
+  @param value Assigned the number of milliseconds, rounded down, if valid.
+  @return Returns true if the value is a number between 0 and kMaxMilliseconds.
+          Returns false if it is not a number, is negative, is NaN, or is too large.
+ */
+bool FetchMilliseconds(lua_State* luaStatePointer, int luaIndex, std::chrono::milliseconds& value)
+{
+	if (lua_type(luaStatePointer, luaIndex) != LUA_TNUMBER)
+	{
+		return false;
+	}
+	auto number = lua_tonumber(luaStatePointer, luaIndex);
+	bool isValid = (number >= 0) && (number <= kMaxMilliseconds);
+	if (!isValid)
+	{
+		return false;
+	}
+	value = std::chrono::milliseconds((long long)number);
+	return true;
+}
+
+/**
+  Fetches a P2P channel number argument.
+  @param luaStatePointer The Lua state the argument belongs to.
+  @param luaArgumentIndex Index to the channel number argument.
+  @param channel Assigned the channel number if valid.
+  @return Returns true if the argument is an integer between 0 and 254.
+          Returns false if the argument is not a number, is fractional, is NaN, or is out of range.
+          Channel 255 is rejected because it is reserved for P2PManager's internal ping traffic.
+ */
+bool FetchPacketChannel(lua_State* luaStatePointer, int luaArgumentIndex, uint8_t& channel)
+{
+	if (lua_type(luaStatePointer, luaArgumentIndex) != LUA_TNUMBER)
+	{
+		return false;
+	}
+	auto value = lua_tonumber(luaStatePointer, luaArgumentIndex);
+	bool isValid = (value >= 0) && (value < P2PManager::kPingChannel) && (value == std::floor(value));
+	if (!isValid)
+	{
+		return false;
+	}
+	channel = (uint8_t)value;
+	return true;
+}
+
+/**
+  Fetches the bytes of a P2P packet or message argument, which can be a string, a ByteBuffer, or a table.
+  Tables are serialized via the P2P manager's codec, which holds onto the bytes until it is used again.
+  @param luaStatePointer The Lua state the argument belongs to.
+  @param contextPointer The runtime context whose P2P manager serializes tables.
+  @param luaArgumentIndex Index to the argument.
+  @param data Assigned a pointer to the argument's bytes.
+  @param byteCount Assigned the number of bytes.
+  @param maxByteCount Max number of bytes allowed, such as P2PManager::kMaxPayloadByteCount.
+  @return Returns true if the bytes were fetched. Returns false after raising a Lua error if the argument
+          is of an unsupported type, cannot be serialized, or exceeds the max number of bytes.
+ */
+bool FetchPacketData(
+	lua_State* luaStatePointer, RuntimeContext* contextPointer, int luaArgumentIndex,
+	const void*& data, size_t& byteCount, uint32_t maxByteCount)
+{
+	auto bufferPointer = ByteBuffer::GetFrom(luaStatePointer, luaArgumentIndex);
+	if (bufferPointer)
+	{
+		data = bufferPointer->GetData();
+		byteCount = bufferPointer->GetLength();
+	}
+	else if (lua_type(luaStatePointer, luaArgumentIndex) == LUA_TSTRING)
+	{
+		data = lua_tolstring(luaStatePointer, luaArgumentIndex, &byteCount);
+	}
+	else if (lua_istable(luaStatePointer, luaArgumentIndex))
+	{
+		auto& codec = contextPointer->GetP2PManager()->GetCodec();
+		if (!codec.Encode(luaStatePointer, luaArgumentIndex))
+		{
+			CoronaLuaError(luaStatePointer, "Failed to serialize table. %s", codec.GetErrorMessage().c_str());
+			return false;
+		}
+		data = codec.GetBytes().data();
+		byteCount = codec.GetBytes().size();
+	}
+	else
+	{
+		CoronaLuaError(luaStatePointer, "Packet data must be set to a string, ByteBuffer, or table.");
+		return false;
+	}
+	if (byteCount > maxByteCount)
+	{
+		CoronaLuaError(luaStatePointer, "Packet data cannot exceed %u bytes.", maxByteCount);
+		return false;
+	}
+	return true;
+}
+
+//---------------------------------------------------------------------------------
+// Lua API Handlers
+//---------------------------------------------------------------------------------
+/** userHandle eos.login(options) */
+int OnLogin(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch the required options table argument.
+	if (!lua_istable(luaStatePointer, 1))
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to a table of login options.");
+		return 0;
+	}
+	lua_getfield(luaStatePointer, 1, "type");
+	const char* typeName = (lua_type(luaStatePointer, -1) == LUA_TSTRING) ? lua_tostring(luaStatePointer, -1) : "";
+	lua_pop(luaStatePointer, 1);
+	lua_getfield(luaStatePointer, 1, "id");
+	const char* id = (lua_type(luaStatePointer, -1) == LUA_TSTRING) ? lua_tostring(luaStatePointer, -1) : nullptr;
+	lua_pop(luaStatePointer, 1);
+	lua_getfield(luaStatePointer, 1, "token");
+	const char* token = (lua_type(luaStatePointer, -1) == LUA_TSTRING) ? lua_tostring(luaStatePointer, -1) : nullptr;
+	lua_pop(luaStatePointer, 1);
+	// Note: The strings fetched above remain referenced by the options table for the rest of this call.
+
+	// Convert the login type name to its equivalent EOS enum constant.
+	EOS_Auth_Credentials credentials = {};
+	credentials.ApiVersion = EOS_AUTH_CREDENTIALS_API_LATEST;
+	if (!strcmp(typeName, "exchangeCode"))
+	{
+		credentials.Type = EOS_ELoginCredentialType::EOS_LCT_ExchangeCode;
+	}
+	else if (!strcmp(typeName, "password"))
+	{
+		credentials.Type = EOS_ELoginCredentialType::EOS_LCT_Password;
+	}
+	else if (!strcmp(typeName, "persistentAuth"))
+	{
+		credentials.Type = EOS_ELoginCredentialType::EOS_LCT_PersistentAuth;
+	}
+	else if (!strcmp(typeName, "developer"))
+	{
+		credentials.Type = EOS_ELoginCredentialType::EOS_LCT_Developer;
+	}
+	else if (!strcmp(typeName, "refreshToken"))
+	{
+		credentials.Type = EOS_ELoginCredentialType::EOS_LCT_RefreshToken;
+	}
+	else if (!strcmp(typeName, "accountPortal"))
+	{
+		credentials.Type = EOS_ELoginCredentialType::EOS_LCT_AccountPortal;
+	}
+	else
+	{
+		CoronaLuaError(luaStatePointer, "Given unknown login type '%s'", typeName);
+		return 0;
+	}
+	credentials.Id = id;
+	credentials.Token = token;
+
+	// Fetch the optional permission scopes, such as { "basicProfile", "friendsList", "presence" }.
+	int scopeFlags = (int)EOS_EAuthScopeFlags::EOS_AS_NoFlags;
+	lua_getfield(luaStatePointer, 1, "scopes");
+	if (lua_istable(luaStatePointer, -1))
+	{
+		int scopeCount = (int)lua_objlen(luaStatePointer, -1);
+		for (int index = 1; index <= scopeCount; index++)
+		{
+			lua_rawgeti(luaStatePointer, -1, index);
+			const char* scopeName = (lua_type(luaStatePointer, -1) == LUA_TSTRING) ? lua_tostring(luaStatePointer, -1) : "";
+			if (!strcmp(scopeName, "basicProfile"))
+			{
+				scopeFlags |= (int)EOS_EAuthScopeFlags::EOS_AS_BasicProfile;
+			}
+			else if (!strcmp(scopeName, "friendsList"))
+			{
+				scopeFlags |= (int)EOS_EAuthScopeFlags::EOS_AS_FriendsList;
+			}
+			else if (!strcmp(scopeName, "presence"))
+			{
+				scopeFlags |= (int)EOS_EAuthScopeFlags::EOS_AS_Presence;
+			}
+			else if (!strcmp(scopeName, "friendsManagement"))
+			{
+				scopeFlags |= (int)EOS_EAuthScopeFlags::EOS_AS_FriendsManagement;
+			}
+			else if (!strcmp(scopeName, "email"))
+			{
+				scopeFlags |= (int)EOS_EAuthScopeFlags::EOS_AS_Email;
+			}
+			else
+			{
+				CoronaLog("WARNING: [EOS SDK] Ignoring unknown login scope '%s'", scopeName);
+			}
+			lua_pop(luaStatePointer, 1);
+		}
+	}
+	lua_pop(luaStatePointer, 1);
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Log in as a new local user. Result is dispatched as a "loginResponse" event with the same user handle.
+	auto sessionPointer = contextPointer->CreateLocalUser();
+	if (!sessionPointer)
+	{
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+	if (!sessionPointer->Login(credentials, (EOS_EAuthScopeFlags)scopeFlags))
+	{
+		contextPointer->RemoveLocalUser(sessionPointer->GetUserHandle());
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+	lua_pushinteger(luaStatePointer, sessionPointer->GetUserHandle());
+	return 1;
+}
+
+/** bool eos.logout([userHandle]) */
+int OnLogout(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Remove simulated users immediately, since they never logged into EOS.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, 1);
+	if (sessionPointer && sessionPointer->IsSimulated())
+	{
+		contextPointer->RemoveLocalUser(sessionPointer->GetUserHandle());
+		lua_pushboolean(luaStatePointer, 1);
+		return 1;
+	}
+
+	// Log out the given local user. Result is dispatched as a "logoutResponse" event.
+	lua_pushboolean(luaStatePointer, (sessionPointer && sessionPointer->Logout()) ? 1 : 0);
+	return 1;
+}
+
+/** table eos.getLocalUsers() */
+int OnGetLocalUsers(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Push an array of all local user sessions, ordered by user handle.
+	auto idCachePointer = contextPointer->GetIdCache();
+	auto sessions = contextPointer->GetLocalUsers();
+	lua_createtable(luaStatePointer, (int)sessions.size(), 0);
+	int arrayIndex = 1;
+	for (auto sessionPointer : sessions)
+	{
+		lua_createtable(luaStatePointer, 0, 4);
+		lua_pushinteger(luaStatePointer, sessionPointer->GetUserHandle());
+		lua_setfield(luaStatePointer, -2, "userHandle");
+		idCachePointer->PushEpicAccountIdTo(luaStatePointer, sessionPointer->GetEpicAccountId());
+		lua_setfield(luaStatePointer, -2, "epicAccountId");
+		idCachePointer->PushProductUserIdTo(luaStatePointer, sessionPointer->GetProductUserId());
+		lua_setfield(luaStatePointer, -2, "productUserId");
+		lua_pushstring(luaStatePointer, LocalUserSession::GetLoginStateName(sessionPointer->GetLoginState()));
+		lua_setfield(luaStatePointer, -2, "loginStatus");
+		lua_rawseti(luaStatePointer, -2, arrayIndex++);
+	}
+	return 1;
+}
+
+/** UserInfo eos.getAuthIdToken([userHandle]) */
+int OnGetAuthIdToken(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Push the cached ID token. Only copied from EOS after logging in or once it is about to expire.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, 1);
+	if (sessionPointer && sessionPointer->PushAuthIdTokenTo(luaStatePointer))
+	{
+		return 1;
+	}
+	else
+	{
+		CoronaLog("WARNING: [EOS SDK] User Auth Token is invalid");
+		return 0;
+	}
+}
+
+/** table eos.getAuthIdTokenClaims([userHandle]) */
+int OnGetAuthIdTokenClaims(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Push the cached ID token's decoded claims table, such as "exp" and "sub".
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, 1);
+	if (sessionPointer && sessionPointer->PushAuthIdTokenClaimsTo(luaStatePointer))
+	{
+		return 1;
+	}
+	return 0;
+}
+
+/** bool eos.connectLogin([userHandle]) */
+int OnConnectLogin(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Log into Connect with the Auth logged in account. Result is dispatched as a "connectLoginResponse" event.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, 1);
+	lua_pushboolean(luaStatePointer, (sessionPointer && sessionPointer->ConnectLogin()) ? 1 : 0);
+	return 1;
+}
+
+/** bool eos.loadProducts([productIds][, userHandle]) */
+int OnLoadProducts(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch the optional offer IDs. All offers in the catalog are provided if not given.
+	std::vector<std::string> productIds;
+	int userHandleArgumentIndex = 1;
+	if (FetchStringArray(luaStatePointer, 1, productIds))
+	{
+		userHandleArgumentIndex = 2;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Request the offers. Provided via a "loadProducts" event, from memory if the catalog was fetched recently.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, userHandleArgumentIndex);
+	bool wasRequested = sessionPointer && contextPointer->GetEcomStore()->LoadProducts(*sessionPointer, productIds);
+	lua_pushboolean(luaStatePointer, wasRequested ? 1 : 0);
+	return 1;
+}
+
+/** bool eos.prepareStore([productIds][, userHandle]) */
+int OnPrepareStore(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch the optional IDs of the offers about to be shown.
+	std::vector<std::string> productIds;
+	int userHandleArgumentIndex = 1;
+	if (FetchStringArray(luaStatePointer, 1, productIds))
+	{
+		userHandleArgumentIndex = 2;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Pre-warm the catalog, offer images, and entitlements so that the store screen and checkout respond quickly.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, userHandleArgumentIndex);
+	bool wasPrepared = sessionPointer && contextPointer->GetEcomStore()->PrepareStore(*sessionPointer, productIds);
+	lua_pushboolean(luaStatePointer, wasPrepared ? 1 : 0);
+	return 1;
+}
+
+/** bool eos.purchase(offerIds[, userHandle]) */
+int OnPurchaseProduct(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch the offer ID or array of offer IDs to purchase.
+	std::vector<std::string> offerIds;
+	if (!FetchStringArray(luaStatePointer, 1, offerIds) || offerIds.empty())
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to an offer ID or an array of offer IDs.");
+		return 0;
+	}
+	if (offerIds.size() > EOS_ECOM_CHECKOUT_MAX_ENTRIES)
+	{
+		CoronaLuaError(luaStatePointer, "Cannot purchase more than %d offers at once.", EOS_ECOM_CHECKOUT_MAX_ENTRIES);
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Check out the offers. Result is dispatched as a "storeTransaction" event.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, 2);
+	bool wasStarted = sessionPointer && contextPointer->GetEcomStore()->Purchase(*sessionPointer, offerIds);
+	lua_pushboolean(luaStatePointer, wasStarted ? 1 : 0);
+	return 1;
+}
+
+/** bool eos.restore([userHandle]) */
+int OnRestorePurchases(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Query unredeemed entitlements. They are dispatched as "restored" transactions via a "storeTransaction" event.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, 1);
+	bool wasStarted = sessionPointer && contextPointer->GetEcomStore()->Restore(*sessionPointer);
+	lua_pushboolean(luaStatePointer, wasStarted ? 1 : 0);
+	return 1;
+}
+
+/** bool eos.finishTransaction(transaction[, userHandle]) */
+int OnFinishTransaction(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch the transaction ID, either given directly or via a "storeTransaction" event's transaction table.
+	std::string transactionId;
+	if (lua_type(luaStatePointer, 1) == LUA_TSTRING)
+	{
+		transactionId = lua_tostring(luaStatePointer, 1);
+	}
+	else if (lua_istable(luaStatePointer, 1))
+	{
+		lua_getfield(luaStatePointer, 1, "identifier");
+		if (lua_type(luaStatePointer, -1) == LUA_TSTRING)
+		{
+			transactionId = lua_tostring(luaStatePointer, -1);
+		}
+		lua_pop(luaStatePointer, 1);
+	}
+	if (transactionId.empty())
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to a transaction or its identifier.");
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Queue the transaction's entitlements to be redeemed in a batch.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, 2);
+	bool wasRequested = sessionPointer && contextPointer->GetEcomStore()->FinishTransaction(*sessionPointer, transactionId);
+	lua_pushboolean(luaStatePointer, wasRequested ? 1 : 0);
+	return 1;
+}
+
+/** bool eos.queryOwnership(itemIds[, userHandle]) */
+int OnQueryOwnership(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch the catalog item ID or array of catalog item IDs to query.
+	std::vector<std::string> itemIds;
+	if (!FetchStringArray(luaStatePointer, 1, itemIds) || itemIds.empty())
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to a catalog item ID or an array of item IDs.");
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Query ownership in batches. The combined result is dispatched as a single "queryOwnership" event.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, 2);
+	bool wasStarted = sessionPointer && contextPointer->GetEcomStore()->QueryOwnership(*sessionPointer, itemIds);
+	lua_pushboolean(luaStatePointer, wasStarted ? 1 : 0);
+	return 1;
+}
+
+/** bool eos.queryEntitlements([entitlementNames][, userHandle]) */
+int OnQueryEntitlements(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch the optional entitlement names. All of the user's entitlements are queried if not given.
+	std::vector<std::string> entitlementNames;
+	int userHandleArgumentIndex = 1;
+	if (FetchStringArray(luaStatePointer, 1, entitlementNames))
+	{
+		userHandleArgumentIndex = 2;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Query entitlements in batches. The combined result is dispatched as a single "queryEntitlements" event.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, userHandleArgumentIndex);
+	bool wasStarted =
+			sessionPointer && contextPointer->GetEcomStore()->QueryEntitlements(*sessionPointer, entitlementNames);
+	lua_pushboolean(luaStatePointer, wasStarted ? 1 : 0);
+	return 1;
+}
+
+/** bool eos.isEntitled(id[, userHandle]) */
+int OnIsEntitled(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch the required catalog item ID, entitlement name, or entitlement ID.
+	if (lua_type(luaStatePointer, 1) != LUA_TSTRING)
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to a catalog item ID or entitlement name.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+	std::string id(lua_tostring(luaStatePointer, 1));
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Look up the ID in the user's entitlement set, which is populated by queries, purchases, and restores.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, 2);
+	bool isEntitled = sessionPointer && sessionPointer->IsEntitledTo(id);
+	lua_pushboolean(luaStatePointer, isEntitled ? 1 : 0);
+	return 1;
+}
+
+/** bool eos.queryOwnershipToken(itemIds[, userHandle]) */
+int OnQueryOwnershipToken(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch the catalog item ID or array of catalog item IDs the tokens must cover.
+	std::vector<std::string> itemIds;
+	if (!FetchStringArray(luaStatePointer, 1, itemIds) || itemIds.empty())
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to a catalog item ID or an array of item IDs.");
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Fetch the tokens, from the cache if not expired. Provided via an "ownershipToken" event.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, 2);
+	bool wasStarted = sessionPointer && contextPointer->GetEcomStore()->QueryOwnershipToken(*sessionPointer, itemIds);
+	lua_pushboolean(luaStatePointer, wasStarted ? 1 : 0);
+	return 1;
+}
+
+/** bool eos.queryEntitlementToken([entitlementNames][, userHandle]) */
+int OnQueryEntitlementToken(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch the optional entitlement names. The token covers all of the user's entitlements if not given.
+	std::vector<std::string> entitlementNames;
+	int userHandleArgumentIndex = 1;
+	if (FetchStringArray(luaStatePointer, 1, entitlementNames))
+	{
+		userHandleArgumentIndex = 2;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Fetch the tokens, from the cache if not expired. Provided via an "entitlementToken" event.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, userHandleArgumentIndex);
+	bool wasStarted =
+			sessionPointer && contextPointer->GetEcomStore()->QueryEntitlementToken(*sessionPointer, entitlementNames);
+	lua_pushboolean(luaStatePointer, wasStarted ? 1 : 0);
+	return 1;
+}
+
+/** isVerified, claims = eos.verifyToken(token[, userHandle]) */
+int OnVerifyToken(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch the required token string.
+	if (lua_type(luaStatePointer, 1) != LUA_TSTRING)
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to an ownership or entitlement token string.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+	JsonWebToken token;
+	if (!token.Parse(lua_tostring(luaStatePointer, 1)))
+	{
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Verify the token's signature and claims locally. The token must belong to the given user, if any.
+	EOS_EpicAccountId accountId = nullptr;
+	if (lua_type(luaStatePointer, 2) == LUA_TNUMBER)
+	{
+		auto sessionPointer = contextPointer->GetLocalUserBy((int)lua_tointeger(luaStatePointer, 2));
+		if (!sessionPointer || !sessionPointer->GetEpicAccountId())
+		{
+			lua_pushboolean(luaStatePointer, 0);
+			return 1;
+		}
+		accountId = sessionPointer->GetEpicAccountId();
+	}
+	bool isVerified = contextPointer->GetEcomStore()->VerifyToken(token, accountId);
+	lua_pushboolean(luaStatePointer, isVerified ? 1 : 0);
+	if (!token.PushClaimsTo(luaStatePointer))
+	{
+		lua_pushnil(luaStatePointer);
+	}
+	return 2;
+}
+
+/** bool eos.setNotificationPosition(positionName) */
+int OnSetNotificationPosition(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch the required position name argument.
+	if (lua_type(luaStatePointer, 1) != LUA_TSTRING)
+	{
+		CoronaLuaError(luaStatePointer, "Given argument is not of type string.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+	const char* positionName = lua_tostring(luaStatePointer, 1);
+	if (!positionName)
+	{
+		positionName = "";
+	}
+
+	// Convert the position name to its equivalent Steam enum constant.
+	EOS_UI_ENotificationLocation positionId;
+	if (!strcmp(positionName, "topLeft"))
+	{
+		positionId = EOS_UI_ENotificationLocation::EOS_UNL_TopLeft;
+	}
+	else if (!strcmp(positionName, "topRight"))
+	{
+		positionId = EOS_UI_ENotificationLocation::EOS_UNL_TopRight;
+	}
+	else if (!strcmp(positionName, "bottomLeft"))
+	{
+		positionId = EOS_UI_ENotificationLocation::EOS_UNL_BottomLeft;
+	}
+	else if (!strcmp(positionName, "bottomRight"))
+	{
+		positionId = EOS_UI_ENotificationLocation::EOS_UNL_BottomRight;
+	}
+	else
+	{
+		CoronaLuaError(luaStatePointer, "Given unknown position name '%s'", positionName);
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+
+	// Fetch the runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	auto eosPlatformHandle = contextPointer->fPlatformHandle;
+	if (eosPlatformHandle)
+	{
+		// Change EOS's notification position with given setting.
+		EOS_HUI ExternalUIHandle = EOS_Platform_GetUIInterface(eosPlatformHandle);
+
+		EOS_UI_SetDisplayPreferenceOptions Options = {};
+		Options.ApiVersion = EOS_UI_SETDISPLAYPREFERENCE_API_LATEST;
+		Options.NotificationLocation = positionId;
+
+		const EOS_EResult Result = EOS_UI_SetDisplayPreference(ExternalUIHandle, &Options);
+		if (Result == EOS_EResult::EOS_Success)
+		{
+			lua_pushboolean(luaStatePointer, 1);
+			return 1;
+		}
+		else
+		{
+			lua_pushboolean(luaStatePointer, 0);
+			return 1;
+		}
+	}
+	else
+	{
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+}
+
+/** bool eos.p2p.sendPacket(peerId, socketName, channel, data[, reliability][, userHandle]) */
+int OnP2PSendPacket(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Fetch the required peer, socket, and channel arguments.
+	if (lua_type(luaStatePointer, 1) != LUA_TSTRING)
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to the peer's product user ID string.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+	auto remoteUserId = contextPointer->GetIdCache()->GetProductUserIdFrom(lua_tostring(luaStatePointer, 1));
+	if (lua_type(luaStatePointer, 2) != LUA_TSTRING)
+	{
+		CoronaLuaError(luaStatePointer, "2nd argument must be set to a socket name string.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+	auto socketName = lua_tostring(luaStatePointer, 2);
+	uint8_t channel = 0;
+	if (!FetchPacketChannel(luaStatePointer, 3, channel))
+	{
+		CoronaLuaError(luaStatePointer, "3rd argument must be set to a channel number between 0 and 254.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+
+	// Fetch the data to send, which can be a string, a ByteBuffer, or a table to be serialized.
+	const void* data = nullptr;
+	size_t byteCount = 0;
+	if (!FetchPacketData(luaStatePointer, contextPointer, 4, data, byteCount, P2PManager::kMaxPayloadByteCount))
+	{
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+
+	// Fetch the optional reliability name.
+	auto reliability = EOS_EPacketReliability::EOS_PR_ReliableOrdered;
+	int userHandleArgumentIndex = 5;
+	if (lua_type(luaStatePointer, 5) == LUA_TSTRING)
+	{
+		auto reliabilityName = lua_tostring(luaStatePointer, 5);
+		if (!FetchPacketReliabilityFrom(reliabilityName, reliability))
+		{
+			CoronaLuaError(luaStatePointer, "Given unknown reliability name '%s'", reliabilityName);
+			lua_pushboolean(luaStatePointer, 0);
+			return 1;
+		}
+		userHandleArgumentIndex = 6;
+	}
+
+	// Send the packet.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, userHandleArgumentIndex);
+	bool wasSent =
+			sessionPointer && contextPointer->GetP2PManager()->SendPacket(
+					*sessionPointer, remoteUserId, socketName, channel, data, (uint32_t)byteCount, reliability);
+	lua_pushboolean(luaStatePointer, wasSent ? 1 : 0);
+	return 1;
+}
+
+/** peerCount eos.p2p.broadcast(relevancy, socketName, channel, data[, reliability][, userHandle]) */
+int OnP2PBroadcast(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Fetch the relevancy argument, which can be a topic string, a table providing a position and/or topic,
+	// or nil to broadcast to all peers whose interest was set.
+	P2PInterestManager::Relevancy relevancy = {};
+	auto relevancyType = lua_type(luaStatePointer, 1);
+	if (relevancyType == LUA_TSTRING)
+	{
+		relevancy.Topic = lua_tostring(luaStatePointer, 1);
+	}
+	else if (relevancyType == LUA_TTABLE)
+	{
+		lua_getfield(luaStatePointer, 1, "x");
+		lua_getfield(luaStatePointer, 1, "y");
+		if ((lua_type(luaStatePointer, -2) == LUA_TNUMBER) && (lua_type(luaStatePointer, -1) == LUA_TNUMBER))
+		{
+			relevancy.HasPosition = true;
+			relevancy.X = lua_tonumber(luaStatePointer, -2);
+			relevancy.Y = lua_tonumber(luaStatePointer, -1);
+		}
+		lua_pop(luaStatePointer, 2);
+		lua_getfield(luaStatePointer, 1, "topic");
+		if (lua_type(luaStatePointer, -1) == LUA_TSTRING)
+		{
+			relevancy.Topic = lua_tostring(luaStatePointer, -1);
+		}
+		lua_pop(luaStatePointer, 1);
+	}
+	else if (relevancyType != LUA_TNIL)
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to a topic string, a relevancy table, or nil.");
+		lua_pushinteger(luaStatePointer, 0);
+		return 1;
+	}
+
+	// Fetch the required socket and channel arguments.
+	if (lua_type(luaStatePointer, 2) != LUA_TSTRING)
+	{
+		CoronaLuaError(luaStatePointer, "2nd argument must be set to a socket name string.");
+		lua_pushinteger(luaStatePointer, 0);
+		return 1;
+	}
+	auto socketName = lua_tostring(luaStatePointer, 2);
+	uint8_t channel = 0;
+	if (!FetchPacketChannel(luaStatePointer, 3, channel))
+	{
+		CoronaLuaError(luaStatePointer, "3rd argument must be set to a channel number between 0 and 254.");
+		lua_pushinteger(luaStatePointer, 0);
+		return 1;
+	}
+
+	// Fetch the data to send, which can be a string, a ByteBuffer, or a table to be serialized.
+	const void* data = nullptr;
+	size_t byteCount = 0;
+	if (!FetchPacketData(luaStatePointer, contextPointer, 4, data, byteCount, P2PManager::kMaxPayloadByteCount))
+	{
+		lua_pushinteger(luaStatePointer, 0);
+		return 1;
+	}
+
+	// Fetch the optional reliability name.
+	auto reliability = EOS_EPacketReliability::EOS_PR_ReliableOrdered;
+	int userHandleArgumentIndex = 5;
+	if (lua_type(luaStatePointer, 5) == LUA_TSTRING)
+	{
+		auto reliabilityName = lua_tostring(luaStatePointer, 5);
+		if (!FetchPacketReliabilityFrom(reliabilityName, reliability))
+		{
+			CoronaLuaError(luaStatePointer, "Given unknown reliability name '%s'", reliabilityName);
+			lua_pushinteger(luaStatePointer, 0);
+			return 1;
+		}
+		userHandleArgumentIndex = 6;
+	}
+
+	// Send the packet to every interested peer and return how many peers it was sent to.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, userHandleArgumentIndex);
+	uint32_t peerCount = 0;
+	if (sessionPointer)
+	{
+		peerCount = contextPointer->GetP2PManager()->BroadcastPacket(
+				*sessionPointer, relevancy, socketName, channel, data, (uint32_t)byteCount, reliability);
+	}
+	lua_pushinteger(luaStatePointer, (lua_Integer)peerCount);
+	return 1;
+}
+
+/** buffer, peerId, channel, socketName eos.p2p.receivePacket([channel][, userHandle]) */
+int OnP2PReceivePacket(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Fetch the optional channel to receive from. Packets are received from all channels if nil.
+	uint8_t channel = 0;
+	const uint8_t* channelPointer = nullptr;
+	if (lua_type(luaStatePointer, 1) == LUA_TNUMBER)
+	{
+		if (!FetchPacketChannel(luaStatePointer, 1, channel))
+		{
+			CoronaLuaError(luaStatePointer, "1st argument must be set to a channel number between 0 and 254 or nil.");
+			lua_pushnil(luaStatePointer);
+			return 1;
+		}
+		channelPointer = &channel;
+	}
+
+	// Receive the next packet directly into the re-usable Lua buffer, which is left on the stack.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, 2);
+	if (!sessionPointer)
+	{
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+	auto p2pManagerPointer = contextPointer->GetP2PManager();
+	auto bufferPointer = p2pManagerPointer->PushReceiveBufferTo(luaStatePointer);
+	P2PManager::ReceivedPacket packet;
+	if (!bufferPointer || !p2pManagerPointer->ReceivePacket(*sessionPointer, channelPointer, *bufferPointer, packet))
+	{
+		lua_pop(luaStatePointer, 1);
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+
+	// Return the buffer followed by the packet's sender, channel, and socket.
+	contextPointer->GetIdCache()->PushProductUserIdTo(luaStatePointer, packet.PeerId);
+	lua_pushinteger(luaStatePointer, packet.Channel);
+	lua_pushstring(luaStatePointer, packet.SocketId.SocketName);
+	return 4;
+}
+
+/** bool eos.p2p.sendLargeMessage(peerId, socketName, channel, data[, userHandle]) */
+int OnP2PSendLargeMessage(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Fetch the required peer, socket, and channel arguments.
+	if (lua_type(luaStatePointer, 1) != LUA_TSTRING)
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to the peer's product user ID string.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+	auto remoteUserId = contextPointer->GetIdCache()->GetProductUserIdFrom(lua_tostring(luaStatePointer, 1));
+	if (lua_type(luaStatePointer, 2) != LUA_TSTRING)
+	{
+		CoronaLuaError(luaStatePointer, "2nd argument must be set to a socket name string.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+	auto socketName = lua_tostring(luaStatePointer, 2);
+	uint8_t channel = 0;
+	if (!FetchPacketChannel(luaStatePointer, 3, channel))
+	{
+		CoronaLuaError(luaStatePointer, "3rd argument must be set to a channel number between 0 and 254.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+
+	// Fetch the message's bytes, which can be a string, a ByteBuffer, or a table to be serialized.
+	const void* data = nullptr;
+	size_t byteCount = 0;
+	if (!FetchPacketData(luaStatePointer, contextPointer, 4, data, byteCount, P2PManager::kMaxMessageByteCount))
+	{
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+
+	// Queue the message to be split into reliable ordered packets, which are sent over the next frames.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, 5);
+	bool wasSent =
+			sessionPointer && contextPointer->GetP2PManager()->SendLargeMessage(
+					*sessionPointer, remoteUserId, socketName, channel, data, (uint32_t)byteCount);
+	lua_pushboolean(luaStatePointer, wasSent ? 1 : 0);
+	return 1;
+}
+
+/** bool eos.p2p.queueMessage(peerId, socketName, channel, data[, options]) */
+int OnP2PQueueMessage(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Fetch the required peer, socket, and channel arguments.
+	if (lua_type(luaStatePointer, 1) != LUA_TSTRING)
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to the peer's product user ID string.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+	auto remoteUserId = contextPointer->GetIdCache()->GetProductUserIdFrom(lua_tostring(luaStatePointer, 1));
+	if (lua_type(luaStatePointer, 2) != LUA_TSTRING)
+	{
+		CoronaLuaError(luaStatePointer, "2nd argument must be set to a socket name string.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+	auto socketName = lua_tostring(luaStatePointer, 2);
+	uint8_t channel = 0;
+	if (!FetchPacketChannel(luaStatePointer, 3, channel))
+	{
+		CoronaLuaError(luaStatePointer, "3rd argument must be set to a channel number between 0 and 254.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+
+	// Fetch the message's bytes, which can be a string, a ByteBuffer, or a table to be serialized.
+	const void* data = nullptr;
+	size_t byteCount = 0;
+	if (!FetchPacketData(luaStatePointer, contextPointer, 4, data, byteCount, P2PManager::kMaxPayloadByteCount))
+	{
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+
+	// Fetch the optional settings.
+	auto reliability = EOS_EPacketReliability::EOS_PR_ReliableOrdered;
+	std::string coalesceKey;
+	LocalUserSession* sessionPointer = nullptr;
+	if (lua_istable(luaStatePointer, 5))
+	{
+		lua_getfield(luaStatePointer, 5, "reliability");
+		if (lua_type(luaStatePointer, -1) == LUA_TSTRING)
+		{
+			auto reliabilityName = lua_tostring(luaStatePointer, -1);
+			if (!FetchPacketReliabilityFrom(reliabilityName, reliability))
+			{
+				CoronaLuaError(luaStatePointer, "Given unknown reliability name '%s'", reliabilityName);
+				lua_pop(luaStatePointer, 1);
+				lua_pushboolean(luaStatePointer, 0);
+				return 1;
+			}
+		}
+		lua_pop(luaStatePointer, 1);
+		lua_getfield(luaStatePointer, 5, "coalesceKey");
+		auto coalesceKeyType = lua_type(luaStatePointer, -1);
+		if ((coalesceKeyType == LUA_TSTRING) || (coalesceKeyType == LUA_TNUMBER))
+		{
+			size_t coalesceKeyLength = 0;
+			auto coalesceKeyString = lua_tolstring(luaStatePointer, -1, &coalesceKeyLength);
+			coalesceKey.assign(coalesceKeyString, coalesceKeyLength);
+		}
+		lua_pop(luaStatePointer, 1);
+		lua_getfield(luaStatePointer, 5, "userHandle");
+		sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, -1);
+		lua_pop(luaStatePointer, 1);
+	}
+	else
+	{
+		sessionPointer = contextPointer->GetDefaultLocalUser();
+	}
+
+	// Queue the message to be sent with other messages to the same peer at the end of the frame.
+	bool wasQueued =
+			sessionPointer && contextPointer->GetP2PManager()->QueueMessage(
+					*sessionPointer, remoteUserId, socketName, channel, data, (uint32_t)byteCount, reliability,
+					coalesceKey);
+	lua_pushboolean(luaStatePointer, wasQueued ? 1 : 0);
+	return 1;
+}
+
+/** eos.p2p.flush() */
+int OnP2PFlush(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Send all queued messages now instead of at the end of the frame.
+	contextPointer->GetP2PManager()->FlushMessages();
+	return 0;
+}
+
+/** data eos.p2p.encode(value) */
+int OnP2PEncode(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Serialize the given value and return it as a string. Returns nil and an error message on failure.
+	auto& codec = contextPointer->GetP2PManager()->GetCodec();
+	if (!codec.Encode(luaStatePointer, 1))
+	{
+		lua_pushnil(luaStatePointer);
+		lua_pushstring(luaStatePointer, codec.GetErrorMessage().c_str());
+		return 2;
+	}
+	auto& bytes = codec.GetBytes();
+	lua_pushlstring(luaStatePointer, (const char*)bytes.data(), bytes.size());
+	return 1;
+}
+
+/** value eos.p2p.decode(data[, offset][, length]) */
+int OnP2PDecode(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch the bytes to decode from a string or a ByteBuffer, such as a "p2pPackets" event's buffer.
+	const uint8_t* bytes = nullptr;
+	size_t byteCount = 0;
+	auto bufferPointer = ByteBuffer::GetFrom(luaStatePointer, 1);
+	if (bufferPointer)
+	{
+		bytes = bufferPointer->GetData();
+		byteCount = bufferPointer->GetLength();
+	}
+	else if (lua_type(luaStatePointer, 1) == LUA_TSTRING)
+	{
+		bytes = (const uint8_t*)lua_tolstring(luaStatePointer, 1, &byteCount);
+	}
+	else
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to a string or ByteBuffer.");
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+
+	// Narrow the bytes down to the optional zero-based offset and length.
+	lua_Number offset = luaL_optnumber(luaStatePointer, 2, 0);
+	lua_Number length = luaL_optnumber(luaStatePointer, 3, (lua_Number)byteCount - offset);
+	// Comparisons are negated so that NaN arguments, for which every comparison is false, are rejected too.
+	bool isInBounds = (offset >= 0) && (length >= 0) && ((offset + length) <= (lua_Number)byteCount);
+	if (!isInBounds)
+	{
+		CoronaLuaError(luaStatePointer, "Given offset and length exceed the data's bounds.");
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+
+	// Push the decoded value. Returns nil if the bytes are malformed.
+	if (!LuaValueCodec::Decode(luaStatePointer, bytes + (size_t)offset, (uint32_t)length))
+	{
+		lua_pushnil(luaStatePointer);
+	}
+	return 1;
+}
+
+/** eos.p2p.setAutoReceive(enabled[, maxPacketCount][, maxByteCount]) */
+int OnP2PSetAutoReceive(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch the required enabled flag.
+	if (lua_type(luaStatePointer, 1) != LUA_TBOOLEAN)
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to a boolean.");
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Update the P2P manager's per-frame receive settings.
+	auto p2pManagerPointer = contextPointer->GetP2PManager();
+	p2pManagerPointer->SetAutoReceiveEnabled(lua_toboolean(luaStatePointer, 1) ? true : false);
+	if (lua_type(luaStatePointer, 2) == LUA_TNUMBER)
+	{
+		p2pManagerPointer->SetMaxReceivePacketCount((uint32_t)lua_tointeger(luaStatePointer, 2));
+	}
+	if (lua_type(luaStatePointer, 3) == LUA_TNUMBER)
+	{
+		p2pManagerPointer->SetMaxReceiveByteCount((uint32_t)lua_tointeger(luaStatePointer, 3));
+	}
+	return 0;
+}
+
+/** bool eos.p2p.registerSnapshotSchema(schemaId, fields) */
+int OnP2PRegisterSnapshotSchema(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Fetch the required schema ID.
+	lua_Number schemaId = (lua_type(luaStatePointer, 1) == LUA_TNUMBER) ? lua_tonumber(luaStatePointer, 1) : -1;
+	bool isValidSchemaId = (schemaId >= 0) && (schemaId <= 255);
+	if (!isValidSchemaId)
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to a schema ID between 0 and 255.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+
+	// Fetch the required array of field definitions, such as {name="x", type="number", precision=0.01}.
+	auto schemaPointer = std::make_shared<SnapshotReplicator::Schema>();
+	schemaPointer->Id = (uint8_t)schemaId;
+	int fieldCount = lua_istable(luaStatePointer, 2) ? (int)lua_objlen(luaStatePointer, 2) : 0;
+	if (fieldCount <= 0)
+	{
+		CoronaLuaError(luaStatePointer, "2nd argument must be set to a non-empty array of field tables.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+	for (int index = 1; index <= fieldCount; index++)
+	{
+		SnapshotReplicator::Field field = {};
+		const char* typeName = nullptr;
+		lua_rawgeti(luaStatePointer, 2, index);
+		if (lua_istable(luaStatePointer, -1))
+		{
+			lua_getfield(luaStatePointer, -1, "name");
+			if (lua_type(luaStatePointer, -1) == LUA_TSTRING)
+			{
+				field.Name = lua_tostring(luaStatePointer, -1);
+			}
+			lua_pop(luaStatePointer, 1);
+			lua_getfield(luaStatePointer, -1, "type");
+			if (lua_type(luaStatePointer, -1) == LUA_TSTRING)
+			{
+				typeName = lua_tostring(luaStatePointer, -1);
+			}
+			lua_pop(luaStatePointer, 1);
+			lua_getfield(luaStatePointer, -1, "precision");
+			if (lua_type(luaStatePointer, -1) == LUA_TNUMBER)
+			{
+				field.Precision = lua_tonumber(luaStatePointer, -1);
+			}
+			lua_pop(luaStatePointer, 1);
+		}
+		lua_pop(luaStatePointer, 1);
+		bool isValidType = true;
+		if (typeName && !strcmp(typeName, "boolean"))
+		{
+			field.Type = SnapshotReplicator::FieldType::kBoolean;
+		}
+		else if (typeName && !strcmp(typeName, "integer"))
+		{
+			field.Type = SnapshotReplicator::FieldType::kInteger;
+		}
+		else if (typeName && !strcmp(typeName, "number"))
+		{
+			field.Type = SnapshotReplicator::FieldType::kNumber;
+		}
+		else if (typeName && !strcmp(typeName, "string"))
+		{
+			field.Type = SnapshotReplicator::FieldType::kString;
+		}
+		else
+		{
+			isValidType = false;
+		}
+		if (field.Name.empty() || !isValidType || (field.Precision < 0))
+		{
+			CoronaLuaError(
+					luaStatePointer,
+					"Field %d must have a name, a type of 'boolean', 'integer', 'number', or 'string', "
+					"and an optional non-negative precision.", index);
+			lua_pushboolean(luaStatePointer, 0);
+			return 1;
+		}
+		schemaPointer->Fields.push_back(field);
+	}
+
+	// Register the schema, replacing the existing schema with the same ID.
+	contextPointer->GetP2PManager()->GetSnapshotReplicator().RegisterSchema(schemaPointer);
+	lua_pushboolean(luaStatePointer, 1);
+	return 1;
+}
+
+/** bool eos.p2p.sendSnapshot(peerIds, socketName, channel, schemaId, entities[, userHandle]) */
+int OnP2PSendSnapshot(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Fetch the required peers, socket, channel, and schema arguments.
+	std::vector<std::string> peerIdStrings;
+	if (!FetchStringArray(luaStatePointer, 1, peerIdStrings))
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to a product user ID string or an array of them.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+	std::vector<EOS_ProductUserId> remoteUserIds;
+	for (auto&& peerIdString : peerIdStrings)
+	{
+		auto remoteUserId = contextPointer->GetIdCache()->GetProductUserIdFrom(peerIdString.c_str());
+		if (remoteUserId)
+		{
+			remoteUserIds.push_back(remoteUserId);
+		}
+	}
+	if (lua_type(luaStatePointer, 2) != LUA_TSTRING)
+	{
+		CoronaLuaError(luaStatePointer, "2nd argument must be set to a socket name string.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+	auto socketName = lua_tostring(luaStatePointer, 2);
+	uint8_t channel = 0;
+	if (!FetchPacketChannel(luaStatePointer, 3, channel))
+	{
+		CoronaLuaError(luaStatePointer, "3rd argument must be set to a channel number between 0 and 254.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+	auto p2pManagerPointer = contextPointer->GetP2PManager();
+	lua_Number schemaId = (lua_type(luaStatePointer, 4) == LUA_TNUMBER) ? lua_tonumber(luaStatePointer, 4) : -1;
+	bool isValidSchemaId = (schemaId >= 0) && (schemaId <= 255);
+	auto schemaPointer =
+			isValidSchemaId ? p2pManagerPointer->GetSnapshotReplicator().GetSchemaBy((uint8_t)schemaId) : nullptr;
+	if (!schemaPointer)
+	{
+		CoronaLuaError(luaStatePointer, "4th argument must be set to the ID of a registered snapshot schema.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+
+	// Quantize the entities table according to the schema.
+	SnapshotReplicator::EntityMap entities;
+	std::string errorMessage;
+	if (!SnapshotReplicator::CaptureEntitiesFrom(luaStatePointer, 5, *schemaPointer, entities, errorMessage))
+	{
+		CoronaLuaError(luaStatePointer, "5th argument is invalid. %s", errorMessage.c_str());
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+
+	// Send each peer the fields that changed since the last snapshot it acknowledged.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, 6);
+	bool wasSent =
+			sessionPointer && p2pManagerPointer->SendSnapshot(
+					*sessionPointer, remoteUserIds, socketName, channel, schemaPointer->Id, std::move(entities));
+	lua_pushboolean(luaStatePointer, wasSent ? 1 : 0);
+	return 1;
+}
+
+/** bool eos.p2p.acceptConnection(peerId, socketName[, userHandle]) */
+int OnP2PAcceptConnection(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Fetch the required peer and socket arguments.
+	if (lua_type(luaStatePointer, 1) != LUA_TSTRING)
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to the peer's product user ID string.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+	auto remoteUserId = contextPointer->GetIdCache()->GetProductUserIdFrom(lua_tostring(luaStatePointer, 1));
+	if (lua_type(luaStatePointer, 2) != LUA_TSTRING)
+	{
+		CoronaLuaError(luaStatePointer, "2nd argument must be set to a socket name string.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+	auto socketName = lua_tostring(luaStatePointer, 2);
+
+	// Accept the connection.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, 3);
+	bool wasAccepted =
+			sessionPointer && contextPointer->GetP2PManager()->GetConnectionManager().AcceptConnection(
+					*sessionPointer, remoteUserId, socketName);
+	lua_pushboolean(luaStatePointer, wasAccepted ? 1 : 0);
+	return 1;
+}
+
+/** bool eos.p2p.closeConnection(peerId[, socketName][, userHandle]) */
+int OnP2PCloseConnection(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Fetch the required peer argument.
+	if (lua_type(luaStatePointer, 1) != LUA_TSTRING)
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to the peer's product user ID string.");
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
+	}
+	auto remoteUserId = contextPointer->GetIdCache()->GetProductUserIdFrom(lua_tostring(luaStatePointer, 1));
+
+	// Fetch the optional socket name. All of the peer's connections are closed if not given.
+	const char* socketName = nullptr;
+	int userHandleArgumentIndex = 2;
+	if (lua_type(luaStatePointer, 2) == LUA_TSTRING)
+	{
+		socketName = lua_tostring(luaStatePointer, 2);
+		userHandleArgumentIndex = 3;
+	}
+
+	// Close the connection.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, userHandleArgumentIndex);
+	bool wasClosed =
+			sessionPointer && contextPointer->GetP2PManager()->GetConnectionManager().CloseConnection(
+					*sessionPointer, remoteUserId, socketName);
+	lua_pushboolean(luaStatePointer, wasClosed ? 1 : 0);
+	return 1;
+}
+
+/** state, networkType eos.p2p.getConnectionState(peerId[, socketName][, userHandle]) */
+int OnP2PGetConnectionState(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Fetch the required peer argument.
+	if (lua_type(luaStatePointer, 1) != LUA_TSTRING)
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to the peer's product user ID string.");
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+	auto remoteUserId = contextPointer->GetIdCache()->GetProductUserIdFrom(lua_tostring(luaStatePointer, 1));
+
+	// Fetch the optional socket name. The most connected of the peer's sockets is used if not given.
+	const char* socketName = nullptr;
+	int userHandleArgumentIndex = 2;
+	if (lua_type(luaStatePointer, 2) == LUA_TSTRING)
+	{
+		socketName = lua_tostring(luaStatePointer, 2);
+		userHandleArgumentIndex = 3;
+	}
+
+	// Return the connection's state from the connection table, without calling into EOS.
+	auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, userHandleArgumentIndex);
+	if (!sessionPointer)
+	{
+		lua_pushstring(luaStatePointer, P2PConnectionManager::GetNameOf(P2PConnectionManager::ConnectionState::kNone));
+		return 1;
+	}
+	auto connection = contextPointer->GetP2PManager()->GetConnectionManager().GetConnectionInfo(
+			sessionPointer->GetProductUserId(), remoteUserId, socketName);
+	lua_pushstring(luaStatePointer, P2PConnectionManager::GetNameOf(connection.State));
+	lua_pushstring(luaStatePointer, P2PConnectionManager::GetNameOf(connection.NetworkType));
+	return 2;
+}
+
+/** eos.p2p.setAutoAccept(value) */
+int OnP2PSetAutoAccept(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+	auto& connectionManager = contextPointer->GetP2PManager()->GetConnectionManager();
+
+	// Accept all or no incoming connection requests natively if given a boolean.
+	if (lua_type(luaStatePointer, 1) == LUA_TBOOLEAN)
+	{
+		bool isEnabled = lua_toboolean(luaStatePointer, 1) ? true : false;
+		connectionManager.SetAutoAcceptPolicy(
+				isEnabled ? P2PConnectionManager::AutoAcceptPolicy::kAll : P2PConnectionManager::AutoAcceptPolicy::kNone);
+		return 0;
+	}
+
+	// Otherwise, only accept requests from the given peers, such as the members of the user's lobby.
+	std::vector<std::string> peerIdStrings;
+	if (!FetchStringArray(luaStatePointer, 1, peerIdStrings))
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to a boolean or an array of product user ID strings.");
+		return 0;
+	}
+	std::vector<EOS_ProductUserId> remoteUserIds;
+	for (auto&& peerIdString : peerIdStrings)
+	{
+		remoteUserIds.push_back(contextPointer->GetIdCache()->GetProductUserIdFrom(peerIdString.c_str()));
+	}
+	connectionManager.SetAutoAcceptPeers(remoteUserIds);
+	connectionManager.SetAutoAcceptPolicy(P2PConnectionManager::AutoAcceptPolicy::kAllowedPeers);
+	return 0;
+}
+
+/** table eos.p2p.getStats([peerId][, userHandle]) */
+int OnP2PGetStats(lua_State* luaStatePointer)
 {
-	RuntimeContext* contextPointer = (RuntimeContext*)Data->ClientData;
-	if (Data->ResultCode == EOS_EResult::EOS_Success)
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+	auto p2pManagerPointer = contextPointer->GetP2PManager();
+
+	// Push a table providing the state of the EOS packet queues, shared by all peers.
+	lua_createtable(luaStatePointer, 0, 24);
+	EOS_P2P_PacketQueueInfo queueInfo = {};
+	if (p2pManagerPointer->FetchPacketQueueInfo(queueInfo))
 	{
-		contextPointer->fAccountId = Data->SelectedAccountId;
+		P2PLinkStats::SetLuaFieldsFrom(luaStatePointer, queueInfo);
 	}
-	
-	if (EOS_EResult_IsOperationComplete(Data->ResultCode))
+	P2PQueueManager::SetLuaFieldsFrom(luaStatePointer, p2pManagerPointer->GetQueueManager().GetOverflowStats());
+
+	// Add the given peer's link statistics to the table, if any packets were exchanged with it.
+	if (lua_type(luaStatePointer, 1) == LUA_TSTRING)
 	{
-		contextPointer->OnLoginResponse(Data);
+		auto remoteUserId = contextPointer->GetIdCache()->GetProductUserIdFrom(lua_tostring(luaStatePointer, 1));
+		auto sessionPointer = FetchLocalUserSession(luaStatePointer, contextPointer, 2);
+		if (sessionPointer)
+		{
+			auto statsPointer =
+					p2pManagerPointer->GetLinkStats().GetPeerStats(sessionPointer->GetProductUserId(), remoteUserId);
+			if (statsPointer)
+			{
+				P2PLinkStats::SetLuaFieldsFrom(luaStatePointer, *statsPointer);
+			}
+		}
 	}
+	return 1;
 }
 
-//---------------------------------------------------------------------------------
-// Lua API Handlers
-//---------------------------------------------------------------------------------
-/** UserInfo eos.getAuthIdToken() */
-int OnGetAuthIdToken(lua_State* luaStatePointer)
+/** eos.p2p.setStatsOptions(options) */
+int OnP2PSetStatsOptions(lua_State* luaStatePointer)
 {
 	// Validate.
 	if (!luaStatePointer)
@@ -139,33 +1998,78 @@ int OnGetAuthIdToken(lua_State* luaStatePointer)
 		return 0;
 	}
 
+	// Fetch the required options table.
+	if (!lua_istable(luaStatePointer, 1))
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to a table.");
+		return 0;
+	}
+
 	// Fetch this plugin's runtime context associated with the calling Lua state.
 	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
 	if (!contextPointer)
 	{
 		return 0;
 	}
+	auto p2pManagerPointer = contextPointer->GetP2PManager();
+
+	// Update the intervals that were given, in milliseconds. Zero disables pinging or the "p2pStats" event.
+	// Both are validated before either is applied.
+	std::chrono::milliseconds pingInterval(0);
+	std::chrono::milliseconds eventInterval(0);
+	lua_getfield(luaStatePointer, 1, "pingInterval");
+	lua_getfield(luaStatePointer, 1, "eventInterval");
+	bool hasPingInterval = !lua_isnil(luaStatePointer, -2);
+	bool hasEventInterval = !lua_isnil(luaStatePointer, -1);
+	if (hasPingInterval && !FetchMilliseconds(luaStatePointer, -2, pingInterval))
+	{
+		CoronaLuaError(luaStatePointer, "The 'pingInterval' field must be a non-negative number of milliseconds.");
+		lua_pop(luaStatePointer, 2);
+		return 0;
+	}
+	if (hasEventInterval && !FetchMilliseconds(luaStatePointer, -1, eventInterval))
+	{
+		CoronaLuaError(luaStatePointer, "The 'eventInterval' field must be a non-negative number of milliseconds.");
+		lua_pop(luaStatePointer, 2);
+		return 0;
+	}
+	lua_pop(luaStatePointer, 2);
+	if (hasPingInterval)
+	{
+		p2pManagerPointer->GetLinkStats().SetPingInterval(pingInterval);
+	}
+	if (hasEventInterval)
+	{
+		p2pManagerPointer->SetStatsEventInterval(eventInterval);
+	}
+	return 0;
+}
 
-	EOS_Auth_CopyIdTokenOptions CopyTokenOptions = { 0 };
-	CopyTokenOptions.ApiVersion = EOS_AUTH_COPYUSERAUTHTOKEN_API_LATEST;
-	CopyTokenOptions.AccountId = contextPointer->fAccountId;
-
-	EOS_Auth_IdToken* outIdToken;
-	if (EOS_Auth_CopyIdToken(contextPointer->fAuthHandle, &CopyTokenOptions, &outIdToken) == EOS_EResult::EOS_Success)
+/** natType, isQuerying eos.p2p.getNATType() */
+int OnP2PGetNATType(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
 	{
-		lua_pushstring(luaStatePointer, outIdToken->JsonWebToken);
-		EOS_Auth_IdToken_Release(outIdToken);
-		return 1;
+		return 0;
 	}
-	else
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
 	{
-		CoronaLog("WARNING: [EOS SDK] User Auth Token is invalid");
 		return 0;
 	}
+
+	// Return the NAT type cached by the query made natively after login, along with whether it is still in progress.
+	auto& networkSettings = contextPointer->GetP2PManager()->GetNetworkSettings();
+	lua_pushstring(luaStatePointer, P2PNetworkSettings::GetNameOf(networkSettings.GetNATType()));
+	lua_pushboolean(luaStatePointer, networkSettings.IsQueryingNATType() ? 1 : 0);
+	return 2;
 }
 
-/** bool eos.setNotificationPosition(positionName) */
-int OnSetNotificationPosition(lua_State* luaStatePointer)
+/** bool eos.p2p.setTransport(name[, options]) */
+int OnP2PSetTransport(lua_State* luaStatePointer)
 {
 	// Validate.
 	if (!luaStatePointer)
@@ -173,78 +2077,262 @@ int OnSetNotificationPosition(lua_State* luaStatePointer)
 		return 0;
 	}
 
-	// Fetch the required position name argument.
+	// Fetch the required transport name.
 	if (lua_type(luaStatePointer, 1) != LUA_TSTRING)
 	{
-		CoronaLuaError(luaStatePointer, "Given argument is not of type string.");
+		CoronaLuaError(luaStatePointer, "1st argument must be set to a transport name string.");
 		lua_pushboolean(luaStatePointer, 0);
 		return 1;
 	}
-	const char* positionName = lua_tostring(luaStatePointer, 1);
-	if (!positionName)
+	auto transportName = lua_tostring(luaStatePointer, 1);
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
 	{
-		positionName = "";
+		return 0;
 	}
 
-	// Convert the position name to its equivalent Steam enum constant.
-	EOS_UI_ENotificationLocation positionId;
-	if (!strcmp(positionName, "topLeft"))
+	// Restore the default EOS transport if requested.
+	auto p2pManagerPointer = contextPointer->GetP2PManager();
+	if (!strcmp(transportName, "eos"))
 	{
-		positionId = EOS_UI_ENotificationLocation::EOS_UNL_TopLeft;
+		p2pManagerPointer->SetTransport(nullptr);
+		lua_pushboolean(luaStatePointer, 1);
+		return 1;
 	}
-	else if (!strcmp(positionName, "topRight"))
+	if (strcmp(transportName, "loopback"))
 	{
-		positionId = EOS_UI_ENotificationLocation::EOS_UNL_TopRight;
+		CoronaLuaError(luaStatePointer, "Unknown transport name '%s'.", transportName);
+		lua_pushboolean(luaStatePointer, 0);
+		return 1;
 	}
-	else if (!strcmp(positionName, "bottomLeft"))
+
+	// Create an in-process loopback transport with the given simulated network conditions.
+	// Latency and jitter are in milliseconds of simulated time, which advances 1/60th of a second per frame.
+	// Loss is a fraction from 0 to 1.
+	// Validate every option before creating the transport, since casting NaN or out of range numbers is undefined.
+	std::chrono::milliseconds latency(0);
+	std::chrono::milliseconds jitter(0);
+	double lossRate = 0;
+	double seed = 0;
+	bool hasSeed = false;
+	if (lua_istable(luaStatePointer, 2))
 	{
-		positionId = EOS_UI_ENotificationLocation::EOS_UNL_BottomLeft;
+		lua_getfield(luaStatePointer, 2, "latency");
+		bool isValid = lua_isnil(luaStatePointer, -1) || FetchMilliseconds(luaStatePointer, -1, latency);
+		lua_pop(luaStatePointer, 1);
+		if (!isValid)
+		{
+			CoronaLuaError(luaStatePointer, "The 'latency' field must be a non-negative number of milliseconds.");
+			lua_pushboolean(luaStatePointer, 0);
+			return 1;
+		}
+		lua_getfield(luaStatePointer, 2, "jitter");
+		isValid = lua_isnil(luaStatePointer, -1) || FetchMilliseconds(luaStatePointer, -1, jitter);
+		lua_pop(luaStatePointer, 1);
+		if (!isValid)
+		{
+			CoronaLuaError(luaStatePointer, "The 'jitter' field must be a non-negative number of milliseconds.");
+			lua_pushboolean(luaStatePointer, 0);
+			return 1;
+		}
+		lua_getfield(luaStatePointer, 2, "loss");
+		isValid = lua_isnil(luaStatePointer, -1);
+		if (lua_type(luaStatePointer, -1) == LUA_TNUMBER)
+		{
+			lossRate = lua_tonumber(luaStatePointer, -1);
+			isValid = (lossRate >= 0) && (lossRate <= 1);
+		}
+		lua_pop(luaStatePointer, 1);
+		if (!isValid)
+		{
+			CoronaLuaError(luaStatePointer, "The 'loss' field must be a number between 0 and 1.");
+			lua_pushboolean(luaStatePointer, 0);
+			return 1;
+		}
+		lua_getfield(luaStatePointer, 2, "seed");
+		isValid = lua_isnil(luaStatePointer, -1);
+		if (lua_type(luaStatePointer, -1) == LUA_TNUMBER)
+		{
+			seed = lua_tonumber(luaStatePointer, -1);
+			isValid = (seed >= 0) && (seed <= (double)UINT32_MAX) && (seed == std::floor(seed));
+			hasSeed = true;
+		}
+		lua_pop(luaStatePointer, 1);
+		if (!isValid)
+		{
+			CoronaLuaError(luaStatePointer, "The 'seed' field must be an integer between 0 and 4294967295.");
+			lua_pushboolean(luaStatePointer, 0);
+			return 1;
+		}
 	}
-	else if (!strcmp(positionName, "bottomRight"))
+	std::unique_ptr<LoopbackP2PTransport> transportPointer(new LoopbackP2PTransport());
+	transportPointer->SetLatency(latency);
+	transportPointer->SetJitter(jitter);
+	transportPointer->SetLossRate(lossRate);
+	if (hasSeed)
 	{
-		positionId = EOS_UI_ENotificationLocation::EOS_UNL_BottomRight;
+		transportPointer->SetSeed((uint32_t)seed);
+	}
+	p2pManagerPointer->SetTransport(std::move(transportPointer));
+	lua_pushboolean(luaStatePointer, 1);
+	return 1;
+}
+
+/** userHandle, productUserId eos.p2p.createLoopbackUser([productUserId]) */
+int OnP2PCreateLoopbackUser(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
+	}
+
+	// Simulated users can only exchange packets via the loopback transport.
+	if (!contextPointer->GetP2PManager()->GetTransport().IsSimulated())
+	{
+		CoronaLuaError(luaStatePointer, "The loopback transport must be set via eos.p2p.setTransport() first.");
+		lua_pushnil(luaStatePointer);
+		return 1;
+	}
+
+	// Fetch the optional product user ID to simulate.
+	// If not given, generate one in the same order on every run, keeping tests reproducible.
+	std::string productUserIdString;
+	if (lua_type(luaStatePointer, 1) == LUA_TSTRING)
+	{
+		productUserIdString = lua_tostring(luaStatePointer, 1);
 	}
 	else
 	{
-		CoronaLuaError(luaStatePointer, "Given unknown position name '%s'", positionName);
-		lua_pushboolean(luaStatePointer, 0);
+		productUserIdString = LoopbackP2PTransport::GenerateUserIdString();
+	}
+
+	// Create a new local user session that is never logged into EOS, which works without the EOS platform.
+	auto productUserId = contextPointer->GetIdCache()->GetProductUserIdFrom(productUserIdString.c_str());
+	auto sessionPointer = contextPointer->CreateSimulatedLocalUser(productUserId);
+	if (!sessionPointer)
+	{
+		CoronaLuaError(luaStatePointer, "Invalid product user ID '%s'.", productUserIdString.c_str());
+		lua_pushnil(luaStatePointer);
 		return 1;
 	}
+	lua_pushinteger(luaStatePointer, sessionPointer->GetUserHandle());
+	lua_pushstring(luaStatePointer, productUserIdString.c_str());
+	return 2;
+}
 
-	// Fetch the runtime context associated with the calling Lua state.
+/** eos.p2p.setInterest(peerId, interest) */
+int OnP2PSetInterest(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
 	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
 	if (!contextPointer)
 	{
 		return 0;
 	}
 
-	auto eosPlatformHandle = contextPointer->fPlatformHandle;
-	if (eosPlatformHandle)
+	// Fetch the required peer argument.
+	if (lua_type(luaStatePointer, 1) != LUA_TSTRING)
 	{
-		// Change EOS's notification position with given setting.
-		EOS_HUI ExternalUIHandle = EOS_Platform_GetUIInterface(eosPlatformHandle);
+		CoronaLuaError(luaStatePointer, "1st argument must be set to the peer's product user ID string.");
+		return 0;
+	}
+	auto remoteUserId = contextPointer->GetIdCache()->GetProductUserIdFrom(lua_tostring(luaStatePointer, 1));
+	if (!remoteUserId)
+	{
+		return 0;
+	}
 
-		EOS_UI_SetDisplayPreferenceOptions Options = {};
-		Options.ApiVersion = EOS_UI_SETDISPLAYPREFERENCE_API_LATEST;
-		Options.NotificationLocation = positionId;
+	// Stop tracking the peer if given nil, such as when it left the session.
+	auto& interestManager = contextPointer->GetP2PManager()->GetInterestManager();
+	if (!lua_istable(luaStatePointer, 2))
+	{
+		interestManager.RemovePeer(remoteUserId);
+		return 0;
+	}
 
-		const EOS_EResult Result = EOS_UI_SetDisplayPreference(ExternalUIHandle, &Options);
-		if (Result == EOS_EResult::EOS_Success)
-		{
-			lua_pushboolean(luaStatePointer, 1);
-			return 1;
-		}
-		else
-		{
-			lua_pushboolean(luaStatePointer, 0);
-			return 1;
-		}
+	// Fetch the peer's topic subscriptions, given as a string or an array of strings.
+	// Validated before anything is replaced so that an invalid argument leaves the peer's interest unchanged.
+	std::vector<std::string> topics;
+	lua_getfield(luaStatePointer, 2, "topics");
+	if (!lua_isnil(luaStatePointer, -1) && !FetchStringArray(luaStatePointer, lua_gettop(luaStatePointer), topics))
+	{
+		CoronaLuaError(luaStatePointer, "The 'topics' field must be set to a string or an array of strings.");
+		lua_pop(luaStatePointer, 1);
+		return 0;
+	}
+	lua_pop(luaStatePointer, 1);
+
+	// Replace the peer's area of interest. The area is removed if no position and radius are given.
+	lua_getfield(luaStatePointer, 2, "x");
+	lua_getfield(luaStatePointer, 2, "y");
+	lua_getfield(luaStatePointer, 2, "radius");
+	bool hasArea =
+			(lua_type(luaStatePointer, -3) == LUA_TNUMBER) && (lua_type(luaStatePointer, -2) == LUA_TNUMBER) &&
+			(lua_type(luaStatePointer, -1) == LUA_TNUMBER);
+	if (hasArea)
+	{
+		interestManager.SetArea(
+				remoteUserId, lua_tonumber(luaStatePointer, -3), lua_tonumber(luaStatePointer, -2),
+				lua_tonumber(luaStatePointer, -1));
 	}
 	else
 	{
-		lua_pushboolean(luaStatePointer, 0);
-		return 1;
+		interestManager.SetArea(remoteUserId, 0, 0, -1);
+	}
+	lua_pop(luaStatePointer, 3);
+
+	// Replace the peer's topic subscriptions.
+	interestManager.SetTopics(remoteUserId, topics);
+	return 0;
+}
+
+/** eos.p2p.setInterestOptions(options) */
+int OnP2PSetInterestOptions(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch the required options table.
+	if (!lua_istable(luaStatePointer, 1))
+	{
+		CoronaLuaError(luaStatePointer, "1st argument must be set to a table.");
+		return 0;
+	}
+
+	// Fetch this plugin's runtime context associated with the calling Lua state.
+	auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (!contextPointer)
+	{
+		return 0;
 	}
+
+	// Update the grid's cell size, in world units, if given.
+	lua_getfield(luaStatePointer, 1, "cellSize");
+	if (lua_type(luaStatePointer, -1) == LUA_TNUMBER)
+	{
+		contextPointer->GetP2PManager()->GetInterestManager().SetCellSize(lua_tonumber(luaStatePointer, -1));
+	}
+	lua_pop(luaStatePointer, 1);
+	return 0;
 }
 
 /** eos.addEventListener(eventName, listener) */
@@ -366,18 +2454,43 @@ int OnAccessingField(lua_State* luaStatePointer)
 			return 0;
 		}
 
-		if (!contextPointer->fAccountId)
+		// Determine if the default local user is logged into the Auth interface.
+		auto sessionPointer = contextPointer->GetDefaultLocalUser();
+		bool isLoggedOn =
+				contextPointer->fPlatformHandle && sessionPointer &&
+				(sessionPointer->GetAuthLoginStatus() == EOS_ELoginStatus::EOS_LS_LoggedIn);
+		lua_pushboolean(luaStatePointer, isLoggedOn ? 1 : 0);
+		resultCount = 1;
+	}
+	else if (!strcmp(fieldName, "loginStatus"))
+	{
+		// Fetch the runtime context associated with the calling Lua state.
+		auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+		if (!contextPointer)
 		{
-			lua_pushboolean(luaStatePointer, 0);
-			return 1;
+			return 0;
 		}
 
-		if (!contextPointer->fPlatformHandle) {
-			lua_pushboolean(luaStatePointer, 0);
-			return 1;
+		// Push the default local user's login state, such as "loggedIn".
+		// Changes are also dispatched as a "loginStatus" event, which is preferable to polling this field.
+		auto sessionPointer = contextPointer->GetDefaultLocalUser();
+		auto loginState = sessionPointer ? sessionPointer->GetLoginState() : LocalUserSession::LoginState::kNotLoggedIn;
+		lua_pushstring(luaStatePointer, LocalUserSession::GetLoginStateName(loginState));
+		resultCount = 1;
+	}
+	else if (!strcmp(fieldName, "productUserId"))
+	{
+		// Fetch the runtime context associated with the calling Lua state.
+		auto contextPointer = (RuntimeContext*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+		if (!contextPointer)
+		{
+			return 0;
 		}
 
-		lua_pushboolean(luaStatePointer, 1);
+		// Push the default local user's product user ID or nil if not logged into Connect.
+		auto sessionPointer = contextPointer->GetDefaultLocalUser();
+		auto productUserId = sessionPointer ? sessionPointer->GetProductUserId() : nullptr;
+		contextPointer->GetIdCache()->PushProductUserIdTo(luaStatePointer, productUserId);
 		resultCount = 1;
 	}
 	else
@@ -461,7 +2574,23 @@ CORONA_EXPORT int luaopen_plugin_eos(lua_State* luaStatePointer)
 	{
 		const struct luaL_Reg luaFunctions[] =
 		{
+			{ "login", OnLogin },
+			{ "logout", OnLogout },
+			{ "getLocalUsers", OnGetLocalUsers },
 			{ "getAuthIdToken", OnGetAuthIdToken },
+			{ "getAuthIdTokenClaims", OnGetAuthIdTokenClaims },
+			{ "connectLogin", OnConnectLogin },
+			{ "loadProducts", OnLoadProducts },
+			{ "prepareStore", OnPrepareStore },
+			{ "purchase", OnPurchaseProduct },
+			{ "restore", OnRestorePurchases },
+			{ "finishTransaction", OnFinishTransaction },
+			{ "queryOwnership", OnQueryOwnership },
+			{ "queryEntitlements", OnQueryEntitlements },
+			{ "isEntitled", OnIsEntitled },
+			{ "queryOwnershipToken", OnQueryOwnershipToken },
+			{ "queryEntitlementToken", OnQueryEntitlementToken },
+			{ "verifyToken", OnVerifyToken },
 			{ "setNotificationPosition", OnSetNotificationPosition },
 			{ "addEventListener", OnAddEventListener },
 			{ "removeEventListener", OnRemoveEventListener },
@@ -472,6 +2601,40 @@ CORONA_EXPORT int luaopen_plugin_eos(lua_State* luaStatePointer)
 		luaL_openlib(luaStatePointer, nullptr, luaFunctions, 1);
 	}
 
+	// Add the "p2p" table of functions to the plugin's Lua table.
+	{
+		const struct luaL_Reg luaFunctions[] =
+		{
+			{ "sendPacket", OnP2PSendPacket },
+			{ "broadcast", OnP2PBroadcast },
+			{ "receivePacket", OnP2PReceivePacket },
+			{ "sendLargeMessage", OnP2PSendLargeMessage },
+			{ "queueMessage", OnP2PQueueMessage },
+			{ "flush", OnP2PFlush },
+			{ "encode", OnP2PEncode },
+			{ "decode", OnP2PDecode },
+			{ "setAutoReceive", OnP2PSetAutoReceive },
+			{ "registerSnapshotSchema", OnP2PRegisterSnapshotSchema },
+			{ "sendSnapshot", OnP2PSendSnapshot },
+			{ "acceptConnection", OnP2PAcceptConnection },
+			{ "closeConnection", OnP2PCloseConnection },
+			{ "getConnectionState", OnP2PGetConnectionState },
+			{ "setAutoAccept", OnP2PSetAutoAccept },
+			{ "getStats", OnP2PGetStats },
+			{ "setStatsOptions", OnP2PSetStatsOptions },
+			{ "getNATType", OnP2PGetNATType },
+			{ "setTransport", OnP2PSetTransport },
+			{ "createLoopbackUser", OnP2PCreateLoopbackUser },
+			{ "setInterest", OnP2PSetInterest },
+			{ "setInterestOptions", OnP2PSetInterestOptions },
+			{ nullptr, nullptr }
+		};
+		lua_createtable(luaStatePointer, 0, 0);
+		lua_pushlightuserdata(luaStatePointer, contextPointer);
+		luaL_openlib(luaStatePointer, nullptr, luaFunctions, 1);
+		lua_setfield(luaStatePointer, -2, "p2p");
+	}
+
 	// Add a Lua finalizer to the plugin's Lua table and to the Lua registry.
 	// Note: Lua 5.1 tables do not support the "__gc" metatable field, but Lua light-userdata types do.
 	{
@@ -513,6 +2676,69 @@ CORONA_EXPORT int luaopen_plugin_eos(lua_State* luaStatePointer)
 	// Fetch the EOS properties from the "config.lua" file.
 	PluginConfigLuaSettings configLuaSettings;
 	configLuaSettings.LoadFrom(luaStatePointer);
+	contextPointer->GetEcomStore()->SetCatalogTimeToLive(
+			std::chrono::seconds(configLuaSettings.GetEcomCatalogTimeToLiveInSeconds()));
+	contextPointer->GetEcomStore()->SetRedeemInterval(
+			std::chrono::seconds(configLuaSettings.GetEcomRedeemIntervalInSeconds()));
+	contextPointer->GetEcomStore()->SetRedeemBatchSize((uint32_t)configLuaSettings.GetEcomRedeemBatchSize());
+	contextPointer->GetEcomStore()->SetTokenPublicKeys(configLuaSettings.GetEcomTokenPublicKeys());
+	contextPointer->GetEcomStore()->SetTokenIssuer(configLuaSettings.GetStringEcomTokenIssuer());
+	contextPointer->GetEcomStore()->GetImageCache().SetMaxByteCount(
+			(uint64_t)configLuaSettings.GetEcomImageCacheSizeInMegabytes() * 1024 * 1024);
+
+	// Configure the P2P packet queues, applied once the EOS platform has been created.
+	{
+		auto& queueManager = contextPointer->GetP2PManager()->GetQueueManager();
+		auto incomingKilobytes = configLuaSettings.GetP2PIncomingQueueSizeInKilobytes();
+		auto outgoingKilobytes = configLuaSettings.GetP2POutgoingQueueSizeInKilobytes();
+		queueManager.SetQueueSizes(
+				(incomingKilobytes >= 0) ? (int64_t)incomingKilobytes * 1024 : -1,
+				(outgoingKilobytes >= 0) ? (int64_t)outgoingKilobytes * 1024 : -1);
+		P2PQueueManager::OverflowPolicy overflowPolicy;
+		auto overflowPolicyName = configLuaSettings.GetStringP2PQueueOverflowPolicy();
+		if (P2PQueueManager::GetOverflowPolicyBy(overflowPolicyName, overflowPolicy))
+		{
+			queueManager.SetOverflowPolicy(overflowPolicy);
+		}
+		else if (overflowPolicyName[0])
+		{
+			CoronaLog("WARNING: [EOS SDK] Ignoring unknown p2pQueueOverflowPolicy '%s'", overflowPolicyName);
+		}
+		queueManager.SetUnreliableChannels(configLuaSettings.GetP2PUnreliableChannels());
+		queueManager.SetChannelPriorities(configLuaSettings.GetP2PChannelPriorities());
+	}
+
+	// Configure P2P relay and port settings, also applied once the EOS platform has been created.
+	{
+		auto& networkSettings = contextPointer->GetP2PManager()->GetNetworkSettings();
+		EOS_ERelayControl relayControl;
+		auto relayControlName = configLuaSettings.GetStringP2PRelayControl();
+		if (P2PNetworkSettings::GetRelayControlBy(relayControlName, relayControl))
+		{
+			networkSettings.SetRelayControl(relayControl);
+		}
+		else if (relayControlName[0])
+		{
+			CoronaLog("WARNING: [EOS SDK] Ignoring unknown p2pRelayControl '%s'", relayControlName);
+		}
+		if (configLuaSettings.GetP2PPort() >= 0)
+		{
+			networkSettings.SetPortRange(
+					(uint16_t)configLuaSettings.GetP2PPort(), configLuaSettings.GetP2PMaxAdditionalPorts());
+		}
+	}
+
+	// Load the store catalog persisted by the last app session, allowing storefronts to be shown right away.
+	contextPointer->GetEcomStore()->SetCatalogFilePath(
+			FetchSystemDirectoryFilePath(luaStatePointer, "eosStoreCatalog.bin", "CachesDirectory"));
+
+	// Load the index of the offer images downloaded by previous app sessions. The images are stored next to it.
+	contextPointer->GetEcomStore()->GetImageCache().SetIndexFilePath(
+			FetchSystemDirectoryFilePath(luaStatePointer, "eosImageCache.index", "CachesDirectory"), "CachesDirectory");
+
+	// Load the store's unfinished transactions. Kept in the documents directory since the OS may purge caches.
+	contextPointer->GetEcomStore()->SetTransactionJournalFilePath(
+			FetchSystemDirectoryFilePath(luaStatePointer, "eosStoreTransactions.journal", "DocumentsDirectory"));
 
 	// Initialize our connection with EOS if this is the first plugin instance.
 	// Note: This avoid initializing twice in case multiple plugin instances exist at the same time.
@@ -609,21 +2835,17 @@ CORONA_EXPORT int luaopen_plugin_eos(lua_State* luaStatePointer)
 			std::string launcherAuthPassword = launcherAuthPasswordLaunchArg->second;
 			if (!launcherAuthPassword.empty())
 			{
-				contextPointer->fAuthHandle = EOS_Platform_GetAuthInterface(contextPointer->fPlatformHandle);
-
 				EOS_Auth_Credentials Credentials = {};
 				Credentials.ApiVersion = EOS_AUTH_CREDENTIALS_API_LATEST;
-
-				EOS_Auth_LoginOptions LoginOptions;
-				memset(&LoginOptions, 0, sizeof(LoginOptions));
-				LoginOptions.ApiVersion = EOS_AUTH_LOGIN_API_LATEST;
-				LoginOptions.ScopeFlags |= EOS_EAuthScopeFlags::EOS_AS_NoFlags;
-
 				Credentials.Type = EOS_ELoginCredentialType::EOS_LCT_ExchangeCode;
 				Credentials.Token = launcherAuthPassword.c_str();
-				LoginOptions.Credentials = &Credentials;
 
-				EOS_Auth_Login(contextPointer->fAuthHandle, &LoginOptions, contextPointer, onLoginCallback);
+				// The launcher's account becomes the default local user.
+				auto sessionPointer = contextPointer->CreateLocalUser();
+				if (sessionPointer && !sessionPointer->Login(Credentials, EOS_EAuthScopeFlags::EOS_AS_NoFlags))
+				{
+					contextPointer->RemoveLocalUser(sessionPointer->GetUserHandle());
+				}
 			}
 		}
 	}
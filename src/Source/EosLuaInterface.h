@@ -0,0 +1,64 @@
+// ----------------------------------------------------------------------------
+//
+// EosLuaInterface.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+
+// Forward declarations.
+extern "C"
+{
+	struct lua_State;
+}
+
+
+// Lua API handlers shared between the plugin's Lua table and platform specific bindings, such as Android's JNI.
+// All of them expect this plugin's RuntimeContext pointer as their 1st Lua upvalue.
+
+int OnLogin(lua_State* luaStatePointer);
+int OnLogout(lua_State* luaStatePointer);
+int OnGetLocalUsers(lua_State* luaStatePointer);
+int OnGetAuthIdToken(lua_State* luaStatePointer);
+int OnGetAuthIdTokenClaims(lua_State* luaStatePointer);
+int OnConnectLogin(lua_State* luaStatePointer);
+int OnLoadProducts(lua_State* luaStatePointer);
+int OnPrepareStore(lua_State* luaStatePointer);
+int OnPurchaseProduct(lua_State* luaStatePointer);
+int OnRestorePurchases(lua_State* luaStatePointer);
+int OnFinishTransaction(lua_State* luaStatePointer);
+int OnQueryOwnership(lua_State* luaStatePointer);
+int OnQueryEntitlements(lua_State* luaStatePointer);
+int OnIsEntitled(lua_State* luaStatePointer);
+int OnQueryOwnershipToken(lua_State* luaStatePointer);
+int OnQueryEntitlementToken(lua_State* luaStatePointer);
+int OnVerifyToken(lua_State* luaStatePointer);
+int OnSetNotificationPosition(lua_State* luaStatePointer);
+int OnP2PSendPacket(lua_State* luaStatePointer);
+int OnP2PBroadcast(lua_State* luaStatePointer);
+int OnP2PReceivePacket(lua_State* luaStatePointer);
+int OnP2PSendLargeMessage(lua_State* luaStatePointer);
+int OnP2PQueueMessage(lua_State* luaStatePointer);
+int OnP2PFlush(lua_State* luaStatePointer);
+int OnP2PEncode(lua_State* luaStatePointer);
+int OnP2PDecode(lua_State* luaStatePointer);
+int OnP2PSetAutoReceive(lua_State* luaStatePointer);
+int OnP2PRegisterSnapshotSchema(lua_State* luaStatePointer);
+int OnP2PSendSnapshot(lua_State* luaStatePointer);
+int OnP2PAcceptConnection(lua_State* luaStatePointer);
+int OnP2PCloseConnection(lua_State* luaStatePointer);
+int OnP2PGetConnectionState(lua_State* luaStatePointer);
+int OnP2PSetAutoAccept(lua_State* luaStatePointer);
+int OnP2PGetStats(lua_State* luaStatePointer);
+int OnP2PSetStatsOptions(lua_State* luaStatePointer);
+int OnP2PGetNATType(lua_State* luaStatePointer);
+int OnP2PSetTransport(lua_State* luaStatePointer);
+int OnP2PCreateLoopbackUser(lua_State* luaStatePointer);
+int OnP2PSetInterest(lua_State* luaStatePointer);
+int OnP2PSetInterestOptions(lua_State* luaStatePointer);
+int OnAddEventListener(lua_State* luaStatePointer);
+int OnRemoveEventListener(lua_State* luaStatePointer);
@@ -0,0 +1,97 @@
+// ----------------------------------------------------------------------------
+//
+// EosP2PTransport.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "EosP2PTransport.h"
+#include "RuntimeContext.h"
+#include "eos_p2p.h"
+
+
+//---------------------------------------------------------------------------------
+// EosP2PTransport Class Members
+//---------------------------------------------------------------------------------
+
+EosP2PTransport::EosP2PTransport(RuntimeContext& context)
+:	fContext(context)
+{
+}
+
+EosP2PTransport::~EosP2PTransport()
+{
+}
+
+bool EosP2PTransport::IsAvailable() const
+{
+	return (GetP2PHandle() != nullptr);
+}
+
+bool EosP2PTransport::IsSimulated() const
+{
+	return false;
+}
+
+void EosP2PTransport::Update()
+{
+}
+
+bool EosP2PTransport::Send(
+	EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const EOS_P2P_SocketId& socketId,
+	uint8_t channel, EOS_EPacketReliability reliability, const void* data, uint32_t byteCount)
+{
+	// Validate.
+	auto p2pHandle = GetP2PHandle();
+	if (!p2pHandle)
+	{
+		return false;
+	}
+
+	// Send the packet. EOS copies its bytes, so the caller can re-use them immediately.
+	EOS_P2P_SendPacketOptions options = {};
+	options.ApiVersion = EOS_P2P_SENDPACKET_API_LATEST;
+	options.LocalUserId = localUserId;
+	options.RemoteUserId = remoteUserId;
+	options.SocketId = &socketId;
+	options.Channel = channel;
+	options.DataLengthBytes = byteCount;
+	options.Data = data;
+	options.bAllowDelayedDelivery = EOS_TRUE;
+	options.Reliability = reliability;
+	options.bDisableAutoAcceptConnection = EOS_FALSE;
+	return (EOS_P2P_SendPacket(p2pHandle, &options) == EOS_EResult::EOS_Success);
+}
+
+bool EosP2PTransport::Receive(
+	EOS_ProductUserId localUserId, const uint8_t* channelPointer, void* data, uint32_t maxByteCount,
+	EOS_ProductUserId& remoteUserId, EOS_P2P_SocketId& socketId, uint8_t& channel, uint32_t& byteCount)
+{
+	// Validate.
+	auto p2pHandle = GetP2PHandle();
+	if (!p2pHandle)
+	{
+		return false;
+	}
+
+	// Receive the next packet.
+	EOS_P2P_ReceivePacketOptions options = {};
+	options.ApiVersion = EOS_P2P_RECEIVEPACKET_API_LATEST;
+	options.LocalUserId = localUserId;
+	options.MaxDataSizeBytes = maxByteCount;
+	options.RequestedChannel = channelPointer;
+	byteCount = 0;
+	auto result = EOS_P2P_ReceivePacket(p2pHandle, &options, &remoteUserId, &socketId, &channel, data, &byteCount);
+	return (result == EOS_EResult::EOS_Success);
+}
+
+EOS_HP2P EosP2PTransport::GetP2PHandle() const
+{
+	if (!fContext.fPlatformHandle)
+	{
+		return nullptr;
+	}
+	return EOS_Platform_GetP2PInterface(fContext.fPlatformHandle);
+}
@@ -0,0 +1,56 @@
+// ----------------------------------------------------------------------------
+//
+// EosP2PTransport.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "P2PTransport.h"
+
+
+// Forward declarations.
+class RuntimeContext;
+
+
+/** Sends and receives packets via the EOS P2P interface. This is the default transport. */
+class EosP2PTransport : public P2PTransport
+{
+	public:
+		/**
+		  Creates a new EOS transport.
+		  @param context The runtime context providing the EOS platform.
+		 */
+		EosP2PTransport(RuntimeContext& context);
+
+		/** Destroys this transport. */
+		virtual ~EosP2PTransport();
+
+		/** Determines if the EOS platform has been created. */
+		virtual bool IsAvailable() const override;
+
+		/** Always returns false. */
+		virtual bool IsSimulated() const override;
+
+		/** Does nothing, since EOS delivers packets in real time. */
+		virtual void Update() override;
+
+		virtual bool Send(
+				EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const EOS_P2P_SocketId& socketId,
+				uint8_t channel, EOS_EPacketReliability reliability, const void* data, uint32_t byteCount) override;
+
+		virtual bool Receive(
+				EOS_ProductUserId localUserId, const uint8_t* channelPointer, void* data, uint32_t maxByteCount,
+				EOS_ProductUserId& remoteUserId, EOS_P2P_SocketId& socketId, uint8_t& channel,
+				uint32_t& byteCount) override;
+
+	private:
+		/** Fetches the EOS P2P interface. Returns null if the EOS platform has not been created. */
+		EOS_HP2P GetP2PHandle() const;
+
+		/** The runtime context providing the EOS platform. */
+		RuntimeContext& fContext;
+};
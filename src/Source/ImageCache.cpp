@@ -0,0 +1,601 @@
+// ----------------------------------------------------------------------------
+//
+// ImageCache.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "ImageCache.h"
+#include "CoronaLua.h"
+#include "DispatchEventTask.h"
+#include "RsaPublicKey.h"
+#include "RuntimeContext.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <memory>
+
+
+//---------------------------------------------------------------------------------
+// Private Constants and Static Variables
+//---------------------------------------------------------------------------------
+
+/** Stores a collection of all ImageCache instances that currently exist. Used to validate download listeners. */
+static std::unordered_set<ImageCache*> sImageCacheCollection;
+
+/** Default max number of bytes the cached images may occupy on disk. */
+static const uint64_t kDefaultMaxByteCount = 32 * 1024 * 1024;
+
+/** Max number of images downloaded at the same time. */
+static const int kMaxConcurrentDownloadCount = 4;
+
+/** Amount of time to wait before downloading an image that failed to download again. */
+static const std::chrono::seconds kRetryDelay(60);
+
+/** Prefix of all files written to the cache directory, making them easy to identify. */
+static const char kFileNamePrefix[] = "eosImage_";
+
+/** First line of the index file, identifying its format and version. Files with any other header are ignored. */
+static const char kIndexFileHeader[] = "EIMG 1";
+
+
+//---------------------------------------------------------------------------------
+// Private Static Functions
+//---------------------------------------------------------------------------------
+
+/**
+  Computes the lowercase hexadecimal SHA-256 digest of the given bytes.
+  @param data The bytes to hash.
+  @param length Number of bytes to hash.
+  @param digitCount Number of hex digits to return, up to 64.
+ */
+static std::string ComputeSha256HexString(const void* data, size_t length, size_t digitCount)
+{
+	static const char kHexDigits[] = "0123456789abcdef";
+	uint8_t digest[32];
+	RsaPublicKey::ComputeSha256(data, length, digest);
+	std::string hexString;
+	for (size_t index = 0; (index < sizeof(digest)) && (hexString.length() < digitCount); index++)
+	{
+		hexString += kHexDigits[digest[index] >> 4];
+		hexString += kHexDigits[digest[index] & 0xF];
+	}
+	hexString.resize(std::min(hexString.length(), digitCount));
+	return hexString;
+}
+
+/**
+  Fetches the file extension of the given URL's path, such as ".png", so that the cached file keeps it.
+  @param url The image's URL.
+  @return Returns the lowercase extension including the dot. Returns an empty string if the path has none.
+ */
+static std::string GetFileExtensionFrom(const std::string& url)
+{
+	auto pathEndIndex = url.find_first_of("?#");
+	if (pathEndIndex == std::string::npos)
+	{
+		pathEndIndex = url.length();
+	}
+	std::string extension;
+	for (auto index = pathEndIndex; index > 0; index--)
+	{
+		char character = url[index - 1];
+		if (character == '.')
+		{
+			if (!extension.empty())
+			{
+				return "." + extension;
+			}
+			break;
+		}
+		if (!isalnum((unsigned char)character) || (extension.length() >= 5))
+		{
+			break;
+		}
+		extension.insert(extension.begin(), (char)tolower((unsigned char)character));
+	}
+	return std::string();
+}
+
+/**
+  Fetches the size of the given file.
+  @param filePath Path of the file.
+  @param byteCount Assigned the file's size in bytes.
+  @return Returns true if the file exists. Returns false if it could not be opened.
+ */
+static bool FetchFileByteCount(const std::string& filePath, uint64_t& byteCount)
+{
+	auto filePointer = fopen(filePath.c_str(), "rb");
+	if (!filePointer)
+	{
+		return false;
+	}
+	fseek(filePointer, 0, SEEK_END);
+	long position = ftell(filePointer);
+	fclose(filePointer);
+	byteCount = (position > 0) ? (uint64_t)position : 0;
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------
+// ImageCache Class Members
+//---------------------------------------------------------------------------------
+
+ImageCache::ImageCache(RuntimeContext& context)
+:	fContext(context),
+	fMaxByteCount(kDefaultMaxByteCount),
+	fByteCount(0),
+	fDownloadCount(0),
+	fIsIndexDirty(false)
+{
+	sImageCacheCollection.insert(this);
+}
+
+ImageCache::~ImageCache()
+{
+	// Remove this cache from the global collection, causing its in-flight download listeners to be ignored.
+	sImageCacheCollection.erase(this);
+
+	// Save the recently used order of this session's images.
+	if (fIsIndexDirty)
+	{
+		SaveIndex();
+	}
+}
+
+void ImageCache::SetIndexFilePath(const std::string& indexFilePath, const char* luaDirectoryName)
+{
+	// Save the last index before switching to the new one.
+	if (fIsIndexDirty)
+	{
+		SaveIndex();
+		fIsIndexDirty = false;
+	}
+	fRecentUrls.clear();
+	fEntries.clear();
+	fFiles.clear();
+	fByteCount = 0;
+
+	// Images are stored next to the index file.
+	auto separatorIndex = indexFilePath.find_last_of("/\\");
+	if ((separatorIndex == std::string::npos) || !luaDirectoryName)
+	{
+		fIndexFilePath.clear();
+		fDirectoryPath.clear();
+		fLuaDirectoryName.clear();
+		return;
+	}
+	fIndexFilePath = indexFilePath;
+	fDirectoryPath = indexFilePath.substr(0, separatorIndex + 1);
+	fLuaDirectoryName = luaDirectoryName;
+
+	// Load the images cached by the last app session.
+	LoadIndex();
+	EvictEntries();
+}
+
+const std::string& ImageCache::GetLuaDirectoryName() const
+{
+	return fLuaDirectoryName;
+}
+
+uint64_t ImageCache::GetMaxByteCount() const
+{
+	return fMaxByteCount;
+}
+
+void ImageCache::SetMaxByteCount(uint64_t value)
+{
+	fMaxByteCount = value;
+	EvictEntries();
+}
+
+std::string ImageCache::GetFileNameBy(const std::string& url)
+{
+	auto iter = fEntries.find(url);
+	if (iter == fEntries.end())
+	{
+		return std::string();
+	}
+	if (iter->second.RecentUrlIterator != fRecentUrls.begin())
+	{
+		fRecentUrls.splice(fRecentUrls.begin(), fRecentUrls, iter->second.RecentUrlIterator);
+		fIsIndexDirty = true;
+	}
+	return iter->second.FileName;
+}
+
+void ImageCache::Prefetch(const std::string& url)
+{
+	// Validate.
+	if (url.empty() || fIndexFilePath.empty() || (fMaxByteCount == 0))
+	{
+		return;
+	}
+
+	// Do not queue images that are cached, already queued, or that recently failed to download.
+	if ((fEntries.find(url) != fEntries.end()) || (fFetchingUrls.find(url) != fFetchingUrls.end()))
+	{
+		return;
+	}
+	auto retryIter = fRetryTimes.find(url);
+	if (retryIter != fRetryTimes.end())
+	{
+		if (std::chrono::steady_clock::now() < retryIter->second)
+		{
+			return;
+		}
+		fRetryTimes.erase(retryIter);
+	}
+
+	// Queue the download. It is started by the next Update() once a download slot is free.
+	fQueuedUrls.push_back(url);
+	fFetchingUrls.insert(url);
+}
+
+void ImageCache::Update()
+{
+	// Start queued downloads, limiting how many are in flight to avoid starving the game's own requests.
+	while ((fDownloadCount < kMaxConcurrentDownloadCount) && !fQueuedUrls.empty())
+	{
+		auto url = fQueuedUrls.front();
+		fQueuedUrls.pop_front();
+		if (StartDownload(url))
+		{
+			fDownloadCount++;
+		}
+		else
+		{
+			fFetchingUrls.erase(url);
+			fRetryTimes[url] = std::chrono::steady_clock::now() + kRetryDelay;
+			fFetchResults.push_back(FetchResult{ url, std::string() });
+		}
+	}
+
+	// Save the index if images were added, evicted, or used.
+	if (fIsIndexDirty)
+	{
+		SaveIndex();
+		fIsIndexDirty = false;
+	}
+
+	// Dispatch the downloads that finished since the last frame to Lua in 1 event.
+	if (!fFetchResults.empty())
+	{
+		auto taskPointer = std::make_shared<DispatchProductImagesEventTask>();
+		taskPointer->AcquireEventDataFrom(std::move(fFetchResults), fLuaDirectoryName);
+		fContext.QueueDispatchEventTask(taskPointer);
+		fFetchResults.clear();
+	}
+}
+
+
+bool ImageCache::StartDownload(const std::string& url)
+{
+	auto luaStatePointer = fContext.GetMainLuaState();
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+
+	// Download to a temporary file named after the URL. It is renamed after its content once downloaded.
+	std::string downloadFileName(kFileNamePrefix);
+	downloadFileName += ComputeSha256HexString(url.c_str(), url.length(), 16);
+	downloadFileName += ".download";
+
+	// Call network.download(url, "GET", listener, params, fileName, baseDirectory).
+	bool wasStarted = false;
+	lua_getglobal(luaStatePointer, "network");
+	if (lua_istable(luaStatePointer, -1))
+	{
+		lua_getfield(luaStatePointer, -1, "download");
+		if (lua_isfunction(luaStatePointer, -1))
+		{
+			lua_pushlstring(luaStatePointer, url.c_str(), url.length());
+			lua_pushstring(luaStatePointer, "GET");
+			lua_pushlightuserdata(luaStatePointer, this);
+			lua_pushlstring(luaStatePointer, url.c_str(), url.length());
+			lua_pushlstring(luaStatePointer, downloadFileName.c_str(), downloadFileName.length());
+			lua_pushcclosure(luaStatePointer, OnNetworkDownloadEvent, 3);
+			lua_newtable(luaStatePointer);
+			lua_pushlstring(luaStatePointer, downloadFileName.c_str(), downloadFileName.length());
+			lua_getglobal(luaStatePointer, "system");
+			if (lua_istable(luaStatePointer, -1))
+			{
+				lua_getfield(luaStatePointer, -1, fLuaDirectoryName.c_str());
+				lua_remove(luaStatePointer, -2);
+			}
+			int callResultCode = CoronaLuaDoCall(luaStatePointer, 6, 0);
+			wasStarted = (callResultCode == 0);
+		}
+		else
+		{
+			lua_pop(luaStatePointer, 1);
+		}
+	}
+	lua_pop(luaStatePointer, 1);
+	return wasStarted;
+}
+
+void ImageCache::OnDownloadEnded(const std::string& url, const std::string& downloadFileName, bool wasSuccessful)
+{
+	// Free up the download slot.
+	fFetchingUrls.erase(url);
+	if (fDownloadCount > 0)
+	{
+		fDownloadCount--;
+	}
+
+	// Read the downloaded file, if any.
+	auto downloadFilePath = GetFilePathFor(downloadFileName);
+	std::string content;
+	if (wasSuccessful)
+	{
+		wasSuccessful = false;
+		auto filePointer = fopen(downloadFilePath.c_str(), "rb");
+		if (filePointer)
+		{
+			char readBuffer[4096];
+			size_t readCount;
+			while ((readCount = fread(readBuffer, 1, sizeof(readBuffer), filePointer)) > 0)
+			{
+				content.append(readBuffer, readCount);
+			}
+			fclose(filePointer);
+			wasSuccessful = !content.empty();
+		}
+	}
+
+	// Name the file after its content so that URLs serving the same image share a file.
+	// Note: On Windows, rename() cannot replace an existing file, which is why it is removed first.
+	std::string fileName;
+	if (wasSuccessful)
+	{
+		fileName = kFileNamePrefix;
+		fileName += ComputeSha256HexString(content.data(), content.length(), 64);
+		fileName += GetFileExtensionFrom(url);
+		if (fFiles.find(fileName) == fFiles.end())
+		{
+			auto filePath = GetFilePathFor(fileName);
+			remove(filePath.c_str());
+			wasSuccessful = (rename(downloadFilePath.c_str(), filePath.c_str()) == 0);
+		}
+	}
+	remove(downloadFilePath.c_str());
+
+	// Add the image to the cache, or delay retrying it if it failed.
+	if (wasSuccessful)
+	{
+		AddEntry(url, fileName, (uint64_t)content.length());
+		EvictEntries();
+		if (fEntries.find(url) == fEntries.end())
+		{
+			fileName.clear();
+		}
+	}
+	else
+	{
+		fileName.clear();
+		fRetryTimes[url] = std::chrono::steady_clock::now() + kRetryDelay;
+	}
+	fFetchResults.push_back(FetchResult{ url, fileName });
+}
+
+void ImageCache::AddEntry(const std::string& url, const std::string& fileName, uint64_t byteCount)
+{
+	if (fEntries.find(url) != fEntries.end())
+	{
+		return;
+	}
+	auto fileIter = fFiles.find(fileName);
+	if (fileIter == fFiles.end())
+	{
+		fileIter = fFiles.emplace(fileName, CachedFile{ byteCount, 0 }).first;
+		fByteCount += byteCount;
+	}
+	fileIter->second.ReferenceCount++;
+	fRecentUrls.push_front(url);
+	fEntries[url] = Entry{ fileName, fRecentUrls.begin() };
+	fIsIndexDirty = true;
+}
+
+void ImageCache::EvictEntries()
+{
+	// Note: The most recently used image is never evicted, even if it alone exceeds the max size,
+	//       unless caching is disabled altogether.
+	size_t minEntryCount = (fMaxByteCount > 0) ? 1 : 0;
+	while ((fByteCount > fMaxByteCount) && (fRecentUrls.size() > minEntryCount))
+	{
+		auto entryIter = fEntries.find(fRecentUrls.back());
+		fRecentUrls.pop_back();
+		if (entryIter == fEntries.end())
+		{
+			continue;
+		}
+		auto fileIter = fFiles.find(entryIter->second.FileName);
+		if ((fileIter != fFiles.end()) && (--fileIter->second.ReferenceCount <= 0))
+		{
+			remove(GetFilePathFor(fileIter->first).c_str());
+			fByteCount -= std::min(fByteCount, fileIter->second.ByteCount);
+			fFiles.erase(fileIter);
+		}
+		fEntries.erase(entryIter);
+		fIsIndexDirty = true;
+	}
+}
+
+void ImageCache::LoadIndex()
+{
+	// Read the whole index file.
+	auto filePointer = fopen(fIndexFilePath.c_str(), "rb");
+	if (!filePointer)
+	{
+		return;
+	}
+	std::string content;
+	char readBuffer[4096];
+	size_t readCount;
+	while ((readCount = fread(readBuffer, 1, sizeof(readBuffer), filePointer)) > 0)
+	{
+		content.append(readBuffer, readCount);
+	}
+	fclose(filePointer);
+
+	// Parse its "<fileName>\t<url>" lines, most recently used first.
+	// Entries whose file was deleted, such as by the OS purging the caches directory, are dropped.
+	size_t lineStartIndex = 0;
+	bool isHeader = true;
+	while (lineStartIndex < content.length())
+	{
+		auto lineEndIndex = content.find('\n', lineStartIndex);
+		if (lineEndIndex == std::string::npos)
+		{
+			// Ignore a truncated last line.
+			break;
+		}
+		auto line = content.substr(lineStartIndex, lineEndIndex - lineStartIndex);
+		lineStartIndex = lineEndIndex + 1;
+		if (isHeader)
+		{
+			if (line != kIndexFileHeader)
+			{
+				fIsIndexDirty = true;
+				return;
+			}
+			isHeader = false;
+			continue;
+		}
+		auto separatorIndex = line.find('\t');
+		if ((separatorIndex == std::string::npos) || (line.compare(0, strlen(kFileNamePrefix), kFileNamePrefix) != 0))
+		{
+			continue;
+		}
+		auto fileName = line.substr(0, separatorIndex);
+		auto url = line.substr(separatorIndex + 1);
+		uint64_t byteCount = 0;
+		if ((fFiles.find(fileName) == fFiles.end()) && !FetchFileByteCount(GetFilePathFor(fileName), byteCount))
+		{
+			fIsIndexDirty = true;
+			continue;
+		}
+		if (fEntries.find(url) == fEntries.end())
+		{
+			// Entries are read most recent first, so they are appended to keep that order.
+			auto fileIter = fFiles.find(fileName);
+			if (fileIter == fFiles.end())
+			{
+				fileIter = fFiles.emplace(fileName, CachedFile{ byteCount, 0 }).first;
+				fByteCount += byteCount;
+			}
+			fileIter->second.ReferenceCount++;
+			fRecentUrls.push_back(url);
+			fEntries[url] = Entry{ fileName, std::prev(fRecentUrls.end()) };
+		}
+	}
+}
+
+bool ImageCache::SaveIndex() const
+{
+	// Validate.
+	if (fIndexFilePath.empty())
+	{
+		return false;
+	}
+
+	// Serialize the entries, most recently used first.
+	std::string content(kIndexFileHeader);
+	content += '\n';
+	for (auto&& url : fRecentUrls)
+	{
+		auto entryIter = fEntries.find(url);
+		if ((entryIter != fEntries.end()) && (url.find_first_of("\t\r\n") == std::string::npos))
+		{
+			content += entryIter->second.FileName;
+			content += '\t';
+			content += url;
+			content += '\n';
+		}
+	}
+
+	// Write the index to a temporary file and then replace the existing index with it.
+	// Note: On Windows, rename() cannot replace an existing file, which is why it is removed first.
+	std::string temporaryFilePath = fIndexFilePath + ".tmp";
+	auto filePointer = fopen(temporaryFilePath.c_str(), "wb");
+	if (!filePointer)
+	{
+		return false;
+	}
+	bool wasWritten = (fwrite(content.data(), 1, content.length(), filePointer) == content.length());
+	wasWritten &= (fclose(filePointer) == 0);
+	if (wasWritten)
+	{
+		remove(fIndexFilePath.c_str());
+		wasWritten = (rename(temporaryFilePath.c_str(), fIndexFilePath.c_str()) == 0);
+	}
+	if (!wasWritten)
+	{
+		remove(temporaryFilePath.c_str());
+	}
+	return wasWritten;
+}
+
+std::string ImageCache::GetFilePathFor(const std::string& fileName) const
+{
+	return fDirectoryPath + fileName;
+}
+
+
+int ImageCache::OnNetworkDownloadEvent(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return 0;
+	}
+
+	// Fetch the image cache that started this download.
+	// Ignore the event if the cache was destroyed while the download was in flight.
+	auto cachePointer = (ImageCache*)lua_touserdata(luaStatePointer, lua_upvalueindex(1));
+	if (sImageCacheCollection.find(cachePointer) == sImageCacheCollection.end())
+	{
+		return 0;
+	}
+
+	// Only handle the final event. A download can also dispatch "began" and "progress" phases.
+	if (!lua_istable(luaStatePointer, 1))
+	{
+		return 0;
+	}
+	bool wasSuccessful = false;
+	lua_getfield(luaStatePointer, 1, "isError");
+	bool isError = lua_toboolean(luaStatePointer, -1) ? true : false;
+	lua_pop(luaStatePointer, 1);
+	if (!isError)
+	{
+		lua_getfield(luaStatePointer, 1, "phase");
+		bool hasEnded = (lua_type(luaStatePointer, -1) == LUA_TSTRING) && !strcmp(lua_tostring(luaStatePointer, -1), "ended");
+		lua_pop(luaStatePointer, 1);
+		if (!hasEnded)
+		{
+			return 0;
+		}
+		lua_getfield(luaStatePointer, 1, "status");
+		int statusCode = lua_isnumber(luaStatePointer, -1) ? (int)lua_tointeger(luaStatePointer, -1) : 200;
+		lua_pop(luaStatePointer, 1);
+		wasSuccessful = (statusCode >= 200) && (statusCode < 300);
+	}
+
+	// Add the downloaded image to the cache.
+	size_t stringLength = 0;
+	auto stringPointer = lua_tolstring(luaStatePointer, lua_upvalueindex(2), &stringLength);
+	std::string url(stringPointer ? stringPointer : "", stringLength);
+	stringPointer = lua_tolstring(luaStatePointer, lua_upvalueindex(3), &stringLength);
+	std::string downloadFileName(stringPointer ? stringPointer : "", stringLength);
+	cachePointer->OnDownloadEnded(url, downloadFileName, wasSuccessful);
+	return 0;
+}
@@ -0,0 +1,216 @@
+// ----------------------------------------------------------------------------
+//
+// ImageCache.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+// Forward declarations.
+class RuntimeContext;
+extern "C"
+{
+	struct lua_State;
+}
+
+
+/**
+  Downloads the store's offer and item images to a Corona system directory, such as the caches directory,
+  so that store screens can display them via local files instead of fetching them every time they are shown.
+
+  Images are downloaded lazily by Corona's network.download() function, a few at a time, once requested via
+  Prefetch(). Downloaded files are named after the SHA-256 digest of their content, letting image URLs that
+  serve the same bytes share one file. The cache is bounded to a max number of bytes on disk, evicting the
+  least recently used images first, and its index is persisted between app launches.
+ */
+class ImageCache
+{
+	public:
+		/** Provides the outcome of a download started by Prefetch(). */
+		struct FetchResult
+		{
+			/** The image's URL. */
+			std::string Url;
+
+			/** Name of the downloaded file in the cache's system directory. Empty if the download failed. */
+			std::string FileName;
+		};
+
+
+		/**
+		  Creates a new image cache.
+		  @param context The runtime context whose Lua state downloads the images.
+		 */
+		ImageCache(RuntimeContext& context);
+
+		/** Saves the index and destroys this cache. Downloads still in flight are ignored once they finish. */
+		virtual ~ImageCache();
+
+		/**
+		  Sets where images are cached and loads the index saved by the last app session.
+		  @param indexFilePath Path of the index file. Images are stored in the same directory.
+		  @param luaDirectoryName Name of the Lua "system" directory constant the index file belongs to,
+		                          such as "CachesDirectory". Passed to network.download().
+		 */
+		void SetIndexFilePath(const std::string& indexFilePath, const char* luaDirectoryName);
+
+		/** Gets the name of the Lua "system" directory constant that the images are stored in. */
+		const std::string& GetLuaDirectoryName() const;
+
+		/** Gets the max number of bytes the cached images may occupy on disk. */
+		uint64_t GetMaxByteCount() const;
+
+		/**
+		  Sets the max number of bytes the cached images may occupy on disk.
+		  Least recently used images are deleted until the cache fits.
+		  @param value The max number of bytes. Zero disables the cache.
+		 */
+		void SetMaxByteCount(uint64_t value);
+
+		/**
+		  Fetches the name of the cached file for the given image URL and marks it as recently used.
+		  @param url The image's URL.
+		  @return Returns the file's name in the cache's system directory. Returns an empty string if not cached.
+		 */
+		std::string GetFileNameBy(const std::string& url);
+
+		/**
+		  Queues the given image to be downloaded, unless it is already cached or being downloaded.
+		  An image that failed to download is not queued again until a short delay has elapsed.
+		  @param url The image's URL.
+		 */
+		void Prefetch(const std::string& url);
+
+		/**
+		  To be called once per frame. Starts queued downloads, saves the index if it changed, and
+		  dispatches the downloads that finished this frame to Lua as a "productImages" event.
+		 */
+		void Update();
+
+	private:
+		/** Information about a cached image URL. */
+		struct Entry
+		{
+			/** Name of the file the URL's image is stored in. */
+			std::string FileName;
+
+			/** Position of the URL in the "fRecentUrls" list. */
+			std::list<std::string>::iterator RecentUrlIterator;
+		};
+
+		/** Information about an image file in the cache directory. */
+		struct CachedFile
+		{
+			/** The file's size in bytes. */
+			uint64_t ByteCount;
+
+			/** Number of cached URLs whose image is stored in this file. */
+			int ReferenceCount;
+		};
+
+		/** Copy constructor deleted to prevent it from being called. */
+		ImageCache(const ImageCache&) = delete;
+
+		/** Method deleted to prevent the copy operator from being called. */
+		void operator=(const ImageCache&) = delete;
+
+		/**
+		  Calls network.download() for the given image.
+		  @param url The image's URL.
+		  @return Returns true if the download was started. Returns false if network.download() is unavailable.
+		 */
+		bool StartDownload(const std::string& url);
+
+		/**
+		  Called when network.download() finished downloading an image.
+		  Moves the downloaded file to its content addressed name and adds it to the cache.
+		  @param url The image's URL.
+		  @param downloadFileName Name of the file the image was downloaded to, in the cache directory.
+		  @param wasSuccessful Set true if the image was downloaded. Set false if the download failed.
+		 */
+		void OnDownloadEnded(const std::string& url, const std::string& downloadFileName, bool wasSuccessful);
+
+		/**
+		  Adds the given URL to the front of the most recently used list.
+		  @param url The image's URL.
+		  @param fileName Name of the file the image is stored in.
+		  @param byteCount The file's size in bytes.
+		 */
+		void AddEntry(const std::string& url, const std::string& fileName, uint64_t byteCount);
+
+		/** Removes the least recently used URLs, deleting files no longer referenced, until the cache fits. */
+		void EvictEntries();
+
+		/** Loads the index file's entries, ignoring the ones whose file no longer exists. */
+		void LoadIndex();
+
+		/** Writes all entries to the index file, most recently used first. */
+		bool SaveIndex() const;
+
+		/** Gets the full path of the given file in the cache directory. */
+		std::string GetFilePathFor(const std::string& fileName) const;
+
+		/**
+		  Called by Corona's network.download() function with its Lua event.
+		  Expects the ImageCache and the image URL as upvalues.
+		 */
+		static int OnNetworkDownloadEvent(lua_State* luaStatePointer);
+
+		/** The runtime context that owns this cache. */
+		RuntimeContext& fContext;
+
+		/** Path of the index file. Empty if the cache has no directory to store images in. */
+		std::string fIndexFilePath;
+
+		/** Path of the directory images are stored in, including the trailing separator. */
+		std::string fDirectoryPath;
+
+		/** Name of the Lua "system" directory constant the images are stored in. */
+		std::string fLuaDirectoryName;
+
+		/** Max number of bytes the cached files may occupy. */
+		uint64_t fMaxByteCount;
+
+		/** Number of bytes the cached files currently occupy. */
+		uint64_t fByteCount;
+
+		/** Cached image URLs, most recently used first. */
+		std::list<std::string> fRecentUrls;
+
+		/** Cached images keyed by URL. */
+		std::unordered_map<std::string, Entry> fEntries;
+
+		/** Cached files keyed by file name. */
+		std::unordered_map<std::string, CachedFile> fFiles;
+
+		/** Image URLs waiting to be downloaded, in the order they were requested. */
+		std::deque<std::string> fQueuedUrls;
+
+		/** Image URLs queued or being downloaded. */
+		std::unordered_set<std::string> fFetchingUrls;
+
+		/** Number of network.download() requests in flight. */
+		int fDownloadCount;
+
+		/** Times at which image URLs that failed to download may be downloaded again. */
+		std::unordered_map<std::string, std::chrono::steady_clock::time_point> fRetryTimes;
+
+		/** Downloads that finished since the last "productImages" event. */
+		std::vector<FetchResult> fFetchResults;
+
+		/** Set true if entries changed since the index file was last saved. */
+		bool fIsIndexDirty;
+};
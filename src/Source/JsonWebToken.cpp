@@ -0,0 +1,670 @@
+// ----------------------------------------------------------------------------
+//
+// JsonWebToken.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "JsonWebToken.h"
+#include "RsaPublicKey.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+extern "C"
+{
+#	include "lua.h"
+}
+
+
+//---------------------------------------------------------------------------------
+// Private Static Functions
+//---------------------------------------------------------------------------------
+
+/** Max number of nested JSON objects/arrays accepted by PushJsonValueTo(). */
+static const int kMaxJsonDepth = 32;
+
+/** Skips JSON whitespace characters. */
+static void SkipJsonWhitespace(const char*& text)
+{
+	while ((*text == ' ') || (*text == '\t') || (*text == '\r') || (*text == '\n'))
+	{
+		text++;
+	}
+}
+
+/** Appends the given unicode code point to the given string in UTF-8 form. */
+static void AppendUtf8(std::string& output, unsigned long codePoint)
+{
+	if (codePoint < 0x80)
+	{
+		output += (char)codePoint;
+	}
+	else if (codePoint < 0x800)
+	{
+		output += (char)(0xC0 | (codePoint >> 6));
+		output += (char)(0x80 | (codePoint & 0x3F));
+	}
+	else if (codePoint < 0x10000)
+	{
+		output += (char)(0xE0 | (codePoint >> 12));
+		output += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+		output += (char)(0x80 | (codePoint & 0x3F));
+	}
+	else
+	{
+		output += (char)(0xF0 | (codePoint >> 18));
+		output += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+		output += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+		output += (char)(0x80 | (codePoint & 0x3F));
+	}
+}
+
+/** Reads the 4 hex digits of a JSON "\u" escape sequence. Returns false if malformed. */
+static bool ReadJsonHexQuad(const char*& text, unsigned long& value)
+{
+	value = 0;
+	for (int index = 0; index < 4; index++, text++)
+	{
+		char character = *text;
+		value <<= 4;
+		if ((character >= '0') && (character <= '9'))
+		{
+			value |= (unsigned long)(character - '0');
+		}
+		else if ((character >= 'a') && (character <= 'f'))
+		{
+			value |= (unsigned long)(character - 'a' + 10);
+		}
+		else if ((character >= 'A') && (character <= 'F'))
+		{
+			value |= (unsigned long)(character - 'A' + 10);
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Reads a quoted JSON string, unescaping it into "output". Returns false if malformed. */
+static bool ReadJsonString(const char*& text, std::string& output)
+{
+	output.clear();
+	if (*text != '"')
+	{
+		return false;
+	}
+	text++;
+	while (*text != '"')
+	{
+		char character = *text++;
+		if (character == '\0')
+		{
+			return false;
+		}
+		if (character != '\\')
+		{
+			output += character;
+			continue;
+		}
+		character = *text++;
+		switch (character)
+		{
+			case '"': output += '"'; break;
+			case '\\': output += '\\'; break;
+			case '/': output += '/'; break;
+			case 'b': output += '\b'; break;
+			case 'f': output += '\f'; break;
+			case 'n': output += '\n'; break;
+			case 'r': output += '\r'; break;
+			case 't': output += '\t'; break;
+			case 'u':
+			{
+				unsigned long codePoint;
+				if (!ReadJsonHexQuad(text, codePoint))
+				{
+					return false;
+				}
+				if ((codePoint >= 0xD800) && (codePoint <= 0xDBFF) && (text[0] == '\\') && (text[1] == 'u'))
+				{
+					// Combine a UTF-16 surrogate pair into 1 code point.
+					unsigned long lowSurrogate;
+					text += 2;
+					if (!ReadJsonHexQuad(text, lowSurrogate) || (lowSurrogate < 0xDC00) || (lowSurrogate > 0xDFFF))
+					{
+						return false;
+					}
+					codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+				}
+				AppendUtf8(output, codePoint);
+				break;
+			}
+			default:
+				return false;
+		}
+	}
+	text++;
+	return true;
+}
+
+/** Skips the JSON value at "text" without decoding it. Returns false if malformed. */
+static bool SkipJsonValue(const char*& text, int depth)
+{
+	SkipJsonWhitespace(text);
+	if (depth > kMaxJsonDepth)
+	{
+		return false;
+	}
+
+	switch (*text)
+	{
+		case '{':
+		case '[':
+		{
+			char endCharacter = (*text == '{') ? '}' : ']';
+			text++;
+			SkipJsonWhitespace(text);
+			if (*text == endCharacter)
+			{
+				text++;
+				return true;
+			}
+			std::string key;
+			while (true)
+			{
+				if (endCharacter == '}')
+				{
+					SkipJsonWhitespace(text);
+					if (!ReadJsonString(text, key))
+					{
+						return false;
+					}
+					SkipJsonWhitespace(text);
+					if (*text++ != ':')
+					{
+						return false;
+					}
+				}
+				if (!SkipJsonValue(text, depth + 1))
+				{
+					return false;
+				}
+				SkipJsonWhitespace(text);
+				if (*text == ',')
+				{
+					text++;
+					continue;
+				}
+				if (*text == endCharacter)
+				{
+					text++;
+					return true;
+				}
+				return false;
+			}
+		}
+		case '"':
+		{
+			std::string value;
+			return ReadJsonString(text, value);
+		}
+		case 't':
+			if (strncmp(text, "true", 4) != 0)
+			{
+				return false;
+			}
+			text += 4;
+			return true;
+		case 'f':
+			if (strncmp(text, "false", 5) != 0)
+			{
+				return false;
+			}
+			text += 5;
+			return true;
+		case 'n':
+			if (strncmp(text, "null", 4) != 0)
+			{
+				return false;
+			}
+			text += 4;
+			return true;
+		default:
+		{
+			char* endPointer = nullptr;
+			strtod(text, &endPointer);
+			if (!endPointer || (endPointer == text))
+			{
+				return false;
+			}
+			text = endPointer;
+			return true;
+		}
+	}
+}
+
+/**
+  Finds a member of the given JSON object by name.
+  @param json The JSON object text to search.
+  @param name The member's name.
+  @return Returns a pointer to the member's value text. Returns null if not found or if the JSON is malformed.
+ */
+static const char* FindJsonObjectMember(const char* json, const char* name)
+{
+	const char* text = json;
+	SkipJsonWhitespace(text);
+	if (*text++ != '{')
+	{
+		return nullptr;
+	}
+	std::string key;
+	while (true)
+	{
+		SkipJsonWhitespace(text);
+		if (!ReadJsonString(text, key))
+		{
+			return nullptr;
+		}
+		SkipJsonWhitespace(text);
+		if (*text++ != ':')
+		{
+			return nullptr;
+		}
+		SkipJsonWhitespace(text);
+		if (key == name)
+		{
+			return text;
+		}
+		if (!SkipJsonValue(text, 1))
+		{
+			return nullptr;
+		}
+		SkipJsonWhitespace(text);
+		if (*text++ != ',')
+		{
+			return nullptr;
+		}
+	}
+}
+
+/** Fetches a string member of the given JSON object. Returns false if not found or not a string. */
+static bool GetJsonObjectString(const std::string& json, const char* name, std::string& value)
+{
+	if (!name)
+	{
+		return false;
+	}
+	const char* text = FindJsonObjectMember(json.c_str(), name);
+	return text && (*text == '"') && ReadJsonString(text, value);
+}
+
+/** Decodes the JSON value at "text" and pushes it to Lua. Returns false if malformed, pushing nothing. */
+static bool PushJsonValueTo(lua_State* luaStatePointer, const char*& text, int depth)
+{
+	// Make sure the Lua stack has room for this level's table, key, and value.
+	SkipJsonWhitespace(text);
+	if ((depth > kMaxJsonDepth) || !lua_checkstack(luaStatePointer, 3))
+	{
+		return false;
+	}
+
+	switch (*text)
+	{
+		case '{':
+		{
+			text++;
+			lua_newtable(luaStatePointer);
+			SkipJsonWhitespace(text);
+			if (*text == '}')
+			{
+				text++;
+				return true;
+			}
+			std::string key;
+			while (true)
+			{
+				SkipJsonWhitespace(text);
+				if (!ReadJsonString(text, key))
+				{
+					break;
+				}
+				SkipJsonWhitespace(text);
+				if (*text++ != ':')
+				{
+					break;
+				}
+				if (!PushJsonValueTo(luaStatePointer, text, depth + 1))
+				{
+					break;
+				}
+				lua_setfield(luaStatePointer, -2, key.c_str());
+				SkipJsonWhitespace(text);
+				if (*text == ',')
+				{
+					text++;
+					continue;
+				}
+				if (*text == '}')
+				{
+					text++;
+					return true;
+				}
+				break;
+			}
+			lua_pop(luaStatePointer, 1);
+			return false;
+		}
+		case '[':
+		{
+			text++;
+			lua_newtable(luaStatePointer);
+			SkipJsonWhitespace(text);
+			if (*text == ']')
+			{
+				text++;
+				return true;
+			}
+			int arrayIndex = 1;
+			while (true)
+			{
+				if (!PushJsonValueTo(luaStatePointer, text, depth + 1))
+				{
+					break;
+				}
+				lua_rawseti(luaStatePointer, -2, arrayIndex++);
+				SkipJsonWhitespace(text);
+				if (*text == ',')
+				{
+					text++;
+					continue;
+				}
+				if (*text == ']')
+				{
+					text++;
+					return true;
+				}
+				break;
+			}
+			lua_pop(luaStatePointer, 1);
+			return false;
+		}
+		case '"':
+		{
+			std::string value;
+			if (!ReadJsonString(text, value))
+			{
+				return false;
+			}
+			lua_pushlstring(luaStatePointer, value.c_str(), value.length());
+			return true;
+		}
+		case 't':
+			if (strncmp(text, "true", 4) == 0)
+			{
+				text += 4;
+				lua_pushboolean(luaStatePointer, 1);
+				return true;
+			}
+			return false;
+		case 'f':
+			if (strncmp(text, "false", 5) == 0)
+			{
+				text += 5;
+				lua_pushboolean(luaStatePointer, 0);
+				return true;
+			}
+			return false;
+		case 'n':
+			if (strncmp(text, "null", 4) == 0)
+			{
+				text += 4;
+				lua_pushnil(luaStatePointer);
+				return true;
+			}
+			return false;
+		default:
+		{
+			char* endPointer = nullptr;
+			double value = strtod(text, &endPointer);
+			if (!endPointer || (endPointer == text))
+			{
+				return false;
+			}
+			text = endPointer;
+			lua_pushnumber(luaStatePointer, (lua_Number)value);
+			return true;
+		}
+	}
+}
+
+
+//---------------------------------------------------------------------------------
+// JsonWebToken Class Members
+//---------------------------------------------------------------------------------
+
+JsonWebToken::JsonWebToken()
+{
+}
+
+JsonWebToken::~JsonWebToken()
+{
+}
+
+bool JsonWebToken::Parse(const char* encodedToken)
+{
+	Reset();
+
+	// Validate.
+	if (!encodedToken)
+	{
+		return false;
+	}
+
+	// A JWT is made up of 3 base64url encoded parts separated by periods.
+	const char* headerEnd = strchr(encodedToken, '.');
+	if (!headerEnd)
+	{
+		return false;
+	}
+	const char* payloadEnd = strchr(headerEnd + 1, '.');
+	if (!payloadEnd)
+	{
+		return false;
+	}
+	bool wasDecoded =
+			Base64UrlDecode(encodedToken, headerEnd - encodedToken, fHeaderJson) &&
+			Base64UrlDecode(headerEnd + 1, payloadEnd - (headerEnd + 1), fPayloadJson) &&
+			Base64UrlDecode(payloadEnd + 1, strlen(payloadEnd + 1), fSignature);
+	if (!wasDecoded || fPayloadJson.empty())
+	{
+		Reset();
+		return false;
+	}
+	fEncodedToken = encodedToken;
+	return true;
+}
+
+void JsonWebToken::Reset()
+{
+	fEncodedToken.clear();
+	fHeaderJson.clear();
+	fPayloadJson.clear();
+	fSignature.clear();
+}
+
+bool JsonWebToken::IsValid() const
+{
+	return !fEncodedToken.empty();
+}
+
+const std::string& JsonWebToken::GetEncodedToken() const
+{
+	return fEncodedToken;
+}
+
+const std::string& JsonWebToken::GetHeaderJson() const
+{
+	return fHeaderJson;
+}
+
+const std::string& JsonWebToken::GetPayloadJson() const
+{
+	return fPayloadJson;
+}
+
+bool JsonWebToken::PushClaimsTo(lua_State* luaStatePointer) const
+{
+	// Validate.
+	if (!luaStatePointer || !IsValid())
+	{
+		return false;
+	}
+
+	// The payload must be a JSON object.
+	if (!PushJsonTo(luaStatePointer, fPayloadJson.c_str()))
+	{
+		return false;
+	}
+	if (!lua_istable(luaStatePointer, -1))
+	{
+		lua_pop(luaStatePointer, 1);
+		return false;
+	}
+	return true;
+}
+
+bool JsonWebToken::GetHeaderString(const char* name, std::string& value) const
+{
+	return GetJsonObjectString(fHeaderJson, name, value);
+}
+
+bool JsonWebToken::GetClaimString(const char* name, std::string& value) const
+{
+	return GetJsonObjectString(fPayloadJson, name, value);
+}
+
+bool JsonWebToken::GetClaimNumber(const char* name, double& value) const
+{
+	// Validate.
+	if (!name)
+	{
+		return false;
+	}
+
+	// Find the claim and make sure it is a number.
+	const char* text = FindJsonObjectMember(fPayloadJson.c_str(), name);
+	if (!text || !(((*text >= '0') && (*text <= '9')) || (*text == '-')))
+	{
+		return false;
+	}
+	char* endPointer = nullptr;
+	double number = strtod(text, &endPointer);
+	if (!endPointer || (endPointer == text))
+	{
+		return false;
+	}
+	value = number;
+	return true;
+}
+
+bool JsonWebToken::VerifySignatureWith(const RsaPublicKey& key) const
+{
+	// Validate.
+	if (!IsValid())
+	{
+		return false;
+	}
+	std::string algorithm;
+	if (!GetHeaderString("alg", algorithm) || (algorithm != "RS256"))
+	{
+		return false;
+	}
+
+	// The signature covers the encoded "header.payload" part of the token.
+	auto signatureSeparatorIndex = fEncodedToken.rfind('.');
+	if (signatureSeparatorIndex == std::string::npos)
+	{
+		return false;
+	}
+	return key.VerifySha256Signature(fEncodedToken.substr(0, signatureSeparatorIndex), fSignature);
+}
+
+bool JsonWebToken::Base64UrlDecode(const char* text, size_t length, std::string& output)
+{
+	output.clear();
+	if (!text)
+	{
+		return false;
+	}
+
+	output.reserve((length * 3) / 4);
+	unsigned long bits = 0;
+	int bitCount = 0;
+	for (size_t index = 0; index < length; index++)
+	{
+		char character = text[index];
+		int value;
+		if ((character >= 'A') && (character <= 'Z'))
+		{
+			value = character - 'A';
+		}
+		else if ((character >= 'a') && (character <= 'z'))
+		{
+			value = character - 'a' + 26;
+		}
+		else if ((character >= '0') && (character <= '9'))
+		{
+			value = character - '0' + 52;
+		}
+		else if ((character == '-') || (character == '+'))
+		{
+			value = 62;
+		}
+		else if ((character == '_') || (character == '/'))
+		{
+			value = 63;
+		}
+		else if (character == '=')
+		{
+			break;
+		}
+		else
+		{
+			return false;
+		}
+		bits = (bits << 6) | (unsigned long)value;
+		bitCount += 6;
+		if (bitCount >= 8)
+		{
+			bitCount -= 8;
+			output += (char)((bits >> bitCount) & 0xFF);
+		}
+	}
+	return true;
+}
+
+bool JsonWebToken::PushJsonTo(lua_State* luaStatePointer, const char* json)
+{
+	// Validate.
+	if (!luaStatePointer || !json)
+	{
+		return false;
+	}
+
+	// Decode the value and make sure nothing but whitespace follows it.
+	const char* text = json;
+	if (!PushJsonValueTo(luaStatePointer, text, 0))
+	{
+		return false;
+	}
+	SkipJsonWhitespace(text);
+	if (*text != '\0')
+	{
+		lua_pop(luaStatePointer, 1);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,140 @@
+// ----------------------------------------------------------------------------
+//
+// JsonWebToken.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <string>
+
+
+// Forward declarations.
+class RsaPublicKey;
+extern "C"
+{
+	struct lua_State;
+}
+
+
+/**
+  Splits and decodes a JSON Web Token (JWT) string, such as the ones returned by EOS_Auth_CopyIdToken(),
+  into its header, payload and signature parts.
+
+  Parsing does not verify the token's signature. The decoded claims are only meant to be read locally,
+  such as to find out when the token expires, unless the signature has been checked via VerifySignatureWith().
+ */
+class JsonWebToken
+{
+	public:
+		/** Creates an empty, invalid token. */
+		JsonWebToken();
+
+		/** Destroys this token. */
+		virtual ~JsonWebToken();
+
+		/**
+		  Decodes the given JWT string, replacing this object's current token.
+		  @param encodedToken The "header.payload.signature" string to decode. Can be null.
+		  @return Returns true if the token was successfully decoded.
+
+		          Returns false if given null or a malformed token. This object will be invalid in this case.
+		 */
+		bool Parse(const char* encodedToken);
+
+		/** Resets this object back to an empty, invalid token. */
+		void Reset();
+
+		/**
+		  Determines if the last call to Parse() succeeded.
+		  @return Returns true if this object contains a decoded token. Returns false if not.
+		 */
+		bool IsValid() const;
+
+		/** Gets the encoded JWT string given to Parse(). Returns an empty string if invalid. */
+		const std::string& GetEncodedToken() const;
+
+		/** Gets the token's decoded JSON header. Returns an empty string if invalid. */
+		const std::string& GetHeaderJson() const;
+
+		/** Gets the token's decoded JSON payload, which contains its claims. Returns an empty string if invalid. */
+		const std::string& GetPayloadJson() const;
+
+		/**
+		  Pushes the token's claims to the top of the Lua stack as a table.
+		  @param luaStatePointer The Lua state to push the table to.
+		  @return Returns true if the table was pushed. Returns false if given null or if this token is invalid,
+		          in which case nothing is pushed to the Lua stack.
+		 */
+		bool PushClaimsTo(lua_State* luaStatePointer) const;
+
+		/**
+		  Fetches a string field from the token's JSON header, such as "alg" or "kid".
+		  @param name The field's name.
+		  @param value Assigned the field's value if found.
+		  @return Returns true if found. Returns false if the field does not exist or is not a string.
+		 */
+		bool GetHeaderString(const char* name, std::string& value) const;
+
+		/**
+		  Fetches a string claim from the token's payload, such as "sub" or "iss".
+		  @param name The claim's name.
+		  @param value Assigned the claim's value if found.
+		  @return Returns true if found. Returns false if the claim does not exist or is not a string.
+		 */
+		bool GetClaimString(const char* name, std::string& value) const;
+
+		/**
+		  Fetches a numeric claim from the token's payload, such as "exp" or "nbf".
+		  @param name The claim's name.
+		  @param value Assigned the claim's value if found.
+		  @return Returns true if found. Returns false if the claim does not exist or is not a number.
+		 */
+		bool GetClaimNumber(const char* name, double& value) const;
+
+		/**
+		  Verifies that the token was signed with the given key's private key via the RS256 algorithm.
+		  Does not check any claims, such as expiration.
+		  @param key The public key to verify the signature with.
+		  @return Returns true if the signature is valid.
+
+		          Returns false if this token is invalid, if its "alg" header is not "RS256",
+		          or if its signature was not made by the given key.
+		 */
+		bool VerifySignatureWith(const RsaPublicKey& key) const;
+
+		/**
+		  Decodes the given base64url string, as used by JWT, with or without padding.
+		  @param text The string to decode.
+		  @param length The number of characters in "text" to decode.
+		  @param output String to write the decoded bytes to. Replaces its current contents.
+		  @return Returns true if decoded. Returns false if the given string contains invalid characters.
+		 */
+		static bool Base64UrlDecode(const char* text, size_t length, std::string& output);
+
+		/**
+		  Decodes the given JSON text and pushes the equivalent Lua value to the top of the Lua stack.
+		  JSON objects and arrays are pushed as tables and null is pushed as nil.
+		  @param luaStatePointer The Lua state to push the value to.
+		  @param json The JSON text to decode.
+		  @return Returns true if the value was pushed. Returns false if given invalid arguments or malformed JSON,
+		          in which case nothing is pushed to the Lua stack.
+		 */
+		static bool PushJsonTo(lua_State* luaStatePointer, const char* json);
+
+	private:
+		/** The token given to Parse(). */
+		std::string fEncodedToken;
+
+		/** The decoded JSON header. */
+		std::string fHeaderJson;
+
+		/** The decoded JSON payload. */
+		std::string fPayloadJson;
+
+		/** The decoded signature bytes. */
+		std::string fSignature;
+};
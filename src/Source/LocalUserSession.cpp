@@ -0,0 +1,546 @@
+// ----------------------------------------------------------------------------
+//
+// LocalUserSession.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "LocalUserSession.h"
+#include "CoronaLua.h"
+#include "DispatchEventTask.h"
+#include "RuntimeContext.h"
+#include <algorithm>
+#include <memory>
+#include <unordered_set>
+extern "C"
+{
+#	include "lua.h"
+#	include "lauxlib.h"
+}
+#include "eos_auth.h"
+#include "eos_connect.h"
+
+
+//---------------------------------------------------------------------------------
+// Private Constants and Static Variables
+//---------------------------------------------------------------------------------
+
+/** Stores a collection of all LocalUserSession instances that currently exist. Used to validate EOS callbacks. */
+static std::unordered_set<LocalUserSession*> sLocalUserSessionCollection;
+
+/** Delay before retrying the first failed Connect session refresh. */
+static const std::chrono::seconds kConnectRefreshMinRetryDelay(5);
+
+/** Upper bound of the Connect session refresh retry delay. */
+static const std::chrono::seconds kConnectRefreshMaxRetryDelay(60);
+
+/** Number of seconds before its expiration that a cached Auth ID token is considered stale. */
+static const time_t kAuthIdTokenExpirationMargin = 60;
+
+
+//---------------------------------------------------------------------------------
+// LocalUserSession Class Members
+//---------------------------------------------------------------------------------
+
+const char* LocalUserSession::GetLoginStateName(LoginState value)
+{
+	switch (value)
+	{
+		case LoginState::kLoggingIn:
+			return "loggingIn";
+		case LoginState::kConnecting:
+			return "connecting";
+		case LoginState::kAuthLoggedIn:
+			return "authLoggedIn";
+		case LoginState::kLoggedIn:
+			return "loggedIn";
+		case LoginState::kLoggingOut:
+			return "loggingOut";
+		default:
+			return "notLoggedIn";
+	}
+}
+
+LocalUserSession::LocalUserSession(RuntimeContext& context, int userHandle)
+:	fContext(context),
+	fUserHandle(userHandle),
+	fEpicAccountId(nullptr),
+	fProductUserId(nullptr),
+	fAuthLoginStatus(EOS_ELoginStatus::EOS_LS_NotLoggedIn),
+	fConnectLoginStatus(EOS_ELoginStatus::EOS_LS_NotLoggedIn),
+	fReportedLoginState(LoginState::kNotLoggedIn),
+	fIsAuthRequestPending(false),
+	fAuthIdTokenLuaReference(LUA_NOREF),
+	fAuthIdTokenExpirationTime(0),
+	fIsConnectLoginPending(false),
+	fIsConnectRefreshing(false),
+	fIsConnectRefreshScheduled(false),
+	fIsSimulated(false),
+	fConnectRefreshRetryDelay(kConnectRefreshMinRetryDelay)
+{
+	sLocalUserSessionCollection.insert(this);
+}
+
+LocalUserSession::~LocalUserSession()
+{
+	InvalidateAuthIdToken();
+	sLocalUserSessionCollection.erase(this);
+}
+
+int LocalUserSession::GetUserHandle() const
+{
+	return fUserHandle;
+}
+
+EOS_EpicAccountId LocalUserSession::GetEpicAccountId() const
+{
+	return fEpicAccountId;
+}
+
+EOS_ProductUserId LocalUserSession::GetProductUserId() const
+{
+	return fProductUserId;
+}
+
+EOS_ELoginStatus LocalUserSession::GetAuthLoginStatus() const
+{
+	return fAuthLoginStatus;
+}
+
+void LocalUserSession::SetAuthLoginStatus(EOS_ELoginStatus value)
+{
+	if (value != fAuthLoginStatus)
+	{
+		fAuthLoginStatus = value;
+		InvalidateAuthIdToken();
+	}
+}
+
+void LocalUserSession::SetConnectLoginStatus(EOS_ELoginStatus value)
+{
+	fConnectLoginStatus = value;
+}
+
+LocalUserSession::LoginState LocalUserSession::GetLoginState() const
+{
+	if (fIsAuthRequestPending)
+	{
+		return fEpicAccountId ? LoginState::kLoggingOut : LoginState::kLoggingIn;
+	}
+	if (fAuthLoginStatus != EOS_ELoginStatus::EOS_LS_LoggedIn)
+	{
+		return LoginState::kNotLoggedIn;
+	}
+	if (fConnectLoginStatus == EOS_ELoginStatus::EOS_LS_LoggedIn)
+	{
+		return LoginState::kLoggedIn;
+	}
+	return fIsConnectLoginPending ? LoginState::kConnecting : LoginState::kAuthLoggedIn;
+}
+
+LocalUserSession::LoginState LocalUserSession::GetReportedLoginState() const
+{
+	return fReportedLoginState;
+}
+
+void LocalUserSession::SetReportedLoginState(LoginState value)
+{
+	fReportedLoginState = value;
+}
+
+bool LocalUserSession::IsRequestPending() const
+{
+	return fIsAuthRequestPending || fIsConnectLoginPending;
+}
+
+bool LocalUserSession::IsSimulated() const
+{
+	return fIsSimulated;
+}
+
+bool LocalUserSession::Login(const EOS_Auth_Credentials& credentials, EOS_EAuthScopeFlags scopeFlags)
+{
+	// Validate.
+	if (fIsAuthRequestPending || fEpicAccountId || !fContext.fAuthHandle)
+	{
+		return false;
+	}
+
+	// Log in. Result is handled by OnAuthLoginCallback().
+	EOS_Auth_LoginOptions loginOptions = {};
+	loginOptions.ApiVersion = EOS_AUTH_LOGIN_API_LATEST;
+	loginOptions.Credentials = &credentials;
+	loginOptions.ScopeFlags = scopeFlags;
+	fIsAuthRequestPending = true;
+	EOS_Auth_Login(fContext.fAuthHandle, &loginOptions, this, &LocalUserSession::OnAuthLoginCallback);
+	return true;
+}
+
+bool LocalUserSession::Logout()
+{
+	// Validate.
+	if (fIsAuthRequestPending || !fEpicAccountId || !fContext.fAuthHandle)
+	{
+		return false;
+	}
+
+	// Log out. Result is handled by OnAuthLogoutCallback().
+	EOS_Auth_LogoutOptions logoutOptions = {};
+	logoutOptions.ApiVersion = EOS_AUTH_LOGOUT_API_LATEST;
+	logoutOptions.LocalUserId = fEpicAccountId;
+	fIsAuthRequestPending = true;
+	EOS_Auth_Logout(fContext.fAuthHandle, &logoutOptions, this, &LocalUserSession::OnAuthLogoutCallback);
+	return true;
+}
+
+bool LocalUserSession::ConnectLogin()
+{
+	// Do not continue if a login is already in flight or if there is no Auth logged in account to log in with.
+	if (fIsConnectLoginPending || !fEpicAccountId || !fContext.fConnectHandle)
+	{
+		return false;
+	}
+
+	// Fetch the Auth ID token to log into Connect with.
+	auto idToken = GetAuthIdToken();
+	if (!idToken)
+	{
+		CoronaLog("WARNING: [EOS SDK] Connect login failed. Unable to copy the Auth ID token.");
+		return false;
+	}
+
+	// Log in.
+	EOS_Connect_Credentials credentials = {};
+	credentials.ApiVersion = EOS_CONNECT_CREDENTIALS_API_LATEST;
+	credentials.Token = idToken;
+	credentials.Type = EOS_EExternalCredentialType::EOS_ECT_EPIC_ID_TOKEN;
+	EOS_Connect_LoginOptions loginOptions = {};
+	loginOptions.ApiVersion = EOS_CONNECT_LOGIN_API_LATEST;
+	loginOptions.Credentials = &credentials;
+	loginOptions.UserLoginInfo = nullptr;
+	fIsConnectLoginPending = true;
+	fIsConnectRefreshing = (fProductUserId != nullptr);
+	EOS_Connect_Login(fContext.fConnectHandle, &loginOptions, this, &LocalUserSession::OnConnectLoginCallback);
+	return true;
+}
+
+bool LocalUserSession::SimulateConnectLogin(EOS_ProductUserId productUserId)
+{
+	// Validate.
+	if (!productUserId || fProductUserId || fEpicAccountId || fIsAuthRequestPending || fIsConnectLoginPending)
+	{
+		return false;
+	}
+
+	// Assign the product user. Connect is never logged into, so the session is never refreshed.
+	fProductUserId = productUserId;
+	fIsSimulated = true;
+	return true;
+}
+
+void LocalUserSession::OnConnectAuthExpiring()
+{
+	// Refresh the session from Update() right after this tick's callbacks have been handled.
+	fConnectRefreshTime = std::chrono::steady_clock::now();
+	fIsConnectRefreshScheduled = true;
+}
+
+void LocalUserSession::Update()
+{
+	// Refresh the Connect session if it is about to expire or if a previous refresh attempt failed.
+	if (fIsConnectRefreshScheduled && !fIsConnectLoginPending)
+	{
+		if (std::chrono::steady_clock::now() >= fConnectRefreshTime)
+		{
+			// Only unschedule the refresh once a request is in flight. If it could not be issued, such as when
+			// the Auth ID token could not be copied, retry later with a backoff until the session expires.
+			if (ConnectLogin())
+			{
+				fIsConnectRefreshScheduled = false;
+			}
+			else if (fProductUserId)
+			{
+				ScheduleConnectRefreshRetry();
+			}
+			else
+			{
+				fIsConnectRefreshScheduled = false;
+			}
+		}
+	}
+}
+
+void LocalUserSession::OnConnectLoginResponse(EOS_EResult resultCode, EOS_ProductUserId productUserId)
+{
+	bool wasRefreshing = fIsConnectRefreshing;
+	fIsConnectLoginPending = false;
+	fIsConnectRefreshing = false;
+
+	if (resultCode == EOS_EResult::EOS_Success)
+	{
+		fProductUserId = productUserId;
+		fConnectLoginStatus = EOS_ELoginStatus::EOS_LS_LoggedIn;
+		fIsConnectRefreshScheduled = false;
+		fConnectRefreshRetryDelay = kConnectRefreshMinRetryDelay;
+	}
+	else if (wasRefreshing && fProductUserId)
+	{
+		// The current session is still valid until it expires. Keep trying to refresh it until then.
+		ScheduleConnectRefreshRetry();
+	}
+
+	// Queue the result to be dispatched to Lua later.
+	auto taskPointer = std::make_shared<DispatchConnectLoginResponseEventTask>();
+	taskPointer->AcquireEventDataFrom(resultCode, productUserId);
+	taskPointer->SetIsRefresh(wasRefreshing);
+	taskPointer->SetUserHandle(fUserHandle);
+	fContext.QueueDispatchEventTask(taskPointer);
+}
+
+void LocalUserSession::ScheduleConnectRefreshRetry()
+{
+	fConnectRefreshTime = std::chrono::steady_clock::now() + fConnectRefreshRetryDelay;
+	fIsConnectRefreshScheduled = true;
+	fConnectRefreshRetryDelay = (std::min)(fConnectRefreshRetryDelay * 2, kConnectRefreshMaxRetryDelay);
+}
+
+const char* LocalUserSession::GetAuthIdToken()
+{
+	if (!UpdateAuthIdTokenCache())
+	{
+		return nullptr;
+	}
+	return fAuthIdToken.GetEncodedToken().c_str();
+}
+
+bool LocalUserSession::PushAuthIdTokenTo(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer || !UpdateAuthIdTokenCache())
+	{
+		return false;
+	}
+
+	lua_rawgeti(luaStatePointer, LUA_REGISTRYINDEX, fAuthIdTokenLuaReference);
+	return true;
+}
+
+bool LocalUserSession::PushAuthIdTokenClaimsTo(lua_State* luaStatePointer)
+{
+	// Validate.
+	if (!luaStatePointer || !UpdateAuthIdTokenCache())
+	{
+		return false;
+	}
+
+	// Decode a new table rather than sharing a cached one, since Lua tables are mutable.
+	if (!fAuthIdToken.PushClaimsTo(luaStatePointer))
+	{
+		lua_newtable(luaStatePointer);
+	}
+	return true;
+}
+
+void LocalUserSession::InvalidateAuthIdToken()
+{
+	auto luaStatePointer = fContext.GetMainLuaState();
+	if (luaStatePointer)
+	{
+		luaL_unref(luaStatePointer, LUA_REGISTRYINDEX, fAuthIdTokenLuaReference);
+	}
+	fAuthIdTokenLuaReference = LUA_NOREF;
+	fAuthIdTokenExpirationTime = 0;
+	fAuthIdToken.Reset();
+}
+
+bool LocalUserSession::IsEntitledTo(const std::string& id) const
+{
+	return fEntitledIds.find(id) != fEntitledIds.end();
+}
+
+void LocalUserSession::SetIsEntitledTo(const std::string& id, bool value)
+{
+	if (id.empty())
+	{
+		return;
+	}
+	if (value)
+	{
+		fEntitledIds.insert(id);
+	}
+	else
+	{
+		fEntitledIds.erase(id);
+	}
+}
+
+bool LocalUserSession::UpdateAuthIdTokenCache()
+{
+	// Use the cached token if it is not about to expire.
+	if (fAuthIdToken.IsValid())
+	{
+		if (!fAuthIdTokenExpirationTime || (time(nullptr) + kAuthIdTokenExpirationMargin < fAuthIdTokenExpirationTime))
+		{
+			return true;
+		}
+		InvalidateAuthIdToken();
+	}
+
+	// Validate.
+	auto luaStatePointer = fContext.GetMainLuaState();
+	if (!luaStatePointer || !fEpicAccountId || !fContext.fAuthHandle)
+	{
+		return false;
+	}
+
+	// Copy the token from EOS.
+	EOS_Auth_CopyIdTokenOptions copyTokenOptions = {};
+	copyTokenOptions.ApiVersion = EOS_AUTH_COPYIDTOKEN_API_LATEST;
+	copyTokenOptions.AccountId = fEpicAccountId;
+	EOS_Auth_IdToken* idTokenPointer = nullptr;
+	if (EOS_Auth_CopyIdToken(fContext.fAuthHandle, &copyTokenOptions, &idTokenPointer) != EOS_EResult::EOS_Success)
+	{
+		return false;
+	}
+	bool wasParsed = fAuthIdToken.Parse(idTokenPointer->JsonWebToken);
+	EOS_Auth_IdToken_Release(idTokenPointer);
+	if (!wasParsed)
+	{
+		return false;
+	}
+
+	// Cache the token string in the Lua registry and read its expiration time from its claims.
+	const auto& encodedToken = fAuthIdToken.GetEncodedToken();
+	lua_pushlstring(luaStatePointer, encodedToken.c_str(), encodedToken.length());
+	fAuthIdTokenLuaReference = luaL_ref(luaStatePointer, LUA_REGISTRYINDEX);
+	if (fAuthIdToken.PushClaimsTo(luaStatePointer))
+	{
+		lua_getfield(luaStatePointer, -1, "exp");
+		if (lua_type(luaStatePointer, -1) == LUA_TNUMBER)
+		{
+			fAuthIdTokenExpirationTime = (time_t)lua_tonumber(luaStatePointer, -1);
+		}
+		lua_pop(luaStatePointer, 2);
+	}
+	return true;
+}
+
+LocalUserSession* LocalUserSession::GetInstanceBy(void* clientData)
+{
+	auto sessionPointer = (LocalUserSession*)clientData;
+	if (sLocalUserSessionCollection.find(sessionPointer) == sLocalUserSessionCollection.end())
+	{
+		return nullptr;
+	}
+	return sessionPointer;
+}
+
+void EOS_CALL LocalUserSession::OnAuthLoginCallback(const EOS_Auth_LoginCallbackInfo* data)
+{
+	// Validate.
+	if (!data || !EOS_EResult_IsOperationComplete(data->ResultCode))
+	{
+		return;
+	}
+	auto sessionPointer = GetInstanceBy(data->ClientData);
+	if (!sessionPointer)
+	{
+		return;
+	}
+
+	// Update the session.
+	sessionPointer->fIsAuthRequestPending = false;
+	bool wasSuccessful = (data->ResultCode == EOS_EResult::EOS_Success) && data->LocalUserId;
+	if (wasSuccessful)
+	{
+		sessionPointer->fEpicAccountId = data->LocalUserId;
+		sessionPointer->SetAuthLoginStatus(EOS_ELoginStatus::EOS_LS_LoggedIn);
+	}
+
+	// Queue the result to be dispatched to Lua later.
+	auto taskPointer = std::make_shared<DispatchLoginResponseEventTask>();
+	taskPointer->AcquireEventDataFrom(data);
+	taskPointer->SetUserHandle(sessionPointer->fUserHandle);
+	sessionPointer->fContext.QueueDispatchEventTask(taskPointer);
+
+	// Log into the Connect interface with the new Auth session so that product user services become available.
+	if (wasSuccessful)
+	{
+		sessionPointer->ConnectLogin();
+	}
+}
+
+void EOS_CALL LocalUserSession::OnAuthLogoutCallback(const EOS_Auth_LogoutCallbackInfo* data)
+{
+	// Validate.
+	if (!data || !EOS_EResult_IsOperationComplete(data->ResultCode))
+	{
+		return;
+	}
+	auto sessionPointer = GetInstanceBy(data->ClientData);
+	if (!sessionPointer)
+	{
+		return;
+	}
+
+	// Update the session. The Connect session cannot outlive the Auth session it was created from.
+	sessionPointer->fIsAuthRequestPending = false;
+	if (data->ResultCode == EOS_EResult::EOS_Success)
+	{
+		sessionPointer->SetAuthLoginStatus(EOS_ELoginStatus::EOS_LS_NotLoggedIn);
+		sessionPointer->SetConnectLoginStatus(EOS_ELoginStatus::EOS_LS_NotLoggedIn);
+		sessionPointer->fIsConnectRefreshScheduled = false;
+	}
+
+	// Queue the result to be dispatched to Lua later.
+	auto taskPointer = std::make_shared<DispatchLogoutResponseEventTask>();
+	taskPointer->AcquireEventDataFrom(data->ResultCode);
+	taskPointer->SetUserHandle(sessionPointer->fUserHandle);
+	sessionPointer->fContext.QueueDispatchEventTask(taskPointer);
+}
+
+void EOS_CALL LocalUserSession::OnConnectLoginCallback(const EOS_Connect_LoginCallbackInfo* data)
+{
+	// Validate.
+	if (!data || !EOS_EResult_IsOperationComplete(data->ResultCode))
+	{
+		return;
+	}
+	auto sessionPointer = GetInstanceBy(data->ClientData);
+	if (!sessionPointer)
+	{
+		return;
+	}
+
+	// If the Epic account has never logged into this product, then create a product user for it.
+	if ((data->ResultCode == EOS_EResult::EOS_InvalidUser) && data->ContinuanceToken)
+	{
+		EOS_Connect_CreateUserOptions options = {};
+		options.ApiVersion = EOS_CONNECT_CREATEUSER_API_LATEST;
+		options.ContinuanceToken = data->ContinuanceToken;
+		EOS_Connect_CreateUser(
+				sessionPointer->fContext.fConnectHandle, &options, sessionPointer,
+				&LocalUserSession::OnConnectCreateUserCallback);
+		return;
+	}
+
+	sessionPointer->OnConnectLoginResponse(data->ResultCode, data->LocalUserId);
+}
+
+void EOS_CALL LocalUserSession::OnConnectCreateUserCallback(const EOS_Connect_CreateUserCallbackInfo* data)
+{
+	// Validate.
+	if (!data || !EOS_EResult_IsOperationComplete(data->ResultCode))
+	{
+		return;
+	}
+	auto sessionPointer = GetInstanceBy(data->ClientData);
+	if (!sessionPointer)
+	{
+		return;
+	}
+
+	sessionPointer->OnConnectLoginResponse(data->ResultCode, data->LocalUserId);
+}
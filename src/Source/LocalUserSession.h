@@ -0,0 +1,326 @@
+// ----------------------------------------------------------------------------
+//
+// LocalUserSession.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "JsonWebToken.h"
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <unordered_set>
+#include "eos_sdk.h"
+#include "eos_auth_types.h"
+#include "eos_connect_types.h"
+
+
+// Forward declarations.
+class RuntimeContext;
+extern "C"
+{
+	struct lua_State;
+}
+
+
+/**
+  Stores the Auth and Connect session of 1 local user logged into EOS.
+
+  A RuntimeContext owns one of these per local user, making it possible for one process to drive several
+  logged in users at the same time, such as for local multiplayer or for load testing.
+  Each session is identified in Lua by an integer user handle that is never re-used by the runtime context.
+ */
+class LocalUserSession
+{
+	public:
+		/**
+		  Overall login state of a session, derived from its Auth and Connect login status
+		  and from its in-flight requests.
+		 */
+		enum class LoginState
+		{
+			/** Not logged into the Auth interface. */
+			kNotLoggedIn,
+
+			/** Waiting for an Auth login request to complete. */
+			kLoggingIn,
+
+			/** Logged into the Auth interface and waiting for a Connect login request to complete. */
+			kConnecting,
+
+			/** Logged into the Auth interface, but not into the Connect interface. */
+			kAuthLoggedIn,
+
+			/** Logged into both the Auth and Connect interfaces. */
+			kLoggedIn,
+
+			/** Waiting for an Auth logout request to complete. */
+			kLoggingOut
+		};
+
+		/**
+		  Gets the Lua name of the given login state, such as "loggedIn".
+		  @param value The state to fetch the name of.
+		  @return Returns the state's name. Never returns null.
+		 */
+		static const char* GetLoginStateName(LoginState value);
+
+		/**
+		  Creates a new session for a local user that has not logged in yet.
+		  @param context The runtime context that owns this session and provides its EOS interface handles.
+		  @param userHandle Unique integer used to identify this session in Lua.
+		 */
+		LocalUserSession(RuntimeContext& context, int userHandle);
+
+		/**
+		  Releases the cached ID token and stops this session from receiving the results of its pending EOS requests.
+		  Does not log the user out.
+		 */
+		virtual ~LocalUserSession();
+
+		/** Gets the integer handle used to identify this session in Lua. */
+		int GetUserHandle() const;
+
+		/** Gets the Epic account this session is logged into. Returns null if not logged in yet. */
+		EOS_EpicAccountId GetEpicAccountId() const;
+
+		/** Gets the product user of this session's Connect login. Returns null if not logged into Connect. */
+		EOS_ProductUserId GetProductUserId() const;
+
+		/** Gets this session's last known Auth login status. */
+		EOS_ELoginStatus GetAuthLoginStatus() const;
+
+		/**
+		  Updates this session's Auth login status, such as when notified by EOS.
+		  Discards the cached ID token since it does not apply to the new login status.
+		  @param value The new login status.
+		 */
+		void SetAuthLoginStatus(EOS_ELoginStatus value);
+
+		/** Updates this session's Connect login status, such as when notified by EOS that the session expired. */
+		void SetConnectLoginStatus(EOS_ELoginStatus value);
+
+		/** Gets this session's current login state. Cheap enough to be called every frame. */
+		LoginState GetLoginState() const;
+
+		/** Gets the login state last reported to Lua via SetReportedLoginState(). */
+		LoginState GetReportedLoginState() const;
+
+		/**
+		  Stores the login state that was last reported to Lua.
+		  Used by the runtime context to detect state changes between frames.
+		  @param value The state that was reported.
+		 */
+		void SetReportedLoginState(LoginState value);
+
+		/**
+		  Determines if an Auth login, logout, or Connect login request is still in flight for this session.
+		  @return Returns true if waiting for EOS to respond. Returns false if not.
+		 */
+		bool IsRequestPending() const;
+
+		/**
+		  Determines if this session was given a product user via SimulateConnectLogin() instead of logging into EOS.
+		  Simulated sessions are kept until removed explicitly and are never used with the EOS interfaces.
+		 */
+		bool IsSimulated() const;
+
+		/**
+		  Logs this session into the Auth interface with the given credentials.
+		  A "loginResponse" event with this session's user handle is dispatched to Lua once complete,
+		  after which this session automatically logs into the Connect interface too.
+		  @param credentials The credentials to log in with.
+		  @param scopeFlags The permissions being requested for the account.
+		  @return Returns true if a login request was issued.
+
+		          Returns false if this session is already logged in or waiting on another request.
+		 */
+		bool Login(const EOS_Auth_Credentials& credentials, EOS_EAuthScopeFlags scopeFlags);
+
+		/**
+		  Logs this session's account out of the Auth interface.
+		  A "logoutResponse" event with this session's user handle is dispatched to Lua once complete.
+		  @return Returns true if a logout request was issued. Returns false if not logged in.
+		 */
+		bool Logout();
+
+		/**
+		  Logs this session's Epic account into the Connect interface using its Auth ID token.
+		  Creates a new product user if the account has never logged into this product before.
+
+		  Once logged in, the session is refreshed on its own ahead of expiry when the owning runtime context
+		  forwards Connect's auth expiration notification via OnConnectAuthExpiring(), retrying with a backoff
+		  until it succeeds or the session expires.
+		  A "connectLoginResponse" event is dispatched to Lua for every login and refresh attempt.
+		  @return Returns true if a Connect login request was issued.
+
+		          Returns false if not logged into the Auth interface, if the Auth ID token could not be copied,
+		          or if a Connect login is already in progress.
+		 */
+		bool ConnectLogin();
+
+		/**
+		  Assigns this session a product user without logging into EOS, such as to exchange packets
+		  with other simulated users over a LoopbackP2PTransport. No events are dispatched.
+		  @param productUserId The product user to assign.
+		  @return Returns true if assigned. Returns false if given null or if this session is logged in
+		          or waiting on another request.
+		 */
+		bool SimulateConnectLogin(EOS_ProductUserId productUserId);
+
+		/** To be called when EOS notifies that this session's Connect login is about to expire. */
+		void OnConnectAuthExpiring();
+
+		/** To be called once per frame after the EOS platform has been ticked. Issues scheduled session refreshes. */
+		void Update();
+
+		/**
+		  Gets this session's Auth ID token as a JWT string.
+
+		  The token is copied from EOS once and then cached until it is about to expire or the account's
+		  login status changes. Repeated calls do not allocate or copy the token.
+		  @return Returns the JWT string. Returns null if not logged into the Auth interface.
+		 */
+		const char* GetAuthIdToken();
+
+		/**
+		  Pushes the cached Auth ID token to the top of the Lua stack as a string.
+		  The Lua string is kept in the Lua registry along with the cached token, making this a single lookup.
+		  @param luaStatePointer The Lua state to push the token to.
+		  @return Returns true if the token was pushed. Returns false if not logged into the Auth interface,
+		          in which case nothing is pushed to the Lua stack.
+		 */
+		bool PushAuthIdTokenTo(lua_State* luaStatePointer);
+
+		/**
+		  Pushes the cached Auth ID token's decoded claims to the top of the Lua stack as a table,
+		  such as "exp" for its expiration time and "sub" for its Epic account ID.
+		  A new table is decoded on every call, so that changes made to it by the caller do not affect other callers.
+		  @param luaStatePointer The Lua state to push the claims table to.
+		  @return Returns true if the table was pushed. Returns false if not logged into the Auth interface,
+		          in which case nothing is pushed to the Lua stack.
+		 */
+		bool PushAuthIdTokenClaimsTo(lua_State* luaStatePointer);
+
+		/** Discards the cached Auth ID token, forcing the next access to copy it from EOS again. */
+		void InvalidateAuthIdToken();
+
+		/**
+		  Determines if this user is known to own the given catalog item or entitlement. This is a single hash lookup.
+		  Updated by the store's ownership and entitlement queries, purchases, and restores.
+		  @param id A catalog item ID, entitlement name, or entitlement ID.
+		  @return Returns true if owned. Returns false if not owned or if ownership has not been queried yet.
+		 */
+		bool IsEntitledTo(const std::string& id) const;
+
+		/**
+		  Adds the given catalog item or entitlement to, or removes it from, this user's set of owned IDs.
+		  @param id A catalog item ID, entitlement name, or entitlement ID. Empty IDs are ignored.
+		  @param value Set true if owned. Set false if not owned.
+		 */
+		void SetIsEntitledTo(const std::string& id, bool value);
+
+	private:
+		/** Copy constructor deleted to prevent it from being called. */
+		LocalUserSession(const LocalUserSession&) = delete;
+
+		/** Method deleted to prevent the copy operator from being used. */
+		void operator=(const LocalUserSession&) = delete;
+
+		/**
+		  Copies the Auth ID token from EOS if it is not cached yet or if the cached one is about to expire.
+		  @return Returns true if a valid token is cached. Returns false if the token could not be copied.
+		 */
+		bool UpdateAuthIdTokenCache();
+
+		/**
+		  Handles the result of an EOS_Connect_Login() or EOS_Connect_CreateUser() request.
+		  Updates the Connect session, schedules a retry if a refresh failed, and queues a Lua event.
+		  @param resultCode The result of the request.
+		  @param productUserId The logged in product user. Can be null if the request failed.
+		 */
+		void OnConnectLoginResponse(EOS_EResult resultCode, EOS_ProductUserId productUserId);
+
+		/** Schedules the Connect session to be refreshed again after the retry delay, then doubles the delay. */
+		void ScheduleConnectRefreshRetry();
+
+		/**
+		  Fetches the session the given EOS callback "ClientData" refers to.
+		  @param clientData The "ClientData" pointer given to the EOS callback.
+		  @return Returns the session. Returns null if the session has since been deleted.
+		 */
+		static LocalUserSession* GetInstanceBy(void* clientData);
+
+		/** Called by EOS when an EOS_Auth_Login() request completes. */
+		static void EOS_CALL OnAuthLoginCallback(const EOS_Auth_LoginCallbackInfo* data);
+
+		/** Called by EOS when an EOS_Auth_Logout() request completes. */
+		static void EOS_CALL OnAuthLogoutCallback(const EOS_Auth_LogoutCallbackInfo* data);
+
+		/** Called by EOS when an EOS_Connect_Login() request completes. */
+		static void EOS_CALL OnConnectLoginCallback(const EOS_Connect_LoginCallbackInfo* data);
+
+		/** Called by EOS when a new product user was created for an Epic account with no product user. */
+		static void EOS_CALL OnConnectCreateUserCallback(const EOS_Connect_CreateUserCallbackInfo* data);
+
+		/** The runtime context that owns this session. */
+		RuntimeContext& fContext;
+
+		/** Integer used to identify this session in Lua. */
+		int fUserHandle;
+
+		/** The logged in Epic account. Null until EOS_Auth_Login() succeeds. */
+		EOS_EpicAccountId fEpicAccountId;
+
+		/** Product user ID of this session's Connect login. Null until EOS_Connect_Login() succeeds. */
+		EOS_ProductUserId fProductUserId;
+
+		/** The last known Auth login status. */
+		EOS_ELoginStatus fAuthLoginStatus;
+
+		/** The last known Connect login status. */
+		EOS_ELoginStatus fConnectLoginStatus;
+
+		/** The login state last reported to Lua. */
+		LoginState fReportedLoginState;
+
+		/**
+		  Set true while an EOS_Auth_Login() or EOS_Auth_Logout() request is in flight.
+		  It is a logout request if "fEpicAccountId" is set, since a session can only log in once.
+		 */
+		bool fIsAuthRequestPending;
+
+		/** The cached Auth ID token. Invalid if not cached. */
+		JsonWebToken fAuthIdToken;
+
+		/** Lua registry reference to the cached Auth ID token string. LUA_NOREF if not cached. */
+		int fAuthIdTokenLuaReference;
+
+		/** Time at which the cached Auth ID token expires, according to its "exp" claim. Zero if unknown. */
+		time_t fAuthIdTokenExpirationTime;
+
+		/** Set true while an EOS_Connect_Login() or EOS_Connect_CreateUser() request is in flight. */
+		bool fIsConnectLoginPending;
+
+		/** Set true while the in-flight Connect login request is refreshing an existing session. */
+		bool fIsConnectRefreshing;
+
+		/** Set true if a Connect session refresh is scheduled to be issued at "fConnectRefreshTime". */
+		bool fIsConnectRefreshScheduled;
+
+		/** Set true if the product user was assigned via SimulateConnectLogin(). */
+		bool fIsSimulated;
+
+		/** Time at which the next scheduled Connect session refresh will be issued. */
+		std::chrono::steady_clock::time_point fConnectRefreshTime;
+
+		/** Delay to wait before retrying a failed Connect session refresh. Doubles on every failure. */
+		std::chrono::seconds fConnectRefreshRetryDelay;
+
+		/** Catalog item IDs, entitlement names, and entitlement IDs this user is known to own. */
+		std::unordered_set<std::string> fEntitledIds;
+};
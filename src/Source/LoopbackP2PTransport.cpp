@@ -0,0 +1,260 @@
+// ----------------------------------------------------------------------------
+//
+// LoopbackP2PTransport.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "LoopbackP2PTransport.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+
+//---------------------------------------------------------------------------------
+// Private Constants
+//---------------------------------------------------------------------------------
+
+/** Seed used by the random generator until SetSeed() is called. */
+static const uint32_t kDefaultSeed = 5489u;
+
+
+//---------------------------------------------------------------------------------
+// Private Types
+//---------------------------------------------------------------------------------
+
+/** A packet in flight between 2 users. */
+struct LoopbackPacket
+{
+	/** The user that sent the packet. */
+	EOS_ProductUserId SenderId;
+
+	/** The socket the packet was sent on. */
+	EOS_P2P_SocketId SocketId;
+
+	/** The channel the packet was sent on. */
+	uint8_t Channel;
+
+	/** The packet's bytes. */
+	std::vector<uint8_t> Bytes;
+};
+
+/** A point in simulated time, measured from when the simulated clock was last reset. */
+typedef std::chrono::microseconds LoopbackTime;
+
+/** Packets queued for 1 receiving user, keyed by when they are due to be delivered. */
+typedef std::multimap<LoopbackTime, LoopbackPacket> LoopbackInbox;
+
+/** Identifies 1 reliable ordered stream by sender, receiver, socket name, and channel. */
+typedef std::tuple<EOS_ProductUserId, EOS_ProductUserId, std::string, uint8_t> LoopbackStreamKey;
+
+
+//---------------------------------------------------------------------------------
+// Private Static Variables
+//---------------------------------------------------------------------------------
+
+/** Packets in flight, keyed by receiving user. Shared by all loopback transports. */
+static std::unordered_map<EOS_ProductUserId, LoopbackInbox> sInboxes;
+
+/** Delivery time of the last packet sent on each reliable ordered stream, used to keep them in order. */
+static std::map<LoopbackStreamKey, LoopbackTime> sLastOrderedDeliveryTimes;
+
+/** The simulated clock shared by all loopback transports, advanced by Update(). */
+static LoopbackTime sSimulatedTime(0);
+
+/** Number of IDs returned by GenerateUserIdString(). */
+static uint32_t sGeneratedUserIdCount = 0;
+
+
+//---------------------------------------------------------------------------------
+// LoopbackP2PTransport Class Members
+//---------------------------------------------------------------------------------
+
+const size_t LoopbackP2PTransport::kMaxQueuedPacketCount = 4096;
+
+const std::chrono::microseconds LoopbackP2PTransport::kFrameDuration(16667);
+
+LoopbackP2PTransport::LoopbackP2PTransport()
+:	fLatency(0),
+	fJitter(0),
+	fLossRate(0),
+	fRandomGenerator(kDefaultSeed),
+	fLostPacketCount(0)
+{
+}
+
+LoopbackP2PTransport::~LoopbackP2PTransport()
+{
+}
+
+void LoopbackP2PTransport::SetLatency(std::chrono::milliseconds value)
+{
+	fLatency = (value.count() > 0) ? value : std::chrono::milliseconds(0);
+}
+
+void LoopbackP2PTransport::SetJitter(std::chrono::milliseconds value)
+{
+	fJitter = (value.count() > 0) ? value : std::chrono::milliseconds(0);
+}
+
+void LoopbackP2PTransport::SetLossRate(double value)
+{
+	fLossRate = std::min(std::max(value, 0.0), 1.0);
+}
+
+void LoopbackP2PTransport::SetSeed(uint32_t value)
+{
+	fRandomGenerator.seed(value);
+}
+
+uint64_t LoopbackP2PTransport::GetLostPacketCount() const
+{
+	return fLostPacketCount;
+}
+
+bool LoopbackP2PTransport::IsAvailable() const
+{
+	return true;
+}
+
+bool LoopbackP2PTransport::IsSimulated() const
+{
+	return true;
+}
+
+void LoopbackP2PTransport::Update()
+{
+	sSimulatedTime += kFrameDuration;
+}
+
+bool LoopbackP2PTransport::Send(
+	EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const EOS_P2P_SocketId& socketId,
+	uint8_t channel, EOS_EPacketReliability reliability, const void* data, uint32_t byteCount)
+{
+	// Validate.
+	if (!localUserId || !remoteUserId || (!data && (byteCount > 0)) || (byteCount > EOS_P2P_MAX_PACKET_SIZE))
+	{
+		return false;
+	}
+
+	// Always draw both random values, so that a given seed yields the same sequence regardless of settings.
+	std::uniform_real_distribution<double> unitDistribution(0.0, 1.0);
+	double lossRoll = unitDistribution(fRandomGenerator);
+	double jitterRoll = unitDistribution(fRandomGenerator);
+
+	// Determine when the packet is to be delivered.
+	// Lost unreliable packets are dropped, while lost reliable packets arrive late as if resent.
+	LoopbackTime delay = fLatency;
+	delay += std::chrono::duration_cast<LoopbackTime>(
+			std::chrono::duration<double, std::milli>(fJitter.count() * jitterRoll));
+	if (lossRoll < fLossRate)
+	{
+		if (reliability == EOS_EPacketReliability::EOS_PR_UnreliableUnordered)
+		{
+			fLostPacketCount++;
+			return true;
+		}
+		delay += fLatency * 2;
+	}
+	auto deliveryTime = sSimulatedTime + delay;
+
+	// Queue the packet for the receiving user, unless its queue is full.
+	// Like EOS, refuse reliable packets so that the caller knows they were not sent. Unreliable packets are lost.
+	auto& inbox = sInboxes[remoteUserId];
+	if (inbox.size() >= kMaxQueuedPacketCount)
+	{
+		if (reliability != EOS_EPacketReliability::EOS_PR_UnreliableUnordered)
+		{
+			return false;
+		}
+		fLostPacketCount++;
+		return true;
+	}
+
+	// Never deliver a reliable ordered packet ahead of the packets sent before it on the same stream.
+	if (reliability == EOS_EPacketReliability::EOS_PR_ReliableOrdered)
+	{
+		LoopbackStreamKey streamKey(localUserId, remoteUserId, std::string(socketId.SocketName), channel);
+		auto& lastDeliveryTime = sLastOrderedDeliveryTimes[streamKey];
+		deliveryTime = std::max(deliveryTime, lastDeliveryTime);
+		lastDeliveryTime = deliveryTime;
+	}
+	LoopbackPacket packet;
+	packet.SenderId = localUserId;
+	packet.SocketId = socketId;
+	packet.Channel = channel;
+	packet.Bytes.assign((const uint8_t*)data, (const uint8_t*)data + byteCount);
+
+	// Multimap inserts equal keys last, keeping ordered packets with the same delivery time in send order.
+	inbox.emplace(deliveryTime, std::move(packet));
+	return true;
+}
+
+bool LoopbackP2PTransport::Receive(
+	EOS_ProductUserId localUserId, const uint8_t* channelPointer, void* data, uint32_t maxByteCount,
+	EOS_ProductUserId& remoteUserId, EOS_P2P_SocketId& socketId, uint8_t& channel, uint32_t& byteCount)
+{
+	// Fetch the given user's queued packets.
+	byteCount = 0;
+	auto inboxIter = sInboxes.find(localUserId);
+	if (inboxIter == sInboxes.end())
+	{
+		return false;
+	}
+	auto& inbox = inboxIter->second;
+
+	// Find the first packet that is due and on the requested channel.
+	auto now = sSimulatedTime;
+	auto packetIter = inbox.begin();
+	for (; (packetIter != inbox.end()) && (packetIter->first <= now); packetIter++)
+	{
+		if (!channelPointer || (packetIter->second.Channel == *channelPointer))
+		{
+			break;
+		}
+	}
+	bool wasFound = (packetIter != inbox.end()) && (packetIter->first <= now);
+	if (!wasFound)
+	{
+		return false;
+	}
+
+	// Copy the packet to the caller and remove it from the queue.
+	auto& packet = packetIter->second;
+	remoteUserId = packet.SenderId;
+	socketId = packet.SocketId;
+	channel = packet.Channel;
+	byteCount = std::min((uint32_t)packet.Bytes.size(), maxByteCount);
+	if (data && (byteCount > 0))
+	{
+		memcpy(data, packet.Bytes.data(), byteCount);
+	}
+	inbox.erase(packetIter);
+	return true;
+}
+
+void LoopbackP2PTransport::ClearAll()
+{
+	sInboxes.clear();
+	sLastOrderedDeliveryTimes.clear();
+	sSimulatedTime = LoopbackTime(0);
+}
+
+std::string LoopbackP2PTransport::GenerateUserIdString()
+{
+	// Product user IDs are 32 hexadecimal digits. Use a fixed prefix unlikely to match a real user.
+	sGeneratedUserIdCount++;
+	std::stringstream stringStream;
+	stringStream << "100000000000000000000000";
+	stringStream.width(8);
+	stringStream.fill('0');
+	stringStream << std::hex << sGeneratedUserIdCount;
+	return stringStream.str();
+}
@@ -0,0 +1,117 @@
+// ----------------------------------------------------------------------------
+//
+// LoopbackP2PTransport.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include "P2PTransport.h"
+
+
+/**
+  Delivers packets between local users within the same process, without EOS or a network.
+
+  Intended for testing and benchmarking netcode, such as snapshot replication, by logging in several simulated users
+  in one app and exchanging packets between them. Every packet is delayed by the configured latency plus a random
+  jitter, and unreliable packets are randomly dropped at the configured loss rate. A reliable packet that would be
+  lost is delayed by 2 more latencies instead, simulating its resend, and reliable ordered packets are never delivered
+  ahead of earlier packets on the same channel.
+
+  Delays are measured by a simulated clock shared by all loopback transports, which advances by kFrameDuration every
+  time Update() is called, rather than by the system clock. Together with a random generator seeded via SetSeed(),
+  this makes which packets are lost and on which frame each packet arrives reproducible between runs,
+  regardless of the app's actual frame rate or hitches.
+  Packets sent by any loopback transport can be received by any other, since they share 1 in-process hub
+  keyed by product user ID.
+ */
+class LoopbackP2PTransport : public P2PTransport
+{
+	public:
+		/**
+		  Max number of packets queued per receiving user.
+		  Sending an unreliable packet to a full queue loses it, while sending a reliable packet fails.
+		 */
+		static const size_t kMaxQueuedPacketCount;
+
+		/** Amount of simulated time that passes every time Update() is called, which is once per frame. */
+		static const std::chrono::microseconds kFrameDuration;
+
+
+		/** Creates a new loopback transport with no simulated latency or loss. */
+		LoopbackP2PTransport();
+
+		/** Destroys this transport. Packets it sent that are still in flight are still delivered. */
+		virtual ~LoopbackP2PTransport();
+
+		/** Sets the simulated one-way delay of every packet. */
+		void SetLatency(std::chrono::milliseconds value);
+
+		/** Sets the max random delay added to each packet's latency. */
+		void SetJitter(std::chrono::milliseconds value);
+
+		/**
+		  Sets the fraction of packets that are lost.
+		  @param value The loss rate, clamped between 0 and 1.
+		 */
+		void SetLossRate(double value);
+
+		/** Re-seeds the random generator used to simulate jitter and loss. */
+		void SetSeed(uint32_t value);
+
+		/** Number of packets this transport sent that were lost or dropped by a full queue. */
+		uint64_t GetLostPacketCount() const;
+
+		/** Always returns true, since the loopback transport does not depend on EOS. */
+		virtual bool IsAvailable() const override;
+
+		/** Always returns true. */
+		virtual bool IsSimulated() const override;
+
+		/**
+		  Advances the simulated clock shared by all loopback transports by kFrameDuration,
+		  making packets whose delay has elapsed available to Receive().
+		 */
+		virtual void Update() override;
+
+		virtual bool Send(
+				EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const EOS_P2P_SocketId& socketId,
+				uint8_t channel, EOS_EPacketReliability reliability, const void* data, uint32_t byteCount) override;
+
+		virtual bool Receive(
+				EOS_ProductUserId localUserId, const uint8_t* channelPointer, void* data, uint32_t maxByteCount,
+				EOS_ProductUserId& remoteUserId, EOS_P2P_SocketId& socketId, uint8_t& channel,
+				uint32_t& byteCount) override;
+
+		/** Discards all packets in flight between all loopback transports and resets the simulated clock. */
+		static void ClearAll();
+
+		/**
+		  Generates a product user ID string for a simulated user, unique within this process.
+		  IDs are generated in the same order on every run, keeping tests reproducible.
+		 */
+		static std::string GenerateUserIdString();
+
+	private:
+		/** Simulated one-way delay of every packet. */
+		std::chrono::milliseconds fLatency;
+
+		/** Max random delay added to each packet's latency. */
+		std::chrono::milliseconds fJitter;
+
+		/** Fraction of packets lost, from 0 to 1. */
+		double fLossRate;
+
+		/** Generates the random values used to simulate jitter and loss. */
+		std::mt19937 fRandomGenerator;
+
+		/** Number of packets this transport sent that were lost. */
+		uint64_t fLostPacketCount;
+};
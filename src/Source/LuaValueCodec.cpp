@@ -0,0 +1,484 @@
+// ----------------------------------------------------------------------------
+//
+// LuaValueCodec.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "LuaValueCodec.h"
+#include "P2PWireFormat.h"
+#include <cmath>
+#include <cstring>
+extern "C"
+{
+#	include "lua.h"
+#	include "lauxlib.h"
+}
+
+
+//---------------------------------------------------------------------------------
+// Private Constants
+//---------------------------------------------------------------------------------
+
+/** Tag of a nil value. */
+static const uint8_t kTagNil = 0x00;
+
+/** Tag of a false boolean. */
+static const uint8_t kTagFalse = 0x01;
+
+/** Tag of a true boolean. */
+static const uint8_t kTagTrue = 0x02;
+
+/** Tag of a positive integer, followed by its value as a variable length integer. */
+static const uint8_t kTagPositiveInteger = 0x03;
+
+/** Tag of a negative integer, followed by "-(value + 1)" as a variable length integer. */
+static const uint8_t kTagNegativeInteger = 0x04;
+
+/** Tag of a number with a fraction, followed by its 8 byte little-endian IEEE 754 representation. */
+static const uint8_t kTagDouble = 0x05;
+
+/** Tag of a string not written yet, followed by its byte count and bytes. Assigned the next string index. */
+static const uint8_t kTagString = 0x06;
+
+/** Tag of a string already written, followed by its string index. */
+static const uint8_t kTagStringReference = 0x07;
+
+/** Tag of a table with keys 1 to N, followed by N and the N values. */
+static const uint8_t kTagArray = 0x08;
+
+/** Tag of any other table, followed by its number of entries and each entry's key and value. */
+static const uint8_t kTagMap = 0x09;
+
+/** Bit set in the tag of an integer from 0 to 127, which is stored in the tag's remaining bits. */
+static const uint8_t kTagSmallIntegerFlag = 0x80;
+
+/** Max number of tables a value can be nested in. */
+static const int kMaxDepth = 32;
+
+/** Integers with a larger magnitude than this cannot be represented exactly by a double. */
+static const double kMaxExactInteger = 9007199254740992.0;
+
+
+//---------------------------------------------------------------------------------
+// Private Static Functions
+//---------------------------------------------------------------------------------
+
+/** Provides the state of a call to LuaValueCodec::Decode(). */
+struct DecodeState
+{
+	/** The bytes being decoded. */
+	const uint8_t* Bytes;
+
+	/** Number of bytes being decoded. */
+	uint32_t ByteCount;
+
+	/** Offset of the next byte to read. */
+	uint32_t Offset;
+
+	/** Offset and length of every string read so far, in string index order. */
+	std::vector<std::pair<uint32_t, uint32_t>> Strings;
+};
+
+/** Reads a variable length integer via P2PWireFormat, advancing the given decode state's offset past it. */
+static bool ReadVarUIntFrom(DecodeState& state, uint64_t& value)
+{
+	return P2PWireFormat::ReadVarUIntFrom(state.Bytes, state.ByteCount, state.Offset, value);
+}
+
+/**
+  Reads a count or length which cannot exceed the number of bytes left to decode.
+  Guards against malformed data making the decoder allocate huge tables.
+ */
+static bool ReadCountFrom(DecodeState& state, uint32_t& count)
+{
+	uint64_t value = 0;
+	if (!ReadVarUIntFrom(state, value) || (value > (uint64_t)(state.ByteCount - state.Offset)))
+	{
+		return false;
+	}
+	count = (uint32_t)value;
+	return true;
+}
+
+/**
+  Reads the next value and pushes it to the top of the Lua stack.
+  @param luaStatePointer The Lua state to push the value to.
+  @param state The decode state to read from.
+  @param depth Number of tables the value is nested in.
+  @return Returns true if a value was pushed. Returns false if the bytes are malformed, in which case
+          nothing is pushed.
+ */
+static bool ReadValueFrom(lua_State* luaStatePointer, DecodeState& state, int depth)
+{
+	// Make sure the stack has room for the value and, if it is a table, its key and value.
+	if ((depth > kMaxDepth) || !lua_checkstack(luaStatePointer, 3) || (state.Offset >= state.ByteCount))
+	{
+		return false;
+	}
+
+	// Read the value's tag.
+	auto tag = state.Bytes[state.Offset++];
+	if (tag & kTagSmallIntegerFlag)
+	{
+		lua_pushinteger(luaStatePointer, tag & ~kTagSmallIntegerFlag);
+		return true;
+	}
+
+	// Read the rest of the value.
+	switch (tag)
+	{
+		case kTagNil:
+		{
+			lua_pushnil(luaStatePointer);
+			return true;
+		}
+		case kTagFalse:
+		case kTagTrue:
+		{
+			lua_pushboolean(luaStatePointer, (tag == kTagTrue) ? 1 : 0);
+			return true;
+		}
+		case kTagPositiveInteger:
+		case kTagNegativeInteger:
+		{
+			uint64_t value = 0;
+			if (!ReadVarUIntFrom(state, value))
+			{
+				return false;
+			}
+			double number = (double)value;
+			lua_pushnumber(luaStatePointer, (tag == kTagNegativeInteger) ? (-number - 1.0) : number);
+			return true;
+		}
+		case kTagDouble:
+		{
+			if ((state.ByteCount - state.Offset) < 8)
+			{
+				return false;
+			}
+			uint64_t bits = 0;
+			for (int index = 7; index >= 0; index--)
+			{
+				bits = (bits << 8) | state.Bytes[state.Offset + index];
+			}
+			state.Offset += 8;
+			double number;
+			memcpy(&number, &bits, sizeof(number));
+			lua_pushnumber(luaStatePointer, number);
+			return true;
+		}
+		case kTagString:
+		{
+			uint32_t length = 0;
+			if (!ReadCountFrom(state, length))
+			{
+				return false;
+			}
+			lua_pushlstring(luaStatePointer, (const char*)state.Bytes + state.Offset, length);
+			if (length > 0)
+			{
+				state.Strings.push_back(std::make_pair(state.Offset, length));
+			}
+			state.Offset += length;
+			return true;
+		}
+		case kTagStringReference:
+		{
+			uint64_t index = 0;
+			if (!ReadVarUIntFrom(state, index) || (index >= (uint64_t)state.Strings.size()))
+			{
+				return false;
+			}
+			auto& entry = state.Strings[(size_t)index];
+			lua_pushlstring(luaStatePointer, (const char*)state.Bytes + entry.first, entry.second);
+			return true;
+		}
+		case kTagArray:
+		{
+			uint32_t count = 0;
+			if (!ReadCountFrom(state, count))
+			{
+				return false;
+			}
+			lua_createtable(luaStatePointer, (int)count, 0);
+			for (uint32_t index = 1; index <= count; index++)
+			{
+				if (!ReadValueFrom(luaStatePointer, state, depth + 1))
+				{
+					lua_pop(luaStatePointer, 1);
+					return false;
+				}
+				lua_rawseti(luaStatePointer, -2, (int)index);
+			}
+			return true;
+		}
+		case kTagMap:
+		{
+			uint32_t count = 0;
+			if (!ReadCountFrom(state, count))
+			{
+				return false;
+			}
+			lua_createtable(luaStatePointer, 0, (int)count);
+			for (uint32_t index = 0; index < count; index++)
+			{
+				if (!ReadValueFrom(luaStatePointer, state, depth + 1))
+				{
+					lua_pop(luaStatePointer, 1);
+					return false;
+				}
+				if (!ReadValueFrom(luaStatePointer, state, depth + 1))
+				{
+					lua_pop(luaStatePointer, 2);
+					return false;
+				}
+				bool isInvalidKey =
+						lua_isnil(luaStatePointer, -2) ||
+						((lua_type(luaStatePointer, -2) == LUA_TNUMBER) &&
+						 std::isnan(lua_tonumber(luaStatePointer, -2)));
+				if (isInvalidKey)
+				{
+					lua_pop(luaStatePointer, 3);
+					return false;
+				}
+				lua_rawset(luaStatePointer, -3);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+
+//---------------------------------------------------------------------------------
+// LuaValueCodec Class Members
+//---------------------------------------------------------------------------------
+
+LuaValueCodec::LuaValueCodec()
+{
+}
+
+LuaValueCodec::~LuaValueCodec()
+{
+}
+
+bool LuaValueCodec::Encode(lua_State* luaStatePointer, int luaIndex)
+{
+	// Validate.
+	fBytes.clear();
+	fStringIndices.clear();
+	fErrorMessage.clear();
+	if (!luaStatePointer)
+	{
+		fErrorMessage = "Lua state is null.";
+		return false;
+	}
+
+	// Convert a relative index to an absolute index, since encoding tables pushes values to the stack.
+	if ((luaIndex < 0) && (luaIndex > LUA_REGISTRYINDEX))
+	{
+		luaIndex = lua_gettop(luaStatePointer) + luaIndex + 1;
+	}
+
+	// Encode the value.
+	bool wasEncoded = WriteValue(luaStatePointer, luaIndex, 0);
+	fStringIndices.clear();
+	if (!wasEncoded)
+	{
+		fBytes.clear();
+	}
+	return wasEncoded;
+}
+
+const std::vector<uint8_t>& LuaValueCodec::GetBytes() const
+{
+	return fBytes;
+}
+
+const std::string& LuaValueCodec::GetErrorMessage() const
+{
+	return fErrorMessage;
+}
+
+bool LuaValueCodec::Decode(lua_State* luaStatePointer, const uint8_t* bytes, uint32_t byteCount)
+{
+	// Validate.
+	if (!luaStatePointer || !bytes || (byteCount <= 0))
+	{
+		return false;
+	}
+
+	// Decode the value, making sure that it used up all of the given bytes.
+	DecodeState state;
+	state.Bytes = bytes;
+	state.ByteCount = byteCount;
+	state.Offset = 0;
+	if (!ReadValueFrom(luaStatePointer, state, 0))
+	{
+		return false;
+	}
+	if (state.Offset != state.ByteCount)
+	{
+		lua_pop(luaStatePointer, 1);
+		return false;
+	}
+	return true;
+}
+
+bool LuaValueCodec::WriteValue(lua_State* luaStatePointer, int luaIndex, int depth)
+{
+	switch (lua_type(luaStatePointer, luaIndex))
+	{
+		case LUA_TNIL:
+		{
+			fBytes.push_back(kTagNil);
+			return true;
+		}
+		case LUA_TBOOLEAN:
+		{
+			fBytes.push_back(lua_toboolean(luaStatePointer, luaIndex) ? kTagTrue : kTagFalse);
+			return true;
+		}
+		case LUA_TNUMBER:
+		{
+			// Write whole numbers as variable length integers, if they can be represented exactly.
+			double number = lua_tonumber(luaStatePointer, luaIndex);
+			bool isInteger = (std::floor(number) == number) && (std::fabs(number) < kMaxExactInteger);
+			if (isInteger && (number >= 0) && (number < kTagSmallIntegerFlag))
+			{
+				fBytes.push_back(kTagSmallIntegerFlag | (uint8_t)number);
+			}
+			else if (isInteger && (number >= 0))
+			{
+				fBytes.push_back(kTagPositiveInteger);
+				P2PWireFormat::WriteVarUIntTo(fBytes, (uint64_t)number);
+			}
+			else if (isInteger)
+			{
+				fBytes.push_back(kTagNegativeInteger);
+				P2PWireFormat::WriteVarUIntTo(fBytes, (uint64_t)(-number - 1.0));
+			}
+			else
+			{
+				uint64_t bits;
+				memcpy(&bits, &number, sizeof(bits));
+				fBytes.push_back(kTagDouble);
+				for (int index = 0; index < 8; index++)
+				{
+					fBytes.push_back((uint8_t)(bits >> (index * 8)));
+				}
+			}
+			return true;
+		}
+		case LUA_TSTRING:
+		{
+			size_t length = 0;
+			auto text = lua_tolstring(luaStatePointer, luaIndex, &length);
+			WriteString(text, length);
+			return true;
+		}
+		case LUA_TTABLE:
+		{
+			// Validate.
+			if (depth >= kMaxDepth)
+			{
+				fErrorMessage = "Tables are nested too deeply or reference themselves.";
+				return false;
+			}
+			if (!lua_checkstack(luaStatePointer, 2))
+			{
+				fErrorMessage = "Lua stack overflow.";
+				return false;
+			}
+
+			// Count the table's entries to determine if it is an array, meaning that its only keys are 1 to N.
+			auto arrayLength = (uint64_t)lua_objlen(luaStatePointer, luaIndex);
+			uint64_t entryCount = 0;
+			uint64_t arrayEntryCount = 0;
+			lua_pushnil(luaStatePointer);
+			while (lua_next(luaStatePointer, luaIndex))
+			{
+				entryCount++;
+				if (lua_type(luaStatePointer, -2) == LUA_TNUMBER)
+				{
+					double key = lua_tonumber(luaStatePointer, -2);
+					bool isArrayKey = (std::floor(key) == key) && (key >= 1) && (key <= (double)arrayLength);
+					if (isArrayKey)
+					{
+						arrayEntryCount++;
+					}
+				}
+				lua_pop(luaStatePointer, 1);
+			}
+
+			// Write an array's values in order, without their keys.
+			if ((entryCount == arrayLength) && (arrayEntryCount == arrayLength))
+			{
+				fBytes.push_back(kTagArray);
+				P2PWireFormat::WriteVarUIntTo(fBytes, arrayLength);
+				for (int index = 1; index <= (int)arrayLength; index++)
+				{
+					lua_rawgeti(luaStatePointer, luaIndex, index);
+					bool wasWritten = WriteValue(luaStatePointer, lua_gettop(luaStatePointer), depth + 1);
+					lua_pop(luaStatePointer, 1);
+					if (!wasWritten)
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+
+			// Write every other table's keys and values.
+			fBytes.push_back(kTagMap);
+			P2PWireFormat::WriteVarUIntTo(fBytes, entryCount);
+			lua_pushnil(luaStatePointer);
+			while (lua_next(luaStatePointer, luaIndex))
+			{
+				int valueIndex = lua_gettop(luaStatePointer);
+				bool wasWritten =
+						WriteValue(luaStatePointer, valueIndex - 1, depth + 1) &&
+						WriteValue(luaStatePointer, valueIndex, depth + 1);
+				lua_pop(luaStatePointer, 1);
+				if (!wasWritten)
+				{
+					lua_pop(luaStatePointer, 1);
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+
+	// The value's type cannot be sent to another peer, such as a function or userdata.
+	fErrorMessage = "Cannot encode a value of type '";
+	fErrorMessage += lua_typename(luaStatePointer, lua_type(luaStatePointer, luaIndex));
+	fErrorMessage += "'.";
+	return false;
+}
+
+void LuaValueCodec::WriteString(const char* text, size_t length)
+{
+	// Write a reference to the string if it was already written.
+	if (length > 0)
+	{
+		fStringKey.assign(text, length);
+		auto iterator = fStringIndices.find(fStringKey);
+		if (iterator != fStringIndices.end())
+		{
+			fBytes.push_back(kTagStringReference);
+			P2PWireFormat::WriteVarUIntTo(fBytes, iterator->second);
+			return;
+		}
+		auto index = (uint32_t)fStringIndices.size();
+		fStringIndices[fStringKey] = index;
+	}
+
+	// Write the string's bytes.
+	fBytes.push_back(kTagString);
+	P2PWireFormat::WriteVarUIntTo(fBytes, length);
+	fBytes.insert(fBytes.end(), (const uint8_t*)text, (const uint8_t*)text + length);
+}
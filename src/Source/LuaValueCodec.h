@@ -0,0 +1,105 @@
+// ----------------------------------------------------------------------------
+//
+// LuaValueCodec.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// Forward declarations.
+extern "C"
+{
+	struct lua_State;
+}
+
+
+/**
+  Serializes Lua values, including nested tables, to a compact binary format and back.
+  Intended to replace json.encode() and json.decode() for data sent between peers via P2P.
+
+  The format is similar to MessagePack. Every value starts with a 1 byte tag. Integers, lengths, and counts are
+  written as variable length integers, so that small values take a single byte. Every distinct string is written
+  once per encoded value and then referenced by index, which makes repeated table keys nearly free.
+
+  Supports nil, booleans, numbers, strings, and tables whose keys and values are of these types.
+  Tables whose keys are exactly 1 to N are written as arrays, without their keys.
+
+  An encoder instance re-uses its memory between calls, so it is meant to be kept for the life of the plugin.
+ */
+class LuaValueCodec
+{
+	public:
+		/** Creates a new codec. */
+		LuaValueCodec();
+
+		/** Destroys this codec. */
+		virtual ~LuaValueCodec();
+
+		/**
+		  Encodes the Lua value at the given index of the Lua stack, replacing this codec's last encoded bytes.
+		  @param luaStatePointer The Lua state the value belongs to.
+		  @param luaIndex Index to the value to encode.
+		  @return Returns true if the value was encoded. Its bytes can then be fetched via GetBytes().
+
+		          Returns false if the value contains an unsupported type, such as a function, or if its tables
+		          are nested too deeply, which includes tables referencing themselves. GetErrorMessage() then
+		          describes why.
+		 */
+		bool Encode(lua_State* luaStatePointer, int luaIndex);
+
+		/** Gets the bytes written by the last successful call to Encode(). */
+		const std::vector<uint8_t>& GetBytes() const;
+
+		/** Gets a description of why the last call to Encode() failed. Empty if it succeeded. */
+		const std::string& GetErrorMessage() const;
+
+		/**
+		  Decodes the given bytes and pushes the resulting Lua value to the top of the Lua stack.
+		  @param luaStatePointer The Lua state to push the value to.
+		  @param bytes Pointer to the encoded bytes.
+		  @param byteCount Number of bytes to decode.
+		  @return Returns true if a value was pushed. Returns false if the bytes are malformed, in which
+		          case nothing is pushed.
+		 */
+		static bool Decode(lua_State* luaStatePointer, const uint8_t* bytes, uint32_t byteCount);
+
+	private:
+		/** Copy constructor deleted to prevent it from being called. */
+		LuaValueCodec(const LuaValueCodec&) = delete;
+
+		/** Method deleted to prevent the copy operator from being used. */
+		void operator=(const LuaValueCodec&) = delete;
+
+		/**
+		  Appends the given Lua value to "fBytes".
+		  @param luaStatePointer The Lua state the value belongs to.
+		  @param luaIndex Absolute index to the value to encode.
+		  @param depth Number of tables the value is nested in.
+		  @return Returns true if the value was written. Returns false if not, after assigning "fErrorMessage".
+		 */
+		bool WriteValue(lua_State* luaStatePointer, int luaIndex, int depth);
+
+		/** Appends the given string to "fBytes", or a reference to it if it was already written. */
+		void WriteString(const char* text, size_t length);
+
+		/** Bytes written by the last call to Encode(). */
+		std::vector<uint8_t> fBytes;
+
+		/** Strings written by the current call to Encode(), mapped to the index they are referenced by. */
+		std::unordered_map<std::string, uint32_t> fStringIndices;
+
+		/** Scratch string used to look up "fStringIndices" without allocating on every lookup. */
+		std::string fStringKey;
+
+		/** Describes why the last call to Encode() failed. */
+		std::string fErrorMessage;
+};
@@ -0,0 +1,525 @@
+// ----------------------------------------------------------------------------
+//
+// P2PConnectionManager.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "P2PConnectionManager.h"
+#include "DispatchEventTask.h"
+#include "LocalUserSession.h"
+#include "P2PWireFormat.h"
+#include "RuntimeContext.h"
+#include <memory>
+#include "eos_p2p.h"
+
+
+//---------------------------------------------------------------------------------
+// Private Static Variables
+//---------------------------------------------------------------------------------
+
+/** Collection of all connection managers that currently exist, used to ignore EOS callbacks for deleted managers. */
+static std::unordered_set<P2PConnectionManager*> sConnectionManagerCollection;
+
+
+//---------------------------------------------------------------------------------
+// P2PConnectionManager Class Members
+//---------------------------------------------------------------------------------
+
+P2PConnectionManager::P2PConnectionManager(RuntimeContext& context)
+:	fContext(context),
+	fAutoAcceptPolicy(AutoAcceptPolicy::kNone)
+{
+	sConnectionManagerCollection.insert(this);
+}
+
+P2PConnectionManager::~P2PConnectionManager()
+{
+	// Remove this manager from the global collection, causing EOS callbacks to be ignored.
+	sConnectionManagerCollection.erase(this);
+
+	// Stop listening to all local users' connection notifications.
+	for (auto&& pair : fUserNotifications)
+	{
+		RemoveNotifications(pair.second);
+	}
+	fUserNotifications.clear();
+}
+
+bool P2PConnectionManager::AcceptConnection(
+	LocalUserSession& session, EOS_ProductUserId remoteUserId, const char* socketName)
+{
+	// Validate.
+	auto p2pHandle = GetP2PHandle();
+	if (!p2pHandle || !session.GetProductUserId() || !remoteUserId)
+	{
+		return false;
+	}
+	EOS_P2P_SocketId socketId;
+	if (!P2PWireFormat::CopySocketIdFrom(socketName, socketId))
+	{
+		return false;
+	}
+
+	// Accept the connection.
+	EOS_P2P_AcceptConnectionOptions options = {};
+	options.ApiVersion = EOS_P2P_ACCEPTCONNECTION_API_LATEST;
+	options.LocalUserId = session.GetProductUserId();
+	options.RemoteUserId = remoteUserId;
+	options.SocketId = &socketId;
+	if (EOS_P2P_AcceptConnection(p2pHandle, &options) != EOS_EResult::EOS_Success)
+	{
+		return false;
+	}
+
+	// Flag the connection as accepted, unless it is already further along.
+	auto& connection = fConnections[ConnectionKey(session.GetProductUserId(), remoteUserId, socketName)];
+	if (connection.State < ConnectionState::kAccepted)
+	{
+		connection.State = ConnectionState::kAccepted;
+	}
+	return true;
+}
+
+bool P2PConnectionManager::CloseConnection(
+	LocalUserSession& session, EOS_ProductUserId remoteUserId, const char* socketName)
+{
+	// Validate.
+	auto p2pHandle = GetP2PHandle();
+	auto localUserId = session.GetProductUserId();
+	if (!p2pHandle || !localUserId || !remoteUserId)
+	{
+		return false;
+	}
+	EOS_P2P_SocketId socketId;
+	if (socketName && !P2PWireFormat::CopySocketIdFrom(socketName, socketId))
+	{
+		return false;
+	}
+
+	// Close the connection on the given socket, or on all sockets if not given.
+	EOS_P2P_CloseConnectionOptions options = {};
+	options.ApiVersion = EOS_P2P_CLOSECONNECTION_API_LATEST;
+	options.LocalUserId = localUserId;
+	options.RemoteUserId = remoteUserId;
+	options.SocketId = socketName ? &socketId : nullptr;
+	if (EOS_P2P_CloseConnection(p2pHandle, &options) != EOS_EResult::EOS_Success)
+	{
+		return false;
+	}
+
+	// Forget the closed connections.
+	if (socketName)
+	{
+		fConnections.erase(ConnectionKey(localUserId, remoteUserId, socketName));
+	}
+	else
+	{
+		auto iterator = fConnections.lower_bound(ConnectionKey(localUserId, remoteUserId, std::string()));
+		while (iterator != fConnections.end())
+		{
+			bool isMatch =
+					(std::get<0>(iterator->first) == localUserId) && (std::get<1>(iterator->first) == remoteUserId);
+			if (!isMatch)
+			{
+				break;
+			}
+			iterator = fConnections.erase(iterator);
+		}
+	}
+	return true;
+}
+
+P2PConnectionManager::ConnectionInfo P2PConnectionManager::GetConnectionInfo(
+	EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const char* socketName) const
+{
+	ConnectionInfo connection = {};
+	connection.State = ConnectionState::kNone;
+	connection.NetworkType = EOS_ENetworkConnectionType::EOS_NCT_NoConnection;
+
+	// Fetch the connection on the given socket.
+	if (socketName)
+	{
+		auto iterator = fConnections.find(ConnectionKey(localUserId, remoteUserId, socketName));
+		if (iterator != fConnections.end())
+		{
+			connection = iterator->second;
+		}
+		return connection;
+	}
+
+	// Fetch the most connected of the peer's sockets. Connections are sorted by local user, peer, and then socket.
+	auto iterator = fConnections.lower_bound(ConnectionKey(localUserId, remoteUserId, std::string()));
+	for (; iterator != fConnections.end(); iterator++)
+	{
+		bool isMatch = (std::get<0>(iterator->first) == localUserId) && (std::get<1>(iterator->first) == remoteUserId);
+		if (!isMatch)
+		{
+			break;
+		}
+		if (iterator->second.State > connection.State)
+		{
+			connection = iterator->second;
+		}
+	}
+	return connection;
+}
+
+P2PConnectionManager::AutoAcceptPolicy P2PConnectionManager::GetAutoAcceptPolicy() const
+{
+	return fAutoAcceptPolicy;
+}
+
+void P2PConnectionManager::SetAutoAcceptPolicy(AutoAcceptPolicy value)
+{
+	fAutoAcceptPolicy = value;
+}
+
+void P2PConnectionManager::SetAutoAcceptPeers(const std::vector<EOS_ProductUserId>& remoteUserIds)
+{
+	fAutoAcceptPeerIds.clear();
+	for (auto&& remoteUserId : remoteUserIds)
+	{
+		if (remoteUserId)
+		{
+			fAutoAcceptPeerIds.insert(remoteUserId);
+		}
+	}
+}
+
+void P2PConnectionManager::Update()
+{
+	// Validate.
+	if (!GetP2PHandle())
+	{
+		return;
+	}
+
+	// Listen to the connections of local users that have logged into Connect since the last frame.
+	// Simulated users are skipped since EOS does not know them.
+	auto sessions = fContext.GetLocalUsers();
+	for (auto sessionPointer : sessions)
+	{
+		auto localUserId = sessionPointer->GetProductUserId();
+		bool isNewUser =
+				localUserId && !sessionPointer->IsSimulated() &&
+				(fUserNotifications.find(localUserId) == fUserNotifications.end());
+		if (isNewUser)
+		{
+			fUserNotifications[localUserId] = AddNotificationsFor(localUserId);
+		}
+	}
+
+	// Stop listening for local users that have logged out, forgetting their connections.
+	for (auto iterator = fUserNotifications.begin(); iterator != fUserNotifications.end();)
+	{
+		auto localUserId = iterator->first;
+		bool isLoggedIn = false;
+		for (auto sessionPointer : sessions)
+		{
+			if (sessionPointer->GetProductUserId() == localUserId)
+			{
+				isLoggedIn = true;
+				break;
+			}
+		}
+		if (isLoggedIn)
+		{
+			iterator++;
+			continue;
+		}
+		RemoveNotifications(iterator->second);
+		iterator = fUserNotifications.erase(iterator);
+		for (auto connectionIterator = fConnections.begin(); connectionIterator != fConnections.end();)
+		{
+			bool isUsersConnection = (std::get<0>(connectionIterator->first) == localUserId);
+			connectionIterator = isUsersConnection ? fConnections.erase(connectionIterator) : std::next(connectionIterator);
+		}
+	}
+}
+
+const char* P2PConnectionManager::GetNameOf(ConnectionState value)
+{
+	switch (value)
+	{
+		case ConnectionState::kRequested:
+			return "requested";
+		case ConnectionState::kAccepted:
+			return "accepted";
+		case ConnectionState::kInterrupted:
+			return "interrupted";
+		case ConnectionState::kConnected:
+			return "connected";
+		default:
+			break;
+	}
+	return "none";
+}
+
+const char* P2PConnectionManager::GetNameOf(EOS_ENetworkConnectionType value)
+{
+	switch (value)
+	{
+		case EOS_ENetworkConnectionType::EOS_NCT_DirectConnection:
+			return "direct";
+		case EOS_ENetworkConnectionType::EOS_NCT_RelayedConnection:
+			return "relayed";
+		default:
+			break;
+	}
+	return "none";
+}
+
+const char* P2PConnectionManager::GetNameOf(EOS_EConnectionClosedReason value)
+{
+	switch (value)
+	{
+		case EOS_EConnectionClosedReason::EOS_CCR_ClosedByLocalUser:
+			return "closedByLocalUser";
+		case EOS_EConnectionClosedReason::EOS_CCR_ClosedByPeer:
+			return "closedByPeer";
+		case EOS_EConnectionClosedReason::EOS_CCR_TimedOut:
+			return "timedOut";
+		case EOS_EConnectionClosedReason::EOS_CCR_TooManyConnections:
+			return "tooManyConnections";
+		case EOS_EConnectionClosedReason::EOS_CCR_InvalidMessage:
+			return "invalidMessage";
+		case EOS_EConnectionClosedReason::EOS_CCR_InvalidData:
+			return "invalidData";
+		case EOS_EConnectionClosedReason::EOS_CCR_ConnectionFailed:
+			return "connectionFailed";
+		case EOS_EConnectionClosedReason::EOS_CCR_ConnectionClosed:
+			return "connectionClosed";
+		case EOS_EConnectionClosedReason::EOS_CCR_NegotiationFailed:
+			return "negotiationFailed";
+		case EOS_EConnectionClosedReason::EOS_CCR_UnexpectedError:
+			return "unexpectedError";
+		default:
+			break;
+	}
+	return "unknown";
+}
+
+EOS_HP2P P2PConnectionManager::GetP2PHandle() const
+{
+	if (!fContext.fPlatformHandle)
+	{
+		return nullptr;
+	}
+	return EOS_Platform_GetP2PInterface(fContext.fPlatformHandle);
+}
+
+P2PConnectionManager::UserNotifications P2PConnectionManager::AddNotificationsFor(EOS_ProductUserId localUserId)
+{
+	UserNotifications notifications = {};
+	auto p2pHandle = GetP2PHandle();
+	if (!p2pHandle)
+	{
+		return notifications;
+	}
+	{
+		EOS_P2P_AddNotifyPeerConnectionRequestOptions options = {};
+		options.ApiVersion = EOS_P2P_ADDNOTIFYPEERCONNECTIONREQUEST_API_LATEST;
+		options.LocalUserId = localUserId;
+		notifications.RequestId = EOS_P2P_AddNotifyPeerConnectionRequest(
+				p2pHandle, &options, this, &P2PConnectionManager::OnConnectionRequestCallback);
+	}
+	{
+		EOS_P2P_AddNotifyPeerConnectionEstablishedOptions options = {};
+		options.ApiVersion = EOS_P2P_ADDNOTIFYPEERCONNECTIONESTABLISHED_API_LATEST;
+		options.LocalUserId = localUserId;
+		notifications.EstablishedId = EOS_P2P_AddNotifyPeerConnectionEstablished(
+				p2pHandle, &options, this, &P2PConnectionManager::OnConnectionEstablishedCallback);
+	}
+	{
+		EOS_P2P_AddNotifyPeerConnectionInterruptedOptions options = {};
+		options.ApiVersion = EOS_P2P_ADDNOTIFYPEERCONNECTIONINTERRUPTED_API_LATEST;
+		options.LocalUserId = localUserId;
+		notifications.InterruptedId = EOS_P2P_AddNotifyPeerConnectionInterrupted(
+				p2pHandle, &options, this, &P2PConnectionManager::OnConnectionInterruptedCallback);
+	}
+	{
+		EOS_P2P_AddNotifyPeerConnectionClosedOptions options = {};
+		options.ApiVersion = EOS_P2P_ADDNOTIFYPEERCONNECTIONCLOSED_API_LATEST;
+		options.LocalUserId = localUserId;
+		notifications.ClosedId = EOS_P2P_AddNotifyPeerConnectionClosed(
+				p2pHandle, &options, this, &P2PConnectionManager::OnConnectionClosedCallback);
+	}
+	return notifications;
+}
+
+void P2PConnectionManager::RemoveNotifications(const UserNotifications& notifications)
+{
+	auto p2pHandle = GetP2PHandle();
+	if (!p2pHandle)
+	{
+		return;
+	}
+	if (notifications.RequestId != EOS_INVALID_NOTIFICATIONID)
+	{
+		EOS_P2P_RemoveNotifyPeerConnectionRequest(p2pHandle, notifications.RequestId);
+	}
+	if (notifications.EstablishedId != EOS_INVALID_NOTIFICATIONID)
+	{
+		EOS_P2P_RemoveNotifyPeerConnectionEstablished(p2pHandle, notifications.EstablishedId);
+	}
+	if (notifications.InterruptedId != EOS_INVALID_NOTIFICATIONID)
+	{
+		EOS_P2P_RemoveNotifyPeerConnectionInterrupted(p2pHandle, notifications.InterruptedId);
+	}
+	if (notifications.ClosedId != EOS_INVALID_NOTIFICATIONID)
+	{
+		EOS_P2P_RemoveNotifyPeerConnectionClosed(p2pHandle, notifications.ClosedId);
+	}
+}
+
+bool P2PConnectionManager::CanAutoAccept(EOS_ProductUserId remoteUserId) const
+{
+	switch (fAutoAcceptPolicy)
+	{
+		case AutoAcceptPolicy::kAll:
+			return true;
+		case AutoAcceptPolicy::kAllowedPeers:
+			return (fAutoAcceptPeerIds.find(remoteUserId) != fAutoAcceptPeerIds.end());
+		default:
+			break;
+	}
+	return false;
+}
+
+P2PConnectionManager* P2PConnectionManager::GetInstanceBy(void* clientData)
+{
+	auto managerPointer = (P2PConnectionManager*)clientData;
+	if (sConnectionManagerCollection.find(managerPointer) == sConnectionManagerCollection.end())
+	{
+		return nullptr;
+	}
+	return managerPointer;
+}
+
+void EOS_CALL P2PConnectionManager::OnConnectionRequestCallback(const EOS_P2P_OnIncomingConnectionRequestInfo* data)
+{
+	// Validate.
+	if (!data || !data->SocketId)
+	{
+		return;
+	}
+	auto managerPointer = GetInstanceBy(data->ClientData);
+	if (!managerPointer)
+	{
+		return;
+	}
+	auto sessionPointer = managerPointer->fContext.GetLocalUserBy(data->LocalUserId);
+	if (!sessionPointer)
+	{
+		return;
+	}
+
+	// Record the request and, if the policy allows it, accept it right away instead of waiting for Lua.
+	auto& connection = managerPointer->fConnections[
+			ConnectionKey(data->LocalUserId, data->RemoteUserId, data->SocketId->SocketName)];
+	if (connection.State < ConnectionState::kRequested)
+	{
+		connection.State = ConnectionState::kRequested;
+	}
+	bool wasAccepted =
+			managerPointer->CanAutoAccept(data->RemoteUserId) &&
+			managerPointer->AcceptConnection(*sessionPointer, data->RemoteUserId, data->SocketId->SocketName);
+
+	// Notify Lua.
+	auto taskPointer = std::make_shared<DispatchP2PConnectionEventTask>();
+	taskPointer->AcquireEventDataFrom(sessionPointer->GetUserHandle(), *data, wasAccepted);
+	managerPointer->fContext.QueueDispatchEventTask(taskPointer);
+}
+
+void EOS_CALL P2PConnectionManager::OnConnectionEstablishedCallback(
+	const EOS_P2P_OnPeerConnectionEstablishedInfo* data)
+{
+	// Validate.
+	if (!data || !data->SocketId)
+	{
+		return;
+	}
+	auto managerPointer = GetInstanceBy(data->ClientData);
+	if (!managerPointer)
+	{
+		return;
+	}
+	auto sessionPointer = managerPointer->fContext.GetLocalUserBy(data->LocalUserId);
+	if (!sessionPointer)
+	{
+		return;
+	}
+
+	// Update the connection's state.
+	auto& connection = managerPointer->fConnections[
+			ConnectionKey(data->LocalUserId, data->RemoteUserId, data->SocketId->SocketName)];
+	connection.State = ConnectionState::kConnected;
+	connection.NetworkType = data->NetworkType;
+
+	// Notify Lua.
+	auto taskPointer = std::make_shared<DispatchP2PConnectionEventTask>();
+	taskPointer->AcquireEventDataFrom(sessionPointer->GetUserHandle(), *data);
+	managerPointer->fContext.QueueDispatchEventTask(taskPointer);
+}
+
+void EOS_CALL P2PConnectionManager::OnConnectionInterruptedCallback(
+	const EOS_P2P_OnPeerConnectionInterruptedInfo* data)
+{
+	// Validate.
+	if (!data || !data->SocketId)
+	{
+		return;
+	}
+	auto managerPointer = GetInstanceBy(data->ClientData);
+	if (!managerPointer)
+	{
+		return;
+	}
+	auto sessionPointer = managerPointer->fContext.GetLocalUserBy(data->LocalUserId);
+	if (!sessionPointer)
+	{
+		return;
+	}
+
+	// Update the connection's state. EOS keeps trying to re-establish it until it gets closed.
+	auto& connection = managerPointer->fConnections[
+			ConnectionKey(data->LocalUserId, data->RemoteUserId, data->SocketId->SocketName)];
+	connection.State = ConnectionState::kInterrupted;
+	connection.NetworkType = EOS_ENetworkConnectionType::EOS_NCT_NoConnection;
+
+	// Notify Lua.
+	auto taskPointer = std::make_shared<DispatchP2PConnectionEventTask>();
+	taskPointer->AcquireEventDataFrom(sessionPointer->GetUserHandle(), *data);
+	managerPointer->fContext.QueueDispatchEventTask(taskPointer);
+}
+
+void EOS_CALL P2PConnectionManager::OnConnectionClosedCallback(const EOS_P2P_OnRemoteConnectionClosedInfo* data)
+{
+	// Validate.
+	if (!data || !data->SocketId)
+	{
+		return;
+	}
+	auto managerPointer = GetInstanceBy(data->ClientData);
+	if (!managerPointer)
+	{
+		return;
+	}
+	auto sessionPointer = managerPointer->fContext.GetLocalUserBy(data->LocalUserId);
+	if (!sessionPointer)
+	{
+		return;
+	}
+
+	// Forget the connection.
+	managerPointer->fConnections.erase(
+			ConnectionKey(data->LocalUserId, data->RemoteUserId, data->SocketId->SocketName));
+
+	// Notify Lua.
+	auto taskPointer = std::make_shared<DispatchP2PConnectionEventTask>();
+	taskPointer->AcquireEventDataFrom(sessionPointer->GetUserHandle(), *data);
+	managerPointer->fContext.QueueDispatchEventTask(taskPointer);
+}
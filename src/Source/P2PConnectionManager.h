@@ -0,0 +1,221 @@
+// ----------------------------------------------------------------------------
+//
+// P2PConnectionManager.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+#include "eos_p2p_types.h"
+
+
+// Forward declarations.
+class LocalUserSession;
+class RuntimeContext;
+
+
+/**
+  Tracks the state of every P2P connection between local users and remote peers.
+
+  Listens to EOS for incoming connection requests and for connections being established, interrupted, and closed,
+  keeping a table of each connection's current state which Lua can read at any time via GetConnectionInfo().
+  Every change is also dispatched to Lua as a "p2pConnection" event.
+
+  Incoming connection requests can be accepted natively as soon as EOS reports them, according to the policy set
+  via SetAutoAcceptPolicy(), so that connecting to a known peer does not have to wait for Lua to respond to an event.
+ */
+class P2PConnectionManager
+{
+	public:
+		/** States a connection can be in, ordered from least to most connected. */
+		enum class ConnectionState
+		{
+			/** There is no connection. */
+			kNone,
+
+			/** The remote peer requested a connection, which the local user has not accepted yet. */
+			kRequested,
+
+			/** The local user accepted the connection, which is not established yet. */
+			kAccepted,
+
+			/** The connection was established, but was interrupted. EOS is attempting to re-establish it. */
+			kInterrupted,
+
+			/** The connection is established. */
+			kConnected
+		};
+
+		/** Determines which incoming connection requests are accepted natively. */
+		enum class AutoAcceptPolicy
+		{
+			/** Requests are left for Lua to accept via AcceptConnection(). */
+			kNone,
+
+			/** Requests from peers given to SetAutoAcceptPeers() are accepted. Others are left for Lua. */
+			kAllowedPeers,
+
+			/** All requests are accepted. */
+			kAll
+		};
+
+		/** Provides the state of a connection. */
+		struct ConnectionInfo
+		{
+			/** The connection's state. */
+			ConnectionState State;
+
+			/** The type of network connection used, if established. */
+			EOS_ENetworkConnectionType NetworkType;
+		};
+
+
+		/**
+		  Creates a new connection manager.
+		  @param context The runtime context whose local users' connections are to be tracked.
+		 */
+		P2PConnectionManager(RuntimeContext& context);
+
+		/** Stops listening to EOS connection notifications and destroys this manager. */
+		virtual ~P2PConnectionManager();
+
+		/**
+		  Accepts a pending or future connection from the given remote peer.
+		  @param session The local user accepting the connection. Must be logged into the Connect interface.
+		  @param remoteUserId The product user to accept a connection from.
+		  @param socketName Name of the socket to accept the connection on.
+		  @return Returns true if the connection was accepted. Returns false if given invalid arguments or if EOS
+		          rejected the request.
+		 */
+		bool AcceptConnection(LocalUserSession& session, EOS_ProductUserId remoteUserId, const char* socketName);
+
+		/**
+		  Closes the connection with the given remote peer, or declines its connection request.
+		  @param session The local user closing the connection. Must be logged into the Connect interface.
+		  @param remoteUserId The product user to close the connection with.
+		  @param socketName Name of the socket to close the connection on. Null closes all connections with the peer.
+		  @return Returns true if the connection was closed. Returns false if given invalid arguments or if EOS
+		          rejected the request.
+		 */
+		bool CloseConnection(LocalUserSession& session, EOS_ProductUserId remoteUserId, const char* socketName);
+
+		/**
+		  Fetches the current state of a connection without calling into EOS.
+		  @param localUserId The local user the connection belongs to.
+		  @param remoteUserId The remote peer the connection is with.
+		  @param socketName Name of the connection's socket. Null fetches the most connected of the peer's sockets.
+		  @return Returns the connection's state. Its state is set to kNone if there is no such connection.
+		 */
+		ConnectionInfo GetConnectionInfo(
+				EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const char* socketName) const;
+
+		/** Gets the policy determining which incoming connection requests are accepted natively. */
+		AutoAcceptPolicy GetAutoAcceptPolicy() const;
+
+		/**
+		  Sets the policy determining which incoming connection requests are accepted natively.
+		  @param value The policy to use. Does not affect requests that were already received.
+		 */
+		void SetAutoAcceptPolicy(AutoAcceptPolicy value);
+
+		/**
+		  Sets the peers whose connection requests are accepted while the policy is set to kAllowedPeers,
+		  such as the members of the lobby the local user is in.
+		  @param remoteUserIds The product users to accept requests from, replacing the previously set peers.
+		 */
+		void SetAutoAcceptPeers(const std::vector<EOS_ProductUserId>& remoteUserIds);
+
+		/**
+		  To be called once per frame. Starts listening to connection notifications for newly logged in local users
+		  and stops listening for logged out users, forgetting their connections.
+		 */
+		void Update();
+
+		/** Gets the name of the given connection state as used by Lua, such as "connected". */
+		static const char* GetNameOf(ConnectionState value);
+
+		/** Gets the name of the given network connection type as used by Lua, such as "relayed". */
+		static const char* GetNameOf(EOS_ENetworkConnectionType value);
+
+		/** Gets the name of the given connection closed reason as used by Lua, such as "timedOut". */
+		static const char* GetNameOf(EOS_EConnectionClosedReason value);
+
+	private:
+		/** Identifies a connection by local user, remote user, and socket name. */
+		typedef std::tuple<EOS_ProductUserId, EOS_ProductUserId, std::string> ConnectionKey;
+
+		/** Notifications registered with EOS for 1 local user. */
+		struct UserNotifications
+		{
+			/** ID of the incoming connection request notification. */
+			EOS_NotificationId RequestId;
+
+			/** ID of the connection established notification. */
+			EOS_NotificationId EstablishedId;
+
+			/** ID of the connection interrupted notification. */
+			EOS_NotificationId InterruptedId;
+
+			/** ID of the connection closed notification. */
+			EOS_NotificationId ClosedId;
+		};
+
+		/** Copy constructor deleted to prevent it from being called. */
+		P2PConnectionManager(const P2PConnectionManager&) = delete;
+
+		/** Method deleted to prevent the copy operator from being used. */
+		void operator=(const P2PConnectionManager&) = delete;
+
+		/** Fetches the EOS P2P interface. Returns null if the EOS platform has not been created. */
+		EOS_HP2P GetP2PHandle() const;
+
+		/** Starts listening to connection notifications for the given local user. */
+		UserNotifications AddNotificationsFor(EOS_ProductUserId localUserId);
+
+		/** Stops listening to the given connection notifications. */
+		void RemoveNotifications(const UserNotifications& notifications);
+
+		/** Determines if an incoming connection request from the given peer is to be accepted natively. */
+		bool CanAutoAccept(EOS_ProductUserId remoteUserId) const;
+
+		/**
+		  Fetches a connection manager by the "ClientData" given to an EOS callback.
+		  @return Returns the manager. Returns null if it was destroyed.
+		 */
+		static P2PConnectionManager* GetInstanceBy(void* clientData);
+
+		/** Called by EOS when a remote peer requests a connection with a local user. */
+		static void EOS_CALL OnConnectionRequestCallback(const EOS_P2P_OnIncomingConnectionRequestInfo* data);
+
+		/** Called by EOS when a connection is established or re-established. */
+		static void EOS_CALL OnConnectionEstablishedCallback(const EOS_P2P_OnPeerConnectionEstablishedInfo* data);
+
+		/** Called by EOS when an established connection is interrupted. */
+		static void EOS_CALL OnConnectionInterruptedCallback(const EOS_P2P_OnPeerConnectionInterruptedInfo* data);
+
+		/** Called by EOS when a connection is closed or a connection request is declined. */
+		static void EOS_CALL OnConnectionClosedCallback(const EOS_P2P_OnRemoteConnectionClosedInfo* data);
+
+		/** The runtime context that owns this manager. */
+		RuntimeContext& fContext;
+
+		/** Determines which incoming connection requests are accepted natively. */
+		AutoAcceptPolicy fAutoAcceptPolicy;
+
+		/** Peers whose connection requests are accepted while "fAutoAcceptPolicy" is set to kAllowedPeers. */
+		std::unordered_set<EOS_ProductUserId> fAutoAcceptPeerIds;
+
+		/** States of all known connections. Connections are removed once closed. */
+		std::map<ConnectionKey, ConnectionInfo> fConnections;
+
+		/** Notifications registered with EOS for each logged in local user. */
+		std::map<EOS_ProductUserId, UserNotifications> fUserNotifications;
+};
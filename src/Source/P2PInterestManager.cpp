@@ -0,0 +1,280 @@
+// ----------------------------------------------------------------------------
+//
+// P2PInterestManager.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "P2PInterestManager.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+//---------------------------------------------------------------------------------
+// P2PInterestManager Class Members
+//---------------------------------------------------------------------------------
+
+const double P2PInterestManager::kDefaultCellSize = 100.0;
+
+const int64_t P2PInterestManager::kMaxCellCountPerPeer = 1024;
+
+P2PInterestManager::P2PInterestManager()
+:	fCellSize(kDefaultCellSize)
+{
+}
+
+P2PInterestManager::~P2PInterestManager()
+{
+}
+
+double P2PInterestManager::GetCellSize() const
+{
+	return fCellSize;
+}
+
+void P2PInterestManager::SetCellSize(double value)
+{
+	// Validate.
+	if (!(value > 0) || (value == fCellSize))
+	{
+		return;
+	}
+
+	// Re-index every peer's area against the new grid.
+	fCells.clear();
+	fUnboundedPeers.clear();
+	fCellSize = value;
+	for (auto&& pair : fPeers)
+	{
+		if (pair.second.HasArea)
+		{
+			AddToCells(pair.first, pair.second);
+		}
+	}
+}
+
+void P2PInterestManager::SetArea(EOS_ProductUserId remoteUserId, double x, double y, double radius)
+{
+	// Validate.
+	if (!remoteUserId || std::isnan(x) || std::isnan(y) || std::isnan(radius))
+	{
+		return;
+	}
+
+	// Remove the peer's previous area from the grid.
+	auto& interest = fPeers[remoteUserId];
+	if (interest.HasArea)
+	{
+		RemoveFromCells(remoteUserId, interest);
+		interest.HasArea = false;
+	}
+
+	// Add the new area to the grid, unless the area is being removed.
+	if (radius >= 0)
+	{
+		interest.HasArea = true;
+		interest.X = x;
+		interest.Y = y;
+		interest.Radius = radius;
+		AddToCells(remoteUserId, interest);
+	}
+}
+
+void P2PInterestManager::SetTopics(EOS_ProductUserId remoteUserId, const std::vector<std::string>& topics)
+{
+	// Validate.
+	if (!remoteUserId)
+	{
+		return;
+	}
+
+	// Unsubscribe the peer from its previous topics.
+	auto& interest = fPeers[remoteUserId];
+	for (auto&& topic : interest.Topics)
+	{
+		auto topicIterator = fTopics.find(topic);
+		if (topicIterator != fTopics.end())
+		{
+			RemoveFrom(topicIterator->second, remoteUserId);
+			if (topicIterator->second.empty())
+			{
+				fTopics.erase(topicIterator);
+			}
+		}
+	}
+	interest.Topics.clear();
+
+	// Subscribe the peer to the given topics, skipping duplicates.
+	for (auto&& topic : topics)
+	{
+		if (topic.empty())
+		{
+			continue;
+		}
+		bool isNewTopic = (std::find(interest.Topics.begin(), interest.Topics.end(), topic) == interest.Topics.end());
+		if (isNewTopic)
+		{
+			interest.Topics.push_back(topic);
+			fTopics[topic].push_back(remoteUserId);
+		}
+	}
+}
+
+void P2PInterestManager::RemovePeer(EOS_ProductUserId remoteUserId)
+{
+	auto peerIterator = fPeers.find(remoteUserId);
+	if (peerIterator == fPeers.end())
+	{
+		return;
+	}
+	SetTopics(remoteUserId, std::vector<std::string>());
+	if (peerIterator->second.HasArea)
+	{
+		RemoveFromCells(remoteUserId, peerIterator->second);
+	}
+	fPeers.erase(peerIterator);
+}
+
+void P2PInterestManager::RemoveAllPeers()
+{
+	fPeers.clear();
+	fCells.clear();
+	fUnboundedPeers.clear();
+	fTopics.clear();
+}
+
+void P2PInterestManager::CollectInterestedPeers(
+	const Relevancy& relevancy, std::vector<EOS_ProductUserId>& remoteUserIds) const
+{
+	// A broadcast without a position or topic is relevant to every tracked peer.
+	bool hasTopic = !relevancy.Topic.empty();
+	if (!relevancy.HasPosition && !hasTopic)
+	{
+		for (auto&& pair : fPeers)
+		{
+			remoteUserIds.push_back(pair.first);
+		}
+		return;
+	}
+
+	// Append the peers listed in the cell containing the broadcast's position, along with the peers whose areas are
+	// too large for the grid. Cells list every overlapping area, so only areas actually containing the point are kept.
+	auto startIndex = remoteUserIds.size();
+	if (relevancy.HasPosition)
+	{
+		auto cellKey = GetCellKeyOf(GetCellIndexOf(relevancy.X), GetCellIndexOf(relevancy.Y));
+		auto cellIterator = fCells.find(cellKey);
+		if (cellIterator != fCells.end())
+		{
+			for (auto remoteUserId : cellIterator->second)
+			{
+				auto& interest = fPeers.at(remoteUserId);
+				double deltaX = relevancy.X - interest.X;
+				double deltaY = relevancy.Y - interest.Y;
+				if (((deltaX * deltaX) + (deltaY * deltaY)) <= (interest.Radius * interest.Radius))
+				{
+					remoteUserIds.push_back(remoteUserId);
+				}
+			}
+		}
+		remoteUserIds.insert(remoteUserIds.end(), fUnboundedPeers.begin(), fUnboundedPeers.end());
+	}
+
+	// Append the topic's subscribers.
+	if (hasTopic)
+	{
+		auto topicIterator = fTopics.find(relevancy.Topic);
+		if (topicIterator != fTopics.end())
+		{
+			remoteUserIds.insert(remoteUserIds.end(), topicIterator->second.begin(), topicIterator->second.end());
+		}
+	}
+
+	// Remove peers appended more than once, such as a subscriber whose area also contains the position.
+	if (relevancy.HasPosition && hasTopic)
+	{
+		auto startIterator = remoteUserIds.begin() + startIndex;
+		std::sort(startIterator, remoteUserIds.end());
+		remoteUserIds.erase(std::unique(startIterator, remoteUserIds.end()), remoteUserIds.end());
+	}
+}
+
+void P2PInterestManager::AddToCells(EOS_ProductUserId remoteUserId, PeerInterest& interest)
+{
+	// Determine which cells the area's bounding box overlaps.
+	interest.MinColumn = GetCellIndexOf(interest.X - interest.Radius);
+	interest.MinRow = GetCellIndexOf(interest.Y - interest.Radius);
+	interest.MaxColumn = GetCellIndexOf(interest.X + interest.Radius);
+	interest.MaxRow = GetCellIndexOf(interest.Y + interest.Radius);
+	int64_t columnCount = (int64_t)interest.MaxColumn - (int64_t)interest.MinColumn + 1;
+	int64_t rowCount = (int64_t)interest.MaxRow - (int64_t)interest.MinRow + 1;
+
+	// Treat areas overlapping too many cells as covering the whole world.
+	interest.IsAreaUnbounded =
+			(columnCount > kMaxCellCountPerPeer) || ((columnCount * rowCount) > kMaxCellCountPerPeer);
+	if (interest.IsAreaUnbounded)
+	{
+		fUnboundedPeers.push_back(remoteUserId);
+		return;
+	}
+
+	// List the peer in every overlapped cell.
+	for (int32_t row = interest.MinRow; row <= interest.MaxRow; row++)
+	{
+		for (int32_t column = interest.MinColumn; column <= interest.MaxColumn; column++)
+		{
+			fCells[GetCellKeyOf(column, row)].push_back(remoteUserId);
+		}
+	}
+}
+
+void P2PInterestManager::RemoveFromCells(EOS_ProductUserId remoteUserId, const PeerInterest& interest)
+{
+	if (interest.IsAreaUnbounded)
+	{
+		RemoveFrom(fUnboundedPeers, remoteUserId);
+		return;
+	}
+	for (int32_t row = interest.MinRow; row <= interest.MaxRow; row++)
+	{
+		for (int32_t column = interest.MinColumn; column <= interest.MaxColumn; column++)
+		{
+			auto cellIterator = fCells.find(GetCellKeyOf(column, row));
+			if (cellIterator != fCells.end())
+			{
+				RemoveFrom(cellIterator->second, remoteUserId);
+				if (cellIterator->second.empty())
+				{
+					fCells.erase(cellIterator);
+				}
+			}
+		}
+	}
+}
+
+int32_t P2PInterestManager::GetCellIndexOf(double position) const
+{
+	double index = std::floor(position / fCellSize);
+	index = std::max(index, (double)std::numeric_limits<int32_t>::min());
+	index = std::min(index, (double)std::numeric_limits<int32_t>::max());
+	return (int32_t)index;
+}
+
+P2PInterestManager::CellKey P2PInterestManager::GetCellKeyOf(int32_t column, int32_t row)
+{
+	return (CellKey)(((uint64_t)(uint32_t)column << 32) | (uint64_t)(uint32_t)row);
+}
+
+void P2PInterestManager::RemoveFrom(std::vector<EOS_ProductUserId>& remoteUserIds, EOS_ProductUserId remoteUserId)
+{
+	// Swap the peer with the last entry and pop it, since the order of peers does not matter.
+	auto iterator = std::find(remoteUserIds.begin(), remoteUserIds.end(), remoteUserId);
+	if (iterator != remoteUserIds.end())
+	{
+		*iterator = remoteUserIds.back();
+		remoteUserIds.pop_back();
+	}
+}
@@ -0,0 +1,177 @@
+// ----------------------------------------------------------------------------
+//
+// P2PInterestManager.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "eos_p2p_types.h"
+
+
+/**
+  Tracks what each remote peer is interested in, so that broadcasts only reach the peers they are relevant to.
+
+  A peer can be interested in a circular area of a 2D world, such as the area around its player, and can subscribe
+  to any number of named topics, such as a team or a chat room. Areas are indexed by a uniform grid. Each peer is
+  listed in every cell overlapping its area, making the lookup of the peers interested in a point a single hash lookup
+  regardless of how many peers exist. Likewise, each topic lists its subscribers.
+
+  Note that interest is tracked per remote peer, regardless of which local user broadcasts to it.
+ */
+class P2PInterestManager
+{
+	public:
+		/** Determines which peers a broadcast is relevant to, as given to CollectInterestedPeers(). */
+		struct Relevancy
+		{
+			/** Set true if the broadcast is relevant to the peers interested in the point at "X" and "Y". */
+			bool HasPosition;
+
+			/** The point's horizontal position in world units. */
+			double X;
+
+			/** The point's vertical position in world units. */
+			double Y;
+
+			/** The broadcast is relevant to the subscribers of this topic. Ignored if empty. */
+			std::string Topic;
+		};
+
+
+		/** Default size of a grid cell in world units. */
+		static const double kDefaultCellSize;
+
+		/**
+		  Max number of grid cells a peer's area can overlap.
+		  Larger areas are treated as covering the whole world, so that a huge radius cannot exhaust memory.
+		 */
+		static const int64_t kMaxCellCountPerPeer;
+
+
+		/** Creates a new interest manager tracking no peers. */
+		P2PInterestManager();
+
+		/** Destroys this manager. */
+		virtual ~P2PInterestManager();
+
+		/** Gets the size of a grid cell in world units. */
+		double GetCellSize() const;
+
+		/**
+		  Sets the size of a grid cell in world units, re-indexing the areas of all peers.
+		  Ideally about the radius of a typical area, such that each area overlaps few cells.
+		  @param value The cell size. Ignored if not greater than zero.
+		 */
+		void SetCellSize(double value);
+
+		/**
+		  Sets the area of the world that the given peer is interested in, replacing its previous area.
+		  @param remoteUserId The peer whose interest is to be set.
+		  @param x Horizontal position of the area's center in world units.
+		  @param y Vertical position of the area's center in world units.
+		  @param radius The area's radius in world units. Negative removes the peer's area.
+		 */
+		void SetArea(EOS_ProductUserId remoteUserId, double x, double y, double radius);
+
+		/**
+		  Replaces the topics that the given peer is subscribed to.
+		  @param remoteUserId The peer whose subscriptions are to be set.
+		  @param topics The topics to subscribe to. Empty topics are ignored.
+		 */
+		void SetTopics(EOS_ProductUserId remoteUserId, const std::vector<std::string>& topics);
+
+		/** Stops tracking the given peer's area and subscriptions, such as when it left the session. */
+		void RemovePeer(EOS_ProductUserId remoteUserId);
+
+		/** Stops tracking all peers. */
+		void RemoveAllPeers();
+
+		/**
+		  Appends every peer that the given broadcast is relevant to. Each peer is appended once.
+		  @param relevancy The broadcast's position and topic. If it has neither, all tracked peers are appended.
+		  @param remoteUserIds The vector to append the peers to.
+		 */
+		void CollectInterestedPeers(const Relevancy& relevancy, std::vector<EOS_ProductUserId>& remoteUserIds) const;
+
+	private:
+		/** Identifies a grid cell by its column and row, packed into 1 integer. */
+		typedef int64_t CellKey;
+
+		/** The interest of 1 peer. */
+		struct PeerInterest
+		{
+			/** Set true if the peer is interested in an area. */
+			bool HasArea;
+
+			/** Horizontal position of the area's center. */
+			double X;
+
+			/** Vertical position of the area's center. */
+			double Y;
+
+			/** The area's radius. */
+			double Radius;
+
+			/** Set true if the area overlaps more than kMaxCellCountPerPeer cells, covering the whole world. */
+			bool IsAreaUnbounded;
+
+			/** First column of the cells that the area overlaps. */
+			int32_t MinColumn;
+
+			/** First row of the cells that the area overlaps. */
+			int32_t MinRow;
+
+			/** Last column of the cells that the area overlaps. */
+			int32_t MaxColumn;
+
+			/** Last row of the cells that the area overlaps. */
+			int32_t MaxRow;
+
+			/** The topics subscribed to. */
+			std::vector<std::string> Topics;
+		};
+
+		/** Copy constructor deleted to prevent it from being called. */
+		P2PInterestManager(const P2PInterestManager&) = delete;
+
+		/** Method deleted to prevent the copy operator from being used. */
+		void operator=(const P2PInterestManager&) = delete;
+
+		/** Lists the given peer in the cells overlapped by its area. */
+		void AddToCells(EOS_ProductUserId remoteUserId, PeerInterest& interest);
+
+		/** Removes the given peer from the cells it was listed in by AddToCells(). */
+		void RemoveFromCells(EOS_ProductUserId remoteUserId, const PeerInterest& interest);
+
+		/** Gets the index of the column or row containing the given position. */
+		int32_t GetCellIndexOf(double position) const;
+
+		/** Packs the given column and row into a cell key. */
+		static CellKey GetCellKeyOf(int32_t column, int32_t row);
+
+		/** Removes the given peer from the given vector, if listed. */
+		static void RemoveFrom(std::vector<EOS_ProductUserId>& remoteUserIds, EOS_ProductUserId remoteUserId);
+
+		/** Size of a grid cell in world units. */
+		double fCellSize;
+
+		/** Interest of every tracked peer. */
+		std::unordered_map<EOS_ProductUserId, PeerInterest> fPeers;
+
+		/** Peers whose areas overlap each grid cell. Cells without peers are removed. */
+		std::unordered_map<CellKey, std::vector<EOS_ProductUserId>> fCells;
+
+		/** Peers whose areas are too large for the grid, interested in every position. */
+		std::vector<EOS_ProductUserId> fUnboundedPeers;
+
+		/** Subscribers of each topic. Topics without subscribers are removed. */
+		std::unordered_map<std::string, std::vector<EOS_ProductUserId>> fTopics;
+};
@@ -0,0 +1,281 @@
+// ----------------------------------------------------------------------------
+//
+// P2PLinkStats.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "P2PLinkStats.h"
+#include <algorithm>
+extern "C"
+{
+#	include "lua.h"
+}
+
+
+//---------------------------------------------------------------------------------
+// Private Constants
+//---------------------------------------------------------------------------------
+
+/** How long to wait for a ping's reply before counting the ping as lost. */
+static const std::chrono::milliseconds kPingTimeout(2000);
+
+/** Max number of pings per peer waiting for a reply. */
+static const size_t kMaxPendingPingCount = 8;
+
+/** Peers that nothing was received from for this long are no longer pinged. */
+static const std::chrono::milliseconds kActivityTimeout(10000);
+
+/** Interval at which per second rates are measured. */
+static const std::chrono::milliseconds kRateInterval(1000);
+
+/** Weight given to every new round trip time sample, same as TCP's smoothed round trip time. */
+static const double kRoundTripTimeSmoothing = 0.125;
+
+/** Weight given to every ping's outcome when updating the loss rate. */
+static const double kLossRateSmoothing = 0.1;
+
+
+//---------------------------------------------------------------------------------
+// P2PLinkStats Class Members
+//---------------------------------------------------------------------------------
+
+P2PLinkStats::P2PLinkStats()
+:	fPingInterval(0)
+{
+}
+
+P2PLinkStats::~P2PLinkStats()
+{
+}
+
+std::chrono::milliseconds P2PLinkStats::GetPingInterval() const
+{
+	return fPingInterval;
+}
+
+void P2PLinkStats::SetPingInterval(std::chrono::milliseconds value)
+{
+	fPingInterval = (value.count() > 0) ? value : std::chrono::milliseconds(0);
+}
+
+void P2PLinkStats::RecordSent(
+	EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const EOS_P2P_SocketId& socketId,
+	uint32_t byteCount)
+{
+	// Note that sending does not count as activity, since pings would otherwise keep dead peers active forever.
+	auto& link = FetchLink(localUserId, remoteUserId, socketId);
+	link.Stats.BytesSent += byteCount;
+	link.Stats.PacketsSent++;
+	link.SocketId = socketId;
+}
+
+void P2PLinkStats::RecordReceived(
+	EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const EOS_P2P_SocketId& socketId,
+	uint32_t byteCount)
+{
+	auto& link = FetchLink(localUserId, remoteUserId, socketId);
+	link.Stats.BytesReceived += byteCount;
+	link.Stats.PacketsReceived++;
+	link.SocketId = socketId;
+	link.LastActivityTime = std::chrono::steady_clock::now();
+}
+
+void P2PLinkStats::RecordPong(EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, uint32_t sequence)
+{
+	// Fetch the ping being replied to. Ignore replies to pings that already timed out.
+	auto linkIterator = fLinks.find(PeerKey(localUserId, remoteUserId));
+	if (linkIterator == fLinks.end())
+	{
+		return;
+	}
+	auto& link = linkIterator->second;
+	auto pingIterator = link.PendingPings.begin();
+	while ((pingIterator != link.PendingPings.end()) && (pingIterator->first != sequence))
+	{
+		pingIterator++;
+	}
+	if (pingIterator == link.PendingPings.end())
+	{
+		return;
+	}
+
+	// Update the round trip time and loss rate.
+	std::chrono::duration<double, std::milli> roundTripTime = std::chrono::steady_clock::now() - pingIterator->second;
+	link.PendingPings.erase(pingIterator);
+	link.Stats.LastRoundTripTime = roundTripTime.count();
+	if (link.Stats.RoundTripTime < 0)
+	{
+		link.Stats.RoundTripTime = roundTripTime.count();
+	}
+	else
+	{
+		link.Stats.RoundTripTime += (roundTripTime.count() - link.Stats.RoundTripTime) * kRoundTripTimeSmoothing;
+	}
+	link.Stats.LossRate -= link.Stats.LossRate * kLossRateSmoothing;
+}
+
+void P2PLinkStats::CollectDuePings(std::vector<PingRequest>& pings)
+{
+	auto now = std::chrono::steady_clock::now();
+	for (auto&& pair : fLinks)
+	{
+		auto& link = pair.second;
+
+		// Update the per second rates once per rate interval.
+		std::chrono::duration<double> rateDuration = now - link.RateStartTime;
+		if (rateDuration >= kRateInterval)
+		{
+			link.Stats.SendBytesPerSecond =
+					(double)(link.Stats.BytesSent - link.RateStartBytesSent) / rateDuration.count();
+			link.Stats.ReceiveBytesPerSecond =
+					(double)(link.Stats.BytesReceived - link.RateStartBytesReceived) / rateDuration.count();
+			link.RateStartTime = now;
+			link.RateStartBytesSent = link.Stats.BytesSent;
+			link.RateStartBytesReceived = link.Stats.BytesReceived;
+		}
+
+		// Count pings that were not replied to in time as lost.
+		while (!link.PendingPings.empty() && ((now - link.PendingPings.front().second) >= kPingTimeout))
+		{
+			link.PendingPings.pop_front();
+			link.Stats.LossRate += (1.0 - link.Stats.LossRate) * kLossRateSmoothing;
+		}
+
+		// Ping the peer if it is due and still active.
+		bool isPingDue =
+				(fPingInterval.count() > 0) && ((now - link.LastActivityTime) < kActivityTimeout) &&
+				((now - link.LastPingTime) >= fPingInterval);
+		if (isPingDue)
+		{
+			link.LastPingTime = now;
+			link.LastPingSequence++;
+			link.PendingPings.push_back(std::make_pair(link.LastPingSequence, now));
+			if (link.PendingPings.size() > kMaxPendingPingCount)
+			{
+				link.PendingPings.pop_front();
+			}
+			PingRequest ping;
+			ping.LocalUserId = std::get<0>(pair.first);
+			ping.RemoteUserId = std::get<1>(pair.first);
+			ping.SocketId = link.SocketId;
+			ping.Sequence = link.LastPingSequence;
+			pings.push_back(ping);
+		}
+	}
+}
+
+const P2PLinkStats::PeerStats* P2PLinkStats::GetPeerStats(
+	EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId) const
+{
+	auto iterator = fLinks.find(PeerKey(localUserId, remoteUserId));
+	if (iterator == fLinks.end())
+	{
+		return nullptr;
+	}
+	return &iterator->second.Stats;
+}
+
+void P2PLinkStats::CopyAllPeerStatsTo(std::vector<std::pair<PeerKey, PeerStats>>& peerStats) const
+{
+	peerStats.reserve(peerStats.size() + fLinks.size());
+	for (auto&& pair : fLinks)
+	{
+		peerStats.push_back(std::make_pair(pair.first, pair.second.Stats));
+	}
+}
+
+void P2PLinkStats::RemoveLocalUsersExcept(const std::vector<EOS_ProductUserId>& localUserIds)
+{
+	for (auto iterator = fLinks.begin(); iterator != fLinks.end();)
+	{
+		auto localUserId = std::get<0>(iterator->first);
+		bool isKept = (std::find(localUserIds.begin(), localUserIds.end(), localUserId) != localUserIds.end());
+		iterator = isKept ? std::next(iterator) : fLinks.erase(iterator);
+	}
+}
+
+void P2PLinkStats::Clear()
+{
+	fLinks.clear();
+}
+
+void P2PLinkStats::SetLuaFieldsFrom(lua_State* luaStatePointer, const PeerStats& stats)
+{
+	// Validate.
+	if (!luaStatePointer || !lua_istable(luaStatePointer, -1))
+	{
+		return;
+	}
+
+	// Copy the statistics to the table.
+	lua_pushnumber(luaStatePointer, (lua_Number)stats.BytesSent);
+	lua_setfield(luaStatePointer, -2, "bytesSent");
+	lua_pushnumber(luaStatePointer, (lua_Number)stats.BytesReceived);
+	lua_setfield(luaStatePointer, -2, "bytesReceived");
+	lua_pushnumber(luaStatePointer, (lua_Number)stats.PacketsSent);
+	lua_setfield(luaStatePointer, -2, "packetsSent");
+	lua_pushnumber(luaStatePointer, (lua_Number)stats.PacketsReceived);
+	lua_setfield(luaStatePointer, -2, "packetsReceived");
+	lua_pushnumber(luaStatePointer, stats.SendBytesPerSecond);
+	lua_setfield(luaStatePointer, -2, "sendBytesPerSecond");
+	lua_pushnumber(luaStatePointer, stats.ReceiveBytesPerSecond);
+	lua_setfield(luaStatePointer, -2, "receiveBytesPerSecond");
+	if (stats.RoundTripTime >= 0)
+	{
+		lua_pushnumber(luaStatePointer, stats.RoundTripTime);
+		lua_setfield(luaStatePointer, -2, "roundTripTime");
+		lua_pushnumber(luaStatePointer, stats.LastRoundTripTime);
+		lua_setfield(luaStatePointer, -2, "lastRoundTripTime");
+	}
+	lua_pushnumber(luaStatePointer, stats.LossRate);
+	lua_setfield(luaStatePointer, -2, "lossRate");
+}
+
+void P2PLinkStats::SetLuaFieldsFrom(lua_State* luaStatePointer, const EOS_P2P_PacketQueueInfo& queueInfo)
+{
+	// Validate.
+	if (!luaStatePointer || !lua_istable(luaStatePointer, -1))
+	{
+		return;
+	}
+
+	// Copy the queue information to the table.
+	lua_pushnumber(luaStatePointer, (lua_Number)queueInfo.IncomingPacketQueueCurrentSizeBytes);
+	lua_setfield(luaStatePointer, -2, "incomingQueueByteCount");
+	lua_pushnumber(luaStatePointer, (lua_Number)queueInfo.IncomingPacketQueueCurrentPacketCount);
+	lua_setfield(luaStatePointer, -2, "incomingQueuePacketCount");
+	lua_pushnumber(luaStatePointer, (lua_Number)queueInfo.IncomingPacketQueueMaxSizeBytes);
+	lua_setfield(luaStatePointer, -2, "incomingQueueMaxByteCount");
+	lua_pushnumber(luaStatePointer, (lua_Number)queueInfo.OutgoingPacketQueueCurrentSizeBytes);
+	lua_setfield(luaStatePointer, -2, "outgoingQueueByteCount");
+	lua_pushnumber(luaStatePointer, (lua_Number)queueInfo.OutgoingPacketQueueCurrentPacketCount);
+	lua_setfield(luaStatePointer, -2, "outgoingQueuePacketCount");
+	lua_pushnumber(luaStatePointer, (lua_Number)queueInfo.OutgoingPacketQueueMaxSizeBytes);
+	lua_setfield(luaStatePointer, -2, "outgoingQueueMaxByteCount");
+}
+
+P2PLinkStats::PeerLink& P2PLinkStats::FetchLink(
+	EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const EOS_P2P_SocketId& socketId)
+{
+	// Fetch the existing link.
+	auto key = PeerKey(localUserId, remoteUserId);
+	auto iterator = fLinks.find(key);
+	if (iterator != fLinks.end())
+	{
+		return iterator->second;
+	}
+
+	// Create the link. It counts as active so that a peer that is only sent packets gets pinged too.
+	auto now = std::chrono::steady_clock::now();
+	auto& link = fLinks[key];
+	link.Stats.RoundTripTime = -1.0;
+	link.Stats.LastRoundTripTime = -1.0;
+	link.SocketId = socketId;
+	link.LastActivityTime = now;
+	link.LastPingTime = now - fPingInterval;
+	link.RateStartTime = now;
+	return link;
+}
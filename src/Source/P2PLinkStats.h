@@ -0,0 +1,218 @@
+// ----------------------------------------------------------------------------
+//
+// P2PLinkStats.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <tuple>
+#include <vector>
+#include "eos_p2p_types.h"
+
+
+// Forward declarations.
+extern "C"
+{
+	struct lua_State;
+}
+
+
+/**
+  Measures the quality of the links between local users and each remote peer they exchange packets with.
+
+  Counts the bytes and packets sent and received per peer and derives per second rates from them once per second.
+  Round trip time and loss are measured by pinging active peers at a fixed interval. This class only decides when
+  a peer is due for a ping and evaluates the replies. Sending the pings and replying to them is up to P2PManager.
+ */
+class P2PLinkStats
+{
+	public:
+		/** Statistics of the link between 1 local user and 1 remote peer. */
+		struct PeerStats
+		{
+			/** Total number of bytes sent to the peer, including the plugin's own packets and headers. */
+			uint64_t BytesSent;
+
+			/** Total number of bytes received from the peer, including the plugin's own packets and headers. */
+			uint64_t BytesReceived;
+
+			/** Total number of packets sent to the peer. */
+			uint64_t PacketsSent;
+
+			/** Total number of packets received from the peer. */
+			uint64_t PacketsReceived;
+
+			/** Bytes sent to the peer during the last full second. */
+			double SendBytesPerSecond;
+
+			/** Bytes received from the peer during the last full second. */
+			double ReceiveBytesPerSecond;
+
+			/** Smoothed round trip time in milliseconds. Negative if no ping was answered yet. */
+			double RoundTripTime;
+
+			/** Round trip time of the last answered ping in milliseconds. Negative if no ping was answered yet. */
+			double LastRoundTripTime;
+
+			/** Smoothed fraction of pings that went unanswered, from 0 to 1. */
+			double LossRate;
+		};
+
+		/** Identifies the link between 1 local user and 1 remote peer. */
+		typedef std::tuple<EOS_ProductUserId, EOS_ProductUserId> PeerKey;
+
+		/** A ping that is due to be sent, as returned by CollectDuePings(). */
+		struct PingRequest
+		{
+			/** The local user to send the ping from. */
+			EOS_ProductUserId LocalUserId;
+
+			/** The peer to send the ping to. */
+			EOS_ProductUserId RemoteUserId;
+
+			/** The socket that packets were last exchanged with the peer on. */
+			EOS_P2P_SocketId SocketId;
+
+			/** Number identifying the ping, to be echoed back by the peer. */
+			uint32_t Sequence;
+		};
+
+
+		/** Creates a new statistics tracker with pinging disabled. */
+		P2PLinkStats();
+
+		/** Destroys this tracker. */
+		virtual ~P2PLinkStats();
+
+		/** Gets the interval at which active peers are pinged. Zero if pinging is disabled. */
+		std::chrono::milliseconds GetPingInterval() const;
+
+		/**
+		  Sets the interval at which active peers are pinged to measure round trip time and loss.
+		  @param value The interval. Set to zero to disable pinging.
+		 */
+		void SetPingInterval(std::chrono::milliseconds value);
+
+		/**
+		  Counts a packet sent to the given peer.
+		  @param localUserId The local user that sent the packet.
+		  @param remoteUserId The peer the packet was sent to.
+		  @param socketId The socket the packet was sent on. Used to ping the peer.
+		  @param byteCount The packet's size in bytes.
+		 */
+		void RecordSent(
+				EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const EOS_P2P_SocketId& socketId,
+				uint32_t byteCount);
+
+		/**
+		  Counts a packet received from the given peer.
+		  @param localUserId The local user that received the packet.
+		  @param remoteUserId The peer the packet was received from.
+		  @param socketId The socket the packet was received on. Used to ping the peer.
+		  @param byteCount The packet's size in bytes.
+		 */
+		void RecordReceived(
+				EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const EOS_P2P_SocketId& socketId,
+				uint32_t byteCount);
+
+		/**
+		  Evaluates the reply to a ping returned by CollectDuePings().
+		  @param localUserId The local user that received the reply.
+		  @param remoteUserId The peer that replied.
+		  @param sequence The sequence number echoed by the peer. Unknown or expired numbers are ignored.
+		 */
+		void RecordPong(EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, uint32_t sequence);
+
+		/**
+		  To be called once per frame. Updates per second rates, counts unanswered pings as lost,
+		  and appends a request for every active peer that is due to be pinged.
+		  @param pings The vector to append ping requests to.
+		 */
+		void CollectDuePings(std::vector<PingRequest>& pings);
+
+		/**
+		  Fetches the statistics of the link between the given local user and peer.
+		  @return Returns the link's statistics. Returns null if no packets were exchanged with the peer.
+		 */
+		const PeerStats* GetPeerStats(EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId) const;
+
+		/** Copies the statistics of every link to the given vector. */
+		void CopyAllPeerStatsTo(std::vector<std::pair<PeerKey, PeerStats>>& peerStats) const;
+
+		/**
+		  Forgets the links of all local users not in the given collection, such as users that logged out.
+		  @param localUserIds The local users whose links are to be kept.
+		 */
+		void RemoveLocalUsersExcept(const std::vector<EOS_ProductUserId>& localUserIds);
+
+		/** Forgets the statistics and pending pings of all links. */
+		void Clear();
+
+		/**
+		  Copies the given statistics to fields such as "roundTripTime" in the table at the top of the Lua stack.
+		  The round trip time fields are left nil if no ping was answered yet.
+		 */
+		static void SetLuaFieldsFrom(lua_State* luaStatePointer, const PeerStats& stats);
+
+		/**
+		  Copies the given EOS packet queue information to fields such as "incomingQueueByteCount"
+		  in the table at the top of the Lua stack. Max sizes are set to zero if unlimited.
+		 */
+		static void SetLuaFieldsFrom(lua_State* luaStatePointer, const EOS_P2P_PacketQueueInfo& queueInfo);
+
+	private:
+		/** Statistics and ping state of 1 link. */
+		struct PeerLink
+		{
+			/** The statistics provided to Lua. */
+			PeerStats Stats;
+
+			/** The socket that packets were last exchanged on. */
+			EOS_P2P_SocketId SocketId;
+
+			/** When a packet was last received. Peers silent for too long are no longer pinged. */
+			std::chrono::steady_clock::time_point LastActivityTime;
+
+			/** When the last ping was sent. */
+			std::chrono::steady_clock::time_point LastPingTime;
+
+			/** When the current per second rate measurement started. */
+			std::chrono::steady_clock::time_point RateStartTime;
+
+			/** Value of "Stats.BytesSent" when the current rate measurement started. */
+			uint64_t RateStartBytesSent;
+
+			/** Value of "Stats.BytesReceived" when the current rate measurement started. */
+			uint64_t RateStartBytesReceived;
+
+			/** Sequence number assigned to the last ping. */
+			uint32_t LastPingSequence;
+
+			/** Pings waiting for a reply, oldest first, with the time they were sent. */
+			std::deque<std::pair<uint32_t, std::chrono::steady_clock::time_point>> PendingPings;
+		};
+
+		/** Copy constructor deleted to prevent it from being called. */
+		P2PLinkStats(const P2PLinkStats&) = delete;
+
+		/** Method deleted to prevent the copy operator from being used. */
+		void operator=(const P2PLinkStats&) = delete;
+
+		/** Fetches the given link, creating it with zeroed statistics if it does not exist yet. */
+		PeerLink& FetchLink(
+				EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const EOS_P2P_SocketId& socketId);
+
+		/** Interval at which active peers are pinged. Zero if disabled. */
+		std::chrono::milliseconds fPingInterval;
+
+		/** All links, keyed by local user and then peer. */
+		std::map<PeerKey, PeerLink> fLinks;
+};
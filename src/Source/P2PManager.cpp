@@ -0,0 +1,1292 @@
+// ----------------------------------------------------------------------------
+//
+// P2PManager.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "P2PManager.h"
+#include "ByteBuffer.h"
+#include "CoronaLua.h"
+#include "DispatchEventTask.h"
+#include "EosP2PTransport.h"
+#include "LocalUserSession.h"
+#include "P2PWireFormat.h"
+#include "RuntimeContext.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+extern "C"
+{
+#	include "lua.h"
+#	include "lauxlib.h"
+}
+#include "eos_p2p.h"
+
+
+//---------------------------------------------------------------------------------
+// Private Constants
+//---------------------------------------------------------------------------------
+
+/** Size of the header this plugin prepends to every packet it sends. */
+static const uint32_t kPacketHeaderByteCount = 1;
+
+/** Header of a packet whose payload belongs to the application. */
+static const uint8_t kPacketTypeData = 0;
+
+/**
+  Header of a packet packing several application messages together.
+  Each message is written as its byte count, encoded as a variable length integer, followed by its bytes.
+ */
+static const uint8_t kPacketTypeBatch = 1;
+
+/** Header of a packet containing a snapshot written by SnapshotReplicator::WriteDeltaTo(). */
+static const uint8_t kPacketTypeSnapshot = 2;
+
+/** Header of a packet acknowledging a received snapshot, written by SnapshotReplicator::WriteAckTo(). */
+static const uint8_t kPacketTypeSnapshotAck = 3;
+
+/**
+  Header of a packet containing 1 fragment of a message sent via SendLargeMessage().
+  Followed by the message's transfer ID, the message's total byte count, and the fragment's offset within the message,
+  each as a variable length integer, and then the fragment's bytes.
+ */
+static const uint8_t kPacketTypeFragment = 4;
+
+/**
+  Header of a packet asking the peer to reply with a pong, sent on P2PManager::kPingChannel.
+  Followed by the ping's sequence number as a variable length integer.
+ */
+static const uint8_t kPacketTypePing = 5;
+
+/** Header of a packet replying to a ping, echoing the ping's sequence number. */
+static const uint8_t kPacketTypePong = 6;
+
+/**
+  Header of a packet telling the receiver to discard a message sent via SendLargeMessage() that will not be finished.
+  Followed by the message's transfer ID as a variable length integer.
+ */
+static const uint8_t kPacketTypeFragmentAbort = 7;
+
+/**
+  Header of a packet containing 1 fragment of a full snapshot that did not fit in 1 packet, sent by SendSnapshot().
+  Laid out like a kPacketTypeFragment packet. The reassembled message is a kPacketTypeSnapshot packet.
+ */
+static const uint8_t kPacketTypeSnapshotFragment = 8;
+
+/** Default max number of packets received per frame while auto receive is enabled. */
+static const uint32_t kDefaultMaxReceivePacketCount = 256;
+
+/** Default max number of bytes received per frame while auto receive is enabled. */
+static const uint32_t kDefaultMaxReceiveByteCount = 64 * 1024;
+
+/**
+  Max number of messages being received via fragments from 1 peer at a time.
+  Fragments are sent on reliable ordered channels, so a well behaved peer only interleaves 1 message per channel.
+ */
+static const size_t kMaxInboundTransferCountPerPeer = 8;
+
+/** Max number of messages being received via fragments from all peers at a time. */
+static const size_t kMaxInboundTransferCount = 64;
+
+/** Time after which a message being received via fragments is discarded if none of its fragments arrived. */
+static const std::chrono::seconds kInboundTransferTimeout(30);
+
+/** Max number of fragment bytes sent per frame for messages queued via SendLargeMessage(). */
+static const uint32_t kFragmentByteBudgetPerFrame = 64 * 1024;
+
+/** Max number of bytes of messages queued via SendLargeMessage() waiting to be sent at a time. */
+static const size_t kMaxOutboundTransferByteCount = 64 * 1024 * 1024;
+
+/** Number of consecutive frames a message's next fragment can fail to send before the message is aborted. */
+static const int kMaxFragmentSendAttemptCount = 60;
+
+/** Number of consecutive flushes a queue of messages can fail to send before its messages are dropped. */
+static const int kMaxFlushAttemptCount = 60;
+
+
+//---------------------------------------------------------------------------------
+// Private Static Functions
+//---------------------------------------------------------------------------------
+
+/**
+  Splits a batched packet into the messages it packs.
+  @param bytes Pointer to the packet's bytes, starting with its header.
+  @param byteCount Number of bytes in the packet.
+  @param packet The packet's sender, socket, and channel, copied to every message.
+  @param baseOffset Offset of the packet's first byte in the buffer it was received into.
+  @param messages The vector to append the messages to, referencing their bytes by offset and length.
+  @return Returns true if the whole packet was split. Returns false if it is malformed, in which case the
+          messages preceding the malformed part are still appended.
+ */
+static bool UnpackBatchPacket(
+	const uint8_t* bytes, uint32_t byteCount, const P2PManager::ReceivedPacket& packet, uint32_t baseOffset,
+	std::vector<P2PManager::ReceivedPacket>& messages)
+{
+	uint32_t offset = kPacketHeaderByteCount;
+	while (offset < byteCount)
+	{
+		// Read the message's byte count.
+		uint32_t length = 0;
+		if (!P2PWireFormat::ReadVarUInt32From(bytes, byteCount, offset, length) || (length > (byteCount - offset)))
+		{
+			return false;
+		}
+
+		// Reference the message's bytes.
+		messages.push_back(packet);
+		messages.back().Offset = baseOffset + offset;
+		messages.back().Length = length;
+		offset += length;
+	}
+	return true;
+}
+
+
+//---------------------------------------------------------------------------------
+// P2PManager Class Members
+//---------------------------------------------------------------------------------
+
+const uint32_t P2PManager::kMaxPayloadByteCount = EOS_P2P_MAX_PACKET_SIZE - kPacketHeaderByteCount;
+
+const uint32_t P2PManager::kMaxMessageByteCount = 16 * 1024 * 1024;
+
+const uint8_t P2PManager::kPingChannel = 255;
+
+P2PManager::P2PManager(RuntimeContext& context)
+:	fContext(context),
+	fConnectionManager(context),
+	fQueueManager(context),
+	fNetworkSettings(context),
+	fTransportPointer(new EosP2PTransport(context)),
+	fReceiveBufferLuaReference(LUA_NOREF),
+	fDrainBufferLuaReference(LUA_NOREF),
+	fIsAutoReceiveEnabled(false),
+	fMaxReceivePacketCount(kDefaultMaxReceivePacketCount),
+	fMaxReceiveByteCount(kDefaultMaxReceiveByteCount),
+	fStatsEventInterval(0),
+	fLastStatsEventTime(std::chrono::steady_clock::now()),
+	fLastTransferId(0)
+{
+	fSendBytes.reserve(EOS_P2P_MAX_PACKET_SIZE);
+}
+
+P2PManager::~P2PManager()
+{
+	auto luaStatePointer = fContext.GetMainLuaState();
+	if (luaStatePointer)
+	{
+		luaL_unref(luaStatePointer, LUA_REGISTRYINDEX, fReceiveBufferLuaReference);
+		luaL_unref(luaStatePointer, LUA_REGISTRYINDEX, fDrainBufferLuaReference);
+	}
+	fReceiveBufferLuaReference = LUA_NOREF;
+	fDrainBufferLuaReference = LUA_NOREF;
+}
+
+bool P2PManager::SendPacket(
+	LocalUserSession& session, EOS_ProductUserId remoteUserId, const char* socketName, uint8_t channel,
+	const void* data, uint32_t byteCount, EOS_EPacketReliability reliability)
+{
+	// Validate.
+	if (!fTransportPointer->IsAvailable() || !session.GetProductUserId() || !remoteUserId)
+	{
+		return false;
+	}
+	if ((byteCount > kMaxPayloadByteCount) || (!data && (byteCount > 0)))
+	{
+		return false;
+	}
+	EOS_P2P_SocketId socketId;
+	if (!P2PWireFormat::CopySocketIdFrom(socketName, socketId))
+	{
+		return false;
+	}
+
+	// Prepend the plugin's header to the application's bytes.
+	fSendBytes.resize(kPacketHeaderByteCount + byteCount);
+	fSendBytes[0] = kPacketTypeData;
+	if (byteCount > 0)
+	{
+		memcpy(fSendBytes.data() + kPacketHeaderByteCount, data, byteCount);
+	}
+
+	// Send the packet.
+	return SendFramedPacket(session.GetProductUserId(), remoteUserId, socketId, channel, reliability);
+}
+
+uint32_t P2PManager::BroadcastPacket(
+	LocalUserSession& session, const P2PInterestManager::Relevancy& relevancy, const char* socketName,
+	uint8_t channel, const void* data, uint32_t byteCount, EOS_EPacketReliability reliability)
+{
+	// Validate.
+	if (!fTransportPointer->IsAvailable() || !session.GetProductUserId())
+	{
+		return 0;
+	}
+	if ((byteCount > kMaxPayloadByteCount) || (!data && (byteCount > 0)))
+	{
+		return 0;
+	}
+	EOS_P2P_SocketId socketId;
+	if (!P2PWireFormat::CopySocketIdFrom(socketName, socketId))
+	{
+		return 0;
+	}
+
+	// Fetch the peers that the packet is relevant to.
+	fBroadcastPeers.clear();
+	fInterestManager.CollectInterestedPeers(relevancy, fBroadcastPeers);
+	if (fBroadcastPeers.empty())
+	{
+		return 0;
+	}
+
+	// Prepend the plugin's header to the application's bytes once, shared by all peers.
+	fSendBytes.resize(kPacketHeaderByteCount + byteCount);
+	fSendBytes[0] = kPacketTypeData;
+	if (byteCount > 0)
+	{
+		memcpy(fSendBytes.data() + kPacketHeaderByteCount, data, byteCount);
+	}
+
+	// Send the packet to each peer, skipping the sending user in case it tracks its own interest.
+	uint32_t sentCount = 0;
+	for (auto remoteUserId : fBroadcastPeers)
+	{
+		if (remoteUserId == session.GetProductUserId())
+		{
+			continue;
+		}
+		if (SendFramedPacket(session.GetProductUserId(), remoteUserId, socketId, channel, reliability))
+		{
+			sentCount++;
+		}
+	}
+	return sentCount;
+}
+
+bool P2PManager::SendLargeMessage(
+	LocalUserSession& session, EOS_ProductUserId remoteUserId, const char* socketName, uint8_t channel,
+	const void* data, uint32_t byteCount)
+{
+	// Validate.
+	if (!fTransportPointer->IsAvailable() || !session.GetProductUserId() || !remoteUserId)
+	{
+		return false;
+	}
+	if ((byteCount > kMaxMessageByteCount) || (!data && (byteCount > 0)))
+	{
+		return false;
+	}
+	EOS_P2P_SocketId socketId;
+	if (!P2PWireFormat::CopySocketIdFrom(socketName, socketId))
+	{
+		return false;
+	}
+
+	// Queue a copy of the message to be sent as fragments by Update(), a limited number of bytes per frame.
+	return QueueOutboundTransfer(session.GetProductUserId(), remoteUserId, socketId, channel, false, data, byteCount);
+}
+
+bool P2PManager::QueueMessage(
+	LocalUserSession& session, EOS_ProductUserId remoteUserId, const char* socketName, uint8_t channel,
+	const void* data, uint32_t byteCount, EOS_EPacketReliability reliability, const std::string& coalesceKey)
+{
+	// Validate.
+	if (!session.GetProductUserId() || !remoteUserId)
+	{
+		return false;
+	}
+	if ((byteCount > kMaxPayloadByteCount) || (!data && (byteCount > 0)))
+	{
+		return false;
+	}
+	EOS_P2P_SocketId socketId;
+	if (!P2PWireFormat::CopySocketIdFrom(socketName, socketId))
+	{
+		return false;
+	}
+
+	// Fetch the queue for the message's destination, creating it if this is its first message this frame.
+	auto& messages = fOutboundQueues[
+			OutboundQueueKey(session.GetProductUserId(), remoteUserId, socketName, channel, reliability)].Messages;
+
+	// If an unreliable message with the same key is still queued, then replace it with the newer message.
+	OutboundMessage* messagePointer = nullptr;
+	bool canCoalesce =
+			!coalesceKey.empty() && (reliability == EOS_EPacketReliability::EOS_PR_UnreliableUnordered);
+	if (canCoalesce)
+	{
+		for (auto&& message : messages)
+		{
+			if (message.CoalesceKey == coalesceKey)
+			{
+				messagePointer = &message;
+				break;
+			}
+		}
+	}
+	if (!messagePointer)
+	{
+		messages.push_back(OutboundMessage());
+		messagePointer = &messages.back();
+		if (canCoalesce)
+		{
+			messagePointer->CoalesceKey = coalesceKey;
+		}
+	}
+	auto dataBytes = (const uint8_t*)data;
+	messagePointer->Bytes.assign(dataBytes, dataBytes + byteCount);
+	return true;
+}
+
+void P2PManager::FlushMessages()
+{
+	// Do not continue if there is nothing to send.
+	if (fOutboundQueues.empty())
+	{
+		return;
+	}
+
+	// Pack each queue's messages, in order, into as few packets as possible.
+	for (auto queueIterator = fOutboundQueues.begin(); queueIterator != fOutboundQueues.end();)
+	{
+		auto localUserId = std::get<0>(queueIterator->first);
+		auto remoteUserId = std::get<1>(queueIterator->first);
+		auto channel = std::get<3>(queueIterator->first);
+		auto reliability = std::get<4>(queueIterator->first);
+		EOS_P2P_SocketId socketId;
+		P2PWireFormat::CopySocketIdFrom(std::get<2>(queueIterator->first).c_str(), socketId);
+		auto& queue = queueIterator->second;
+		auto& messages = queue.Messages;
+		size_t messageIndex = 0;
+		bool wasSent = true;
+		while (messageIndex < messages.size())
+		{
+			// Find how many of the next messages fit in 1 batched packet. Always take at least 1 message.
+			size_t endIndex = messageIndex;
+			uint32_t packetByteCount = kPacketHeaderByteCount;
+			while (endIndex < messages.size())
+			{
+				auto messageByteCount = (uint32_t)messages[endIndex].Bytes.size();
+				uint32_t entryByteCount = P2PWireFormat::GetVarUIntByteCountFor(messageByteCount) + messageByteCount;
+				if ((endIndex > messageIndex) && ((packetByteCount + entryByteCount) > EOS_P2P_MAX_PACKET_SIZE))
+				{
+					break;
+				}
+				packetByteCount += entryByteCount;
+				endIndex++;
+			}
+
+			// Send a lone message as a plain data packet. Otherwise, pack the messages into a batched packet.
+			fSendBytes.clear();
+			if ((endIndex - messageIndex) == 1)
+			{
+				auto& bytes = messages[messageIndex].Bytes;
+				fSendBytes.push_back(kPacketTypeData);
+				fSendBytes.insert(fSendBytes.end(), bytes.begin(), bytes.end());
+			}
+			else
+			{
+				fSendBytes.push_back(kPacketTypeBatch);
+				for (size_t index = messageIndex; index < endIndex; index++)
+				{
+					auto& bytes = messages[index].Bytes;
+					P2PWireFormat::WriteVarUIntTo(fSendBytes, (uint32_t)bytes.size());
+					fSendBytes.insert(fSendBytes.end(), bytes.begin(), bytes.end());
+				}
+			}
+			wasSent = SendFramedPacket(localUserId, remoteUserId, socketId, channel, reliability);
+			if (!wasSent)
+			{
+				break;
+			}
+			messageIndex = endIndex;
+		}
+
+		// Remove the queue once all of its messages were sent.
+		if (wasSent)
+		{
+			queueIterator = fOutboundQueues.erase(queueIterator);
+			continue;
+		}
+
+		// Otherwise keep the unsent messages, in order, to be sent by the next flush.
+		// Drop them if they keep failing to send without progress, such as if the local user logged out.
+		if (messageIndex > 0)
+		{
+			messages.erase(messages.begin(), messages.begin() + messageIndex);
+			queue.FailedFlushCount = 0;
+		}
+		queue.FailedFlushCount++;
+		if (queue.FailedFlushCount >= kMaxFlushAttemptCount)
+		{
+			CoronaLog("WARNING: Dropped %d queued P2P messages that failed to send.", (int)messages.size());
+			queueIterator = fOutboundQueues.erase(queueIterator);
+			continue;
+		}
+		queueIterator++;
+	}
+}
+
+bool P2PManager::SendSnapshot(
+	LocalUserSession& session, const std::vector<EOS_ProductUserId>& remoteUserIds, const char* socketName,
+	uint8_t channel, uint8_t schemaId, SnapshotReplicator::EntityMap&& entities)
+{
+	// Validate.
+	auto localUserId = session.GetProductUserId();
+	auto schemaPointer = fSnapshotReplicator.GetSchemaBy(schemaId);
+	if (!localUserId || !schemaPointer)
+	{
+		return false;
+	}
+	EOS_P2P_SocketId socketId;
+	if (!P2PWireFormat::CopySocketIdFrom(socketName, socketId))
+	{
+		return false;
+	}
+
+	// Number the snapshot and send each peer a delta against the last snapshot it acknowledged.
+	auto snapshotPointer = fSnapshotReplicator.AddOutboundSnapshot(localUserId, schemaId, std::move(entities));
+	if (!snapshotPointer)
+	{
+		return false;
+	}
+	bool wasSent = true;
+	for (auto&& remoteUserId : remoteUserIds)
+	{
+		fSendBytes.clear();
+		fSendBytes.push_back(kPacketTypeSnapshot);
+		fSnapshotReplicator.WriteDeltaTo(fSendBytes, localUserId, remoteUserId, *schemaPointer, *snapshotPointer);
+		if (fSendBytes.size() <= EOS_P2P_MAX_PACKET_SIZE)
+		{
+			bool wasPacketSent = SendFramedPacket(
+					localUserId, remoteUserId, socketId, channel, EOS_EPacketReliability::EOS_PR_UnreliableUnordered);
+			wasSent = wasSent && wasPacketSent;
+			continue;
+		}
+
+		// The delta does not fit in 1 packet, so send the full snapshot as reliable fragments instead.
+		// Once the peer acknowledges it, the deltas against it are expected to be small again.
+		// Skip the peer while an earlier full snapshot is still being sent to it, since a newer one would queue up.
+		auto transferIterator = std::find_if(
+				fOutboundTransfers.begin(), fOutboundTransfers.end(),
+				[localUserId, remoteUserId](const OutboundTransfer& transfer)
+				{
+					return transfer.IsSnapshot &&
+							(transfer.LocalUserId == localUserId) && (transfer.RemoteUserId == remoteUserId);
+				});
+		if (transferIterator != fOutboundTransfers.end())
+		{
+			continue;
+		}
+		fSendBytes.clear();
+		fSendBytes.push_back(kPacketTypeSnapshot);
+		SnapshotReplicator::WriteFullTo(fSendBytes, *schemaPointer, *snapshotPointer);
+		bool wasQueued =
+				(fSendBytes.size() <= kMaxMessageByteCount) && QueueOutboundTransfer(
+						localUserId, remoteUserId, socketId, channel, true,
+						fSendBytes.data(), (uint32_t)fSendBytes.size());
+		wasSent = wasSent && wasQueued;
+	}
+	return wasSent;
+}
+
+bool P2PManager::ReceivePacket(
+	LocalUserSession& session, const uint8_t* channelPointer, ByteBuffer& buffer, ReceivedPacket& packet)
+{
+	// Validate.
+	if (!fTransportPointer->IsAvailable() || !session.GetProductUserId())
+	{
+		return false;
+	}
+
+	// Return messages left over from a batched packet received by an earlier call first.
+	if (PopPendingMessage(session.GetProductUserId(), channelPointer, buffer, packet))
+	{
+		return true;
+	}
+
+	// Make room for the largest possible packet so that it can be received without querying its size first.
+	buffer.Reserve(EOS_P2P_MAX_PACKET_SIZE);
+
+	// Answer pings first if the caller only receives from 1 channel, since pings have a channel of their own.
+	if (channelPointer && (*channelPointer != kPingChannel))
+	{
+		while (true)
+		{
+			uint32_t byteCount = 0;
+			bool wasReceived = fTransportPointer->Receive(
+					session.GetProductUserId(), &kPingChannel, buffer.GetData(), buffer.GetCapacity(),
+					packet.PeerId, packet.SocketId, packet.Channel, byteCount);
+			if (!wasReceived)
+			{
+				break;
+			}
+			fLinkStats.RecordReceived(session.GetProductUserId(), packet.PeerId, packet.SocketId, byteCount);
+			HandleInternalPacket(session, packet, buffer.GetData(), byteCount);
+		}
+	}
+
+	// Receive packets until one belonging to the application is found.
+	while (true)
+	{
+		uint32_t byteCount = 0;
+		bool wasReceived = fTransportPointer->Receive(
+				session.GetProductUserId(), channelPointer, buffer.GetData(), buffer.GetCapacity(),
+				packet.PeerId, packet.SocketId, packet.Channel, byteCount);
+		if (!wasReceived)
+		{
+			buffer.SetLength(0);
+			return false;
+		}
+		fLinkStats.RecordReceived(session.GetProductUserId(), packet.PeerId, packet.SocketId, byteCount);
+
+		// Skip packets without a header. They were not sent by this plugin.
+		if (byteCount < kPacketHeaderByteCount)
+		{
+			continue;
+		}
+
+		// Strip the header off of application packets and hand them to the caller.
+		auto bytes = buffer.GetData();
+		bool isOnPingChannel = (packet.Channel == kPingChannel);
+		if ((bytes[0] == kPacketTypeData) && !isOnPingChannel)
+		{
+			memmove(bytes, bytes + kPacketHeaderByteCount, byteCount - kPacketHeaderByteCount);
+			buffer.SetLength(byteCount - kPacketHeaderByteCount);
+			packet.Offset = 0;
+			packet.Length = byteCount - kPacketHeaderByteCount;
+			return true;
+		}
+
+		// Copy the messages packed into a batched packet, since the buffer only fits 1 message at a time,
+		// and return the first one.
+		if ((bytes[0] == kPacketTypeBatch) && !isOnPingChannel)
+		{
+			fUnpackedMessages.clear();
+			UnpackBatchPacket(bytes, byteCount, packet, 0, fUnpackedMessages);
+			for (auto&& message : fUnpackedMessages)
+			{
+				fPendingMessages.push_back(PendingMessage());
+				auto& pendingMessage = fPendingMessages.back();
+				pendingMessage.LocalUserId = session.GetProductUserId();
+				pendingMessage.Packet = message;
+				pendingMessage.Bytes.assign(bytes + message.Offset, bytes + message.Offset + message.Length);
+			}
+			if (PopPendingMessage(session.GetProductUserId(), channelPointer, buffer, packet))
+			{
+				return true;
+			}
+			continue;
+		}
+
+		// Handle the plugin's own packets natively.
+		HandleInternalPacket(session, packet, bytes, byteCount);
+	}
+}
+
+bool P2PManager::IsAutoReceiveEnabled() const
+{
+	return fIsAutoReceiveEnabled;
+}
+
+void P2PManager::SetAutoReceiveEnabled(bool value)
+{
+	fIsAutoReceiveEnabled = value;
+}
+
+uint32_t P2PManager::GetMaxReceivePacketCount() const
+{
+	return fMaxReceivePacketCount;
+}
+
+void P2PManager::SetMaxReceivePacketCount(uint32_t value)
+{
+	fMaxReceivePacketCount = (value > 0) ? value : 1;
+}
+
+uint32_t P2PManager::GetMaxReceiveByteCount() const
+{
+	return fMaxReceiveByteCount;
+}
+
+void P2PManager::SetMaxReceiveByteCount(uint32_t value)
+{
+	fMaxReceiveByteCount = value;
+}
+
+std::chrono::milliseconds P2PManager::GetStatsEventInterval() const
+{
+	return fStatsEventInterval;
+}
+
+void P2PManager::SetStatsEventInterval(std::chrono::milliseconds value)
+{
+	fStatsEventInterval = (value.count() > 0) ? value : std::chrono::milliseconds(0);
+}
+
+bool P2PManager::FetchPacketQueueInfo(EOS_P2P_PacketQueueInfo& queueInfo) const
+{
+	auto p2pHandle = GetP2PHandle();
+	if (!p2pHandle)
+	{
+		return false;
+	}
+	EOS_P2P_GetPacketQueueInfoOptions options = {};
+	options.ApiVersion = EOS_P2P_GETPACKETQUEUEINFO_API_LATEST;
+	return (EOS_P2P_GetPacketQueueInfo(p2pHandle, &options, &queueInfo) == EOS_EResult::EOS_Success);
+}
+
+void P2PManager::Update()
+{
+	// Track the connections of local users that logged in or out since the last frame.
+	// Apply the configured packet queue sizes and network settings once the EOS platform exists.
+	fConnectionManager.Update();
+	fQueueManager.Update();
+	fNetworkSettings.Update();
+
+	// Let a simulated transport advance its clock before this frame's packets are sent and received.
+	fTransportPointer->Update();
+
+	// Send this frame's queued messages and the next fragments of large messages being sent.
+	// Report the progress of large messages being received.
+	// Discard large messages whose sender stopped sending fragments.
+	FlushMessages();
+	SendQueuedFragments();
+	QueueTransferProgressEvents();
+	RemoveStalledTransfers();
+
+	// Ping peers and report their link statistics.
+	UpdateLinkStats();
+
+	// Do not continue if Lua receives packets itself.
+	if (!fIsAutoReceiveEnabled)
+	{
+		return;
+	}
+	auto luaStatePointer = fContext.GetMainLuaState();
+	if (!fTransportPointer->IsAvailable() || !luaStatePointer)
+	{
+		return;
+	}
+
+	// Fetch the buffer that this frame's packets are written to, back to back.
+	// Its previous content was dispatched to Lua last frame and is no longer needed.
+	auto bufferPointer = PushBufferTo(luaStatePointer, fDrainBufferLuaReference);
+	lua_pop(luaStatePointer, 1);
+	if (!bufferPointer)
+	{
+		return;
+	}
+
+	// Receive each local user's packets directly into the buffer until this frame's limits have been reached.
+	uint32_t packetCount = 0;
+	uint32_t writeOffset = 0;
+	for (auto sessionPointer : fContext.GetLocalUsers())
+	{
+		if (!sessionPointer->GetProductUserId())
+		{
+			continue;
+		}
+		fDrainedPackets.clear();
+		while ((packetCount < fMaxReceivePacketCount) && (writeOffset < fMaxReceiveByteCount))
+		{
+			// Receive the next packet at the end of the buffer, growing it if needed.
+			bufferPointer->Reserve(writeOffset + EOS_P2P_MAX_PACKET_SIZE);
+			ReceivedPacket packet;
+			uint32_t byteCount = 0;
+			bool wasReceived = fTransportPointer->Receive(
+					sessionPointer->GetProductUserId(), nullptr, bufferPointer->GetData() + writeOffset,
+					EOS_P2P_MAX_PACKET_SIZE, packet.PeerId, packet.SocketId, packet.Channel, byteCount);
+			if (!wasReceived)
+			{
+				break;
+			}
+			packetCount++;
+			fLinkStats.RecordReceived(sessionPointer->GetProductUserId(), packet.PeerId, packet.SocketId, byteCount);
+
+			// Keep application packets in the buffer, referencing their payload after the header.
+			// Batched packets are kept as is too, referencing each of their messages instead.
+			auto bytes = bufferPointer->GetData() + writeOffset;
+			bool isApplicationChannel = (packet.Channel != kPingChannel);
+			if (isApplicationChannel && (byteCount >= kPacketHeaderByteCount) && (bytes[0] == kPacketTypeData))
+			{
+				packet.Offset = writeOffset + kPacketHeaderByteCount;
+				packet.Length = byteCount - kPacketHeaderByteCount;
+				fDrainedPackets.push_back(packet);
+				writeOffset += byteCount;
+			}
+			else if (isApplicationChannel && (byteCount >= kPacketHeaderByteCount) && (bytes[0] == kPacketTypeBatch))
+			{
+				UnpackBatchPacket(bytes, byteCount, packet, writeOffset, fDrainedPackets);
+				writeOffset += byteCount;
+			}
+			else
+			{
+				HandleInternalPacket(*sessionPointer, packet, bytes, byteCount);
+			}
+		}
+		QueuePacketsEvents(*sessionPointer, fDrainedPackets);
+	}
+	bufferPointer->SetLength(writeOffset);
+}
+
+bool P2PManager::SendFramedPacket(
+	EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const EOS_P2P_SocketId& socketId,
+	uint8_t channel, EOS_EPacketReliability reliability)
+{
+	// Validate.
+	if (!fTransportPointer->IsAvailable() || !localUserId || !remoteUserId || fSendBytes.empty())
+	{
+		return false;
+	}
+
+	// Send the packet. Transports copy its bytes, so the scratch memory can be re-used immediately.
+	auto byteCount = (uint32_t)fSendBytes.size();
+	bool wasSent = fTransportPointer->Send(
+			localUserId, remoteUserId, socketId, channel, reliability, fSendBytes.data(), byteCount);
+	if (!wasSent)
+	{
+		return false;
+	}
+	fLinkStats.RecordSent(localUserId, remoteUserId, socketId, byteCount);
+	return true;
+}
+
+void P2PManager::HandleInternalPacket(
+	LocalUserSession& session, const ReceivedPacket& packet, const uint8_t* bytes, uint32_t byteCount)
+{
+	// Validate.
+	if (!bytes || (byteCount < kPacketHeaderByteCount))
+	{
+		return;
+	}
+	auto payloadBytes = bytes + kPacketHeaderByteCount;
+	auto payloadByteCount = byteCount - kPacketHeaderByteCount;
+
+	// Let the replicator track which snapshots the peer has, so that later deltas can be relative to them.
+	if (bytes[0] == kPacketTypeSnapshotAck)
+	{
+		fSnapshotReplicator.ReadAckFrom(session.GetProductUserId(), packet.PeerId, payloadBytes, payloadByteCount);
+		return;
+	}
+
+	// Answer pings by echoing their sequence number back on the same socket.
+	if (bytes[0] == kPacketTypePing)
+	{
+		uint32_t offset = 0;
+		uint32_t sequence = 0;
+		if (P2PWireFormat::ReadVarUInt32From(payloadBytes, payloadByteCount, offset, sequence))
+		{
+			fSendBytes.clear();
+			fSendBytes.push_back(kPacketTypePong);
+			P2PWireFormat::WriteVarUIntTo(fSendBytes, sequence);
+			SendFramedPacket(
+					session.GetProductUserId(), packet.PeerId, packet.SocketId, kPingChannel,
+					EOS_EPacketReliability::EOS_PR_UnreliableUnordered);
+		}
+		return;
+	}
+
+	// Let the link statistics measure the round trip time of answered pings.
+	if (bytes[0] == kPacketTypePong)
+	{
+		uint32_t offset = 0;
+		uint32_t sequence = 0;
+		if (P2PWireFormat::ReadVarUInt32From(payloadBytes, payloadByteCount, offset, sequence))
+		{
+			fLinkStats.RecordPong(session.GetProductUserId(), packet.PeerId, sequence);
+		}
+		return;
+	}
+
+	// Copy message fragments to their place in the message's buffer.
+	if ((bytes[0] == kPacketTypeFragment) || (bytes[0] == kPacketTypeSnapshotFragment))
+	{
+		HandleFragment(session, packet, payloadBytes, payloadByteCount, (bytes[0] == kPacketTypeSnapshotFragment));
+		return;
+	}
+
+	// Discard a message whose sender gave up on it right away, instead of waiting for it to stall.
+	if (bytes[0] == kPacketTypeFragmentAbort)
+	{
+		uint32_t offset = 0;
+		uint32_t transferId = 0;
+		if (P2PWireFormat::ReadVarUInt32From(payloadBytes, payloadByteCount, offset, transferId))
+		{
+			fInboundTransfers.erase(InboundTransferKey(session.GetProductUserId(), packet.PeerId, transferId));
+		}
+		return;
+	}
+
+	// Rebuild a received snapshot, acknowledge it, and queue it to be dispatched to Lua.
+	// Snapshots that arrived out of order or whose baseline is no longer remembered are dropped.
+	if (bytes[0] == kPacketTypeSnapshot)
+	{
+		std::shared_ptr<const SnapshotReplicator::Schema> schemaPointer;
+		auto snapshotPointer = fSnapshotReplicator.ReadDeltaFrom(
+				session.GetProductUserId(), packet.PeerId, payloadBytes, payloadByteCount, schemaPointer);
+		if (!snapshotPointer)
+		{
+			return;
+		}
+		fSendBytes.clear();
+		fSendBytes.push_back(kPacketTypeSnapshotAck);
+		SnapshotReplicator::WriteAckTo(fSendBytes, schemaPointer->Id, snapshotPointer->Sequence);
+		SendFramedPacket(
+				session.GetProductUserId(), packet.PeerId, packet.SocketId, packet.Channel,
+				EOS_EPacketReliability::EOS_PR_UnreliableUnordered);
+		auto taskPointer = std::make_shared<DispatchP2PSnapshotEventTask>();
+		taskPointer->AcquireEventDataFrom(session.GetUserHandle(), packet, schemaPointer, snapshotPointer);
+		fContext.QueueDispatchEventTask(taskPointer);
+	}
+}
+
+void P2PManager::HandleFragment(
+	LocalUserSession& session, const ReceivedPacket& packet, const uint8_t* bytes, uint32_t byteCount,
+	bool isSnapshot)
+{
+	// Read the fragment's header, ignoring malformed fragments and messages too large to accept.
+	uint32_t offset = 0;
+	uint32_t transferId = 0;
+	uint32_t totalByteCount = 0;
+	uint32_t fragmentOffset = 0;
+	bool isValid =
+			P2PWireFormat::ReadVarUInt32From(bytes, byteCount, offset, transferId) &&
+			P2PWireFormat::ReadVarUInt32From(bytes, byteCount, offset, totalByteCount) &&
+			P2PWireFormat::ReadVarUInt32From(bytes, byteCount, offset, fragmentOffset);
+	if (!isValid || (totalByteCount > kMaxMessageByteCount))
+	{
+		return;
+	}
+	uint32_t fragmentByteCount = byteCount - offset;
+
+	// Fetch the message's transfer, starting a new one upon receiving the message's first fragment.
+	// Fragments arriving without their first fragment, such as after a transfer was discarded, are ignored.
+	auto localUserId = session.GetProductUserId();
+	auto transferKey = InboundTransferKey(localUserId, packet.PeerId, transferId);
+	auto transferIterator = fInboundTransfers.find(transferKey);
+	if (transferIterator == fInboundTransfers.end())
+	{
+		// Refuse the message if the peer or all peers are already sending too many messages at once.
+		// Otherwise a peer could exhaust memory by starting an unbounded number of transfers.
+		if ((fragmentOffset != 0) || (fInboundTransfers.size() >= kMaxInboundTransferCount))
+		{
+			return;
+		}
+		size_t peerTransferCount = 0;
+		auto peerIterator = fInboundTransfers.lower_bound(InboundTransferKey(localUserId, packet.PeerId, 0));
+		for (; peerIterator != fInboundTransfers.end(); peerIterator++)
+		{
+			bool isSamePeer =
+					(std::get<0>(peerIterator->first) == localUserId) &&
+					(std::get<1>(peerIterator->first) == packet.PeerId);
+			if (!isSamePeer)
+			{
+				break;
+			}
+			peerTransferCount++;
+		}
+		if (peerTransferCount >= kMaxInboundTransferCountPerPeer)
+		{
+			return;
+		}
+
+		// Start the transfer with an empty buffer, grown as fragments arrive rather than sized by the claimed total.
+		transferIterator = fInboundTransfers.insert(std::make_pair(transferKey, InboundTransfer())).first;
+		auto& transfer = transferIterator->second;
+		transfer.UserHandle = session.GetUserHandle();
+		transfer.Packet = packet;
+		transfer.Packet.Offset = 0;
+		transfer.Packet.Length = totalByteCount;
+		transfer.TotalByteCount = totalByteCount;
+		transfer.ReceivedByteCount = 0;
+		transfer.HasProgressed = false;
+		transfer.IsSnapshot = isSnapshot;
+		transfer.BytesPointer = std::make_shared<std::vector<uint8_t>>();
+	}
+
+	// Fragments are sent on a reliable ordered channel, so each must continue exactly where the last one ended.
+	// Discard the transfer if not, since the message would otherwise be handed to Lua with gaps or overlaps.
+	auto& transfer = transferIterator->second;
+	bool isNextFragment =
+			(totalByteCount == transfer.TotalByteCount) && (fragmentOffset == transfer.ReceivedByteCount) &&
+			(fragmentByteCount <= (totalByteCount - fragmentOffset)) && (isSnapshot == transfer.IsSnapshot);
+	if (!isNextFragment)
+	{
+		fInboundTransfers.erase(transferIterator);
+		return;
+	}
+
+	// Append the fragment to the message.
+	transfer.BytesPointer->insert(transfer.BytesPointer->end(), bytes + offset, bytes + offset + fragmentByteCount);
+	transfer.ReceivedByteCount += fragmentByteCount;
+	transfer.HasProgressed = true;
+	transfer.LastProgressTime = std::chrono::steady_clock::now();
+
+	// Handle a snapshot natively once all of its bytes were received. Only snapshot packets are accepted this way.
+	bool isFinished = (transfer.ReceivedByteCount >= transfer.TotalByteCount);
+	if (isFinished && transfer.IsSnapshot)
+	{
+		auto bytesPointer = transfer.BytesPointer;
+		auto transferPacket = transfer.Packet;
+		fInboundTransfers.erase(transferIterator);
+		if (!bytesPointer->empty() && (bytesPointer->front() == kPacketTypeSnapshot))
+		{
+			HandleInternalPacket(session, transferPacket, bytesPointer->data(), (uint32_t)bytesPointer->size());
+		}
+		return;
+	}
+
+	// Hand the message to Lua once all of its bytes were received.
+	if (isFinished)
+	{
+		auto taskPointer = std::make_shared<DispatchP2PMessageEventTask>();
+		taskPointer->AcquireEventDataFrom(transfer.UserHandle, transfer.Packet, transferId, transfer.BytesPointer);
+		fContext.QueueDispatchEventTask(taskPointer);
+		fInboundTransfers.erase(transferIterator);
+	}
+}
+
+bool P2PManager::QueueOutboundTransfer(
+	EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const EOS_P2P_SocketId& socketId,
+	uint8_t channel, bool isSnapshot, const void* data, uint32_t byteCount)
+{
+	// Refuse the message if too many bytes of earlier messages are still waiting to be sent.
+	size_t queuedByteCount = byteCount;
+	for (auto&& transfer : fOutboundTransfers)
+	{
+		queuedByteCount += transfer.Bytes.size() - transfer.SentByteCount;
+	}
+	if (queuedByteCount > kMaxOutboundTransferByteCount)
+	{
+		return false;
+	}
+
+	// Queue a copy of the message, to be sent after the messages queued before it.
+	fLastTransferId++;
+	fOutboundTransfers.push_back(OutboundTransfer());
+	auto& transfer = fOutboundTransfers.back();
+	transfer.LocalUserId = localUserId;
+	transfer.RemoteUserId = remoteUserId;
+	transfer.SocketId = socketId;
+	transfer.Channel = channel;
+	transfer.TransferId = fLastTransferId;
+	transfer.IsSnapshot = isSnapshot;
+	if (byteCount > 0)
+	{
+		auto dataBytes = (const uint8_t*)data;
+		transfer.Bytes.assign(dataBytes, dataBytes + byteCount);
+	}
+	transfer.SentByteCount = 0;
+	transfer.FailedFrameCount = 0;
+	return true;
+}
+
+void P2PManager::SendQueuedFragments()
+{
+	// Send the oldest message's fragments first, each filling up a whole packet, until the frame's budget is spent.
+	// Always send at least 1 fragment, even if empty. The reliable ordered channel delivers them all,
+	// letting the receiver count bytes to detect the last one.
+	uint32_t budgetByteCount = kFragmentByteBudgetPerFrame;
+	while (!fOutboundTransfers.empty() && (budgetByteCount > 0))
+	{
+		auto& transfer = fOutboundTransfers.front();
+		auto byteCount = (uint32_t)transfer.Bytes.size();
+		fSendBytes.clear();
+		fSendBytes.push_back(transfer.IsSnapshot ? kPacketTypeSnapshotFragment : kPacketTypeFragment);
+		P2PWireFormat::WriteVarUIntTo(fSendBytes, transfer.TransferId);
+		P2PWireFormat::WriteVarUIntTo(fSendBytes, byteCount);
+		P2PWireFormat::WriteVarUIntTo(fSendBytes, transfer.SentByteCount);
+		uint32_t fragmentByteCount = std::min(
+				byteCount - transfer.SentByteCount, EOS_P2P_MAX_PACKET_SIZE - (uint32_t)fSendBytes.size());
+		auto fragmentBytes = transfer.Bytes.data() + transfer.SentByteCount;
+		fSendBytes.insert(fSendBytes.end(), fragmentBytes, fragmentBytes + fragmentByteCount);
+		bool wasSent = SendFramedPacket(
+				transfer.LocalUserId, transfer.RemoteUserId, transfer.SocketId, transfer.Channel,
+				EOS_EPacketReliability::EOS_PR_ReliableOrdered);
+
+		// If the fragment failed to send, such as when the outgoing queue is full, then try again next frame.
+		// Abort the message if it keeps failing, telling the receiver to discard the fragments it already has.
+		if (!wasSent)
+		{
+			transfer.FailedFrameCount++;
+			if (transfer.FailedFrameCount < kMaxFragmentSendAttemptCount)
+			{
+				break;
+			}
+			CoronaLog(
+					"WARNING: Aborted sending a P2P message of %u bytes after %u bytes were sent.",
+					byteCount, transfer.SentByteCount);
+			if (transfer.SentByteCount > 0)
+			{
+				fSendBytes.clear();
+				fSendBytes.push_back(kPacketTypeFragmentAbort);
+				P2PWireFormat::WriteVarUIntTo(fSendBytes, transfer.TransferId);
+				SendFramedPacket(
+						transfer.LocalUserId, transfer.RemoteUserId, transfer.SocketId, transfer.Channel,
+						EOS_EPacketReliability::EOS_PR_ReliableOrdered);
+			}
+			fOutboundTransfers.pop_front();
+			continue;
+		}
+
+		// Move on to the next message once this one's last fragment was sent.
+		transfer.FailedFrameCount = 0;
+		transfer.SentByteCount += fragmentByteCount;
+		budgetByteCount -= std::min(budgetByteCount, (uint32_t)fSendBytes.size());
+		if (transfer.SentByteCount >= byteCount)
+		{
+			fOutboundTransfers.pop_front();
+		}
+	}
+}
+
+void P2PManager::QueueTransferProgressEvents()
+{
+	for (auto&& pair : fInboundTransfers)
+	{
+		auto& transfer = pair.second;
+		if (transfer.HasProgressed && !transfer.IsSnapshot)
+		{
+			auto taskPointer = std::make_shared<DispatchP2PMessageProgressEventTask>();
+			taskPointer->AcquireEventDataFrom(
+					transfer.UserHandle, transfer.Packet, std::get<2>(pair.first),
+					transfer.ReceivedByteCount, transfer.TotalByteCount);
+			fContext.QueueDispatchEventTask(taskPointer);
+			transfer.HasProgressed = false;
+		}
+	}
+}
+
+void P2PManager::RemoveStalledTransfers()
+{
+	auto now = std::chrono::steady_clock::now();
+	for (auto iterator = fInboundTransfers.begin(); iterator != fInboundTransfers.end();)
+	{
+		bool isStalled = ((now - iterator->second.LastProgressTime) >= kInboundTransferTimeout);
+		iterator = isStalled ? fInboundTransfers.erase(iterator) : std::next(iterator);
+	}
+}
+
+void P2PManager::UpdateLinkStats()
+{
+	// Forget the links of local users that have logged out.
+	std::vector<EOS_ProductUserId> localUserIds;
+	for (auto sessionPointer : fContext.GetLocalUsers())
+	{
+		if (sessionPointer->GetProductUserId())
+		{
+			localUserIds.push_back(sessionPointer->GetProductUserId());
+		}
+	}
+	fLinkStats.RemoveLocalUsersExcept(localUserIds);
+
+	// Send the pings that are due.
+	fDuePings.clear();
+	fLinkStats.CollectDuePings(fDuePings);
+	for (auto&& ping : fDuePings)
+	{
+		fSendBytes.clear();
+		fSendBytes.push_back(kPacketTypePing);
+		P2PWireFormat::WriteVarUIntTo(fSendBytes, ping.Sequence);
+		SendFramedPacket(
+				ping.LocalUserId, ping.RemoteUserId, ping.SocketId, kPingChannel,
+				EOS_EPacketReliability::EOS_PR_UnreliableUnordered);
+	}
+
+	// Dispatch every link's statistics to Lua once per stats event interval.
+	auto now = std::chrono::steady_clock::now();
+	bool isEventDue = (fStatsEventInterval.count() > 0) && ((now - fLastStatsEventTime) >= fStatsEventInterval);
+	if (!isEventDue)
+	{
+		return;
+	}
+	fLastStatsEventTime = now;
+	std::vector<std::pair<P2PLinkStats::PeerKey, P2PLinkStats::PeerStats>> allPeerStats;
+	fLinkStats.CopyAllPeerStatsTo(allPeerStats);
+	std::vector<DispatchP2PStatsEventTask::PeerEntry> peers;
+	peers.reserve(allPeerStats.size());
+	for (auto&& pair : allPeerStats)
+	{
+		auto sessionPointer = fContext.GetLocalUserBy(std::get<0>(pair.first));
+		if (!sessionPointer)
+		{
+			continue;
+		}
+		DispatchP2PStatsEventTask::PeerEntry peer = {};
+		peer.UserHandle = sessionPointer->GetUserHandle();
+		peer.PeerId = std::get<1>(pair.first);
+		peer.Stats = pair.second;
+		peers.push_back(peer);
+	}
+	EOS_P2P_PacketQueueInfo queueInfo = {};
+	bool hasQueueInfo = FetchPacketQueueInfo(queueInfo);
+	auto taskPointer = std::make_shared<DispatchP2PStatsEventTask>();
+	taskPointer->AcquireEventDataFrom(
+			peers, hasQueueInfo ? &queueInfo : nullptr, fQueueManager.GetOverflowStats());
+	fContext.QueueDispatchEventTask(taskPointer);
+}
+
+bool P2PManager::PopPendingMessage(
+	EOS_ProductUserId localUserId, const uint8_t* channelPointer, ByteBuffer& buffer, ReceivedPacket& packet)
+{
+	for (auto iterator = fPendingMessages.begin(); iterator != fPendingMessages.end(); iterator++)
+	{
+		bool isMatch =
+				(iterator->LocalUserId == localUserId) &&
+				(!channelPointer || (iterator->Packet.Channel == *channelPointer));
+		if (isMatch)
+		{
+			auto byteCount = (uint32_t)iterator->Bytes.size();
+			buffer.Reserve(byteCount);
+			if (byteCount > 0)
+			{
+				memcpy(buffer.GetData(), iterator->Bytes.data(), byteCount);
+			}
+			buffer.SetLength(byteCount);
+			packet = iterator->Packet;
+			packet.Offset = 0;
+			fPendingMessages.erase(iterator);
+			return true;
+		}
+	}
+	return false;
+}
+
+ByteBuffer* P2PManager::PushReceiveBufferTo(lua_State* luaStatePointer)
+{
+	return PushBufferTo(luaStatePointer, fReceiveBufferLuaReference);
+}
+
+ByteBuffer* P2PManager::PushBufferTo(lua_State* luaStatePointer, int& luaReference)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return nullptr;
+	}
+
+	// Push the existing buffer, if created.
+	if (luaReference != LUA_NOREF)
+	{
+		lua_rawgeti(luaStatePointer, LUA_REGISTRYINDEX, luaReference);
+		auto bufferPointer = ByteBuffer::GetFrom(luaStatePointer, -1);
+		if (bufferPointer)
+		{
+			return bufferPointer;
+		}
+		lua_pop(luaStatePointer, 1);
+	}
+
+	// Create the buffer, preallocated to fit the largest possible packet, and keep it alive via the Lua registry.
+	auto bufferPointer = ByteBuffer::PushNewTo(luaStatePointer);
+	bufferPointer->Reserve(EOS_P2P_MAX_PACKET_SIZE);
+	lua_pushvalue(luaStatePointer, -1);
+	luaReference = luaL_ref(luaStatePointer, LUA_REGISTRYINDEX);
+	return bufferPointer;
+}
+
+void P2PManager::QueuePacketsEvents(LocalUserSession& session, std::vector<ReceivedPacket>& packets)
+{
+	// Group the packets by channel, preserving the order they were received in within each channel.
+	std::stable_sort(
+			packets.begin(), packets.end(),
+			[](const ReceivedPacket& x, const ReceivedPacket& y)->bool { return x.Channel < y.Channel; });
+
+	// Queue 1 event per channel.
+	auto iterator = packets.begin();
+	while (iterator != packets.end())
+	{
+		auto channel = iterator->Channel;
+		auto endIterator = std::find_if(
+				iterator, packets.end(), [channel](const ReceivedPacket& packet)->bool { return packet.Channel != channel; });
+		auto taskPointer = std::make_shared<DispatchP2PPacketsEventTask>();
+		taskPointer->AcquireEventDataFrom(
+				session.GetUserHandle(), channel, fDrainBufferLuaReference,
+				std::vector<ReceivedPacket>(iterator, endIterator));
+		fContext.QueueDispatchEventTask(taskPointer);
+		iterator = endIterator;
+	}
+}
+
+LuaValueCodec& P2PManager::GetCodec()
+{
+	return fCodec;
+}
+
+SnapshotReplicator& P2PManager::GetSnapshotReplicator()
+{
+	return fSnapshotReplicator;
+}
+
+P2PConnectionManager& P2PManager::GetConnectionManager()
+{
+	return fConnectionManager;
+}
+
+P2PLinkStats& P2PManager::GetLinkStats()
+{
+	return fLinkStats;
+}
+
+P2PQueueManager& P2PManager::GetQueueManager()
+{
+	return fQueueManager;
+}
+
+P2PNetworkSettings& P2PManager::GetNetworkSettings()
+{
+	return fNetworkSettings;
+}
+
+P2PInterestManager& P2PManager::GetInterestManager()
+{
+	return fInterestManager;
+}
+
+P2PTransport& P2PManager::GetTransport()
+{
+	return *fTransportPointer;
+}
+
+void P2PManager::SetTransport(std::unique_ptr<P2PTransport> transportPointer)
+{
+	// Do not allow the transport to be removed. Fall back to EOS instead.
+	if (!transportPointer)
+	{
+		transportPointer.reset(new EosP2PTransport(fContext));
+	}
+
+	// Replace the transport, discarding all state tied to the peers of the previous transport.
+	ClearTransportState();
+	fTransportPointer = std::move(transportPointer);
+}
+
+void P2PManager::ClearTransportState()
+{
+	// Discard messages still queued to be sent and messages partially or fully received but not yet handed to Lua.
+	fOutboundQueues.clear();
+	fOutboundTransfers.clear();
+	fInboundTransfers.clear();
+	fPendingMessages.clear();
+	fDrainedPackets.clear();
+
+	// Forget what each peer acknowledged, the statistics of each link, and which peers are interested in what.
+	fSnapshotReplicator.ClearStreams();
+	fLinkStats.Clear();
+	fDuePings.clear();
+	fInterestManager.RemoveAllPeers();
+}
+
+EOS_HP2P P2PManager::GetP2PHandle() const
+{
+	if (!fContext.fPlatformHandle)
+	{
+		return nullptr;
+	}
+	return EOS_Platform_GetP2PInterface(fContext.fPlatformHandle);
+}
@@ -0,0 +1,630 @@
+// ----------------------------------------------------------------------------
+//
+// P2PManager.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "LuaValueCodec.h"
+#include "P2PConnectionManager.h"
+#include "P2PInterestManager.h"
+#include "P2PLinkStats.h"
+#include "P2PNetworkSettings.h"
+#include "P2PQueueManager.h"
+#include "P2PTransport.h"
+#include "SnapshotReplicator.h"
+#include "eos_p2p_types.h"
+
+
+// Forward declarations.
+class ByteBuffer;
+class LocalUserSession;
+class RuntimeContext;
+extern "C"
+{
+	struct lua_State;
+}
+
+
+/**
+  Sends and receives packets between local users and remote peers via the EOS P2P interface
+  or another P2PTransport given to SetTransport().
+
+  Every packet sent by this plugin starts with a 1 byte header identifying the packet's type, letting the plugin
+  mix its own internal packets with the application's packets on the same sockets. The header is stripped before
+  the application's packets are handed to Lua.
+
+  Received packets are written directly into a single re-usable ByteBuffer owned by the Lua registry, so that
+  receiving packets at a high rate does not create any Lua garbage.
+
+  Small messages can be queued per peer and channel via QueueMessage() instead of being sent right away.
+  Update() then packs each queue's messages into as few packets as possible, each up to EOS_P2P_MAX_PACKET_SIZE,
+  and the receiving plugin splits them back into individual messages. Receivers cannot tell the difference.
+
+  Packets can also be received automatically once per frame via SetAutoReceiveEnabled(). All of the frame's packets
+  are then written back to back into one buffer and dispatched to Lua as one "p2pPackets" event per local user and
+  channel, listing each packet's offset and length within that buffer.
+
+  Entity state snapshots can be replicated via SendSnapshot(), which sends each peer only what changed since the
+  last snapshot it acknowledged. Received snapshots are acknowledged natively and dispatched to Lua as "p2pSnapshot"
+  events, regardless of whether Lua receives its own packets automatically or via ReceivePacket().
+
+  Packets can be broadcast via BroadcastPacket() to only the peers interested in them, such as the peers near the
+  position of the entity being updated or the subscribers of a topic, as tracked by a P2PInterestManager.
+
+  Messages too large for 1 packet can be sent via SendLargeMessage(), which queues them to be split into fragments
+  sent on a reliable ordered channel. Update() sends the queued fragments a limited number of bytes per frame so that
+  large messages do not flood the outgoing packet queue, and tells the receiver to discard a message if its fragments
+  keep failing to send. The receiving plugin appends each fragment to the message's buffer as it arrives, reports
+  progress once per frame via "p2pMessageProgress" events, and hands the finished buffer to Lua without copying it
+  again via a "p2pMessage" event. Messages received at once are limited per peer and discarded if they stall.
+
+  Every packet sent and received is counted per peer by a P2PLinkStats instance. Once a ping interval is set, active
+  peers are also pinged on the reserved kPingChannel to measure round trip time and loss, and once a stats event
+  interval is set, all peers' statistics are dispatched to Lua periodically via a "p2pStats" event.
+ */
+class P2PManager
+{
+	public:
+		/** Provides information about a packet received by ReceivePacket(). */
+		struct ReceivedPacket
+		{
+			/** The product user that sent the packet. */
+			EOS_ProductUserId PeerId;
+
+			/** The socket the packet was received on. */
+			EOS_P2P_SocketId SocketId;
+
+			/** The channel the packet was received on. */
+			uint8_t Channel;
+
+			/** Zero-based offset of the packet's first byte in the buffer it was received into. */
+			uint32_t Offset;
+
+			/** Number of bytes in the packet, excluding the plugin's header. */
+			uint32_t Length;
+		};
+
+
+		/** Max number of application bytes that can be sent in a single packet, excluding the plugin's header. */
+		static const uint32_t kMaxPayloadByteCount;
+
+		/** Max number of bytes that can be sent in a single message via SendLargeMessage(). */
+		static const uint32_t kMaxMessageByteCount;
+
+		/**
+		  Channel reserved for pings sent to measure round trip time. Application packets sent on it are dropped,
+		  which is why the Lua bindings only accept channels 0 through 254.
+		 */
+		static const uint8_t kPingChannel;
+
+
+		/**
+		  Creates a new P2P manager.
+		  @param context The runtime context that owns this manager.
+		 */
+		P2PManager(RuntimeContext& context);
+
+		/** Releases the receive buffers from the Lua registry and destroys this manager. */
+		virtual ~P2PManager();
+
+		/**
+		  Sends an application packet to the given remote peer, opening a connection to it if needed.
+		  @param session The local user sending the packet. Must be logged into the Connect interface.
+		  @param remoteUserId The product user to send the packet to.
+		  @param socketName Name of the socket to send the packet on. Both peers must use the same name.
+		  @param channel The channel to send the packet on.
+		  @param data Pointer to the bytes to send. Can be null if "byteCount" is zero.
+		  @param byteCount Number of bytes to send. Cannot exceed kMaxPayloadByteCount.
+		  @param reliability How the packet is to be delivered.
+		  @return Returns true if the packet was queued to be sent by EOS.
+
+		          Returns false if given invalid arguments, if the user is not logged into Connect,
+		          or if EOS failed to queue the packet.
+		 */
+		bool SendPacket(
+				LocalUserSession& session, EOS_ProductUserId remoteUserId, const char* socketName, uint8_t channel,
+				const void* data, uint32_t byteCount, EOS_EPacketReliability reliability);
+
+		/**
+		  Sends an application packet to every remote peer that the given relevancy matches
+		  according to the interests tracked by GetInterestManager(), without Lua having to loop through peers.
+		  The packet is framed once and then handed to the transport for each peer.
+		  @param session The local user sending the packet. Must be logged into the Connect interface.
+		  @param relevancy The packet's position and topic. If it has neither, the packet is sent to all tracked peers.
+		  @param socketName Name of the socket to send the packet on. Both peers must use the same name.
+		  @param channel The channel to send the packet on.
+		  @param data Pointer to the bytes to send. Can be null if "byteCount" is zero.
+		  @param byteCount Number of bytes to send. Cannot exceed kMaxPayloadByteCount.
+		  @param reliability How the packet is to be delivered.
+		  @return Returns the number of peers the packet was queued to be sent to.
+		          Returns zero if given invalid arguments or if the user is not logged into Connect.
+		 */
+		uint32_t BroadcastPacket(
+				LocalUserSession& session, const P2PInterestManager::Relevancy& relevancy, const char* socketName,
+				uint8_t channel, const void* data, uint32_t byteCount, EOS_EPacketReliability reliability);
+
+		/**
+		  Queues a message to be sent to the given remote peer by the next call to FlushMessages() or Update().
+		  Messages queued for the same peer, socket, channel, and reliability are packed together into packets.
+		  @param session The local user sending the message. Must be logged into the Connect interface.
+		  @param remoteUserId The product user to send the message to.
+		  @param socketName Name of the socket to send the message on. Both peers must use the same name.
+		  @param channel The channel to send the message on.
+		  @param data Pointer to the bytes to send. Can be null if "byteCount" is zero.
+		  @param byteCount Number of bytes to send. Cannot exceed kMaxPayloadByteCount.
+		  @param reliability How the message is to be delivered.
+		  @param coalesceKey Optional key identifying what the message updates, such as an entity's ID.
+		                     An unreliable message replaces the queued unreliable message having the same key,
+		                     so that only the latest state is sent. Ignored if empty or if the message is reliable.
+		  @return Returns true if the message was queued. Returns false if given invalid arguments.
+		 */
+		bool QueueMessage(
+				LocalUserSession& session, EOS_ProductUserId remoteUserId, const char* socketName, uint8_t channel,
+				const void* data, uint32_t byteCount, EOS_EPacketReliability reliability, const std::string& coalesceKey);
+
+		/**
+		  Queues a message of any size up to kMaxMessageByteCount to be sent to the given remote peer on a reliable
+		  ordered channel, split into as many packets as needed. The remote peer receives it as a "p2pMessage" event.
+		  The message's bytes are copied and its packets are sent by Update() over the next frames, a limited number of
+		  bytes per frame, after the messages queued before it.
+		  @param session The local user sending the message. Must be logged into the Connect interface.
+		  @param remoteUserId The product user to send the message to.
+		  @param socketName Name of the socket to send the message on. Both peers must use the same name.
+		  @param channel The channel to send the message on.
+		  @param data Pointer to the bytes to send. Can be null if "byteCount" is zero.
+		  @param byteCount Number of bytes to send. Cannot exceed kMaxMessageByteCount.
+		  @return Returns true if the message was queued to be sent.
+
+		          Returns false if given invalid arguments, if the user is not logged into Connect,
+		          or if too many bytes of other large messages are still waiting to be sent.
+		 */
+		bool SendLargeMessage(
+				LocalUserSession& session, EOS_ProductUserId remoteUserId, const char* socketName, uint8_t channel,
+				const void* data, uint32_t byteCount);
+
+		/**
+		  Packs all messages queued via QueueMessage() into packets and sends them.
+		  If a packet fails to send, such as when the outgoing queue is full, then its messages and the ones queued
+		  after them for the same destination are kept for the next flush. They are dropped and a warning is logged
+		  if they keep failing to send.
+		 */
+		void FlushMessages();
+
+		/**
+		  Sends a snapshot of entity states to the given remote peers as unreliable packets.
+		  Each peer is sent a delta against the newest snapshot it acknowledged, or the full snapshot if none.
+		  If a peer's delta does not fit in 1 packet, then the full snapshot is queued to be sent to it as reliable
+		  fragments like a large message instead, skipping the peer until that snapshot's fragments were sent.
+		  @param session The local user sending the snapshot. Must be logged into the Connect interface.
+		  @param remoteUserIds The product users to send the snapshot to.
+		  @param socketName Name of the socket to send the snapshot on. Both peers must use the same name.
+		  @param channel The channel to send the snapshot on.
+		  @param schemaId ID of the schema registered via GetSnapshotReplicator() that the entities use.
+		  @param entities The entities captured via SnapshotReplicator::CaptureEntitiesFrom().
+		  @return Returns true if the snapshot was queued to be sent to all peers, or if a peer is skipped
+		          because a full snapshot is still being sent to it.
+
+		          Returns false if given invalid arguments, if the schema is not registered, or if the snapshot
+		          could not be sent to at least 1 peer, such as when its full snapshot exceeds kMaxMessageByteCount.
+		 */
+		bool SendSnapshot(
+				LocalUserSession& session, const std::vector<EOS_ProductUserId>& remoteUserIds, const char* socketName,
+				uint8_t channel, uint8_t schemaId, SnapshotReplicator::EntityMap&& entities);
+
+		/**
+		  Receives the next application packet queued for the given local user.
+		  Internal plugin packets received while searching for it are handled natively and skipped.
+		  @param session The local user to receive a packet for.
+		  @param channelPointer Pointer to the only channel to receive a packet from. Null receives from any channel.
+		  @param buffer The buffer to write the packet's bytes to. Its length is set to the packet's size.
+		  @param packet Receives the packet's sender, socket, and channel.
+		  @return Returns true if a packet was received. Returns false if no packets are queued.
+		 */
+		bool ReceivePacket(
+				LocalUserSession& session, const uint8_t* channelPointer, ByteBuffer& buffer, ReceivedPacket& packet);
+
+		/** Determines if packets are received automatically once per frame by Update(). */
+		bool IsAutoReceiveEnabled() const;
+
+		/**
+		  Enables or disables receiving packets automatically once per frame by Update().
+		  While enabled, Lua is expected to receive packets via "p2pPackets" events instead of ReceivePacket().
+		  @param value Set true to enable. Set false to disable.
+		 */
+		void SetAutoReceiveEnabled(bool value);
+
+		/** Gets the max number of packets received per frame while auto receive is enabled. */
+		uint32_t GetMaxReceivePacketCount() const;
+
+		/**
+		  Sets the max number of packets received per frame while auto receive is enabled.
+		  Packets exceeding the limit stay queued in EOS until the next frame.
+		  @param value The max number of packets. Zero is treated as one.
+		 */
+		void SetMaxReceivePacketCount(uint32_t value);
+
+		/** Gets the max number of bytes received per frame while auto receive is enabled. */
+		uint32_t GetMaxReceiveByteCount() const;
+
+		/**
+		  Sets the max number of bytes received per frame while auto receive is enabled.
+		  Packets exceeding the limit stay queued in EOS until the next frame.
+		  @param value The max number of bytes. The last packet received may overshoot it.
+		 */
+		void SetMaxReceiveByteCount(uint32_t value);
+
+		/** Gets the interval at which a "p2pStats" event is dispatched. Zero if disabled. */
+		std::chrono::milliseconds GetStatsEventInterval() const;
+
+		/**
+		  Sets the interval at which all peers' link statistics are dispatched to Lua via a "p2pStats" event.
+		  @param value The interval. Set to zero to disable the event.
+		 */
+		void SetStatsEventInterval(std::chrono::milliseconds value);
+
+		/**
+		  Fetches the current state of the EOS incoming and outgoing packet queues.
+		  @param queueInfo Receives the queues' state.
+		  @return Returns true if the state was fetched. Returns false if the EOS platform has not been created.
+		 */
+		bool FetchPacketQueueInfo(EOS_P2P_PacketQueueInfo& queueInfo) const;
+
+		/**
+		  To be called once per frame. Updates the connection, queue, and network settings managers,
+		  sends the messages queued via QueueMessage() and the next fragments of the messages queued via
+		  SendLargeMessage(), and queues a "p2pMessageProgress" event
+		  for every message partially received since the last frame.
+		  Pings peers that are due and queues a "p2pStats" event if its interval elapsed.
+		  Then, if auto receive is enabled, drains the packets queued for all local users
+		  into one buffer and queues a "p2pPackets" event per local user and channel.
+		 */
+		void Update();
+
+		/**
+		  Pushes the re-usable buffer that packets received for Lua are written to, creating it the first time.
+		  @param luaStatePointer The Lua state to push the buffer to. Must belong to this manager's runtime context.
+		  @return Returns a pointer to the buffer. Returns null if given a null Lua state.
+		 */
+		ByteBuffer* PushReceiveBufferTo(lua_State* luaStatePointer);
+
+		/**
+		  Gets the codec used to serialize Lua tables given to the "p2p" Lua functions.
+		  Shared so that its memory is re-used between calls.
+		 */
+		LuaValueCodec& GetCodec();
+
+		/** Gets the replicator used to encode and decode snapshots, which snapshot schemas are registered with. */
+		SnapshotReplicator& GetSnapshotReplicator();
+
+		/** Gets the manager tracking the state of every connection with remote peers. */
+		P2PConnectionManager& GetConnectionManager();
+
+		/** Gets the statistics of every link with remote peers, which the ping interval is set on. */
+		P2PLinkStats& GetLinkStats();
+
+		/** Gets the manager sizing the EOS packet queues and handling the incoming queue overflowing. */
+		P2PQueueManager& GetQueueManager();
+
+		/** Gets the manager applying relay and port settings, which caches the local network's NAT type. */
+		P2PNetworkSettings& GetNetworkSettings();
+
+		/** Gets the manager tracking which peers are interested in which broadcasts. */
+		P2PInterestManager& GetInterestManager();
+
+		/** Gets the transport that packets are sent and received with. Defaults to an EosP2PTransport. */
+		P2PTransport& GetTransport();
+
+		/**
+		  Sets the transport that packets are sent and received with, such as a LoopbackP2PTransport
+		  to test netcode between simulated local users without EOS.
+		  All state tied to the previous transport's peers is discarded via ClearTransportState(),
+		  such as queued messages, snapshot acknowledgements, link statistics, and peer interests.
+		  Note that connection tracking, queue management, and network settings always apply to EOS.
+		  @param transportPointer The transport to take ownership of. Null restores the default EOS transport.
+		 */
+		void SetTransport(std::unique_ptr<P2PTransport> transportPointer);
+
+		/**
+		  Fetches the EOS P2P interface.
+		  @return Returns the interface's handle. Returns null if the EOS platform has not been created.
+		 */
+		EOS_HP2P GetP2PHandle() const;
+
+	private:
+		/** Identifies an outbound message queue by local user, remote user, socket name, channel, and reliability. */
+		typedef std::tuple<EOS_ProductUserId, EOS_ProductUserId, std::string, uint8_t, EOS_EPacketReliability>
+				OutboundQueueKey;
+
+		/** A message waiting in an outbound queue. */
+		struct OutboundMessage
+		{
+			/** Key given to QueueMessage(), used to replace this message with a newer one. Empty if none. */
+			std::string CoalesceKey;
+
+			/** The application's bytes to send. */
+			std::vector<uint8_t> Bytes;
+		};
+
+		/** Messages queued via QueueMessage() for 1 destination. */
+		struct OutboundQueue
+		{
+			/** The messages waiting to be sent, in the order they were queued. */
+			std::vector<OutboundMessage> Messages;
+
+			/** Number of consecutive flushes that failed to send the queue's next packet. */
+			int FailedFlushCount;
+		};
+
+		/** Identifies a message being received via fragments by local user, remote user, and transfer ID. */
+		typedef std::tuple<EOS_ProductUserId, EOS_ProductUserId, uint32_t> InboundTransferKey;
+
+		/** A message sent via SendLargeMessage() whose fragments are still being received. */
+		struct InboundTransfer
+		{
+			/** Handle of the local user receiving the message. */
+			int UserHandle;
+
+			/** The message's sender, socket, and channel. */
+			ReceivedPacket Packet;
+
+			/** The message's total number of bytes. */
+			uint32_t TotalByteCount;
+
+			/** Number of bytes received so far. */
+			uint32_t ReceivedByteCount;
+
+			/** Set true if fragments were received since the last progress event. */
+			bool HasProgressed;
+
+			/** Set true if the message is a snapshot, handled natively instead of being handed to Lua. */
+			bool IsSnapshot;
+
+			/** When the last fragment was received. Transfers without progress for too long are discarded. */
+			std::chrono::steady_clock::time_point LastProgressTime;
+
+			/** Buffer that fragments are appended to as they arrive. Handed to Lua when finished. */
+			std::shared_ptr<std::vector<uint8_t>> BytesPointer;
+		};
+
+		/** A message queued via SendLargeMessage() whose fragments are still being sent. */
+		struct OutboundTransfer
+		{
+			/** The local user sending the message. */
+			EOS_ProductUserId LocalUserId;
+
+			/** The product user to send the message to. */
+			EOS_ProductUserId RemoteUserId;
+
+			/** The socket to send the message on. */
+			EOS_P2P_SocketId SocketId;
+
+			/** The channel to send the message on. */
+			uint8_t Channel;
+
+			/** ID identifying the message's fragments to the receiver. */
+			uint32_t TransferId;
+
+			/** Set true if the message is a full snapshot queued by SendSnapshot() instead of an application message. */
+			bool IsSnapshot;
+
+			/** Copy of the message's bytes. */
+			std::vector<uint8_t> Bytes;
+
+			/** Number of the message's bytes sent so far. */
+			uint32_t SentByteCount;
+
+			/** Number of consecutive frames in which the next fragment failed to send. */
+			int FailedFrameCount;
+		};
+
+		/** A message unpacked from a batched packet that ReceivePacket() has not returned yet. */
+		struct PendingMessage
+		{
+			/** The local user that received the message. */
+			EOS_ProductUserId LocalUserId;
+
+			/** The message's sender, socket, and channel. */
+			ReceivedPacket Packet;
+
+			/** The application's bytes. */
+			std::vector<uint8_t> Bytes;
+		};
+
+		/** Copy constructor deleted to prevent it from being called. */
+		P2PManager(const P2PManager&) = delete;
+
+		/** Method deleted to prevent the copy operator from being used. */
+		void operator=(const P2PManager&) = delete;
+
+		/**
+		  Sends the "fSendBytes" scratch memory, which must already start with the plugin's header, as 1 packet.
+		  @return Returns true if the packet was queued to be sent by EOS. Returns false if not.
+		 */
+		bool SendFramedPacket(
+				EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const EOS_P2P_SocketId& socketId,
+				uint8_t channel, EOS_EPacketReliability reliability);
+
+		/**
+		  Handles a packet that the plugin sent to itself on a remote peer, such as a snapshot.
+		  @param session The local user that received the packet.
+		  @param packet The packet's sender, socket, and channel.
+		  @param bytes Pointer to the packet's bytes, starting with its header.
+		  @param byteCount Number of bytes in the packet.
+		 */
+		void HandleInternalPacket(
+				LocalUserSession& session, const ReceivedPacket& packet, const uint8_t* bytes, uint32_t byteCount);
+
+		/**
+		  Appends a fragment of a message sent via SendLargeMessage() to the message's buffer,
+		  queueing a "p2pMessage" event once all of the message's fragments were received.
+		  A snapshot sent as fragments is handled like a snapshot packet once received instead.
+		  Fragments must arrive in order. The number of messages received at once is limited per peer and in total,
+		  and messages are refused or discarded when these limits are exceeded or a fragment is out of place.
+		  @param session The local user that received the fragment.
+		  @param packet The fragment's sender, socket, and channel.
+		  @param bytes Pointer to the fragment's bytes, after the plugin's header.
+		  @param byteCount Number of bytes in the fragment.
+		  @param isSnapshot Set true if the fragment belongs to a snapshot sent by SendSnapshot().
+		 */
+		void HandleFragment(
+				LocalUserSession& session, const ReceivedPacket& packet, const uint8_t* bytes, uint32_t byteCount,
+				bool isSnapshot);
+
+		/**
+		  Queues a copy of the given message to be sent as fragments by SendQueuedFragments().
+		  @param localUserId The local user sending the message.
+		  @param remoteUserId The product user to send the message to.
+		  @param socketId The socket to send the message on.
+		  @param channel The channel to send the message on.
+		  @param isSnapshot Set true if the message is a snapshot packet, starting with its header.
+		  @param data Pointer to the bytes to send. Can be null if "byteCount" is zero.
+		  @param byteCount Number of bytes to send. Cannot exceed kMaxMessageByteCount.
+		  @return Returns true if the message was queued.
+		          Returns false if too many bytes of other messages are still waiting to be sent.
+		 */
+		bool QueueOutboundTransfer(
+				EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const EOS_P2P_SocketId& socketId,
+				uint8_t channel, bool isSnapshot, const void* data, uint32_t byteCount);
+
+		/**
+		  Sends the fragments of the messages queued via SendLargeMessage(), oldest message first,
+		  until this frame's byte budget is spent. Aborts a message whose fragments keep failing to send.
+		 */
+		void SendQueuedFragments();
+
+		/** Queues a "p2pMessageProgress" event for every message that received fragments since the last call. */
+		void QueueTransferProgressEvents();
+
+		/** Discards the messages being received via fragments whose last fragment arrived too long ago. */
+		void RemoveStalledTransfers();
+
+		/**
+		  Discards all state tied to the peers of the current transport, such as queued outbound messages,
+		  partially received messages, snapshot acknowledgements, link statistics, and tracked interests.
+		  Registered snapshot schemas and settings are kept. Called when the transport is replaced.
+		 */
+		void ClearTransportState();
+
+		/**
+		  Forgets the link statistics of logged out local users, sends the pings that are due,
+		  and queues a "p2pStats" event if its interval elapsed.
+		 */
+		void UpdateLinkStats();
+
+		/**
+		  Removes the oldest message unpacked by ReceivePacket() for the given local user and channel.
+		  @param localUserId The local user to fetch a message for.
+		  @param channelPointer Pointer to the only channel to fetch a message from. Null accepts any channel.
+		  @param buffer The buffer to copy the message's bytes to.
+		  @param packet Receives the message's sender, socket, and channel.
+		  @return Returns true if a message was found. Returns false if not.
+		 */
+		bool PopPendingMessage(
+				EOS_ProductUserId localUserId, const uint8_t* channelPointer, ByteBuffer& buffer, ReceivedPacket& packet);
+
+		/**
+		  Pushes the buffer referenced by the given Lua registry reference, creating it the first time.
+		  @param luaStatePointer The Lua state to push the buffer to.
+		  @param luaReference The buffer's Lua registry reference. Assigned if the buffer gets created.
+		  @return Returns a pointer to the buffer. Returns null if given a null Lua state.
+		 */
+		ByteBuffer* PushBufferTo(lua_State* luaStatePointer, int& luaReference);
+
+		/**
+		  Queues a "p2pPackets" event for each channel that the given packets were received on.
+		  @param session The local user that received the packets.
+		  @param packets The packets received for the user this frame, in the order they were received.
+		 */
+		void QueuePacketsEvents(LocalUserSession& session, std::vector<ReceivedPacket>& packets);
+
+		/** The runtime context that owns this manager. */
+		RuntimeContext& fContext;
+
+		/** Tracks connections with remote peers and accepts incoming connection requests natively. */
+		P2PConnectionManager fConnectionManager;
+
+		/** Sizes the EOS packet queues and makes room natively when the incoming queue is full. */
+		P2PQueueManager fQueueManager;
+
+		/** Applies relay and port settings and queries the NAT type once a local user logs in. */
+		P2PNetworkSettings fNetworkSettings;
+
+		/** Sends and receives this manager's packets. Never null. */
+		std::unique_ptr<P2PTransport> fTransportPointer;
+
+		/** Lua registry reference to the buffer returned by PushReceiveBufferTo(). */
+		int fReceiveBufferLuaReference;
+
+		/** Lua registry reference to the buffer that Update() drains all of a frame's packets into. */
+		int fDrainBufferLuaReference;
+
+		/** Set true if Update() is to receive packets. */
+		bool fIsAutoReceiveEnabled;
+
+		/** Max number of packets that Update() receives per frame. */
+		uint32_t fMaxReceivePacketCount;
+
+		/** Max number of bytes that Update() receives per frame. */
+		uint32_t fMaxReceiveByteCount;
+
+		/** Packets received by Update() for the local user being drained. Re-used between frames. */
+		std::vector<ReceivedPacket> fDrainedPackets;
+
+		/** Scratch memory used to prepend the plugin's header to outgoing packets. */
+		std::vector<uint8_t> fSendBytes;
+
+		/** Serializes Lua tables to bytes and back. */
+		LuaValueCodec fCodec;
+
+		/** Encodes and decodes snapshots sent via SendSnapshot(). */
+		SnapshotReplicator fSnapshotReplicator;
+
+		/** Counts the packets exchanged with each peer and measures round trip time and loss. */
+		P2PLinkStats fLinkStats;
+
+		/** Determines which peers the packets sent via BroadcastPacket() are relevant to. */
+		P2PInterestManager fInterestManager;
+
+		/** Peers collected by BroadcastPacket(). Re-used between calls. */
+		std::vector<EOS_ProductUserId> fBroadcastPeers;
+
+		/** Interval at which a "p2pStats" event is dispatched. Zero if disabled. */
+		std::chrono::milliseconds fStatsEventInterval;
+
+		/** When the last "p2pStats" event was queued. */
+		std::chrono::steady_clock::time_point fLastStatsEventTime;
+
+		/** Pings due to be sent by UpdateLinkStats(). Re-used between frames. */
+		std::vector<P2PLinkStats::PingRequest> fDuePings;
+
+		/** ID assigned to the last message sent via SendLargeMessage(). */
+		uint32_t fLastTransferId;
+
+		/** Messages queued via SendLargeMessage(), in the order their fragments are to be sent. */
+		std::deque<OutboundTransfer> fOutboundTransfers;
+
+		/** Messages being received via fragments. */
+		std::map<InboundTransferKey, InboundTransfer> fInboundTransfers;
+
+		/** Messages queued via QueueMessage(), waiting to be packed into packets. */
+		std::map<OutboundQueueKey, OutboundQueue> fOutboundQueues;
+
+		/** Messages unpacked from batched packets by ReceivePacket(), in the order they were received. */
+		std::deque<PendingMessage> fPendingMessages;
+
+		/** Messages found in batched packets received by ReceivePacket(). Re-used between calls. */
+		std::vector<ReceivedPacket> fUnpackedMessages;
+};
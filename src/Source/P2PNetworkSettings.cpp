@@ -0,0 +1,222 @@
+// ----------------------------------------------------------------------------
+//
+// P2PNetworkSettings.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "P2PNetworkSettings.h"
+#include "LocalUserSession.h"
+#include "RuntimeContext.h"
+#include <cstring>
+#include "eos_p2p.h"
+
+
+//---------------------------------------------------------------------------------
+// Private Static Variables
+//---------------------------------------------------------------------------------
+
+/** Collection of all settings managers that currently exist, used to ignore EOS callbacks for deleted managers. */
+static std::unordered_set<P2PNetworkSettings*> sNetworkSettingsCollection;
+
+
+//---------------------------------------------------------------------------------
+// P2PNetworkSettings Class Members
+//---------------------------------------------------------------------------------
+
+const std::chrono::seconds P2PNetworkSettings::kNATTypeRetryInterval(30);
+
+P2PNetworkSettings::P2PNetworkSettings(RuntimeContext& context)
+:	fContext(context),
+	fRelayControl(EOS_ERelayControl::EOS_RC_AllowRelays),
+	fHasRelayControlChanged(false),
+	fPort(0),
+	fMaxAdditionalPortsToTry(-1),
+	fHasPortRangeChanged(false),
+	fNATType(EOS_ENATType::EOS_NAT_Unknown),
+	fWasNATTypeQueried(false),
+	fIsQueryingNATType(false),
+	fLastNATTypeQueryFailureTime(std::chrono::steady_clock::now() - kNATTypeRetryInterval)
+{
+	sNetworkSettingsCollection.insert(this);
+}
+
+P2PNetworkSettings::~P2PNetworkSettings()
+{
+	// Remove this manager from the global collection, causing EOS callbacks to be ignored.
+	sNetworkSettingsCollection.erase(this);
+}
+
+void P2PNetworkSettings::SetRelayControl(EOS_ERelayControl value)
+{
+	fRelayControl = value;
+	fHasRelayControlChanged = true;
+}
+
+void P2PNetworkSettings::SetPortRange(uint16_t port, int maxAdditionalPortsToTry)
+{
+	fPort = port;
+	fMaxAdditionalPortsToTry = (port > 0) ? maxAdditionalPortsToTry : 0;
+	fHasPortRangeChanged = true;
+}
+
+EOS_ENATType P2PNetworkSettings::GetNATType() const
+{
+	return fNATType;
+}
+
+bool P2PNetworkSettings::IsQueryingNATType() const
+{
+	return fIsQueryingNATType;
+}
+
+void P2PNetworkSettings::Update()
+{
+	// Validate.
+	auto p2pHandle = GetP2PHandle();
+	if (!p2pHandle)
+	{
+		return;
+	}
+
+	// Apply the settings changed since the last frame.
+	if (fHasRelayControlChanged)
+	{
+		EOS_P2P_SetRelayControlOptions options = {};
+		options.ApiVersion = EOS_P2P_SETRELAYCONTROL_API_LATEST;
+		options.RelayControl = fRelayControl;
+		EOS_P2P_SetRelayControl(p2pHandle, &options);
+		fHasRelayControlChanged = false;
+	}
+	if (fHasPortRangeChanged)
+	{
+		EOS_P2P_SetPortRangeOptions options = {};
+		options.ApiVersion = EOS_P2P_SETPORTRANGE_API_LATEST;
+		options.Port = fPort;
+		options.MaxAdditionalPortsToTry = (uint16_t)fMaxAdditionalPortsToTry;
+		if (fMaxAdditionalPortsToTry < 0)
+		{
+			EOS_P2P_GetPortRangeOptions currentOptions = {};
+			currentOptions.ApiVersion = EOS_P2P_GETPORTRANGE_API_LATEST;
+			uint16_t currentPort = 0;
+			options.MaxAdditionalPortsToTry = 0;
+			EOS_P2P_GetPortRange(p2pHandle, &currentOptions, &currentPort, &options.MaxAdditionalPortsToTry);
+		}
+		EOS_P2P_SetPortRange(p2pHandle, &options);
+		fHasPortRangeChanged = false;
+	}
+
+	// Do not continue if the NAT type is already known or being queried, or if the last query failed too recently.
+	auto now = std::chrono::steady_clock::now();
+	bool canQuery =
+			!fWasNATTypeQueried && !fIsQueryingNATType &&
+			((now - fLastNATTypeQueryFailureTime) >= kNATTypeRetryInterval);
+	if (!canQuery)
+	{
+		return;
+	}
+
+	// Query the NAT type once any local user is logged into Connect, which EOS requires.
+	for (auto sessionPointer : fContext.GetLocalUsers())
+	{
+		if (sessionPointer->GetProductUserId() && !sessionPointer->IsSimulated())
+		{
+			EOS_P2P_QueryNATTypeOptions options = {};
+			options.ApiVersion = EOS_P2P_QUERYNATTYPE_API_LATEST;
+			fIsQueryingNATType = true;
+			EOS_P2P_QueryNATType(p2pHandle, &options, this, OnQueryNATTypeCallback);
+			break;
+		}
+	}
+}
+
+const char* P2PNetworkSettings::GetNameOf(EOS_ENATType value)
+{
+	switch (value)
+	{
+		case EOS_ENATType::EOS_NAT_Open:
+			return "open";
+		case EOS_ENATType::EOS_NAT_Moderate:
+			return "moderate";
+		case EOS_ENATType::EOS_NAT_Strict:
+			return "strict";
+		default:
+			break;
+	}
+	return "unknown";
+}
+
+bool P2PNetworkSettings::GetRelayControlBy(const char* name, EOS_ERelayControl& value)
+{
+	// Validate.
+	if (!name)
+	{
+		return false;
+	}
+
+	// Fetch the setting by name.
+	if (!strcmp(name, "noRelays"))
+	{
+		value = EOS_ERelayControl::EOS_RC_NoRelays;
+	}
+	else if (!strcmp(name, "allowRelays"))
+	{
+		value = EOS_ERelayControl::EOS_RC_AllowRelays;
+	}
+	else if (!strcmp(name, "forceRelays"))
+	{
+		value = EOS_ERelayControl::EOS_RC_ForceRelays;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+EOS_HP2P P2PNetworkSettings::GetP2PHandle() const
+{
+	if (!fContext.fPlatformHandle)
+	{
+		return nullptr;
+	}
+	return EOS_Platform_GetP2PInterface(fContext.fPlatformHandle);
+}
+
+P2PNetworkSettings* P2PNetworkSettings::GetInstanceBy(void* clientData)
+{
+	auto settingsPointer = (P2PNetworkSettings*)clientData;
+	if (sNetworkSettingsCollection.find(settingsPointer) == sNetworkSettingsCollection.end())
+	{
+		return nullptr;
+	}
+	return settingsPointer;
+}
+
+void P2PNetworkSettings::OnQueryNATTypeCallback(const EOS_P2P_OnQueryNATTypeCompleteInfo* data)
+{
+	// Fetch the manager that started the query.
+	if (!data)
+	{
+		return;
+	}
+	auto settingsPointer = GetInstanceBy(data->ClientData);
+	if (!settingsPointer)
+	{
+		return;
+	}
+
+	// Cache the NAT type, or retry later if the query failed.
+	settingsPointer->fIsQueryingNATType = false;
+	if (data->ResultCode == EOS_EResult::EOS_Success)
+	{
+		settingsPointer->fNATType = data->NATType;
+		settingsPointer->fWasNATTypeQueried = true;
+	}
+	else
+	{
+		settingsPointer->fLastNATTypeQueryFailureTime = std::chrono::steady_clock::now();
+	}
+}
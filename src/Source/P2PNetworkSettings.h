@@ -0,0 +1,135 @@
+// ----------------------------------------------------------------------------
+//
+// P2PNetworkSettings.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <unordered_set>
+#include "eos_p2p_types.h"
+
+
+// Forward declarations.
+class RuntimeContext;
+
+
+/**
+  Applies the EOS P2P network settings loaded from "config.lua", such as relay control and port range,
+  and determines the local network's NAT type.
+
+  The NAT type is queried natively as soon as the first local user logs into the Connect interface and is cached,
+  so that Lua can read it synchronously via GetNATType(), such as when building lobby attributes for matchmaking,
+  without waiting for an extra asynchronous query on the critical path.
+ */
+class P2PNetworkSettings
+{
+	public:
+		/** Interval at which a failed NAT type query is retried. */
+		static const std::chrono::seconds kNATTypeRetryInterval;
+
+
+		/**
+		  Creates a new settings manager.
+		  @param context The runtime context whose EOS platform the settings are applied to.
+		 */
+		P2PNetworkSettings(RuntimeContext& context);
+
+		/** Destroys this manager, causing the result of a pending NAT type query to be ignored. */
+		virtual ~P2PNetworkSettings();
+
+		/**
+		  Sets which relay servers P2P connections may use, applied by the next call to Update().
+		  Only affects connections established afterwards.
+		  @param value The relay control setting.
+		 */
+		void SetRelayControl(EOS_ERelayControl value);
+
+		/**
+		  Sets the range of ports used for P2P traffic, applied by the next call to Update().
+		  @param port The ideal port. Zero lets the OS choose a port.
+		  @param maxAdditionalPortsToTry Number of ports after "port" to try if it is unavailable. Forced to zero if
+		                                 "port" is zero. Negative keeps EOS' current setting.
+		 */
+		void SetPortRange(uint16_t port, int maxAdditionalPortsToTry);
+
+		/**
+		  Gets the local network's NAT type, as cached by the last successful query.
+		  @return Returns the NAT type. Returns EOS_NAT_Unknown if no query has succeeded yet.
+		 */
+		EOS_ENATType GetNATType() const;
+
+		/** Determines if a NAT type query is in progress. */
+		bool IsQueryingNATType() const;
+
+		/**
+		  To be called once per frame. Applies the settings given since the last call once the EOS platform exists,
+		  and starts querying the NAT type once a local user is logged into Connect, if not done already.
+		 */
+		void Update();
+
+		/** Gets the name of the given NAT type as used by Lua, such as "moderate". */
+		static const char* GetNameOf(EOS_ENATType value);
+
+		/**
+		  Fetches a relay control setting by the name used in "config.lua", such as "forceRelays".
+		  @param name The setting's name. Can be null.
+		  @param value Assigned the setting if found.
+		  @return Returns true if the setting was found. Returns false if given an unknown name.
+		 */
+		static bool GetRelayControlBy(const char* name, EOS_ERelayControl& value);
+
+	private:
+		/** Copy constructor deleted to prevent it from being called. */
+		P2PNetworkSettings(const P2PNetworkSettings&) = delete;
+
+		/** Method deleted to prevent the copy operator from being used. */
+		void operator=(const P2PNetworkSettings&) = delete;
+
+		/** Fetches the EOS P2P interface. Returns null if the EOS platform has not been created. */
+		EOS_HP2P GetP2PHandle() const;
+
+		/**
+		  Fetches a settings manager by the "ClientData" given to an EOS callback.
+		  @return Returns the manager. Returns null if it was destroyed.
+		 */
+		static P2PNetworkSettings* GetInstanceBy(void* clientData);
+
+		/** Called by EOS when a NAT type query has completed. */
+		static void EOS_CALL OnQueryNATTypeCallback(const EOS_P2P_OnQueryNATTypeCompleteInfo* data);
+
+		/** The runtime context that owns this manager. */
+		RuntimeContext& fContext;
+
+		/** The relay control setting to apply. */
+		EOS_ERelayControl fRelayControl;
+
+		/** Set true if "fRelayControl" was changed since it was last applied to EOS. */
+		bool fHasRelayControlChanged;
+
+		/** The ideal port to apply. */
+		uint16_t fPort;
+
+		/** Number of additional ports to try to apply. Negative keeps EOS' current setting. */
+		int fMaxAdditionalPortsToTry;
+
+		/** Set true if the port range was changed since it was last applied to EOS. */
+		bool fHasPortRangeChanged;
+
+		/** The NAT type returned by the last successful query. */
+		EOS_ENATType fNATType;
+
+		/** Set true if the NAT type was queried successfully. */
+		bool fWasNATTypeQueried;
+
+		/** Set true while a NAT type query is in progress. */
+		bool fIsQueryingNATType;
+
+		/** When the last NAT type query failed. Used to delay retrying. */
+		std::chrono::steady_clock::time_point fLastNATTypeQueryFailureTime;
+};
@@ -0,0 +1,345 @@
+// ----------------------------------------------------------------------------
+//
+// P2PQueueManager.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "P2PQueueManager.h"
+#include "RuntimeContext.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+extern "C"
+{
+#	include "lua.h"
+}
+#include "eos_p2p.h"
+
+
+//---------------------------------------------------------------------------------
+// Private Static Variables
+//---------------------------------------------------------------------------------
+
+/** Collection of all queue managers that currently exist, used to ignore EOS callbacks for deleted managers. */
+static std::unordered_set<P2PQueueManager*> sQueueManagerCollection;
+
+
+//---------------------------------------------------------------------------------
+// P2PQueueManager Class Members
+//---------------------------------------------------------------------------------
+
+const uint64_t P2PQueueManager::kMaxGrownQueueByteCount = 64 * 1024 * 1024;
+
+P2PQueueManager::P2PQueueManager(RuntimeContext& context)
+:	fContext(context),
+	fIncomingQueueByteCount(-1),
+	fOutgoingQueueByteCount(-1),
+	fHaveQueueSizesChanged(false),
+	fOverflowPolicy(OverflowPolicy::kNone),
+	fOverflowStats(),
+	fQueueFullNotificationId(EOS_INVALID_NOTIFICATIONID)
+{
+	sQueueManagerCollection.insert(this);
+}
+
+P2PQueueManager::~P2PQueueManager()
+{
+	// Remove this manager from the global collection, causing EOS callbacks to be ignored.
+	sQueueManagerCollection.erase(this);
+
+	// Stop listening to the queue full notification.
+	auto p2pHandle = GetP2PHandle();
+	if (p2pHandle && (fQueueFullNotificationId != EOS_INVALID_NOTIFICATIONID))
+	{
+		EOS_P2P_RemoveNotifyIncomingPacketQueueFull(p2pHandle, fQueueFullNotificationId);
+	}
+	fQueueFullNotificationId = EOS_INVALID_NOTIFICATIONID;
+}
+
+void P2PQueueManager::SetQueueSizes(int64_t incomingByteCount, int64_t outgoingByteCount)
+{
+	fIncomingQueueByteCount = (incomingByteCount >= 0) ? incomingByteCount : -1;
+	fOutgoingQueueByteCount = (outgoingByteCount >= 0) ? outgoingByteCount : -1;
+	fHaveQueueSizesChanged = (fIncomingQueueByteCount >= 0) || (fOutgoingQueueByteCount >= 0);
+}
+
+P2PQueueManager::OverflowPolicy P2PQueueManager::GetOverflowPolicy() const
+{
+	return fOverflowPolicy;
+}
+
+void P2PQueueManager::SetOverflowPolicy(OverflowPolicy value)
+{
+	fOverflowPolicy = value;
+}
+
+void P2PQueueManager::SetUnreliableChannels(const std::vector<uint8_t>& channels)
+{
+	fUnreliableChannels.clear();
+	fUnreliableChannels.insert(channels.begin(), channels.end());
+}
+
+void P2PQueueManager::SetChannelPriorities(const std::map<uint8_t, int>& priorities)
+{
+	fChannelPriorities = priorities;
+}
+
+const P2PQueueManager::OverflowStats& P2PQueueManager::GetOverflowStats() const
+{
+	return fOverflowStats;
+}
+
+void P2PQueueManager::Update()
+{
+	// Validate.
+	auto p2pHandle = GetP2PHandle();
+	if (!p2pHandle)
+	{
+		return;
+	}
+
+	// Apply the configured queue sizes. EOS requires both sizes, so the current size is kept for those not given.
+	if (fHaveQueueSizesChanged)
+	{
+		EOS_P2P_PacketQueueInfo queueInfo = {};
+		EOS_P2P_GetPacketQueueInfoOptions queueInfoOptions = {};
+		queueInfoOptions.ApiVersion = EOS_P2P_GETPACKETQUEUEINFO_API_LATEST;
+		if (EOS_P2P_GetPacketQueueInfo(p2pHandle, &queueInfoOptions, &queueInfo) == EOS_EResult::EOS_Success)
+		{
+			EOS_P2P_SetPacketQueueSizeOptions options = {};
+			options.ApiVersion = EOS_P2P_SETPACKETQUEUESIZE_API_LATEST;
+			options.IncomingPacketQueueMaxSizeBytes = (fIncomingQueueByteCount >= 0) ?
+					(uint64_t)fIncomingQueueByteCount : queueInfo.IncomingPacketQueueMaxSizeBytes;
+			options.OutgoingPacketQueueMaxSizeBytes = (fOutgoingQueueByteCount >= 0) ?
+					(uint64_t)fOutgoingQueueByteCount : queueInfo.OutgoingPacketQueueMaxSizeBytes;
+			EOS_P2P_SetPacketQueueSize(p2pHandle, &options);
+		}
+		fHaveQueueSizesChanged = false;
+	}
+
+	// Start listening to the incoming queue overflowing.
+	if (fQueueFullNotificationId == EOS_INVALID_NOTIFICATIONID)
+	{
+		EOS_P2P_AddNotifyIncomingPacketQueueFullOptions options = {};
+		options.ApiVersion = EOS_P2P_ADDNOTIFYINCOMINGPACKETQUEUEFULL_API_LATEST;
+		fQueueFullNotificationId = EOS_P2P_AddNotifyIncomingPacketQueueFull(
+				p2pHandle, &options, this, OnIncomingQueueFullCallback);
+	}
+}
+
+bool P2PQueueManager::GetOverflowPolicyBy(const char* name, OverflowPolicy& value)
+{
+	// Validate.
+	if (!name)
+	{
+		return false;
+	}
+
+	// Fetch the policy by name.
+	if (!strcmp(name, "none"))
+	{
+		value = OverflowPolicy::kNone;
+	}
+	else if (!strcmp(name, "grow"))
+	{
+		value = OverflowPolicy::kGrow;
+	}
+	else if (!strcmp(name, "dropUnreliable"))
+	{
+		value = OverflowPolicy::kDropUnreliable;
+	}
+	else if (!strcmp(name, "dropByPriority"))
+	{
+		value = OverflowPolicy::kDropByPriority;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+void P2PQueueManager::SetLuaFieldsFrom(lua_State* luaStatePointer, const OverflowStats& stats)
+{
+	// Validate.
+	if (!luaStatePointer || !lua_istable(luaStatePointer, -1))
+	{
+		return;
+	}
+
+	// Copy the counters to the table.
+	lua_pushnumber(luaStatePointer, (lua_Number)stats.OverflowCount);
+	lua_setfield(luaStatePointer, -2, "incomingQueueOverflowCount");
+	lua_pushnumber(luaStatePointer, (lua_Number)stats.UnresolvedOverflowCount);
+	lua_setfield(luaStatePointer, -2, "incomingQueueUnresolvedOverflowCount");
+	lua_pushnumber(luaStatePointer, (lua_Number)stats.DroppedPacketCount);
+	lua_setfield(luaStatePointer, -2, "incomingQueueDroppedPacketCount");
+	lua_pushnumber(luaStatePointer, (lua_Number)stats.DroppedByteCount);
+	lua_setfield(luaStatePointer, -2, "incomingQueueDroppedByteCount");
+	lua_pushnumber(luaStatePointer, (lua_Number)stats.GrowCount);
+	lua_setfield(luaStatePointer, -2, "incomingQueueGrowCount");
+}
+
+EOS_HP2P P2PQueueManager::GetP2PHandle() const
+{
+	if (!fContext.fPlatformHandle)
+	{
+		return nullptr;
+	}
+	return EOS_Platform_GetP2PInterface(fContext.fPlatformHandle);
+}
+
+bool P2PQueueManager::GrowIncomingQueue()
+{
+	// Fetch the queues' current max sizes.
+	auto p2pHandle = GetP2PHandle();
+	if (!p2pHandle)
+	{
+		return false;
+	}
+	EOS_P2P_PacketQueueInfo queueInfo = {};
+	EOS_P2P_GetPacketQueueInfoOptions queueInfoOptions = {};
+	queueInfoOptions.ApiVersion = EOS_P2P_GETPACKETQUEUEINFO_API_LATEST;
+	if (EOS_P2P_GetPacketQueueInfo(p2pHandle, &queueInfoOptions, &queueInfo) != EOS_EResult::EOS_Success)
+	{
+		return false;
+	}
+
+	// Double the incoming queue's max size, unless it already reached the limit.
+	auto maxByteCount = queueInfo.IncomingPacketQueueMaxSizeBytes;
+	if ((maxByteCount == EOS_P2P_MAX_QUEUE_SIZE_UNLIMITED) || (maxByteCount >= kMaxGrownQueueByteCount))
+	{
+		return false;
+	}
+	EOS_P2P_SetPacketQueueSizeOptions options = {};
+	options.ApiVersion = EOS_P2P_SETPACKETQUEUESIZE_API_LATEST;
+	options.IncomingPacketQueueMaxSizeBytes = std::min(maxByteCount * 2, kMaxGrownQueueByteCount);
+	options.OutgoingPacketQueueMaxSizeBytes = queueInfo.OutgoingPacketQueueMaxSizeBytes;
+	if (EOS_P2P_SetPacketQueueSize(p2pHandle, &options) != EOS_EResult::EOS_Success)
+	{
+		return false;
+	}
+	fIncomingQueueByteCount = (int64_t)options.IncomingPacketQueueMaxSizeBytes;
+	return true;
+}
+
+void P2PQueueManager::DropPackets(EOS_ProductUserId localUserId, uint8_t channel, uint64_t& byteCount)
+{
+	// Validate.
+	auto p2pHandle = GetP2PHandle();
+	if (!p2pHandle || !localUserId)
+	{
+		return;
+	}
+
+	// Receive the channel's oldest packets into scratch memory until enough bytes were dropped.
+	fDropBytes.resize(EOS_P2P_MAX_PACKET_SIZE);
+	EOS_P2P_ReceivePacketOptions options = {};
+	options.ApiVersion = EOS_P2P_RECEIVEPACKET_API_LATEST;
+	options.LocalUserId = localUserId;
+	options.MaxDataSizeBytes = (uint32_t)fDropBytes.size();
+	options.RequestedChannel = &channel;
+	while (byteCount > 0)
+	{
+		EOS_ProductUserId peerId = nullptr;
+		EOS_P2P_SocketId socketId;
+		uint8_t receivedChannel = 0;
+		uint32_t receivedByteCount = 0;
+		auto result = EOS_P2P_ReceivePacket(
+				p2pHandle, &options, &peerId, &socketId, &receivedChannel, fDropBytes.data(), &receivedByteCount);
+		if (result != EOS_EResult::EOS_Success)
+		{
+			break;
+		}
+		fOverflowStats.DroppedPacketCount++;
+		fOverflowStats.DroppedByteCount += receivedByteCount;
+		byteCount -= std::min((uint64_t)receivedByteCount, byteCount);
+	}
+}
+
+P2PQueueManager* P2PQueueManager::GetInstanceBy(void* clientData)
+{
+	auto managerPointer = (P2PQueueManager*)clientData;
+	if (sQueueManagerCollection.find(managerPointer) == sQueueManagerCollection.end())
+	{
+		return nullptr;
+	}
+	return managerPointer;
+}
+
+void P2PQueueManager::OnIncomingQueueFullCallback(const EOS_P2P_OnIncomingPacketQueueFullInfo* data)
+{
+	// Fetch the manager that is listening.
+	if (!data)
+	{
+		return;
+	}
+	auto managerPointer = GetInstanceBy(data->ClientData);
+	if (!managerPointer)
+	{
+		return;
+	}
+	auto& stats = managerPointer->fOverflowStats;
+	stats.OverflowCount++;
+
+	// Determine how many bytes must be freed for the incoming packet to fit.
+	uint64_t byteCount = data->OverflowPacketSizeBytes;
+	if ((data->PacketQueueCurrentSizeBytes + byteCount) > data->PacketQueueMaxSizeBytes)
+	{
+		byteCount = data->PacketQueueCurrentSizeBytes + byteCount - data->PacketQueueMaxSizeBytes;
+	}
+
+	// Make room according to the overflow policy.
+	bool wasResolved = false;
+	switch (managerPointer->fOverflowPolicy)
+	{
+		case OverflowPolicy::kGrow:
+			wasResolved = managerPointer->GrowIncomingQueue();
+			if (wasResolved)
+			{
+				stats.GrowCount++;
+			}
+			break;
+		case OverflowPolicy::kDropUnreliable:
+			for (auto channel : managerPointer->fUnreliableChannels)
+			{
+				managerPointer->DropPackets(data->OverflowPacketLocalUserId, channel, byteCount);
+			}
+			wasResolved = (byteCount == 0);
+			break;
+		case OverflowPolicy::kDropByPriority:
+		{
+			// Drop packets from the lowest priority channels first, never from channels as important as the packet's.
+			int incomingPriority = 0;
+			auto iterator = managerPointer->fChannelPriorities.find(data->OverflowPacketChannel);
+			if (iterator != managerPointer->fChannelPriorities.end())
+			{
+				incomingPriority = iterator->second;
+			}
+			std::vector<std::pair<int, uint8_t>> channels;
+			for (auto&& pair : managerPointer->fChannelPriorities)
+			{
+				if (pair.second < incomingPriority)
+				{
+					channels.push_back(std::make_pair(pair.second, pair.first));
+				}
+			}
+			std::sort(channels.begin(), channels.end());
+			for (auto&& pair : channels)
+			{
+				managerPointer->DropPackets(data->OverflowPacketLocalUserId, pair.second, byteCount);
+			}
+			wasResolved = (byteCount == 0);
+			break;
+		}
+		default:
+			break;
+	}
+	if (!wasResolved)
+	{
+		stats.UnresolvedOverflowCount++;
+	}
+}
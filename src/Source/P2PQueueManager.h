@@ -0,0 +1,204 @@
+// ----------------------------------------------------------------------------
+//
+// P2PQueueManager.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <unordered_set>
+#include <vector>
+#include "eos_p2p_types.h"
+
+
+// Forward declarations.
+class RuntimeContext;
+extern "C"
+{
+	struct lua_State;
+}
+
+
+/**
+  Configures the size of the EOS incoming and outgoing packet queues and handles the incoming queue overflowing.
+
+  EOS discards every packet arriving while its incoming queue is full, reliable or not, which would stall reliable
+  traffic whenever Lua stops receiving for a while. When EOS reports that the queue is full, this class makes room
+  natively according to its overflow policy, by either growing the queue or dropping the oldest queued packets of
+  channels that are safe to drop, so that the packet about to arrive is kept. Every overflow is counted.
+
+  Sizes and policy are typically loaded from "config.lua" and are applied to EOS by Update() once the platform exists.
+ */
+class P2PQueueManager
+{
+	public:
+		/** Determines how room is made when the incoming packet queue is full. */
+		enum class OverflowPolicy
+		{
+			/** Nothing is done. EOS discards incoming packets until Lua receives enough of them. */
+			kNone,
+
+			/** The queue's max size is doubled, up to kMaxGrownQueueByteCount. */
+			kGrow,
+
+			/** The oldest packets queued on the channels given to SetUnreliableChannels() are dropped. */
+			kDropUnreliable,
+
+			/**
+			  The oldest packets queued on channels with a lower priority than the incoming packet's channel
+			  are dropped, lowest priority first. Priorities are given to SetChannelPriorities().
+			 */
+			kDropByPriority
+		};
+
+		/** Counts how often the incoming packet queue overflowed and how it was handled. */
+		struct OverflowStats
+		{
+			/** Number of times EOS reported the incoming queue being full. */
+			uint64_t OverflowCount;
+
+			/** Number of overflows that no room could be made for, causing EOS to discard incoming packets. */
+			uint64_t UnresolvedOverflowCount;
+
+			/** Number of queued packets dropped to make room. */
+			uint64_t DroppedPacketCount;
+
+			/** Number of bytes of queued packets dropped to make room. */
+			uint64_t DroppedByteCount;
+
+			/** Number of times the incoming queue was grown to make room. */
+			uint64_t GrowCount;
+		};
+
+
+		/** Max size that the kGrow policy grows the incoming packet queue to. */
+		static const uint64_t kMaxGrownQueueByteCount;
+
+
+		/**
+		  Creates a new queue manager.
+		  @param context The runtime context whose EOS platform's packet queues are to be managed.
+		 */
+		P2PQueueManager(RuntimeContext& context);
+
+		/** Stops listening to the EOS queue full notification and destroys this manager. */
+		virtual ~P2PQueueManager();
+
+		/**
+		  Sets the max sizes of the EOS packet queues, applied by the next call to Update().
+		  @param incomingByteCount Max size of the incoming queue. Zero for unlimited. Negative keeps EOS' default.
+		  @param outgoingByteCount Max size of the outgoing queue. Zero for unlimited. Negative keeps EOS' default.
+		 */
+		void SetQueueSizes(int64_t incomingByteCount, int64_t outgoingByteCount);
+
+		/** Gets how room is made when the incoming packet queue is full. */
+		OverflowPolicy GetOverflowPolicy() const;
+
+		/** Sets how room is made when the incoming packet queue is full. */
+		void SetOverflowPolicy(OverflowPolicy value);
+
+		/**
+		  Sets the channels that only carry unreliable packets, dropped by the kDropUnreliable policy.
+		  Note that EOS does not tell which of the queued packets are reliable, which is why channels must be given.
+		  @param channels The channels, replacing the previously set channels.
+		 */
+		void SetUnreliableChannels(const std::vector<uint8_t>& channels);
+
+		/**
+		  Sets the priority of each channel, used by the kDropByPriority policy.
+		  @param priorities Priority of each channel, replacing the previous priorities.
+		                    Packets on unlisted channels are never dropped.
+		 */
+		void SetChannelPriorities(const std::map<uint8_t, int>& priorities);
+
+		/** Gets how often the incoming packet queue overflowed and how it was handled. */
+		const OverflowStats& GetOverflowStats() const;
+
+		/**
+		  To be called once per frame. Applies the queue sizes given to SetQueueSizes()
+		  and starts listening to the EOS queue full notification once the EOS platform exists.
+		 */
+		void Update();
+
+		/**
+		  Fetches an overflow policy by the name used in "config.lua", such as "dropByPriority".
+		  @param name The policy's name. Can be null.
+		  @param value Assigned the policy if found.
+		  @return Returns true if the policy was found. Returns false if given an unknown name.
+		 */
+		static bool GetOverflowPolicyBy(const char* name, OverflowPolicy& value);
+
+		/**
+		  Copies the given counters to fields such as "incomingQueueOverflowCount"
+		  in the table at the top of the Lua stack.
+		 */
+		static void SetLuaFieldsFrom(lua_State* luaStatePointer, const OverflowStats& stats);
+
+	private:
+		/** Copy constructor deleted to prevent it from being called. */
+		P2PQueueManager(const P2PQueueManager&) = delete;
+
+		/** Method deleted to prevent the copy operator from being used. */
+		void operator=(const P2PQueueManager&) = delete;
+
+		/** Fetches the EOS P2P interface. Returns null if the EOS platform has not been created. */
+		EOS_HP2P GetP2PHandle() const;
+
+		/**
+		  Doubles the max size of the incoming packet queue, keeping the outgoing queue's size.
+		  @return Returns true if the queue was grown. Returns false if it already reached kMaxGrownQueueByteCount.
+		 */
+		bool GrowIncomingQueue();
+
+		/**
+		  Receives and discards the oldest packets queued for the given local user on the given channel.
+		  @param localUserId The local user whose queue is to be trimmed.
+		  @param channel The channel to drop packets from.
+		  @param byteCount Number of bytes to drop. Dropped byte counts are subtracted from it.
+		 */
+		void DropPackets(EOS_ProductUserId localUserId, uint8_t channel, uint64_t& byteCount);
+
+		/**
+		  Fetches a queue manager by the "ClientData" given to an EOS callback.
+		  @return Returns the manager. Returns null if it was destroyed.
+		 */
+		static P2PQueueManager* GetInstanceBy(void* clientData);
+
+		/** Called by EOS when a packet arrives while the incoming packet queue is full. */
+		static void EOS_CALL OnIncomingQueueFullCallback(const EOS_P2P_OnIncomingPacketQueueFullInfo* data);
+
+		/** The runtime context that owns this manager. */
+		RuntimeContext& fContext;
+
+		/** Max size of the incoming queue to apply. Negative keeps EOS' default. */
+		int64_t fIncomingQueueByteCount;
+
+		/** Max size of the outgoing queue to apply. Negative keeps EOS' default. */
+		int64_t fOutgoingQueueByteCount;
+
+		/** Set true if the queue sizes changed since they were last applied to EOS. */
+		bool fHaveQueueSizesChanged;
+
+		/** Determines how room is made when the incoming packet queue is full. */
+		OverflowPolicy fOverflowPolicy;
+
+		/** Channels dropped by the kDropUnreliable policy. */
+		std::unordered_set<uint8_t> fUnreliableChannels;
+
+		/** Priority of each channel used by the kDropByPriority policy. */
+		std::map<uint8_t, int> fChannelPriorities;
+
+		/** Counts how often the incoming packet queue overflowed. */
+		OverflowStats fOverflowStats;
+
+		/** ID of the EOS queue full notification. EOS_INVALID_NOTIFICATIONID if not listening. */
+		EOS_NotificationId fQueueFullNotificationId;
+
+		/** Scratch memory that dropped packets are received into. */
+		std::vector<uint8_t> fDropBytes;
+};
@@ -0,0 +1,23 @@
+// ----------------------------------------------------------------------------
+//
+// P2PTransport.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "P2PTransport.h"
+
+
+//---------------------------------------------------------------------------------
+// P2PTransport Class Members
+//---------------------------------------------------------------------------------
+
+P2PTransport::P2PTransport()
+{
+}
+
+P2PTransport::~P2PTransport()
+{
+}
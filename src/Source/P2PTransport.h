@@ -0,0 +1,88 @@
+// ----------------------------------------------------------------------------
+//
+// P2PTransport.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include "eos_p2p_types.h"
+
+
+/**
+  Abstract class used by P2PManager to send and receive raw packets between local users and remote peers.
+
+  Decouples the plugin's P2P layer, such as message batching, snapshots, and large messages, from how packets are
+  actually delivered. EosP2PTransport delivers them via the EOS P2P interface, while LoopbackP2PTransport delivers
+  them in-process with simulated latency and loss so that netcode can be tested without a network.
+ */
+class P2PTransport
+{
+	public:
+		/** Destroys this transport. */
+		virtual ~P2PTransport();
+
+		/**
+		  Determines if this transport can currently send and receive packets.
+		  @return Returns true if ready. Returns false if not, such as before the EOS platform has been created.
+		 */
+		virtual bool IsAvailable() const = 0;
+
+		/**
+		  Determines if this transport simulates the network instead of using EOS,
+		  allowing simulated local users created without EOS to send and receive packets.
+		 */
+		virtual bool IsSimulated() const = 0;
+
+		/**
+		  Called by P2PManager once per frame, before it sends or receives that frame's packets.
+		  Allows a simulated transport to advance its simulated clock.
+		 */
+		virtual void Update() = 0;
+
+		/**
+		  Sends a packet to the given remote peer, opening a connection to it if needed.
+		  @param localUserId The local user sending the packet.
+		  @param remoteUserId The product user to send the packet to.
+		  @param socketId The socket to send the packet on.
+		  @param channel The channel to send the packet on.
+		  @param reliability How the packet is to be delivered.
+		  @param data Pointer to the bytes to send.
+		  @param byteCount Number of bytes to send. Cannot exceed EOS_P2P_MAX_PACKET_SIZE.
+		  @return Returns true if the packet was queued to be sent. Returns false if not.
+		 */
+		virtual bool Send(
+				EOS_ProductUserId localUserId, EOS_ProductUserId remoteUserId, const EOS_P2P_SocketId& socketId,
+				uint8_t channel, EOS_EPacketReliability reliability, const void* data, uint32_t byteCount) = 0;
+
+		/**
+		  Receives the next packet queued for the given local user.
+		  @param localUserId The local user to receive a packet for.
+		  @param channelPointer Pointer to the only channel to receive a packet from. Null receives from any channel.
+		  @param data The buffer to copy the packet's bytes to.
+		  @param maxByteCount Size of the given buffer. Larger packets are truncated.
+		  @param remoteUserId Assigned the product user that sent the packet.
+		  @param socketId Assigned the socket the packet was received on.
+		  @param channel Assigned the channel the packet was received on.
+		  @param byteCount Assigned the number of bytes copied to the buffer.
+		  @return Returns true if a packet was received. Returns false if no packets are queued.
+		 */
+		virtual bool Receive(
+				EOS_ProductUserId localUserId, const uint8_t* channelPointer, void* data, uint32_t maxByteCount,
+				EOS_ProductUserId& remoteUserId, EOS_P2P_SocketId& socketId, uint8_t& channel, uint32_t& byteCount) = 0;
+
+	protected:
+		/** Creates a new transport. */
+		P2PTransport();
+
+	private:
+		/** Copy constructor deleted to prevent it from being called. */
+		P2PTransport(const P2PTransport&) = delete;
+
+		/** Method deleted to prevent the copy operator from being used. */
+		void operator=(const P2PTransport&) = delete;
+};
@@ -0,0 +1,79 @@
+// ----------------------------------------------------------------------------
+//
+// P2PWireFormat.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "P2PWireFormat.h"
+#include <cstring>
+
+
+//---------------------------------------------------------------------------------
+// P2PWireFormat Class Members
+//---------------------------------------------------------------------------------
+
+bool P2PWireFormat::CopySocketIdFrom(const char* socketName, EOS_P2P_SocketId& socketId)
+{
+	if (!socketName || !socketName[0] || (strlen(socketName) >= sizeof(socketId.SocketName)))
+	{
+		return false;
+	}
+	memset(&socketId, 0, sizeof(socketId));
+	socketId.ApiVersion = EOS_P2P_SOCKETID_API_LATEST;
+	strcpy(socketId.SocketName, socketName);
+	return true;
+}
+
+uint32_t P2PWireFormat::GetVarUIntByteCountFor(uint64_t value)
+{
+	uint32_t byteCount = 1;
+	while (value >= 0x80)
+	{
+		value >>= 7;
+		byteCount++;
+	}
+	return byteCount;
+}
+
+void P2PWireFormat::WriteVarUIntTo(std::vector<uint8_t>& bytes, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		bytes.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back((uint8_t)value);
+}
+
+bool P2PWireFormat::ReadVarUIntFrom(const uint8_t* bytes, uint32_t byteCount, uint32_t& offset, uint64_t& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (offset >= byteCount)
+		{
+			return false;
+		}
+		auto nextByte = bytes[offset++];
+		value |= (uint64_t)(nextByte & 0x7F) << shift;
+		if (!(nextByte & 0x80))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool P2PWireFormat::ReadVarUInt32From(const uint8_t* bytes, uint32_t byteCount, uint32_t& offset, uint32_t& value)
+{
+	uint64_t wideValue = 0;
+	if (!ReadVarUIntFrom(bytes, byteCount, offset, wideValue) || (wideValue > UINT32_MAX))
+	{
+		return false;
+	}
+	value = (uint32_t)wideValue;
+	return true;
+}
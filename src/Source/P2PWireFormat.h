@@ -0,0 +1,66 @@
+// ----------------------------------------------------------------------------
+//
+// P2PWireFormat.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "eos_p2p_types.h"
+
+
+/**
+  Provides static helpers shared by the plugin's P2P classes to build socket IDs and to read and write the
+  variable length integers used by its packet formats, such as batches, fragments, snapshots, and encoded Lua values.
+
+  Variable length integers are written 7 bits per byte, low bits first, with the high bit set on every byte
+  except the last. Values up to 127 take a single byte.
+ */
+class P2PWireFormat
+{
+	public:
+		/**
+		  Copies the given name into an EOS socket ID.
+		  @param socketName The socket's name. Can be null.
+		  @param socketId The socket ID to initialize.
+		  @return Returns true if the name was copied. Returns false if it is null, empty, or too long.
+		 */
+		static bool CopySocketIdFrom(const char* socketName, EOS_P2P_SocketId& socketId);
+
+		/** Gets the number of bytes needed to write the given value as a variable length integer. */
+		static uint32_t GetVarUIntByteCountFor(uint64_t value);
+
+		/** Appends the given value to the given bytes as a variable length integer. */
+		static void WriteVarUIntTo(std::vector<uint8_t>& bytes, uint64_t value);
+
+		/**
+		  Reads a variable length integer written by WriteVarUIntTo().
+		  @param bytes Pointer to the bytes to read from.
+		  @param byteCount Number of bytes that can be read.
+		  @param offset Offset of the integer's first byte. Advanced past the integer.
+		  @param value Assigned the integer read.
+		  @return Returns true if an integer was read.
+		          Returns false if the bytes ended early or the integer does not fit in 64 bits.
+		 */
+		static bool ReadVarUIntFrom(const uint8_t* bytes, uint32_t byteCount, uint32_t& offset, uint64_t& value);
+
+		/**
+		  Reads a variable length integer written by WriteVarUIntTo() that must fit in 32 bits.
+		  @param bytes Pointer to the bytes to read from.
+		  @param byteCount Number of bytes that can be read.
+		  @param offset Offset of the integer's first byte. Advanced past the integer.
+		  @param value Assigned the integer read.
+		  @return Returns true if an integer was read.
+		          Returns false if the bytes ended early or the integer does not fit in 32 bits.
+		 */
+		static bool ReadVarUInt32From(const uint8_t* bytes, uint32_t byteCount, uint32_t& offset, uint32_t& value);
+
+	private:
+		/** Constructor deleted since this class only provides static functions. */
+		P2PWireFormat() = delete;
+};
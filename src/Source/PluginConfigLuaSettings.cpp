@@ -13,7 +13,78 @@
 #include <string>
 
 
+//---------------------------------------------------------------------------------
+// Private Constants
+//---------------------------------------------------------------------------------
+
+/** Default number of seconds a fetched store catalog is served from memory. */
+static const int kDefaultEcomCatalogTimeToLiveInSeconds = 300;
+
+/** Default max number of megabytes the store's offer images may occupy in the caches directory. */
+static const int kDefaultEcomImageCacheSizeInMegabytes = 32;
+
+/** Default number of seconds finished transactions' entitlements are collected before being redeemed together. */
+static const int kDefaultEcomRedeemIntervalInSeconds = 5;
+
+/** Default number of queued entitlements that causes them to be redeemed before the interval elapses. */
+static const int kDefaultEcomRedeemBatchSize = 32;
+
+/** Default size of the EOS P2P packet queues. Negative keeps EOS' own default size. */
+static const int kDefaultP2PQueueSizeInKilobytes = -1;
+
+/** Default P2P port settings. Negative keeps EOS' own default port range. */
+static const int kDefaultP2PPort = -1;
+static const int kDefaultP2PMaxAdditionalPorts = -1;
+
+
+//---------------------------------------------------------------------------------
+// Private Static Functions
+//---------------------------------------------------------------------------------
+
+/**
+  Loads the RSA JSON Web Key table at the top of the Lua stack, having string "n", "e", and optional "kid" fields.
+  @param luaStatePointer The Lua state the table belongs to.
+  @param key Assigned the loaded key.
+  @return Returns true if loaded. Returns false if not given a valid RSA key table.
+ */
+static bool LoadJsonWebKeyFrom(lua_State* luaStatePointer, RsaPublicKey& key)
+{
+	if (!lua_istable(luaStatePointer, -1))
+	{
+		return false;
+	}
+	lua_getfield(luaStatePointer, -1, "n");
+	lua_getfield(luaStatePointer, -2, "e");
+	bool wasLoaded =
+			(lua_type(luaStatePointer, -2) == LUA_TSTRING) && (lua_type(luaStatePointer, -1) == LUA_TSTRING) &&
+			key.SetFromJsonWebKey(lua_tostring(luaStatePointer, -2), lua_tostring(luaStatePointer, -1));
+	lua_pop(luaStatePointer, 2);
+	if (wasLoaded)
+	{
+		lua_getfield(luaStatePointer, -1, "kid");
+		if (lua_type(luaStatePointer, -1) == LUA_TSTRING)
+		{
+			key.SetKeyId(lua_tostring(luaStatePointer, -1));
+		}
+		lua_pop(luaStatePointer, 1);
+	}
+	return wasLoaded;
+}
+
+
+//---------------------------------------------------------------------------------
+// PluginConfigLuaSettings Class Members
+//---------------------------------------------------------------------------------
+
 PluginConfigLuaSettings::PluginConfigLuaSettings()
+:	fEcomCatalogTimeToLiveInSeconds(kDefaultEcomCatalogTimeToLiveInSeconds),
+	fEcomImageCacheSizeInMegabytes(kDefaultEcomImageCacheSizeInMegabytes),
+	fEcomRedeemIntervalInSeconds(kDefaultEcomRedeemIntervalInSeconds),
+	fEcomRedeemBatchSize(kDefaultEcomRedeemBatchSize),
+	fP2PIncomingQueueSizeInKilobytes(kDefaultP2PQueueSizeInKilobytes),
+	fP2POutgoingQueueSizeInKilobytes(kDefaultP2PQueueSizeInKilobytes),
+	fP2PPort(kDefaultP2PPort),
+	fP2PMaxAdditionalPorts(kDefaultP2PMaxAdditionalPorts)
 {
 }
 
@@ -140,11 +211,189 @@ void PluginConfigLuaSettings::SetStringClientSecret(const char* stringId)
 	}
 }
 
+int PluginConfigLuaSettings::GetEcomCatalogTimeToLiveInSeconds() const
+{
+	return fEcomCatalogTimeToLiveInSeconds;
+}
+
+void PluginConfigLuaSettings::SetEcomCatalogTimeToLiveInSeconds(int value)
+{
+	fEcomCatalogTimeToLiveInSeconds = (value > 0) ? value : 0;
+}
+
+int PluginConfigLuaSettings::GetEcomImageCacheSizeInMegabytes() const
+{
+	return fEcomImageCacheSizeInMegabytes;
+}
+
+void PluginConfigLuaSettings::SetEcomImageCacheSizeInMegabytes(int value)
+{
+	fEcomImageCacheSizeInMegabytes = (value > 0) ? value : 0;
+}
+
+int PluginConfigLuaSettings::GetEcomRedeemIntervalInSeconds() const
+{
+	return fEcomRedeemIntervalInSeconds;
+}
+
+void PluginConfigLuaSettings::SetEcomRedeemIntervalInSeconds(int value)
+{
+	fEcomRedeemIntervalInSeconds = (value > 0) ? value : 0;
+}
+
+int PluginConfigLuaSettings::GetEcomRedeemBatchSize() const
+{
+	return fEcomRedeemBatchSize;
+}
+
+void PluginConfigLuaSettings::SetEcomRedeemBatchSize(int value)
+{
+	fEcomRedeemBatchSize = (value > 1) ? value : 1;
+}
+
+const std::vector<RsaPublicKey>& PluginConfigLuaSettings::GetEcomTokenPublicKeys() const
+{
+	return fEcomTokenPublicKeys;
+}
+
+void PluginConfigLuaSettings::AddEcomTokenPublicKey(const RsaPublicKey& key)
+{
+	if (key.IsValid())
+	{
+		fEcomTokenPublicKeys.push_back(key);
+	}
+}
+
+const char* PluginConfigLuaSettings::GetStringEcomTokenIssuer() const
+{
+	return fStringEcomTokenIssuer.c_str();
+}
+
+void PluginConfigLuaSettings::SetStringEcomTokenIssuer(const char* value)
+{
+	if (value)
+	{
+		fStringEcomTokenIssuer = value;
+	}
+	else
+	{
+		fStringEcomTokenIssuer.clear();
+	}
+}
+
+int PluginConfigLuaSettings::GetP2PIncomingQueueSizeInKilobytes() const
+{
+	return fP2PIncomingQueueSizeInKilobytes;
+}
+
+void PluginConfigLuaSettings::SetP2PIncomingQueueSizeInKilobytes(int value)
+{
+	fP2PIncomingQueueSizeInKilobytes = (value >= 0) ? value : kDefaultP2PQueueSizeInKilobytes;
+}
+
+int PluginConfigLuaSettings::GetP2POutgoingQueueSizeInKilobytes() const
+{
+	return fP2POutgoingQueueSizeInKilobytes;
+}
+
+void PluginConfigLuaSettings::SetP2POutgoingQueueSizeInKilobytes(int value)
+{
+	fP2POutgoingQueueSizeInKilobytes = (value >= 0) ? value : kDefaultP2PQueueSizeInKilobytes;
+}
+
+const char* PluginConfigLuaSettings::GetStringP2PQueueOverflowPolicy() const
+{
+	return fStringP2PQueueOverflowPolicy.c_str();
+}
+
+void PluginConfigLuaSettings::SetStringP2PQueueOverflowPolicy(const char* value)
+{
+	if (value)
+	{
+		fStringP2PQueueOverflowPolicy = value;
+	}
+	else
+	{
+		fStringP2PQueueOverflowPolicy.clear();
+	}
+}
+
+const std::vector<uint8_t>& PluginConfigLuaSettings::GetP2PUnreliableChannels() const
+{
+	return fP2PUnreliableChannels;
+}
+
+void PluginConfigLuaSettings::AddP2PUnreliableChannel(uint8_t channel)
+{
+	fP2PUnreliableChannels.push_back(channel);
+}
+
+const std::map<uint8_t, int>& PluginConfigLuaSettings::GetP2PChannelPriorities() const
+{
+	return fP2PChannelPriorities;
+}
+
+void PluginConfigLuaSettings::SetP2PChannelPriority(uint8_t channel, int priority)
+{
+	fP2PChannelPriorities[channel] = priority;
+}
+
+const char* PluginConfigLuaSettings::GetStringP2PRelayControl() const
+{
+	return fStringP2PRelayControl.c_str();
+}
+
+void PluginConfigLuaSettings::SetStringP2PRelayControl(const char* value)
+{
+	if (value)
+	{
+		fStringP2PRelayControl = value;
+	}
+	else
+	{
+		fStringP2PRelayControl.clear();
+	}
+}
+
+int PluginConfigLuaSettings::GetP2PPort() const
+{
+	return fP2PPort;
+}
+
+void PluginConfigLuaSettings::SetP2PPort(int value)
+{
+	fP2PPort = ((value >= 0) && (value <= 65535)) ? value : kDefaultP2PPort;
+}
+
+int PluginConfigLuaSettings::GetP2PMaxAdditionalPorts() const
+{
+	return fP2PMaxAdditionalPorts;
+}
+
+void PluginConfigLuaSettings::SetP2PMaxAdditionalPorts(int value)
+{
+	fP2PMaxAdditionalPorts = ((value >= 0) && (value <= 65535)) ? value : kDefaultP2PMaxAdditionalPorts;
+}
+
 void PluginConfigLuaSettings::Reset()
 {
 	fStringAppId.clear();
 	fStringClientId.clear();
 	fStringClientSecret.clear();
+	fEcomCatalogTimeToLiveInSeconds = kDefaultEcomCatalogTimeToLiveInSeconds;
+	fEcomImageCacheSizeInMegabytes = kDefaultEcomImageCacheSizeInMegabytes;
+	fEcomRedeemIntervalInSeconds = kDefaultEcomRedeemIntervalInSeconds;
+	fEcomRedeemBatchSize = kDefaultEcomRedeemBatchSize;
+	fEcomTokenPublicKeys.clear();
+	fStringEcomTokenIssuer.clear();
+	fP2PIncomingQueueSizeInKilobytes = kDefaultP2PQueueSizeInKilobytes;
+	fP2POutgoingQueueSizeInKilobytes = kDefaultP2PQueueSizeInKilobytes;
+	fStringP2PQueueOverflowPolicy.clear();
+	fP2PUnreliableChannels.clear();
+	fP2PChannelPriorities.clear();
+	fStringP2PRelayControl.clear();
+	fP2PPort = kDefaultP2PPort;
+	fP2PMaxAdditionalPorts = kDefaultP2PMaxAdditionalPorts;
 }
 
 bool PluginConfigLuaSettings::LoadFrom(lua_State* luaStatePointer)
@@ -298,6 +547,159 @@ bool PluginConfigLuaSettings::LoadFrom(lua_State* luaStatePointer)
 				}
 				lua_pop(luaStatePointer, 1);
 
+				// Fetch the number of seconds the store's offer catalog is served from memory before being fetched again.
+				lua_getfield(luaStatePointer, -1, "ecomCatalogTimeToLive");
+				if (lua_type(luaStatePointer, -1) == LUA_TNUMBER)
+				{
+					SetEcomCatalogTimeToLiveInSeconds((int)lua_tointeger(luaStatePointer, -1));
+				}
+				lua_pop(luaStatePointer, 1);
+
+				// Fetch the max number of megabytes of offer images to cache. Zero disables image caching.
+				lua_getfield(luaStatePointer, -1, "ecomImageCacheSize");
+				if (lua_type(luaStatePointer, -1) == LUA_TNUMBER)
+				{
+					SetEcomImageCacheSizeInMegabytes((int)lua_tointeger(luaStatePointer, -1));
+				}
+				lua_pop(luaStatePointer, 1);
+
+				// Fetch how finished transactions' entitlements are batched before being redeemed.
+				// They are redeemed once the interval in seconds elapses or once the batch size is reached.
+				lua_getfield(luaStatePointer, -1, "ecomRedeemInterval");
+				if (lua_type(luaStatePointer, -1) == LUA_TNUMBER)
+				{
+					SetEcomRedeemIntervalInSeconds((int)lua_tointeger(luaStatePointer, -1));
+				}
+				lua_pop(luaStatePointer, 1);
+				lua_getfield(luaStatePointer, -1, "ecomRedeemBatchSize");
+				if (lua_type(luaStatePointer, -1) == LUA_TNUMBER)
+				{
+					SetEcomRedeemBatchSize((int)lua_tointeger(luaStatePointer, -1));
+				}
+				lua_pop(luaStatePointer, 1);
+
+				// Fetch the public keys used to verify ownership and entitlement tokens locally.
+				// Accepts a single JSON Web Key table, an array of them, or a JWKS table with a "keys" array.
+				lua_getfield(luaStatePointer, -1, "ecomTokenPublicKeys");
+				if (lua_istable(luaStatePointer, -1))
+				{
+					RsaPublicKey key;
+					if (LoadJsonWebKeyFrom(luaStatePointer, key))
+					{
+						AddEcomTokenPublicKey(key);
+					}
+					else
+					{
+						lua_getfield(luaStatePointer, -1, "keys");
+						if (!lua_istable(luaStatePointer, -1))
+						{
+							lua_pop(luaStatePointer, 1);
+							lua_pushvalue(luaStatePointer, -1);
+						}
+						int keyCount = (int)lua_objlen(luaStatePointer, -1);
+						for (int index = 1; index <= keyCount; index++)
+						{
+							lua_rawgeti(luaStatePointer, -1, index);
+							if (LoadJsonWebKeyFrom(luaStatePointer, key))
+							{
+								AddEcomTokenPublicKey(key);
+							}
+							lua_pop(luaStatePointer, 1);
+						}
+						lua_pop(luaStatePointer, 1);
+					}
+				}
+				lua_pop(luaStatePointer, 1);
+
+				// Fetch the expected "iss" claim of verified tokens, if any.
+				lua_getfield(luaStatePointer, -1, "ecomTokenIssuer");
+				if (lua_type(luaStatePointer, -1) == LUA_TSTRING)
+				{
+					SetStringEcomTokenIssuer(lua_tostring(luaStatePointer, -1));
+				}
+				lua_pop(luaStatePointer, 1);
+
+				// Fetch the max number of kilobytes the EOS P2P packet queues may use. Zero means unlimited.
+				lua_getfield(luaStatePointer, -1, "p2pIncomingQueueSize");
+				if (lua_type(luaStatePointer, -1) == LUA_TNUMBER)
+				{
+					SetP2PIncomingQueueSizeInKilobytes((int)lua_tointeger(luaStatePointer, -1));
+				}
+				lua_pop(luaStatePointer, 1);
+				lua_getfield(luaStatePointer, -1, "p2pOutgoingQueueSize");
+				if (lua_type(luaStatePointer, -1) == LUA_TNUMBER)
+				{
+					SetP2POutgoingQueueSizeInKilobytes((int)lua_tointeger(luaStatePointer, -1));
+				}
+				lua_pop(luaStatePointer, 1);
+
+				// Fetch how room is made when the incoming P2P packet queue is full, such as "dropByPriority".
+				lua_getfield(luaStatePointer, -1, "p2pQueueOverflowPolicy");
+				if (lua_type(luaStatePointer, -1) == LUA_TSTRING)
+				{
+					SetStringP2PQueueOverflowPolicy(lua_tostring(luaStatePointer, -1));
+				}
+				lua_pop(luaStatePointer, 1);
+
+				// Fetch the array of P2P channels that only carry unreliable packets, safe to drop on overflow.
+				lua_getfield(luaStatePointer, -1, "p2pUnreliableChannels");
+				if (lua_istable(luaStatePointer, -1))
+				{
+					int channelCount = (int)lua_objlen(luaStatePointer, -1);
+					for (int index = 1; index <= channelCount; index++)
+					{
+						lua_rawgeti(luaStatePointer, -1, index);
+						if (lua_type(luaStatePointer, -1) == LUA_TNUMBER)
+						{
+							AddP2PUnreliableChannel((uint8_t)lua_tointeger(luaStatePointer, -1));
+						}
+						lua_pop(luaStatePointer, 1);
+					}
+				}
+				lua_pop(luaStatePointer, 1);
+
+				// Fetch the table mapping P2P channels to priorities. Lower priority channels are dropped first.
+				lua_getfield(luaStatePointer, -1, "p2pChannelPriorities");
+				if (lua_istable(luaStatePointer, -1))
+				{
+					lua_pushnil(luaStatePointer);
+					while (lua_next(luaStatePointer, -2))
+					{
+						bool isValid =
+								(lua_type(luaStatePointer, -2) == LUA_TNUMBER) &&
+								(lua_type(luaStatePointer, -1) == LUA_TNUMBER);
+						if (isValid)
+						{
+							SetP2PChannelPriority(
+									(uint8_t)lua_tointeger(luaStatePointer, -2), (int)lua_tointeger(luaStatePointer, -1));
+						}
+						lua_pop(luaStatePointer, 1);
+					}
+				}
+				lua_pop(luaStatePointer, 1);
+
+				// Fetch which relay servers P2P connections may use, such as "forceRelays" to hide IP addresses.
+				lua_getfield(luaStatePointer, -1, "p2pRelayControl");
+				if (lua_type(luaStatePointer, -1) == LUA_TSTRING)
+				{
+					SetStringP2PRelayControl(lua_tostring(luaStatePointer, -1));
+				}
+				lua_pop(luaStatePointer, 1);
+
+				// Fetch the ideal P2P port and how many ports after it to try if it is unavailable.
+				lua_getfield(luaStatePointer, -1, "p2pPort");
+				if (lua_type(luaStatePointer, -1) == LUA_TNUMBER)
+				{
+					SetP2PPort((int)lua_tointeger(luaStatePointer, -1));
+				}
+				lua_pop(luaStatePointer, 1);
+				lua_getfield(luaStatePointer, -1, "p2pMaxAdditionalPorts");
+				if (lua_type(luaStatePointer, -1) == LUA_TNUMBER)
+				{
+					SetP2PMaxAdditionalPorts((int)lua_tointeger(luaStatePointer, -1));
+				}
+				lua_pop(luaStatePointer, 1);
+
 				// *** In the future, other "config.lua" plugin settings can be loaded here. ***
 			}
 			lua_pop(luaStatePointer, 1);
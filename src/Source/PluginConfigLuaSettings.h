@@ -9,7 +9,11 @@
 
 #pragma once
 
+#include "RsaPublicKey.h"
+#include <cstdint>
+#include <map>
 #include <string>
+#include <vector>
 extern "C"
 {
 #	include "lua.h"
@@ -42,6 +46,34 @@ class PluginConfigLuaSettings
 		void SetStringClientId(const char* stringId);
 		const char* GetStringClientSecret() const;
 		void SetStringClientSecret(const char* stringId);
+		int GetEcomCatalogTimeToLiveInSeconds() const;
+		void SetEcomCatalogTimeToLiveInSeconds(int value);
+		int GetEcomImageCacheSizeInMegabytes() const;
+		void SetEcomImageCacheSizeInMegabytes(int value);
+		int GetEcomRedeemIntervalInSeconds() const;
+		void SetEcomRedeemIntervalInSeconds(int value);
+		int GetEcomRedeemBatchSize() const;
+		void SetEcomRedeemBatchSize(int value);
+		const std::vector<RsaPublicKey>& GetEcomTokenPublicKeys() const;
+		void AddEcomTokenPublicKey(const RsaPublicKey& key);
+		const char* GetStringEcomTokenIssuer() const;
+		void SetStringEcomTokenIssuer(const char* value);
+		int GetP2PIncomingQueueSizeInKilobytes() const;
+		void SetP2PIncomingQueueSizeInKilobytes(int value);
+		int GetP2POutgoingQueueSizeInKilobytes() const;
+		void SetP2POutgoingQueueSizeInKilobytes(int value);
+		const char* GetStringP2PQueueOverflowPolicy() const;
+		void SetStringP2PQueueOverflowPolicy(const char* value);
+		const std::vector<uint8_t>& GetP2PUnreliableChannels() const;
+		void AddP2PUnreliableChannel(uint8_t channel);
+		const std::map<uint8_t, int>& GetP2PChannelPriorities() const;
+		void SetP2PChannelPriority(uint8_t channel, int priority);
+		const char* GetStringP2PRelayControl() const;
+		void SetStringP2PRelayControl(const char* value);
+		int GetP2PPort() const;
+		void SetP2PPort(int value);
+		int GetP2PMaxAdditionalPorts() const;
+		void SetP2PMaxAdditionalPorts(int value);
 		void Reset();
 		bool LoadFrom(lua_State* luaStatePointer);
 
@@ -53,4 +85,18 @@ class PluginConfigLuaSettings
 		std::string fStringDeploymentId;
 		std::string fStringClientId;
 		std::string fStringClientSecret;
+		int fEcomCatalogTimeToLiveInSeconds;
+		int fEcomImageCacheSizeInMegabytes;
+		int fEcomRedeemIntervalInSeconds;
+		int fEcomRedeemBatchSize;
+		std::vector<RsaPublicKey> fEcomTokenPublicKeys;
+		std::string fStringEcomTokenIssuer;
+		int fP2PIncomingQueueSizeInKilobytes;
+		int fP2POutgoingQueueSizeInKilobytes;
+		std::string fStringP2PQueueOverflowPolicy;
+		std::vector<uint8_t> fP2PUnreliableChannels;
+		std::map<uint8_t, int> fP2PChannelPriorities;
+		std::string fStringP2PRelayControl;
+		int fP2PPort;
+		int fP2PMaxAdditionalPorts;
 };
@@ -0,0 +1,412 @@
+// ----------------------------------------------------------------------------
+//
+// RsaPublicKey.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "RsaPublicKey.h"
+#include "JsonWebToken.h"
+#include <cstring>
+
+
+//---------------------------------------------------------------------------------
+// Private Constants
+//---------------------------------------------------------------------------------
+
+/** Smallest accepted modulus size. Smaller keys are too weak to be trusted. */
+static const size_t kMinModulusByteCount = 1024 / 8;
+
+/** Largest accepted modulus size. */
+static const size_t kMaxModulusByteCount = 8192 / 8;
+
+/** DER encoded DigestInfo prefix of a SHA-256 hash, as defined by PKCS #1. */
+static const uint8_t kSha256DigestInfoPrefix[] =
+{
+	0x30, 0x31, 0x30, 0x0D, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01, 0x05, 0x00, 0x04, 0x20
+};
+
+/** SHA-256 round constants. */
+static const uint32_t kSha256RoundConstants[64] =
+{
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+
+//---------------------------------------------------------------------------------
+// Private Static Functions
+//---------------------------------------------------------------------------------
+
+/** Rotates the given value right by the given number of bits. */
+static uint32_t RotateRight(uint32_t value, int bitCount)
+{
+	return (value >> bitCount) | (value << (32 - bitCount));
+}
+
+/** Hashes 1 64 byte block into the given SHA-256 state. */
+static void HashSha256Block(uint32_t state[8], const uint8_t* block)
+{
+	uint32_t words[64];
+	for (int index = 0; index < 16; index++)
+	{
+		words[index] =
+				((uint32_t)block[index * 4] << 24) | ((uint32_t)block[index * 4 + 1] << 16) |
+				((uint32_t)block[index * 4 + 2] << 8) | (uint32_t)block[index * 4 + 3];
+	}
+	for (int index = 16; index < 64; index++)
+	{
+		uint32_t s0 = RotateRight(words[index - 15], 7) ^ RotateRight(words[index - 15], 18) ^ (words[index - 15] >> 3);
+		uint32_t s1 = RotateRight(words[index - 2], 17) ^ RotateRight(words[index - 2], 19) ^ (words[index - 2] >> 10);
+		words[index] = words[index - 16] + s0 + words[index - 7] + s1;
+	}
+
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+	uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+	for (int index = 0; index < 64; index++)
+	{
+		uint32_t s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+		uint32_t choice = (e & f) ^ (~e & g);
+		uint32_t temp1 = h + s1 + choice + kSha256RoundConstants[index] + words[index];
+		uint32_t s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+		uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+		uint32_t temp2 = s0 + majority;
+		h = g;
+		g = f;
+		f = e;
+		e = d + temp1;
+		d = c;
+		c = b;
+		b = a;
+		a = temp1 + temp2;
+	}
+	state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+	state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+/** Converts the given big endian bytes to 32-bit limbs, least significant first, zero padded to "limbCount". */
+static void BytesToLimbs(const std::string& bytes, size_t limbCount, std::vector<uint32_t>& limbs)
+{
+	limbs.assign(limbCount, 0);
+	size_t byteCount = bytes.length();
+	for (size_t index = 0; (index < byteCount) && (index < (limbCount * 4)); index++)
+	{
+		auto byteValue = (uint32_t)(uint8_t)bytes[byteCount - 1 - index];
+		limbs[index / 4] |= byteValue << ((index % 4) * 8);
+	}
+}
+
+/** Compares the given equally sized limb arrays. Returns -1, 0, or 1 if "a" is less, equal, or greater than "b". */
+static int CompareLimbs(const uint32_t* a, const uint32_t* b, size_t limbCount)
+{
+	for (size_t index = limbCount; index > 0; index--)
+	{
+		if (a[index - 1] != b[index - 1])
+		{
+			return (a[index - 1] < b[index - 1]) ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+/** Subtracts "b" from "a" in place. Returns the borrow. */
+static uint32_t SubtractLimbs(uint32_t* a, const uint32_t* b, size_t limbCount)
+{
+	uint64_t borrow = 0;
+	for (size_t index = 0; index < limbCount; index++)
+	{
+		uint64_t difference = (uint64_t)a[index] - b[index] - borrow;
+		a[index] = (uint32_t)difference;
+		borrow = (difference >> 32) & 1;
+	}
+	return (uint32_t)borrow;
+}
+
+
+//---------------------------------------------------------------------------------
+// RsaPublicKey Class Members
+//---------------------------------------------------------------------------------
+
+RsaPublicKey::RsaPublicKey()
+:	fModulusByteCount(0),
+	fExponent(0),
+	fModulusInverse(0)
+{
+}
+
+RsaPublicKey::~RsaPublicKey()
+{
+}
+
+bool RsaPublicKey::SetFromJsonWebKey(const char* modulus, const char* exponent)
+{
+	// Reset this key.
+	fModulus.clear();
+	fMontgomerySquare.clear();
+	fModulusByteCount = 0;
+	fExponent = 0;
+
+	// Validate.
+	if (!modulus || !exponent)
+	{
+		return false;
+	}
+
+	// Decode the modulus, ignoring leading zeros. It must be odd for Montgomery multiplication to work,
+	// which is always the case for an RSA modulus since it is the product of 2 large primes.
+	std::string modulusBytes;
+	if (!JsonWebToken::Base64UrlDecode(modulus, strlen(modulus), modulusBytes))
+	{
+		return false;
+	}
+	size_t leadingZeroCount = 0;
+	while ((leadingZeroCount < modulusBytes.length()) && (modulusBytes[leadingZeroCount] == 0))
+	{
+		leadingZeroCount++;
+	}
+	modulusBytes.erase(0, leadingZeroCount);
+	if ((modulusBytes.length() < kMinModulusByteCount) || (modulusBytes.length() > kMaxModulusByteCount))
+	{
+		return false;
+	}
+	if ((modulusBytes.back() & 1) == 0)
+	{
+		return false;
+	}
+
+	// Decode the exponent.
+	std::string exponentBytes;
+	if (!JsonWebToken::Base64UrlDecode(exponent, strlen(exponent), exponentBytes))
+	{
+		return false;
+	}
+	uint64_t exponentValue = 0;
+	for (auto&& byteValue : exponentBytes)
+	{
+		if (exponentValue >> 56)
+		{
+			return false;
+		}
+		exponentValue = (exponentValue << 8) | (uint8_t)byteValue;
+	}
+	if (exponentValue < 3)
+	{
+		return false;
+	}
+
+	// Store the modulus in little endian limbs.
+	size_t limbCount = (modulusBytes.length() + 3) / 4;
+	BytesToLimbs(modulusBytes, limbCount, fModulus);
+	fModulusByteCount = modulusBytes.length();
+	fExponent = exponentValue;
+
+	// Compute "-(n^-1) mod 2^32" via Newton's method. Each iteration doubles the number of correct bits.
+	uint32_t inverse = 1;
+	for (int iteration = 0; iteration < 5; iteration++)
+	{
+		inverse *= 2 - (fModulus[0] * inverse);
+	}
+	fModulusInverse = (uint32_t)(0 - inverse);
+
+	// Compute "R^2 mod n" by doubling 1 modulo n, "2 * 32 * limbCount" times.
+	std::vector<uint32_t> value(limbCount + 1, 0);
+	std::vector<uint32_t> modulusCopy(fModulus);
+	modulusCopy.push_back(0);
+	value[0] = 1;
+	for (size_t iteration = 0; iteration < (limbCount * 64); iteration++)
+	{
+		uint32_t carry = 0;
+		for (size_t index = 0; index <= limbCount; index++)
+		{
+			uint32_t nextCarry = value[index] >> 31;
+			value[index] = (value[index] << 1) | carry;
+			carry = nextCarry;
+		}
+		if (CompareLimbs(value.data(), modulusCopy.data(), limbCount + 1) >= 0)
+		{
+			SubtractLimbs(value.data(), modulusCopy.data(), limbCount + 1);
+		}
+	}
+	value.pop_back();
+	fMontgomerySquare = std::move(value);
+	return true;
+}
+
+bool RsaPublicKey::IsValid() const
+{
+	return !fModulus.empty();
+}
+
+const std::string& RsaPublicKey::GetKeyId() const
+{
+	return fKeyId;
+}
+
+void RsaPublicKey::SetKeyId(const std::string& value)
+{
+	fKeyId = value;
+}
+
+bool RsaPublicKey::VerifySha256Signature(const std::string& message, const std::string& signature) const
+{
+	// Validate.
+	if (!IsValid() || (signature.length() != fModulusByteCount))
+	{
+		return false;
+	}
+
+	// The signature must be less than the modulus.
+	size_t limbCount = fModulus.size();
+	std::vector<uint32_t> signatureValue;
+	BytesToLimbs(signature, limbCount, signatureValue);
+	if (CompareLimbs(signatureValue.data(), fModulus.data(), limbCount) >= 0)
+	{
+		return false;
+	}
+
+	// Compute "signature^e mod n" via square-and-multiply in Montgomery form.
+	std::vector<uint32_t> base(limbCount);
+	std::vector<uint32_t> result(limbCount);
+	std::vector<uint32_t> temp(limbCount);
+	MontgomeryMultiply(signatureValue.data(), fMontgomerySquare.data(), base.data());
+	result = base;
+	int bitIndex = 63;
+	while (((fExponent >> bitIndex) & 1) == 0)
+	{
+		bitIndex--;
+	}
+	for (bitIndex--; bitIndex >= 0; bitIndex--)
+	{
+		MontgomeryMultiply(result.data(), result.data(), temp.data());
+		result.swap(temp);
+		if ((fExponent >> bitIndex) & 1)
+		{
+			MontgomeryMultiply(result.data(), base.data(), temp.data());
+			result.swap(temp);
+		}
+	}
+	std::vector<uint32_t> one(limbCount, 0);
+	one[0] = 1;
+	MontgomeryMultiply(result.data(), one.data(), temp.data());
+
+	// Convert the result back to big endian bytes.
+	std::string encodedMessage(fModulusByteCount, '\0');
+	for (size_t index = 0; index < fModulusByteCount; index++)
+	{
+		encodedMessage[fModulusByteCount - 1 - index] = (char)((temp[index / 4] >> ((index % 4) * 8)) & 0xFF);
+	}
+
+	// Build the expected PKCS #1 v1.5 encoding: 0x00 0x01 0xFF...0xFF 0x00 DigestInfo Hash
+	const size_t digestInfoLength = sizeof(kSha256DigestInfoPrefix) + 32;
+	if (fModulusByteCount < (digestInfoLength + 11))
+	{
+		return false;
+	}
+	std::string expectedMessage(fModulusByteCount, (char)0xFF);
+	expectedMessage[0] = 0x00;
+	expectedMessage[1] = 0x01;
+	size_t offset = fModulusByteCount - digestInfoLength - 1;
+	expectedMessage[offset++] = 0x00;
+	memcpy(&expectedMessage[offset], kSha256DigestInfoPrefix, sizeof(kSha256DigestInfoPrefix));
+	offset += sizeof(kSha256DigestInfoPrefix);
+	uint8_t digest[32];
+	ComputeSha256(message.data(), message.length(), digest);
+	memcpy(&expectedMessage[offset], digest, sizeof(digest));
+	return (encodedMessage == expectedMessage);
+}
+
+void RsaPublicKey::ComputeSha256(const void* data, size_t length, uint8_t digest[32])
+{
+	uint32_t state[8] =
+	{
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+
+	// Hash all complete blocks.
+	auto bytes = (const uint8_t*)data;
+	size_t offset = 0;
+	for (; (offset + 64) <= length; offset += 64)
+	{
+		HashSha256Block(state, bytes + offset);
+	}
+
+	// Pad the remaining bytes with a 1 bit, zeros, and the message's length in bits.
+	uint8_t block[128] = {};
+	size_t remainingCount = length - offset;
+	if (remainingCount > 0)
+	{
+		memcpy(block, bytes + offset, remainingCount);
+	}
+	block[remainingCount] = 0x80;
+	size_t blockLength = (remainingCount < 56) ? 64 : 128;
+	uint64_t bitLength = (uint64_t)length * 8;
+	for (int index = 0; index < 8; index++)
+	{
+		block[blockLength - 1 - index] = (uint8_t)(bitLength >> (index * 8));
+	}
+	HashSha256Block(state, block);
+	if (blockLength > 64)
+	{
+		HashSha256Block(state, block + 64);
+	}
+
+	// Output the state in big endian order.
+	for (int index = 0; index < 8; index++)
+	{
+		digest[index * 4] = (uint8_t)(state[index] >> 24);
+		digest[index * 4 + 1] = (uint8_t)(state[index] >> 16);
+		digest[index * 4 + 2] = (uint8_t)(state[index] >> 8);
+		digest[index * 4 + 3] = (uint8_t)state[index];
+	}
+}
+
+void RsaPublicKey::MontgomeryMultiply(const uint32_t* a, const uint32_t* b, uint32_t* result) const
+{
+	// Coarsely integrated operand scanning (CIOS) Montgomery multiplication.
+	size_t limbCount = fModulus.size();
+	const uint32_t* modulus = fModulus.data();
+	std::vector<uint32_t> sum(limbCount + 2, 0);
+	for (size_t outerIndex = 0; outerIndex < limbCount; outerIndex++)
+	{
+		// Add "a * b[i]" to the sum.
+		uint64_t carry = 0;
+		for (size_t index = 0; index < limbCount; index++)
+		{
+			uint64_t value = (uint64_t)sum[index] + ((uint64_t)a[index] * b[outerIndex]) + carry;
+			sum[index] = (uint32_t)value;
+			carry = value >> 32;
+		}
+		uint64_t value = (uint64_t)sum[limbCount] + carry;
+		sum[limbCount] = (uint32_t)value;
+		sum[limbCount + 1] = (uint32_t)(value >> 32);
+
+		// Add a multiple of the modulus that zeroes the lowest limb, then shift the sum down by 1 limb.
+		uint32_t multiplier = sum[0] * fModulusInverse;
+		value = (uint64_t)sum[0] + ((uint64_t)multiplier * modulus[0]);
+		carry = value >> 32;
+		for (size_t index = 1; index < limbCount; index++)
+		{
+			value = (uint64_t)sum[index] + ((uint64_t)multiplier * modulus[index]) + carry;
+			sum[index - 1] = (uint32_t)value;
+			carry = value >> 32;
+		}
+		value = (uint64_t)sum[limbCount] + carry;
+		sum[limbCount - 1] = (uint32_t)value;
+		sum[limbCount] = sum[limbCount + 1] + (uint32_t)(value >> 32);
+	}
+
+	// The sum is less than 2n. Subtract the modulus once if it is not less than n.
+	if (sum[limbCount] || (CompareLimbs(sum.data(), modulus, limbCount) >= 0))
+	{
+		SubtractLimbs(sum.data(), modulus, limbCount);
+	}
+	memcpy(result, sum.data(), limbCount * sizeof(uint32_t));
+}
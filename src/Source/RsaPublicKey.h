@@ -0,0 +1,89 @@
+// ----------------------------------------------------------------------------
+//
+// RsaPublicKey.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/**
+  RSA public key used to verify RS256 (RSASSA-PKCS1-v1_5 with SHA-256) signatures, such as the signatures of
+  the JSON Web Tokens returned by the EOS Ecom interface.
+
+  Only supports verification. Everything is computed natively without a crypto library dependency,
+  which is fast enough for the occasional token check since the public exponent is small.
+ */
+class RsaPublicKey
+{
+	public:
+		/** Creates an empty, invalid key. */
+		RsaPublicKey();
+
+		/** Destroys this key. */
+		virtual ~RsaPublicKey();
+
+		/**
+		  Loads the key from the base64url encoded "n" and "e" fields of an RSA JSON Web Key (JWK).
+		  @param modulus The big endian modulus, base64url encoded. Must be at least 1024 bits.
+		  @param exponent The big endian public exponent, base64url encoded, typically "AQAB".
+		  @return Returns true if the key was loaded. Returns false if given null or invalid values,
+		          in which case this key is invalid.
+		 */
+		bool SetFromJsonWebKey(const char* modulus, const char* exponent);
+
+		/** Determines if a key was successfully loaded via SetFromJsonWebKey(). */
+		bool IsValid() const;
+
+		/** Gets the key's ID, matched against a JWT's "kid" header. Returns an empty string if not assigned. */
+		const std::string& GetKeyId() const;
+
+		/** Sets the key's ID, matched against a JWT's "kid" header. */
+		void SetKeyId(const std::string& value);
+
+		/**
+		  Verifies an RS256 signature.
+		  @param message The signed bytes, such as a JWT's "header.payload" string.
+		  @param signature The raw signature bytes.
+		  @return Returns true if the signature was made by this key's private key. Returns false if not.
+		 */
+		bool VerifySha256Signature(const std::string& message, const std::string& signature) const;
+
+		/**
+		  Computes the SHA-256 digest of the given bytes.
+		  @param data The bytes to hash. Can be null if "length" is zero.
+		  @param length Number of bytes to hash.
+		  @param digest Array to copy the 32 byte digest to.
+		 */
+		static void ComputeSha256(const void* data, size_t length, uint8_t digest[32]);
+
+	private:
+		/** Computes "(a * b) / R mod n" in Montgomery form, where "R" is 2^(32 * limb count). */
+		void MontgomeryMultiply(const uint32_t* a, const uint32_t* b, uint32_t* result) const;
+
+		/** The modulus' 32-bit limbs, least significant first. */
+		std::vector<uint32_t> fModulus;
+
+		/** Number of bytes in the big endian modulus, which is also the length of a valid signature. */
+		size_t fModulusByteCount;
+
+		/** The public exponent. */
+		uint64_t fExponent;
+
+		/** "-(modulus^-1) mod 2^32", used by MontgomeryMultiply(). */
+		uint32_t fModulusInverse;
+
+		/** "R^2 mod n", used to convert values to Montgomery form. */
+		std::vector<uint32_t> fMontgomerySquare;
+
+		/** The key's ID, if assigned. */
+		std::string fKeyId;
+};
@@ -17,7 +17,10 @@
 extern "C"
 {
 #	include "lua.h"
+#	include "lauxlib.h"
 }
+#include "eos_auth.h"
+#include "eos_connect.h"
 
 
 /** Stores a collection of all RuntimeContext instances that currently exist in the application. */
@@ -26,6 +29,10 @@ static std::unordered_set<RuntimeContext*> sRuntimeContextCollection;
 
 RuntimeContext::RuntimeContext(lua_State* luaStatePointer)
 :	fLuaEnterFrameCallback(this, &RuntimeContext::OnCoronaEnterFrame, luaStatePointer),
+	fNextLocalUserHandle(1),
+	fAuthLoginStatusNotificationId(EOS_INVALID_NOTIFICATIONID),
+	fConnectLoginStatusNotificationId(EOS_INVALID_NOTIFICATIONID),
+	fConnectAuthExpirationNotificationId(EOS_INVALID_NOTIFICATIONID),
 	fWasRenderRequested(false)
 {
 	// Validate.
@@ -47,6 +54,15 @@ RuntimeContext::RuntimeContext(lua_State* luaStatePointer)
 	// Used to dispatch global events to listeners
 	fLuaEventDispatcherPointer = std::make_shared<LuaEventDispatcher>(luaStatePointer);
 
+	// Create the cache used to push EOS user IDs to Lua as strings.
+	fIdCachePointer = std::make_shared<EosIdCache>(luaStatePointer);
+
+	// Create the in-app store.
+	fEcomStorePointer.reset(new EcomStore(*this));
+
+	// Create the P2P manager.
+	fP2PManagerPointer.reset(new P2PManager(*this));
+
 	// Add Corona runtime event listeners.
 	fLuaEnterFrameCallback.AddToRuntimeEventListeners("enterFrame");
 
@@ -55,7 +71,7 @@ RuntimeContext::RuntimeContext(lua_State* luaStatePointer)
 	
 	fAuthHandle = 0;
 	fPlatformHandle = 0;
-	fAccountId = 0;
+	fConnectHandle = 0;
 }
 
 RuntimeContext::~RuntimeContext()
@@ -63,6 +79,34 @@ RuntimeContext::~RuntimeContext()
 	// Remove our Corona runtime event listeners.
 	fLuaEnterFrameCallback.RemoveFromRuntimeEventListeners("enterFrame");
 
+	// Delete the store, causing its in-flight EOS requests to be ignored.
+	fEcomStorePointer.reset();
+
+	// Delete the P2P manager, releasing its Lua receive buffer.
+	fP2PManagerPointer.reset();
+
+	// Delete all local user sessions, releasing their cached ID tokens.
+	fLocalUserSessions.clear();
+
+	// Stop listening for login status changes.
+	if (fAuthHandle && (fAuthLoginStatusNotificationId != EOS_INVALID_NOTIFICATIONID))
+	{
+		EOS_Auth_RemoveNotifyLoginStatusChanged(fAuthHandle, fAuthLoginStatusNotificationId);
+		fAuthLoginStatusNotificationId = EOS_INVALID_NOTIFICATIONID;
+	}
+
+	// Stop listening for Connect session changes.
+	if (fConnectHandle && (fConnectLoginStatusNotificationId != EOS_INVALID_NOTIFICATIONID))
+	{
+		EOS_Connect_RemoveNotifyLoginStatusChanged(fConnectHandle, fConnectLoginStatusNotificationId);
+		fConnectLoginStatusNotificationId = EOS_INVALID_NOTIFICATIONID;
+	}
+	if (fConnectHandle && (fConnectAuthExpirationNotificationId != EOS_INVALID_NOTIFICATIONID))
+	{
+		EOS_Connect_RemoveNotifyAuthExpiration(fConnectHandle, fConnectAuthExpirationNotificationId);
+		fConnectAuthExpirationNotificationId = EOS_INVALID_NOTIFICATIONID;
+	}
+
 	EOS_Platform_Release(fPlatformHandle);
 	EOS_Shutdown();
 
@@ -93,6 +137,21 @@ std::shared_ptr<LuaEventDispatcher> RuntimeContext::GetLuaEventDispatcher() cons
 	return fLuaEventDispatcherPointer;
 }
 
+std::shared_ptr<EosIdCache> RuntimeContext::GetIdCache() const
+{
+	return fIdCachePointer;
+}
+
+EcomStore* RuntimeContext::GetEcomStore() const
+{
+	return fEcomStorePointer.get();
+}
+
+P2PManager* RuntimeContext::GetP2PManager() const
+{
+	return fP2PManagerPointer.get();
+}
+
 RuntimeContext* RuntimeContext::GetInstanceBy(lua_State* luaStatePointer)
 {
 	// Validate.
@@ -139,6 +198,39 @@ int RuntimeContext::OnCoronaEnterFrame(lua_State* luaStatePointer)
 		EOS_Platform_Tick(fPlatformHandle);
 	}
 
+	// Update all local user sessions, such as to refresh Connect logins that are about to expire.
+	for (auto&& pair : fLocalUserSessions)
+	{
+		pair.second->Update();
+	}
+
+	// Drain this frame's P2P packets and queue them to be dispatched to Lua as a few batched events.
+	fP2PManagerPointer->Update();
+
+	// Write this frame's store transaction changes to disk in a single batch.
+	fEcomStorePointer->Update();
+
+	// Report this frame's login state changes to Lua, including those of sessions that are about to be deleted.
+	QueueLoginStatusChanges();
+
+	// Delete sessions that have been logged out or have failed to log in. They are no longer needed.
+	// Simulated sessions never log into EOS and are kept until removed explicitly.
+	for (auto iterator = fLocalUserSessions.begin(); iterator != fLocalUserSessions.end();)
+	{
+		auto sessionPointer = iterator->second.get();
+		bool isDefunct =
+				!sessionPointer->IsSimulated() && !sessionPointer->IsRequestPending() &&
+				(sessionPointer->GetAuthLoginStatus() == EOS_ELoginStatus::EOS_LS_NotLoggedIn);
+		if (isDefunct)
+		{
+			iterator = fLocalUserSessions.erase(iterator);
+		}
+		else
+		{
+			iterator++;
+		}
+	}
+
 	// Dispatch all queued events received from the above SteamAPI_RunCallbacks() call to Lua.
 	while (fDispatchEventTaskQueue.size() > 0)
 	{
@@ -208,6 +300,7 @@ void RuntimeContext::OnHandleGlobalEosEvent(TSteamResultType* eventDataPointer)
 		return;
 	}
 	taskPointer->SetLuaEventDispatcher(fLuaEventDispatcherPointer);
+	taskPointer->SetIdCache(fIdCachePointer);
 	taskPointer->AcquireEventDataFrom(*eventDataPointer);
 
 	// Special handling of particular Epic events goes here if we had any.
@@ -241,7 +334,242 @@ void RuntimeContext::OnHandleGlobalEosEventWithGameId(TSteamResultType* eventDat
 	OnHandleGlobalEosEvent<TSteamResultType, TDispatchEventTask>(eventDataPointer);
 }
 
- void RuntimeContext::OnLoginResponse(const EOS_Auth_LoginCallbackInfo* Data)
- {
- 	OnHandleGlobalEosEvent<const EOS_Auth_LoginCallbackInfo*, DispatchLoginResponseEventTask>(&Data);
- }
+LocalUserSession* RuntimeContext::CreateLocalUser()
+{
+	// Validate.
+	if (!fPlatformHandle)
+	{
+		return nullptr;
+	}
+
+	// Fetch the interfaces used by local user sessions and listen for their session changes.
+	if (!fAuthHandle)
+	{
+		fAuthHandle = EOS_Platform_GetAuthInterface(fPlatformHandle);
+	}
+	if (!fConnectHandle)
+	{
+		fConnectHandle = EOS_Platform_GetConnectInterface(fPlatformHandle);
+	}
+	if (!fAuthHandle || !fConnectHandle)
+	{
+		return nullptr;
+	}
+	if (fAuthLoginStatusNotificationId == EOS_INVALID_NOTIFICATIONID)
+	{
+		EOS_Auth_AddNotifyLoginStatusChangedOptions options = {};
+		options.ApiVersion = EOS_AUTH_ADDNOTIFYLOGINSTATUSCHANGED_API_LATEST;
+		fAuthLoginStatusNotificationId = EOS_Auth_AddNotifyLoginStatusChanged(
+				fAuthHandle, &options, this, &RuntimeContext::OnAuthLoginStatusChangedCallback);
+	}
+	if (fConnectLoginStatusNotificationId == EOS_INVALID_NOTIFICATIONID)
+	{
+		EOS_Connect_AddNotifyLoginStatusChangedOptions options = {};
+		options.ApiVersion = EOS_CONNECT_ADDNOTIFYLOGINSTATUSCHANGED_API_LATEST;
+		fConnectLoginStatusNotificationId = EOS_Connect_AddNotifyLoginStatusChanged(
+				fConnectHandle, &options, this, &RuntimeContext::OnConnectLoginStatusChangedCallback);
+	}
+	if (fConnectAuthExpirationNotificationId == EOS_INVALID_NOTIFICATIONID)
+	{
+		EOS_Connect_AddNotifyAuthExpirationOptions options = {};
+		options.ApiVersion = EOS_CONNECT_ADDNOTIFYAUTHEXPIRATION_API_LATEST;
+		fConnectAuthExpirationNotificationId = EOS_Connect_AddNotifyAuthExpiration(
+				fConnectHandle, &options, this, &RuntimeContext::OnConnectAuthExpirationCallback);
+	}
+
+	// Create the session.
+	int userHandle = fNextLocalUserHandle++;
+	auto sessionPointer = new LocalUserSession(*this, userHandle);
+	fLocalUserSessions[userHandle] = std::unique_ptr<LocalUserSession>(sessionPointer);
+	return sessionPointer;
+}
+
+LocalUserSession* RuntimeContext::CreateSimulatedLocalUser(EOS_ProductUserId productUserId)
+{
+	// Validate.
+	if (!productUserId)
+	{
+		return nullptr;
+	}
+
+	// Create the session without touching the EOS interfaces, which may not exist.
+	int userHandle = fNextLocalUserHandle++;
+	auto sessionPointer = new LocalUserSession(*this, userHandle);
+	fLocalUserSessions[userHandle] = std::unique_ptr<LocalUserSession>(sessionPointer);
+	sessionPointer->SimulateConnectLogin(productUserId);
+	return sessionPointer;
+}
+
+void RuntimeContext::RemoveLocalUser(int userHandle)
+{
+	fLocalUserSessions.erase(userHandle);
+}
+
+LocalUserSession* RuntimeContext::GetLocalUserBy(int userHandle) const
+{
+	auto iterator = fLocalUserSessions.find(userHandle);
+	if (iterator == fLocalUserSessions.end())
+	{
+		return nullptr;
+	}
+	return iterator->second.get();
+}
+
+LocalUserSession* RuntimeContext::GetLocalUserBy(EOS_EpicAccountId accountId) const
+{
+	if (accountId)
+	{
+		for (auto&& pair : fLocalUserSessions)
+		{
+			if (pair.second->GetEpicAccountId() == accountId)
+			{
+				return pair.second.get();
+			}
+		}
+	}
+	return nullptr;
+}
+
+LocalUserSession* RuntimeContext::GetLocalUserBy(EOS_ProductUserId productUserId) const
+{
+	if (productUserId)
+	{
+		for (auto&& pair : fLocalUserSessions)
+		{
+			if (pair.second->GetProductUserId() == productUserId)
+			{
+				return pair.second.get();
+			}
+		}
+	}
+	return nullptr;
+}
+
+LocalUserSession* RuntimeContext::GetDefaultLocalUser() const
+{
+	if (fLocalUserSessions.empty())
+	{
+		return nullptr;
+	}
+	return fLocalUserSessions.begin()->second.get();
+}
+
+std::vector<LocalUserSession*> RuntimeContext::GetLocalUsers() const
+{
+	std::vector<LocalUserSession*> sessions;
+	sessions.reserve(fLocalUserSessions.size());
+	for (auto&& pair : fLocalUserSessions)
+	{
+		sessions.push_back(pair.second.get());
+	}
+	return sessions;
+}
+
+void RuntimeContext::QueueDispatchEventTask(const std::shared_ptr<BaseDispatchEventTask>& taskPointer)
+{
+	if (taskPointer)
+	{
+		taskPointer->SetLuaEventDispatcher(fLuaEventDispatcherPointer);
+		taskPointer->SetIdCache(fIdCachePointer);
+		fDispatchEventTaskQueue.push(taskPointer);
+	}
+}
+
+void RuntimeContext::QueueLoginStatusChanges()
+{
+	// Collect all sessions whose login state has changed since the last report.
+	std::shared_ptr<DispatchLoginStatusEventTask> taskPointer;
+	for (auto&& pair : fLocalUserSessions)
+	{
+		auto sessionPointer = pair.second.get();
+		auto loginState = sessionPointer->GetLoginState();
+		auto reportedLoginState = sessionPointer->GetReportedLoginState();
+		if (loginState != reportedLoginState)
+		{
+			if (!taskPointer)
+			{
+				taskPointer = std::make_shared<DispatchLoginStatusEventTask>();
+			}
+			taskPointer->AddStatusChange(
+					sessionPointer->GetUserHandle(),
+					LocalUserSession::GetLoginStateName(loginState),
+					LocalUserSession::GetLoginStateName(reportedLoginState));
+			sessionPointer->SetReportedLoginState(loginState);
+		}
+	}
+
+	// Queue 1 event for all of the above changes.
+	if (taskPointer)
+	{
+		auto defaultSessionPointer = GetDefaultLocalUser();
+		if (defaultSessionPointer)
+		{
+			taskPointer->SetDefaultStatus(LocalUserSession::GetLoginStateName(defaultSessionPointer->GetLoginState()));
+		}
+		QueueDispatchEventTask(taskPointer);
+	}
+}
+
+void EOS_CALL RuntimeContext::OnAuthLoginStatusChangedCallback(const EOS_Auth_LoginStatusChangedCallbackInfo* data)
+{
+	// Validate.
+	if (!data)
+	{
+		return;
+	}
+	auto contextPointer = (RuntimeContext*)data->ClientData;
+	if (sRuntimeContextCollection.find(contextPointer) == sRuntimeContextCollection.end())
+	{
+		return;
+	}
+
+	// Update the local user's session. Its ID token is no longer valid for its new login status.
+	auto sessionPointer = contextPointer->GetLocalUserBy(data->LocalUserId);
+	if (sessionPointer)
+	{
+		sessionPointer->SetAuthLoginStatus(data->CurrentStatus);
+	}
+}
+
+void EOS_CALL RuntimeContext::OnConnectLoginStatusChangedCallback(
+	const EOS_Connect_LoginStatusChangedCallbackInfo* data)
+{
+	// Validate.
+	if (!data)
+	{
+		return;
+	}
+	auto contextPointer = (RuntimeContext*)data->ClientData;
+	if (sRuntimeContextCollection.find(contextPointer) == sRuntimeContextCollection.end())
+	{
+		return;
+	}
+
+	// Update the local user's session, such as when its Connect login has expired without being refreshed.
+	auto sessionPointer = contextPointer->GetLocalUserBy(data->LocalUserId);
+	if (sessionPointer)
+	{
+		sessionPointer->SetConnectLoginStatus(data->CurrentStatus);
+	}
+}
+
+void EOS_CALL RuntimeContext::OnConnectAuthExpirationCallback(const EOS_Connect_AuthExpirationCallbackInfo* data)
+{
+	// Validate.
+	if (!data)
+	{
+		return;
+	}
+	auto contextPointer = (RuntimeContext*)data->ClientData;
+	if (sRuntimeContextCollection.find(contextPointer) == sRuntimeContextCollection.end())
+	{
+		return;
+	}
+
+	// Have the local user's session refresh its Connect login.
+	auto sessionPointer = contextPointer->GetLocalUserBy(data->LocalUserId);
+	if (sessionPointer)
+	{
+		sessionPointer->OnConnectAuthExpiring();
+	}
+}
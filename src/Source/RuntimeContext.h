@@ -11,10 +11,14 @@
 
 #include "BaseEosCallResultHandler.h"
 #include "DispatchEventTask.h"
+#include "EcomStore.h"
 #include "LuaEventDispatcher.h"
 #include "LuaMethodCallback.h"
 #include "EosCallResultHandler.h"
+#include "LocalUserSession.h"
+#include "P2PManager.h"
 #include <functional>
+#include <map>
 #include <memory>
 #include <queue>
 #include <type_traits>
@@ -122,6 +126,25 @@ class RuntimeContext
 		 */
 		std::shared_ptr<LuaEventDispatcher> GetLuaEventDispatcher() const;
 
+		/**
+		  Gets the cache used to convert EOS user ID handles to Lua strings and back.
+		  Assigned to all event tasks queued by this context so that recurring IDs are only formatted once.
+		  @return Returns a pointer to this context's ID cache. Never returns null.
+		 */
+		std::shared_ptr<EosIdCache> GetIdCache() const;
+
+		/**
+		  Gets the in-app store used by the plugin's loadProducts(), purchase(), and restore() Lua functions.
+		  @return Returns a pointer to this context's store. Never returns null.
+		 */
+		EcomStore* GetEcomStore() const;
+
+		/**
+		  Gets the P2P manager used by the plugin's "p2p" Lua functions to send and receive packets.
+		  @return Returns a pointer to this context's P2P manager. Never returns null.
+		 */
+		P2PManager* GetP2PManager() const;
+
 
 		/** Handle for Auth interface */
 		EOS_HAuth fAuthHandle;
@@ -129,9 +152,8 @@ class RuntimeContext
 		/** Handle for Platform interface*/
 		EOS_PlatformHandle* fPlatformHandle;
 
-		/** Handle for logged in account*/
-		EOS_EpicAccountId fAccountId;
-
+		/** Handle for Connect interface */
+		EOS_HConnect fConnectHandle;
 
 
 
@@ -169,8 +191,67 @@ class RuntimeContext
 		 */
 		static int GetInstanceCount();
 
-		/** Set up global Steam event handlers via their macros. */
-		void OnLoginResponse(const EOS_Auth_LoginCallbackInfo* Data);
+		/**
+		  Creates a new session for a local user that has not logged in yet.
+		  The caller is expected to log it in via its Login() method.
+		  @return Returns a pointer to the new session, owned by this context.
+
+		          Returns null if the EOS platform has not been created.
+		 */
+		LocalUserSession* CreateLocalUser();
+
+		/**
+		  Creates a new session for a simulated local user that never logs into EOS, such as to exchange packets
+		  with other simulated users via a LoopbackP2PTransport. Does not require the EOS platform.
+		  The session is kept until removed via RemoveLocalUser().
+		  @param productUserId The product user to assign to the session.
+		  @return Returns a pointer to the new session, owned by this context. Returns null if given a null ID.
+		 */
+		LocalUserSession* CreateSimulatedLocalUser(EOS_ProductUserId productUserId);
+
+		/**
+		  Deletes the given local user's session. Does not log it out of EOS.
+		  @param userHandle Handle of the session to delete.
+		 */
+		void RemoveLocalUser(int userHandle);
+
+		/**
+		  Fetches a local user's session by its Lua user handle.
+		  @param userHandle Handle returned by the session's GetUserHandle() method.
+		  @return Returns the session. Returns null if not found.
+		 */
+		LocalUserSession* GetLocalUserBy(int userHandle) const;
+
+		/**
+		  Fetches a local user's session by its Epic account.
+		  @param accountId The Epic account to search for. Can be null.
+		  @return Returns the session. Returns null if not found.
+		 */
+		LocalUserSession* GetLocalUserBy(EOS_EpicAccountId accountId) const;
+
+		/**
+		  Fetches a local user's session by its Connect product user.
+		  @param productUserId The product user to search for. Can be null.
+		  @return Returns the session. Returns null if not found.
+		 */
+		LocalUserSession* GetLocalUserBy(EOS_ProductUserId productUserId) const;
+
+		/**
+		  Fetches the default local user's session, which is the oldest session still active.
+		  Used by Lua APIs that are not given a user handle.
+		  @return Returns the session. Returns null if there are no local users.
+		 */
+		LocalUserSession* GetDefaultLocalUser() const;
+
+		/** Gets all local user sessions, ordered by user handle. */
+		std::vector<LocalUserSession*> GetLocalUsers() const;
+
+		/**
+		  Queues the given task to be dispatched to Lua on the next "enterFrame" via this context's
+		  main event dispatcher, and only while the Corona runtime is running (ie: not suspended).
+		  @param taskPointer The task to queue. Null is ignored.
+		 */
+		void QueueDispatchEventTask(const std::shared_ptr<BaseDispatchEventTask>& taskPointer);
 
 	private:
 		/** Copy constructor deleted to prevent it from being called. */
@@ -186,6 +267,22 @@ class RuntimeContext
 		 */
 		int OnCoronaEnterFrame(lua_State* luatStatePointer);
 
+		/** Called by EOS when a local user's Auth login status changes. Updates the user's session. */
+		static void EOS_CALL OnAuthLoginStatusChangedCallback(const EOS_Auth_LoginStatusChangedCallbackInfo* data);
+
+		/**
+		  Compares every local user's login state with the state last reported to Lua and, if any have changed,
+		  queues a single "loginStatus" event listing all of the changes.
+		  Expected to be called once per frame so that changes are coalesced into one event.
+		 */
+		void QueueLoginStatusChanges();
+
+		/** Called by EOS when a local user's Connect login status changes. Updates the user's session. */
+		static void EOS_CALL OnConnectLoginStatusChangedCallback(const EOS_Connect_LoginStatusChangedCallbackInfo* data);
+
+		/** Called by EOS when a local user's Connect login is about to expire. Schedules a session refresh. */
+		static void EOS_CALL OnConnectAuthExpirationCallback(const EOS_Connect_AuthExpirationCallbackInfo* data);
+
 		template<class TSteamResultType, class TDispatchEventTask>
 		/**
 		  To be called by this class' global EOS event handler methods.
@@ -223,6 +320,15 @@ class RuntimeContext
 		 */
 		std::shared_ptr<LuaEventDispatcher> fLuaEventDispatcherPointer;
 
+		/** Cache of EOS user ID strings shared with all queued event tasks. */
+		std::shared_ptr<EosIdCache> fIdCachePointer;
+
+		/** The in-app store, which caches the offer catalog between Lua requests. */
+		std::unique_ptr<EcomStore> fEcomStorePointer;
+
+		/** Sends and receives P2P packets on behalf of the local users. */
+		std::unique_ptr<P2PManager> fP2PManagerPointer;
+
 		/** Lua "enterFrame" listener. */
 		LuaMethodCallback<RuntimeContext> fLuaEnterFrameCallback;
 
@@ -239,6 +345,21 @@ class RuntimeContext
 		 */
 		std::vector<BaseEosCallResultHandler*> fEosCallResultHandlerPool;
 
+		/** Sessions of all local users logged in or logging in, keyed by user handle. */
+		std::map<int, std::unique_ptr<LocalUserSession>> fLocalUserSessions;
+
+		/** User handle to be assigned to the next session created by CreateLocalUser(). Never re-used. */
+		int fNextLocalUserHandle;
+
+		/** Notification ID returned by EOS_Auth_AddNotifyLoginStatusChanged(). */
+		EOS_NotificationId fAuthLoginStatusNotificationId;
+
+		/** Notification ID returned by EOS_Connect_AddNotifyLoginStatusChanged(). */
+		EOS_NotificationId fConnectLoginStatusNotificationId;
+
+		/** Notification ID returned by EOS_Connect_AddNotifyAuthExpiration(). */
+		EOS_NotificationId fConnectAuthExpirationNotificationId;
+
 		/** set of auth ID tokens to be destroyed **/
 //		std::set<EOS_Auth_IdToken> fAuthIdTokens;
 
@@ -0,0 +1,631 @@
+// ----------------------------------------------------------------------------
+//
+// SnapshotReplicator.cpp
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#include "SnapshotReplicator.h"
+#include "P2PWireFormat.h"
+#include <cmath>
+#include <cstring>
+extern "C"
+{
+#	include "lua.h"
+#	include "lauxlib.h"
+}
+
+
+//---------------------------------------------------------------------------------
+// Private Constants
+//---------------------------------------------------------------------------------
+
+/** Max number of snapshots remembered per stream, which peers can send deltas against or acknowledge. */
+static const size_t kMaxHistoryCount = 32;
+
+/** Quantized values are clamped to this magnitude, the largest integer a double can represent exactly. */
+static const double kMaxExactInteger = 9007199254740992.0;
+
+/** Largest entity ID that can be replicated. */
+static const double kMaxEntityId = 4294967295.0;
+
+
+//---------------------------------------------------------------------------------
+// Private Static Functions
+//---------------------------------------------------------------------------------
+
+/** Provides the state of a call to SnapshotReplicator::ReadDeltaFrom() or ReadAckFrom(). */
+struct SnapshotReadState
+{
+	/** The bytes being read. */
+	const uint8_t* Bytes;
+
+	/** Number of bytes being read. */
+	uint32_t ByteCount;
+
+	/** Offset of the next byte to read. */
+	uint32_t Offset;
+};
+
+/** Reads a variable length integer via P2PWireFormat, advancing the given read state's offset past it. */
+static bool ReadVarUIntFrom(SnapshotReadState& state, uint64_t& value)
+{
+	return P2PWireFormat::ReadVarUIntFrom(state.Bytes, state.ByteCount, state.Offset, value);
+}
+
+/** Reads a variable length integer via P2PWireFormat, failing if it does not fit in 32 bits. */
+static bool ReadVarUInt32From(SnapshotReadState& state, uint32_t& value)
+{
+	return P2PWireFormat::ReadVarUInt32From(state.Bytes, state.ByteCount, state.Offset, value);
+}
+
+/** Rounds the given number to the nearest integer, clamped to the range a double can represent exactly. */
+static int64_t QuantizeNumber(double value)
+{
+	if (std::isnan(value))
+	{
+		return 0;
+	}
+	value = std::round(value);
+	if (value > kMaxExactInteger)
+	{
+		value = kMaxExactInteger;
+	}
+	else if (value < -kMaxExactInteger)
+	{
+		value = -kMaxExactInteger;
+	}
+	return (int64_t)value;
+}
+
+/**
+  Quantizes the Lua value at the top of the stack to the given field's type.
+  @param luaStatePointer The Lua state the value belongs to.
+  @param field The field the value is assigned to.
+  @param fieldValue Assigned the quantized value. Nil and mismatched types are quantized as zero or empty.
+ */
+static void CaptureFieldValueFrom(
+	lua_State* luaStatePointer, const SnapshotReplicator::Field& field, SnapshotReplicator::FieldValue& fieldValue)
+{
+	fieldValue.Number = 0;
+	fieldValue.Text.clear();
+	switch (field.Type)
+	{
+		case SnapshotReplicator::FieldType::kBoolean:
+			fieldValue.Number = lua_toboolean(luaStatePointer, -1) ? 1 : 0;
+			break;
+		case SnapshotReplicator::FieldType::kInteger:
+			fieldValue.Number = QuantizeNumber(lua_tonumber(luaStatePointer, -1));
+			break;
+		case SnapshotReplicator::FieldType::kNumber:
+			if (field.Precision > 0)
+			{
+				fieldValue.Number = QuantizeNumber(lua_tonumber(luaStatePointer, -1) / field.Precision);
+			}
+			else
+			{
+				double value = lua_tonumber(luaStatePointer, -1);
+				memcpy(&fieldValue.Number, &value, sizeof(value));
+			}
+			break;
+		case SnapshotReplicator::FieldType::kString:
+			if (lua_type(luaStatePointer, -1) == LUA_TSTRING)
+			{
+				size_t length = 0;
+				auto text = lua_tolstring(luaStatePointer, -1, &length);
+				fieldValue.Text.assign(text, length);
+			}
+			break;
+	}
+}
+
+/** Pushes the given quantized field value to the top of the Lua stack, converted back to a Lua value. */
+static void PushFieldValueTo(
+	lua_State* luaStatePointer, const SnapshotReplicator::Field& field, const SnapshotReplicator::FieldValue& fieldValue)
+{
+	switch (field.Type)
+	{
+		case SnapshotReplicator::FieldType::kBoolean:
+			lua_pushboolean(luaStatePointer, fieldValue.Number ? 1 : 0);
+			break;
+		case SnapshotReplicator::FieldType::kInteger:
+			lua_pushnumber(luaStatePointer, (lua_Number)fieldValue.Number);
+			break;
+		case SnapshotReplicator::FieldType::kNumber:
+			if (field.Precision > 0)
+			{
+				lua_pushnumber(luaStatePointer, (lua_Number)((double)fieldValue.Number * field.Precision));
+			}
+			else
+			{
+				double value = 0;
+				memcpy(&value, &fieldValue.Number, sizeof(value));
+				lua_pushnumber(luaStatePointer, (lua_Number)value);
+			}
+			break;
+		case SnapshotReplicator::FieldType::kString:
+			lua_pushlstring(luaStatePointer, fieldValue.Text.c_str(), fieldValue.Text.length());
+			break;
+		default:
+			lua_pushnil(luaStatePointer);
+			break;
+	}
+}
+
+/**
+  Appends the given field value to the given bytes.
+  Booleans take 1 byte. Integers and quantized numbers are zigzag encoded variable length integers, so that
+  small negative values stay small. Unquantized numbers take 8 bytes. Strings are prefixed with their length.
+ */
+static void WriteFieldValueTo(
+	std::vector<uint8_t>& bytes, const SnapshotReplicator::Field& field, const SnapshotReplicator::FieldValue& fieldValue)
+{
+	bool isRawNumber = (field.Type == SnapshotReplicator::FieldType::kNumber) && !(field.Precision > 0);
+	if (field.Type == SnapshotReplicator::FieldType::kBoolean)
+	{
+		bytes.push_back(fieldValue.Number ? 1 : 0);
+	}
+	else if (field.Type == SnapshotReplicator::FieldType::kString)
+	{
+		P2PWireFormat::WriteVarUIntTo(bytes, fieldValue.Text.length());
+		bytes.insert(bytes.end(), fieldValue.Text.begin(), fieldValue.Text.end());
+	}
+	else if (isRawNumber)
+	{
+		auto bits = (uint64_t)fieldValue.Number;
+		for (int index = 0; index < 8; index++)
+		{
+			bytes.push_back((uint8_t)(bits >> (index * 8)));
+		}
+	}
+	else
+	{
+		auto value = (uint64_t)fieldValue.Number;
+		P2PWireFormat::WriteVarUIntTo(bytes, (value << 1) ^ (uint64_t)(fieldValue.Number >> 63));
+	}
+}
+
+/**
+  Reads a field value written by WriteFieldValueTo().
+  @param state The read state to read from.
+  @param field The field the value belongs to.
+  @param fieldValue Assigned the value read.
+  @return Returns true if the value was read. Returns false if the bytes are malformed.
+ */
+static bool ReadFieldValueFrom(
+	SnapshotReadState& state, const SnapshotReplicator::Field& field, SnapshotReplicator::FieldValue& fieldValue)
+{
+	bool isRawNumber = (field.Type == SnapshotReplicator::FieldType::kNumber) && !(field.Precision > 0);
+	if (field.Type == SnapshotReplicator::FieldType::kBoolean)
+	{
+		if (state.Offset >= state.ByteCount)
+		{
+			return false;
+		}
+		fieldValue.Number = state.Bytes[state.Offset++] ? 1 : 0;
+	}
+	else if (field.Type == SnapshotReplicator::FieldType::kString)
+	{
+		uint32_t length = 0;
+		if (!ReadVarUInt32From(state, length) || (length > (state.ByteCount - state.Offset)))
+		{
+			return false;
+		}
+		fieldValue.Text.assign((const char*)state.Bytes + state.Offset, length);
+		state.Offset += length;
+	}
+	else if (isRawNumber)
+	{
+		if ((state.ByteCount - state.Offset) < 8)
+		{
+			return false;
+		}
+		uint64_t bits = 0;
+		for (int index = 0; index < 8; index++)
+		{
+			bits |= (uint64_t)state.Bytes[state.Offset++] << (index * 8);
+		}
+		fieldValue.Number = (int64_t)bits;
+	}
+	else
+	{
+		uint64_t value = 0;
+		if (!ReadVarUIntFrom(state, value))
+		{
+			return false;
+		}
+		fieldValue.Number = (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+	}
+	return true;
+}
+
+/** Determines if the given quantized field values are equal. */
+static bool AreFieldValuesEqual(const SnapshotReplicator::FieldValue& x, const SnapshotReplicator::FieldValue& y)
+{
+	return (x.Number == y.Number) && (x.Text == y.Text);
+}
+
+
+//---------------------------------------------------------------------------------
+// SnapshotReplicator Class Members
+//---------------------------------------------------------------------------------
+
+SnapshotReplicator::SnapshotReplicator()
+{
+}
+
+SnapshotReplicator::~SnapshotReplicator()
+{
+}
+
+void SnapshotReplicator::RegisterSchema(const std::shared_ptr<const Schema>& schemaPointer)
+{
+	// Validate.
+	if (!schemaPointer)
+	{
+		return;
+	}
+
+	// Drop all snapshots using the schema being replaced, since their fields no longer match.
+	auto schemaId = schemaPointer->Id;
+	for (auto iterator = fOutboundStreams.begin(); iterator != fOutboundStreams.end();)
+	{
+		iterator = (std::get<1>(iterator->first) == schemaId) ? fOutboundStreams.erase(iterator) : std::next(iterator);
+	}
+	for (auto iterator = fInboundStreams.begin(); iterator != fInboundStreams.end();)
+	{
+		iterator = (std::get<2>(iterator->first) == schemaId) ? fInboundStreams.erase(iterator) : std::next(iterator);
+	}
+
+	// Add the schema.
+	fSchemas[schemaId] = schemaPointer;
+}
+
+std::shared_ptr<const SnapshotReplicator::Schema> SnapshotReplicator::GetSchemaBy(uint8_t schemaId) const
+{
+	auto iterator = fSchemas.find(schemaId);
+	if (iterator == fSchemas.end())
+	{
+		return nullptr;
+	}
+	return iterator->second;
+}
+
+std::shared_ptr<const SnapshotReplicator::Snapshot> SnapshotReplicator::AddOutboundSnapshot(
+	EOS_ProductUserId localUserId, uint8_t schemaId, EntityMap&& entities)
+{
+	// Validate.
+	if (fSchemas.find(schemaId) == fSchemas.end())
+	{
+		return nullptr;
+	}
+
+	// Number the snapshot and remember it until peers are unlikely to acknowledge it anymore.
+	auto& stream = fOutboundStreams[OutboundStreamKey(localUserId, schemaId)];
+	auto snapshotPointer = std::make_shared<Snapshot>();
+	snapshotPointer->Sequence = ++stream.LastSequence;
+	snapshotPointer->Entities = std::move(entities);
+	stream.History.push_back(snapshotPointer);
+	if (stream.History.size() > kMaxHistoryCount)
+	{
+		stream.History.pop_front();
+	}
+	return snapshotPointer;
+}
+
+void SnapshotReplicator::WriteDeltaTo(
+	std::vector<uint8_t>& bytes, EOS_ProductUserId localUserId, EOS_ProductUserId peerId,
+	const Schema& schema, const Snapshot& snapshot) const
+{
+	// Find the newest snapshot the peer acknowledged, if still remembered. Otherwise, send the full snapshot.
+	const Snapshot* baselinePointer = nullptr;
+	auto streamIterator = fOutboundStreams.find(OutboundStreamKey(localUserId, schema.Id));
+	if (streamIterator != fOutboundStreams.end())
+	{
+		auto& stream = streamIterator->second;
+		auto ackIterator = stream.AckedSequences.find(peerId);
+		if (ackIterator != stream.AckedSequences.end())
+		{
+			for (auto&& historyPointer : stream.History)
+			{
+				if (historyPointer->Sequence == ackIterator->second)
+				{
+					baselinePointer = historyPointer.get();
+					break;
+				}
+			}
+		}
+	}
+	WriteSnapshotTo(bytes, schema, snapshot, baselinePointer);
+}
+
+void SnapshotReplicator::WriteFullTo(std::vector<uint8_t>& bytes, const Schema& schema, const Snapshot& snapshot)
+{
+	WriteSnapshotTo(bytes, schema, snapshot, nullptr);
+}
+
+void SnapshotReplicator::WriteSnapshotTo(
+	std::vector<uint8_t>& bytes, const Schema& schema, const Snapshot& snapshot, const Snapshot* baselinePointer)
+{
+	EntityMap emptyEntities;
+	auto& baselineEntities = baselinePointer ? baselinePointer->Entities : emptyEntities;
+
+	// Write the delta's header.
+	bytes.push_back(schema.Id);
+	P2PWireFormat::WriteVarUIntTo(bytes, snapshot.Sequence);
+	P2PWireFormat::WriteVarUIntTo(bytes, baselinePointer ? baselinePointer->Sequence : 0);
+
+	// Walk both snapshots' entities in ID order, writing each added, changed, or removed entity until the end.
+	// Each entry starts with the entity's ID shifted left by 1, with the low bit flagging a removed entity.
+	// Other entries are followed by a bitmask of the fields that changed and then the changed fields' values.
+	size_t fieldCount = schema.Fields.size();
+	size_t maskByteCount = (fieldCount + 7) / 8;
+	auto currentIterator = snapshot.Entities.begin();
+	auto baselineIterator = baselineEntities.begin();
+	while ((currentIterator != snapshot.Entities.end()) || (baselineIterator != baselineEntities.end()))
+	{
+		// Write an entity missing from the current snapshot as removed.
+		bool isRemoved =
+				(currentIterator == snapshot.Entities.end()) ||
+				((baselineIterator != baselineEntities.end()) && (baselineIterator->first < currentIterator->first));
+		if (isRemoved)
+		{
+			P2PWireFormat::WriteVarUIntTo(bytes, ((uint64_t)baselineIterator->first << 1) | 1);
+			baselineIterator++;
+			continue;
+		}
+
+		// Fetch the entity's values in the baseline snapshot. Entities added since then have all fields written.
+		const std::vector<FieldValue>* baselineValuesPointer = nullptr;
+		bool hasBaseline =
+				(baselineIterator != baselineEntities.end()) && (baselineIterator->first == currentIterator->first);
+		if (hasBaseline)
+		{
+			baselineValuesPointer = &baselineIterator->second;
+			baselineIterator++;
+		}
+
+		// Write the entity's changed fields, if any.
+		size_t entryOffset = bytes.size();
+		P2PWireFormat::WriteVarUIntTo(bytes, (uint64_t)currentIterator->first << 1);
+		size_t maskOffset = bytes.size();
+		bytes.resize(maskOffset + maskByteCount, 0);
+		bool hasChanges = false;
+		auto& values = currentIterator->second;
+		for (size_t index = 0; (index < fieldCount) && (index < values.size()); index++)
+		{
+			bool isChanged =
+					!baselineValuesPointer || (index >= baselineValuesPointer->size()) ||
+					!AreFieldValuesEqual(values[index], (*baselineValuesPointer)[index]);
+			if (isChanged)
+			{
+				bytes[maskOffset + (index / 8)] |= (uint8_t)(1 << (index % 8));
+				WriteFieldValueTo(bytes, schema.Fields[index], values[index]);
+				hasChanges = true;
+			}
+		}
+		if (!hasChanges && baselineValuesPointer)
+		{
+			bytes.resize(entryOffset);
+		}
+		currentIterator++;
+	}
+}
+
+std::shared_ptr<const SnapshotReplicator::Snapshot> SnapshotReplicator::ReadDeltaFrom(
+	EOS_ProductUserId localUserId, EOS_ProductUserId peerId, const uint8_t* bytes, uint32_t byteCount,
+	std::shared_ptr<const Schema>& schemaPointer)
+{
+	// Validate.
+	if (!bytes || (byteCount < 1))
+	{
+		return nullptr;
+	}
+
+	// Read the delta's header.
+	SnapshotReadState state;
+	state.Bytes = bytes;
+	state.ByteCount = byteCount;
+	state.Offset = 1;
+	schemaPointer = GetSchemaBy(bytes[0]);
+	uint32_t sequence = 0;
+	uint32_t baselineSequence = 0;
+	if (!schemaPointer || !ReadVarUInt32From(state, sequence) || !ReadVarUInt32From(state, baselineSequence))
+	{
+		return nullptr;
+	}
+	if ((sequence == 0) || (baselineSequence >= sequence))
+	{
+		return nullptr;
+	}
+
+	// Ignore snapshots older than the newest one received, since unreliable packets can arrive out of order.
+	auto& stream = fInboundStreams[InboundStreamKey(localUserId, peerId, schemaPointer->Id)];
+	if (!stream.History.empty() && (sequence <= stream.History.back()->Sequence))
+	{
+		return nullptr;
+	}
+
+	// Start from a copy of the snapshot the delta is relative to, if any.
+	auto snapshotPointer = std::make_shared<Snapshot>();
+	snapshotPointer->Sequence = sequence;
+	if (baselineSequence > 0)
+	{
+		bool wasFound = false;
+		for (auto&& historyPointer : stream.History)
+		{
+			if (historyPointer->Sequence == baselineSequence)
+			{
+				snapshotPointer->Entities = historyPointer->Entities;
+				wasFound = true;
+				break;
+			}
+		}
+		if (!wasFound)
+		{
+			return nullptr;
+		}
+	}
+
+	// Apply the delta's entries.
+	size_t fieldCount = schemaPointer->Fields.size();
+	uint32_t maskByteCount = (uint32_t)((fieldCount + 7) / 8);
+	while (state.Offset < state.ByteCount)
+	{
+		uint64_t key = 0;
+		if (!ReadVarUIntFrom(state, key) || ((key >> 1) > UINT32_MAX))
+		{
+			return nullptr;
+		}
+		auto entityId = (uint32_t)(key >> 1);
+		if (key & 1)
+		{
+			snapshotPointer->Entities.erase(entityId);
+			continue;
+		}
+		if ((state.ByteCount - state.Offset) < maskByteCount)
+		{
+			return nullptr;
+		}
+		auto maskBytes = state.Bytes + state.Offset;
+		state.Offset += maskByteCount;
+		auto& values = snapshotPointer->Entities[entityId];
+		values.resize(fieldCount);
+		for (size_t index = 0; index < fieldCount; index++)
+		{
+			bool isChanged = (maskBytes[index / 8] & (1 << (index % 8))) != 0;
+			if (isChanged && !ReadFieldValueFrom(state, schemaPointer->Fields[index], values[index]))
+			{
+				return nullptr;
+			}
+		}
+	}
+
+	// Remember the snapshot so that the peer can send deltas against it once it receives our acknowledgement.
+	stream.History.push_back(snapshotPointer);
+	if (stream.History.size() > kMaxHistoryCount)
+	{
+		stream.History.pop_front();
+	}
+	return snapshotPointer;
+}
+
+void SnapshotReplicator::WriteAckTo(std::vector<uint8_t>& bytes, uint8_t schemaId, uint32_t sequence)
+{
+	bytes.push_back(schemaId);
+	P2PWireFormat::WriteVarUIntTo(bytes, sequence);
+}
+
+void SnapshotReplicator::ReadAckFrom(
+	EOS_ProductUserId localUserId, EOS_ProductUserId peerId, const uint8_t* bytes, uint32_t byteCount)
+{
+	// Validate.
+	if (!bytes || (byteCount < 1))
+	{
+		return;
+	}
+
+	// Read the acknowledgement.
+	SnapshotReadState state;
+	state.Bytes = bytes;
+	state.ByteCount = byteCount;
+	state.Offset = 1;
+	uint32_t sequence = 0;
+	if (!ReadVarUInt32From(state, sequence))
+	{
+		return;
+	}
+
+	// Keep the newest acknowledged snapshot. Acknowledgements are unreliable and can arrive out of order.
+	auto streamIterator = fOutboundStreams.find(OutboundStreamKey(localUserId, bytes[0]));
+	if ((streamIterator == fOutboundStreams.end()) || (sequence > streamIterator->second.LastSequence))
+	{
+		return;
+	}
+	auto& ackedSequence = streamIterator->second.AckedSequences[peerId];
+	if (sequence > ackedSequence)
+	{
+		ackedSequence = sequence;
+	}
+}
+
+void SnapshotReplicator::ClearStreams()
+{
+	fOutboundStreams.clear();
+	fInboundStreams.clear();
+}
+
+bool SnapshotReplicator::CaptureEntitiesFrom(
+	lua_State* luaStatePointer, int luaIndex, const Schema& schema, EntityMap& entities, std::string& errorMessage)
+{
+	// Validate.
+	entities.clear();
+	if (!luaStatePointer)
+	{
+		return false;
+	}
+	if (luaIndex < 0)
+	{
+		luaIndex = lua_gettop(luaStatePointer) + luaIndex + 1;
+	}
+	if (lua_type(luaStatePointer, luaIndex) != LUA_TTABLE)
+	{
+		errorMessage = "Entities must be a table.";
+		return false;
+	}
+
+	// Quantize every entity's fields.
+	lua_pushnil(luaStatePointer);
+	while (lua_next(luaStatePointer, luaIndex) != 0)
+	{
+		double entityId = (lua_type(luaStatePointer, -2) == LUA_TNUMBER) ? lua_tonumber(luaStatePointer, -2) : -1.0;
+		bool isValidId = (entityId >= 0) && (entityId <= kMaxEntityId) && (std::floor(entityId) == entityId);
+		if (!isValidId)
+		{
+			lua_pop(luaStatePointer, 2);
+			errorMessage = "Entity IDs must be non-negative integers.";
+			return false;
+		}
+		if (lua_type(luaStatePointer, -1) != LUA_TTABLE)
+		{
+			lua_pop(luaStatePointer, 2);
+			errorMessage = "Entities must be tables.";
+			return false;
+		}
+		auto& values = entities[(uint32_t)entityId];
+		values.resize(schema.Fields.size());
+		for (size_t index = 0; index < schema.Fields.size(); index++)
+		{
+			lua_getfield(luaStatePointer, -1, schema.Fields[index].Name.c_str());
+			CaptureFieldValueFrom(luaStatePointer, schema.Fields[index], values[index]);
+			lua_pop(luaStatePointer, 1);
+		}
+		lua_pop(luaStatePointer, 1);
+	}
+	return true;
+}
+
+void SnapshotReplicator::PushEntitiesTo(lua_State* luaStatePointer, const Schema& schema, const EntityMap& entities)
+{
+	// Validate.
+	if (!luaStatePointer)
+	{
+		return;
+	}
+
+	// Push a table of entity tables keyed by entity ID.
+	lua_createtable(luaStatePointer, 0, (int)entities.size());
+	for (auto&& pair : entities)
+	{
+		lua_pushnumber(luaStatePointer, (lua_Number)pair.first);
+		lua_createtable(luaStatePointer, 0, (int)schema.Fields.size());
+		for (size_t index = 0; (index < schema.Fields.size()) && (index < pair.second.size()); index++)
+		{
+			PushFieldValueTo(luaStatePointer, schema.Fields[index], pair.second[index]);
+			lua_setfield(luaStatePointer, -2, schema.Fields[index].Name.c_str());
+		}
+		lua_rawset(luaStatePointer, -3);
+	}
+}
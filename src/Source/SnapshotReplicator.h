@@ -0,0 +1,274 @@
+// ----------------------------------------------------------------------------
+//
+// SnapshotReplicator.h
+// Copyright (c) 2016 Corona Labs Inc. All rights reserved.
+// This software may be modified and distributed under the terms
+// of the MIT license.  See the LICENSE file for details.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include "eos_common.h"
+
+
+// Forward declarations.
+extern "C"
+{
+	struct lua_State;
+}
+
+
+/**
+  Replicates snapshots of game state between peers, sending only what changed since the last snapshot
+  each peer acknowledged receiving.
+
+  A snapshot is a set of entities keyed by integer ID, each having the fields described by a schema that Lua
+  registers ahead of time on every peer. Field values are quantized to integers when captured from Lua, so that
+  comparing them is exact and sending them takes only a few bytes. Each snapshot is written as a delta against the
+  newest snapshot the receiving peer acknowledged, listing only the entities that changed along with a bitmask of
+  their changed fields, followed by the IDs of the entities that were removed.
+
+  This class only encodes and decodes snapshots. Sending and receiving them is up to the P2PManager class.
+ */
+class SnapshotReplicator
+{
+	public:
+		/** Types of values a schema's fields can hold. */
+		enum class FieldType
+		{
+			/** A Lua boolean. */
+			kBoolean,
+
+			/** A Lua number rounded to the nearest integer. */
+			kInteger,
+
+			/** A Lua number, quantized to the field's precision if it has one. */
+			kNumber,
+
+			/** A Lua string. */
+			kString
+		};
+
+		/** Describes one field of the entities in a snapshot. */
+		struct Field
+		{
+			/** The field's name in the entity's Lua table. */
+			std::string Name;
+
+			/** The type of value the field holds. */
+			FieldType Type;
+
+			/**
+			  Smallest difference between 2 values of a "kNumber" field that needs to be replicated.
+			  Values are sent as integer multiples of it. Set to zero to send the exact value instead.
+			 */
+			double Precision;
+		};
+
+		/** Describes the fields of all entities in a snapshot. */
+		struct Schema
+		{
+			/** ID that Lua assigned to the schema, identifying it to remote peers. */
+			uint8_t Id;
+
+			/** The entity fields, in the order they are replicated in. */
+			std::vector<Field> Fields;
+		};
+
+		/** Quantized value of an entity field. */
+		struct FieldValue
+		{
+			/** The field's value if it is not a string, or the bits of a number field without a precision. */
+			int64_t Number;
+
+			/** The field's value if it is a string. */
+			std::string Text;
+		};
+
+		/** Maps entity IDs to their field values, in schema order. */
+		typedef std::map<uint32_t, std::vector<FieldValue>> EntityMap;
+
+		/** A numbered snapshot of all entities. */
+		struct Snapshot
+		{
+			/** Number assigned by the sending peer. Starts at 1 and increases by 1 per snapshot sent. */
+			uint32_t Sequence;
+
+			/** The snapshot's entities. */
+			EntityMap Entities;
+		};
+
+
+		/** Creates a new replicator without any schemas. */
+		SnapshotReplicator();
+
+		/** Destroys this replicator. */
+		virtual ~SnapshotReplicator();
+
+		/**
+		  Adds the given schema, replacing the schema having the same ID along with all snapshots using it.
+		  @param schemaPointer The schema to add. Cannot be null.
+		 */
+		void RegisterSchema(const std::shared_ptr<const Schema>& schemaPointer);
+
+		/**
+		  Fetches a schema by ID.
+		  @param schemaId The ID assigned to the schema.
+		  @return Returns the schema. Returns null if no schema was registered with the given ID.
+		 */
+		std::shared_ptr<const Schema> GetSchemaBy(uint8_t schemaId) const;
+
+		/**
+		  Adds a new snapshot to be sent by the given local user, assigning it the stream's next sequence number.
+		  @param localUserId The local user sending the snapshot.
+		  @param schemaId ID of the schema the snapshot's entities use.
+		  @param entities The snapshot's entities, captured via CaptureEntitiesFrom().
+		  @return Returns the new snapshot. Returns null if the schema is not registered.
+		 */
+		std::shared_ptr<const Snapshot> AddOutboundSnapshot(
+				EOS_ProductUserId localUserId, uint8_t schemaId, EntityMap&& entities);
+
+		/**
+		  Writes the given snapshot as a delta against the newest snapshot that the given peer acknowledged.
+		  @param bytes The bytes to append the delta to.
+		  @param localUserId The local user sending the snapshot.
+		  @param peerId The peer to send the snapshot to.
+		  @param schema The schema the snapshot's entities use.
+		  @param snapshot A snapshot returned by AddOutboundSnapshot().
+		 */
+		void WriteDeltaTo(
+				std::vector<uint8_t>& bytes, EOS_ProductUserId localUserId, EOS_ProductUserId peerId,
+				const Schema& schema, const Snapshot& snapshot) const;
+
+		/**
+		  Writes the given snapshot in full, regardless of what the peer acknowledged,
+		  in the same format as WriteDeltaTo() so that it is read via ReadDeltaFrom().
+		  @param bytes The bytes to append the snapshot to.
+		  @param schema The schema the snapshot's entities use.
+		  @param snapshot A snapshot returned by AddOutboundSnapshot().
+		 */
+		static void WriteFullTo(std::vector<uint8_t>& bytes, const Schema& schema, const Snapshot& snapshot);
+
+		/**
+		  Reads a delta written by a remote peer's WriteDeltaTo() or WriteFullTo() and rebuilds the full snapshot.
+		  @param localUserId The local user that received the delta.
+		  @param peerId The peer that sent the delta.
+		  @param bytes Pointer to the delta's bytes.
+		  @param byteCount Number of bytes in the delta.
+		  @param schemaPointer Assigned the schema the snapshot uses.
+		  @return Returns the rebuilt snapshot, which is to be acknowledged to the peer.
+
+		          Returns null if the delta is malformed, uses an unregistered schema, is older than the newest
+		          snapshot received from the peer, or is relative to a snapshot that is no longer remembered.
+		 */
+		std::shared_ptr<const Snapshot> ReadDeltaFrom(
+				EOS_ProductUserId localUserId, EOS_ProductUserId peerId, const uint8_t* bytes, uint32_t byteCount,
+				std::shared_ptr<const Schema>& schemaPointer);
+
+		/**
+		  Writes an acknowledgement of the given received snapshot, to be sent back to its sender.
+		  @param bytes The bytes to append the acknowledgement to.
+		  @param schemaId ID of the schema the snapshot uses.
+		  @param sequence The snapshot's sequence number.
+		 */
+		static void WriteAckTo(std::vector<uint8_t>& bytes, uint8_t schemaId, uint32_t sequence);
+
+		/**
+		  Reads an acknowledgement written by a remote peer's WriteAckTo(), so that the next snapshots sent to
+		  the peer are written relative to the acknowledged snapshot.
+		  @param localUserId The local user that received the acknowledgement.
+		  @param peerId The peer that sent the acknowledgement.
+		  @param bytes Pointer to the acknowledgement's bytes.
+		  @param byteCount Number of bytes in the acknowledgement.
+		 */
+		void ReadAckFrom(EOS_ProductUserId localUserId, EOS_ProductUserId peerId, const uint8_t* bytes, uint32_t byteCount);
+
+		/**
+		  Forgets all snapshots sent and received along with their acknowledgements, keeping the registered schemas.
+		  The next snapshot sent to each peer is then a full snapshot.
+		 */
+		void ClearStreams();
+
+		/**
+		  Quantizes the entities in the given Lua table according to the given schema.
+		  @param luaStatePointer The Lua state the table belongs to.
+		  @param luaIndex Index to a table mapping non-negative integer entity IDs to entity tables.
+		  @param schema The schema describing the entities' fields. Missing fields are captured as zero or empty.
+		  @param entities The map to copy the quantized entities to.
+		  @param errorMessage Assigned a description of why the capture failed.
+		  @return Returns true if the entities were captured. Returns false if the table is malformed.
+		 */
+		static bool CaptureEntitiesFrom(
+				lua_State* luaStatePointer, int luaIndex, const Schema& schema, EntityMap& entities,
+				std::string& errorMessage);
+
+		/**
+		  Pushes a table mapping entity IDs to entity tables to the top of the Lua stack.
+		  @param luaStatePointer The Lua state to push the table to.
+		  @param schema The schema describing the entities' fields.
+		  @param entities The entities to push, whose quantized fields are converted back to Lua values.
+		 */
+		static void PushEntitiesTo(lua_State* luaStatePointer, const Schema& schema, const EntityMap& entities);
+
+	private:
+		/** Identifies the snapshots 1 local user sends using 1 schema. */
+		typedef std::tuple<EOS_ProductUserId, uint8_t> OutboundStreamKey;
+
+		/** Identifies the snapshots 1 local user receives from 1 peer using 1 schema. */
+		typedef std::tuple<EOS_ProductUserId, EOS_ProductUserId, uint8_t> InboundStreamKey;
+
+		/** Snapshots sent by 1 local user using 1 schema. */
+		struct OutboundStream
+		{
+			/** Sequence number assigned to the newest snapshot. Zero if none were sent yet. */
+			uint32_t LastSequence;
+
+			/** The most recent snapshots sent, oldest first, which peers may acknowledge. */
+			std::deque<std::shared_ptr<const Snapshot>> History;
+
+			/** The newest snapshot sequence number each peer acknowledged. */
+			std::unordered_map<EOS_ProductUserId, uint32_t> AckedSequences;
+		};
+
+		/** Snapshots received by 1 local user from 1 peer using 1 schema. */
+		struct InboundStream
+		{
+			/** The most recent snapshots received, oldest first, which the peer may send deltas against. */
+			std::deque<std::shared_ptr<const Snapshot>> History;
+		};
+
+		/** Copy constructor deleted to prevent it from being called. */
+		SnapshotReplicator(const SnapshotReplicator&) = delete;
+
+		/** Method deleted to prevent the copy operator from being used. */
+		void operator=(const SnapshotReplicator&) = delete;
+
+		/**
+		  Writes the given snapshot as a delta against the given baseline snapshot.
+		  @param bytes The bytes to append the delta to.
+		  @param schema The schema the snapshot's entities use.
+		  @param snapshot The snapshot to write.
+		  @param baselinePointer The snapshot the delta is relative to. Null writes the full snapshot.
+		 */
+		static void WriteSnapshotTo(
+				std::vector<uint8_t>& bytes, const Schema& schema, const Snapshot& snapshot,
+				const Snapshot* baselinePointer);
+
+		/** Registered schemas keyed by ID. */
+		std::map<uint8_t, std::shared_ptr<const Schema>> fSchemas;
+
+		/** Snapshot streams sent by local users. */
+		std::map<OutboundStreamKey, OutboundStream> fOutboundStreams;
+
+		/** Snapshot streams received from remote peers. */
+		std::map<InboundStreamKey, InboundStream> fInboundStreams;
+};